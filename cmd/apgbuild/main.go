@@ -4,17 +4,34 @@
 // Commands:
 //
 //	build <dir> -o <out.apg>          — create APG package from directory
+//	build --batch <manifest> | <dir>... [-o <outdir>] — build many packages at once
 //	meta [-o metadata.json] [flags]   — generate or edit metadata.json
-//	sums <dir> <output>               — generate CRC32 checksums
+//	sums [-j N] <dir> <output>        — generate SHA-256 checksums
+//	verify [-j N] <sums> [basedir]    — verify files against a sums file
+//	list <pkg.apg>                    — list package members from headers
+//	extract <pkg.apg> [dest] [-j N] [--file <path>] — extract a package or one member
+//	delta <old.apg> <new.apg> -o <out.apgd> — changes between two versions
+//	apply <old.apg|dir> <delta.apgd> [-o <new.apg>] — rebuild a package or update a tree
+//	dict train -o <out.dict> <dir>... — train a zstd dictionary
+//	sonames build|lookup              — SONAME → package repository index
+//	index <repodir> [-o <repo.idx>]   — binary index of a repository's metadata
+//	serve [--socket <path>] [-j N]    — run build, list, verify, index and meta for clients
 package main
 
 import (
+	"encoding/json"
 	"flag"
 	"fmt"
 	"os"
+	"path/filepath"
+	"strconv"
+	"time"
 
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
 	"github.com/NurOS-Linux/apgbuild/internal/builder"
 	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+	"github.com/NurOS-Linux/apgbuild/internal/delta"
+	"github.com/NurOS-Linux/apgbuild/internal/elfanalyzer"
 	"github.com/NurOS-Linux/apgbuild/internal/metadata"
 )
 
@@ -24,14 +41,40 @@ func main() {
 		os.Exit(1)
 	}
 
+	if ok, err := runServed(os.Args[1:]); ok {
+		if err != nil {
+			fmt.Fprintf(os.Stderr, "error: %v\n", err)
+			os.Exit(1)
+		}
+		return
+	}
+
 	var err error
 	switch os.Args[1] {
+	case "serve":
+		err = cmdServe(os.Args[2:])
 	case "build":
-		err = cmdBuild(os.Args[2:])
+		err = cmdBuild(local, os.Args[2:])
 	case "meta":
-		err = cmdMeta(os.Args[2:])
+		err = cmdMeta(local, os.Args[2:])
 	case "sums":
 		err = cmdSums(os.Args[2:])
+	case "verify":
+		err = cmdVerify(local, os.Args[2:])
+	case "list":
+		err = cmdList(local, os.Args[2:])
+	case "extract":
+		err = cmdExtract(os.Args[2:])
+	case "delta":
+		err = cmdDelta(os.Args[2:])
+	case "apply":
+		err = cmdApply(os.Args[2:])
+	case "dict":
+		err = cmdDict(os.Args[2:])
+	case "sonames":
+		err = cmdSonames(os.Args[2:])
+	case "index":
+		err = cmdIndex(local, os.Args[2:])
 	default:
 		fmt.Fprintf(os.Stderr, "unknown command: %s\n", os.Args[1])
 		usage()
@@ -48,61 +91,560 @@ func usage() {
 	fmt.Fprintln(os.Stderr, `apgbuild — APG package builder
 
 Commands:
-  build <dir> -o <out.apg>
+  build <dir> -o <out.apg|-> [--compression zstd|auto] [--level N] [--budget D] [--single-pass] [-j N] [--threads N|auto] [--seekable] [--frame-size N] [--dedup] [--blob-store <dir>] [--order group|path] [--reproducible] [--dict <file>] [--hash sha256|sha256-tree] [--max-files N] [--max-file-size N] [--max-size N] [--no-cache] [--stats[=json]] [-q]
+  build --batch <manifest.json> | <dir> <dir>... [-o <outdir>] [-j N] [build options]
   meta [-o metadata.json] [--split libs|bins|dev --base-name <name> --version <ver> --arch <arch>] [--detect-deps <dir>]
-  sums <dir> <output>`)
+  meta --split all --base-name <name> --detect-deps <destdir> [-o <outdir>] [--build] [-j N]
+  sums [-q] [-j N] [--hash sha256|sha256-tree] [--cache <file>] <dir> <output>
+  verify [-q] [-j N] <sums> [basedir]
+  verify [-q] [-j N] --package <pkg.apg>...
+  list <pkg.apg>
+  extract <pkg.apg> [dest] [-j N] [--file <path>] [--max-files N] [--max-file-size N] [--max-size N]
+  delta <old.apg> <new.apg> -o <out.apgd> [--diff] [--diff-min-size N] [--compression zstd] [--level N] [--max-files N] [--max-file-size N] [--max-size N]
+  apply <old.apg|dir> <delta.apgd> [-o <new.apg>] [-j N] [--compression zstd] [--level N] [--reproducible] [--max-files N] [--max-file-size N] [--max-size N]
+  dict train -o <out.dict> [--size N] <dir>...
+  sonames build -o <soname.idx> <pkg.apg|pkgdir|repodir>...
+  sonames lookup [--index <soname.idx>] <soname>...
+  index <repodir> [-o <repo.idx>] [-j N]
+  serve [--socket <path>] [-j N]
+
+While apgbuild serve listens on $APGBUILD_SOCKET (default
+$XDG_RUNTIME_DIR/apgbuild.sock), build, list, verify, index and meta --split run
+in it, with warm caches.`)
 }
 
-// cmdBuild: apgbuild build <dir> -o <out.apg> [--compression zstd] [--level 19]
-func cmdBuild(args []string) error {
-	fs := flag.NewFlagSet("build", flag.ContinueOnError)
-	output := fs.String("o", "", "Output .apg file path (auto-generated from metadata if omitted)")
-	compression := fs.String("compression", "zstd", "Compression type: zstd|xz|bz2|gz|lz4|lzma")
+// cmdBuild: apgbuild build <dir> -o <out.apg> [--compression zstd|auto] [--level 19] [--budget D] [--single-pass] [-j N] [--threads N|auto] [--seekable] [--frame-size N] [--dedup] [--blob-store <dir>] [--order group|path] [--reproducible] [--dict <file>] [--hash sha256|sha256-tree] [--max-files N] [--max-file-size N] [--max-size N] [--no-cache] [--stats[=json]] [-q]
+//
+// With --batch or several dirs, builds them all in one process (see buildBatch).
+func cmdBuild(s *session, args []string) error {
+	fs := s.flagSet("build")
+	output := fs.String("o", "", "Output .apg file path, - for stdout (auto-generated from metadata if omitted)")
+	compression := fs.String("compression", "zstd", "Compression type: zstd|xz|bz2|gz|lz4|lzma, or auto (zstd, level chosen per package)")
 	level := fs.Int("level", 0, "Compression level (0 = algorithm default)")
-	if err := fs.Parse(args); err != nil {
+	budget := fs.Duration("budget", 0, "With --compression auto: compression time to aim for, e.g. 30s (0 = smallest package)")
+	singlePass := fs.Bool("single-pass", false, "Hash files while archiving them (one read per file)")
+	jobs := jobsFlag(fs, "Files hashed in parallel (0 = number of CPUs)")
+	threads := fs.String("threads", "", "Compressor threads for zstd/xz: N or auto (= number of CPUs)")
+	seekable := fs.Bool("seekable", false, "Write the seekable APGv2 framed layout (zstd only)")
+	frameSize := fs.Int64("frame-size", 0, "Cut seekable frames at the first member boundary past N uncompressed bytes (0 = 4 MiB); implies --seekable")
+	dedup := fs.Bool("dedup", false, "Store files of identical content once, as hardlinks")
+	blobStore := fs.String("blob-store", "", "Splice large files into seekable packages from this store of compressed frames")
+	order := fs.String("order", archive.OrderGroup, "Member order: group (similar files together) or path")
+	reproducible := fs.Bool("reproducible", false, "Store owners as root, no atime/ctime; clamp mtimes to $SOURCE_DATE_EPOCH")
+	batch := fs.String("batch", "", "Build the packages listed in this JSON manifest")
+	dictPath := fs.String("dict", "", "Compress with this zstd dictionary (see apgbuild dict train)")
+	hashAlg := hashFlag(fs)
+	limits := limitsFlags(fs, false)
+	noCache := fs.Bool("no-cache", false, "Ignore and do not update the .apgbuild-cache build cache")
+	quiet := fs.Bool("q", false, "Print only warnings and failures")
+	var stats statsFlag
+	fs.Var(&stats, "stats", "Print per-phase timings to stderr: --stats or --stats=json")
+	if err := parseInterspersed(fs, args); err != nil {
 		return err
 	}
-	if fs.NArg() < 1 {
+	nThreads, err := parseThreads(*threads)
+	if err != nil {
+		return err
+	}
+	alg, err := checksum.ParseAlgorithm(*hashAlg)
+	if err != nil {
+		return err
+	}
+	if *frameSize < 0 {
+		return fmt.Errorf("invalid --frame-size %d", *frameSize)
+	}
+	if *order != archive.OrderGroup && *order != archive.OrderPath {
+		return fmt.Errorf("invalid --order value %q: must be group or path", *order)
+	}
+	var epoch time.Time
+	if *reproducible {
+		if epoch, err = sourceDateEpoch(s.getenv("SOURCE_DATE_EPOCH")); err != nil {
+			return err
+		}
+	}
+	var dict []byte
+	if *dictPath != "" {
+		if dict, err = os.ReadFile(s.path(*dictPath)); err != nil {
+			return fmt.Errorf("failed to read dictionary: %w", err)
+		}
+		if archive.DictionaryID(dict) == 0 {
+			return fmt.Errorf("%s is not a zstd dictionary", *dictPath)
+		}
+	}
+	if fs.NArg() < 1 && *batch == "" {
 		return fmt.Errorf("usage: apgbuild build <dir> -o <out.apg>")
 	}
-	srcDir := fs.Arg(0)
 
+	var blobs *archive.BlobStore
+	if *blobStore != "" {
+		if blobs, err = archive.OpenBlobStore(s.path(*blobStore)); err != nil {
+			return err
+		}
+	}
+
+	b := s.newBuilder(*quiet)
+	bopts := builder.Options{
+		Compression:  *compression,
+		Level:        *level,
+		Budget:       *budget,
+		SinglePass:   *singlePass,
+		Jobs:         *jobs,
+		Threads:      nThreads,
+		Seekable:     *seekable || *frameSize > 0,
+		FrameSize:    *frameSize,
+		Dedup:        *dedup,
+		Blobs:        blobs,
+		Order:        *order,
+		Reproducible: *reproducible,
+		Epoch:        epoch,
+		Dictionary:   dict,
+		Hash:         alg,
+		Limits:       *limits,
+		NoCache:      *noCache,
+		Caches:       s.caches,
+	}
+	if *batch != "" || fs.NArg() > 1 {
+		if *output == "-" {
+			return fmt.Errorf("-o - writes one package; batch builds need an output directory")
+		}
+		dirs := make([]string, fs.NArg())
+		for i, d := range fs.Args() {
+			dirs[i] = s.path(d)
+		}
+		manifest, outDir := *batch, *output
+		if manifest != "" {
+			manifest = s.path(manifest)
+		}
+		if outDir != "" {
+			outDir = s.path(outDir)
+		}
+		return buildBatch(s, b, manifest, dirs, outDir, bopts, stats)
+	}
+
+	srcDir := s.path(fs.Arg(0))
 	outPath := *output
 	if outPath == "" {
 		// Auto-generate from metadata.json: name-version-arch.apg
-		metaPath := srcDir + "/metadata.json"
-		meta, err := metadata.Load(metaPath)
-		if err != nil {
+		if outPath, err = builder.OutputName(srcDir); err != nil {
 			return fmt.Errorf("no -o given and failed to read metadata.json: %w", err)
 		}
-		arch := "noarch"
-		if meta.Architecture != nil && *meta.Architecture != "" {
-			arch = *meta.Architecture
+	}
+	if outPath != "-" {
+		outPath = s.path(outPath)
+	} else {
+		if s != local {
+			return fmt.Errorf("-o - cannot stream a package through apgbuild serve")
+		}
+		// The package goes to stdout (e.g. into an uploader), messages to stderr.
+		if fi, err := os.Stdout.Stat(); err == nil && fi.Mode()&os.ModeCharDevice != 0 {
+			return fmt.Errorf("refusing to write a package to a terminal; redirect stdout")
 		}
-		outPath = fmt.Sprintf("%s-%s-%s.apg", meta.Name, meta.Version, arch)
+		bopts.Sink = os.Stdout
+		b.SetOutput(os.Stderr)
+		outPath = "<stdout>"
+	}
+	if stats != "" {
+		bopts.Stats = &builder.BuildStats{}
+	}
+	if err := b.CreatePackageWithOptions(srcDir, outPath, bopts); err != nil {
+		return err
+	}
+	switch stats {
+	case "text":
+		bopts.Stats.WriteText(s.stderr)
+	case "json":
+		return bopts.Stats.WriteJSON(s.stderr)
 	}
+	return nil
+}
 
-	b := builder.New()
-	return b.CreatePackageWithCompression(srcDir, outPath, *compression, *level)
+// buildBatch builds the packages of a manifest and/or several directories.
+// -o is then an output directory; -j is the thread budget of the batch.
+func buildBatch(s *session, b *builder.Builder, manifest string, dirs []string, outDir string, opts builder.Options, stats statsFlag) error {
+	var pkgs []builder.BatchPackage
+	if manifest != "" {
+		var err error
+		if pkgs, err = builder.LoadBatchManifest(manifest); err != nil {
+			return err
+		}
+	}
+	for _, d := range dirs {
+		pkgs = append(pkgs, builder.BatchPackage{Dir: d})
+	}
+	if outDir != "" {
+		if err := os.MkdirAll(outDir, 0755); err != nil {
+			return fmt.Errorf("failed to create output directory: %w", err)
+		}
+		for i := range pkgs {
+			p := &pkgs[i]
+			if p.Output == "" {
+				name, err := builder.OutputName(p.Dir)
+				if err != nil {
+					name = filepath.Base(filepath.Clean(p.Dir)) + ".apg"
+				}
+				p.Output = filepath.Join(outDir, name)
+			} else if !filepath.IsAbs(p.Output) && manifest == "" {
+				p.Output = filepath.Join(outDir, p.Output)
+			}
+		}
+	}
+
+	results := b.BuildBatch(pkgs, opts, opts.Jobs)
+	switch stats {
+	case "json":
+		enc := json.NewEncoder(s.stderr)
+		enc.SetIndent("", "  ")
+		if err := enc.Encode(results); err != nil {
+			return err
+		}
+	case "text":
+		for _, r := range results {
+			fmt.Fprintf(s.stderr, "%s:\n", r.Package.Dir)
+			r.Stats.WriteText(s.stderr)
+		}
+	}
+	builder.WriteBatchSummary(s.stdout, results)
+	failed := 0
+	for _, r := range results {
+		if r.Err != nil {
+			failed++
+		}
+	}
+	if failed > 0 {
+		return fmt.Errorf("%d of %d packages failed", failed, len(results))
+	}
+	return nil
+}
+
+// parseThreads converts a --threads value ("", "auto" or a count).
+func parseThreads(s string) (int, error) {
+	switch s {
+	case "":
+		return 0, nil
+	case "auto":
+		return archive.ThreadsAuto, nil
+	}
+	n, err := strconv.Atoi(s)
+	if err != nil || n < 0 {
+		return 0, fmt.Errorf("invalid --threads value %q: must be a count or auto", s)
+	}
+	return n, nil
 }
 
-// cmdSums: apgbuild sums <dir> <output>
+// sourceDateEpoch parses the value v of $SOURCE_DATE_EPOCH, the zero time
+// if unset.
+func sourceDateEpoch(v string) (time.Time, error) {
+	if v == "" {
+		return time.Time{}, nil
+	}
+	n, err := strconv.ParseInt(v, 10, 64)
+	if err != nil || n < 0 {
+		return time.Time{}, fmt.Errorf("invalid SOURCE_DATE_EPOCH %q: must be seconds since 1970", v)
+	}
+	return time.Unix(n, 0), nil
+}
+
+// statsFlag is --stats ("text") or --stats=json.
+type statsFlag string
+
+func (s *statsFlag) String() string   { return string(*s) }
+func (s *statsFlag) IsBoolFlag() bool { return true }
+
+func (s *statsFlag) Set(v string) error {
+	switch v {
+	case "true", "text":
+		*s = "text"
+	case "json":
+		*s = "json"
+	case "false":
+		*s = ""
+	default:
+		return fmt.Errorf("--stats: want text or json, got %q", v)
+	}
+	return nil
+}
+
+// jobsFlag registers -j and --jobs as aliases for a worker count.
+func jobsFlag(fs *flag.FlagSet, usage string) *int {
+	jobs := new(int)
+	fs.IntVar(jobs, "j", 0, usage)
+	fs.IntVar(jobs, "jobs", 0, usage)
+	return jobs
+}
+
+// limitsFlags registers --max-files, --max-file-size and --max-size (in
+// bytes; 0 = default, -1 = unlimited); extract tells that the command
+// extracts, where the defaults are bounded by free space.
+func limitsFlags(fs *flag.FlagSet, extract bool) *archive.Limits {
+	l := new(archive.Limits)
+	free := ""
+	if extract {
+		free = ", at most the free space of the destination"
+	}
+	fs.Int64Var(&l.Files, "max-files", 0, fmt.Sprintf("Most members a package may have (0 = %d, -1 = unlimited)", archive.MaxFiles))
+	fs.Int64Var(&l.FileSize, "max-file-size", 0, fmt.Sprintf("Largest member in bytes (0 = %d%s, -1 = unlimited)", int64(archive.MaxFileSize), free))
+	fs.Int64Var(&l.Total, "max-size", 0, fmt.Sprintf("Most uncompressed bytes in a package (0 = %d%s, -1 = unlimited)", int64(archive.MaxArchiveSize), free))
+	return l
+}
+
+// hashFlag registers --hash, the algorithm of written sums files.
+func hashFlag(fs *flag.FlagSet) *string {
+	return fs.String("hash", string(checksum.SHA256), "Sums algorithm: sha256, or sha256-tree to hash large files on several cores")
+}
+
+// cmdSums: apgbuild sums [-j N] [--hash sha256|sha256-tree] [--cache <file>] <dir> <output>
 func cmdSums(args []string) error {
-	if len(args) < 2 {
-		return fmt.Errorf("usage: apgbuild sums <dir> <output>")
+	fs := flag.NewFlagSet("sums", flag.ContinueOnError)
+	jobs := jobsFlag(fs, "Files hashed in parallel (0 = number of CPUs)")
+	hashAlg := hashFlag(fs)
+	cachePath := fs.String("cache", "", "Reuse and update sums of unchanged files in this cache file")
+	quiet := fs.Bool("q", false, "Print only failures")
+	if err := parseInterspersed(fs, args); err != nil {
+		return err
+	}
+	if fs.NArg() < 2 {
+		return fmt.Errorf("usage: apgbuild sums [-q] [-j N] [--hash sha256|sha256-tree] [--cache <file>] <dir> <output>")
+	}
+	alg, err := checksum.ParseAlgorithm(*hashAlg)
+	if err != nil {
+		return err
+	}
+	opts := checksum.Options{Jobs: *jobs, Algorithm: alg}
+	if *cachePath != "" {
+		opts.Cache = checksum.OpenCache(*cachePath)
+	}
+	if err := local.newBuilder(*quiet).GenerateChecksumsWithOptions(fs.Arg(0), fs.Arg(1), opts); err != nil {
+		return err
 	}
-	_, err := checksum.CreateSums(args[0], args[1])
-	return err
+	if opts.Cache != nil {
+		return opts.Cache.Save()
+	}
+	return nil
+}
+
+// cmdVerify: apgbuild verify [-q] [-j N] <sums> [basedir] | --package <pkg.apg>...
+func cmdVerify(s *session, args []string) error {
+	fs := s.flagSet("verify")
+	jobs := jobsFlag(fs, "Files hashed in parallel, with --package frames decompressed (0 = number of CPUs)")
+	quiet := fs.Bool("q", false, "Print only failures")
+	pkg := fs.Bool("package", false, "Verify .apg files against the sums stored in them, without extracting")
+	if err := parseInterspersed(fs, args); err != nil {
+		return err
+	}
+	if fs.NArg() < 1 {
+		return fmt.Errorf("usage: apgbuild verify [-q] [-j N] <sums> [basedir] | --package <pkg.apg>...")
+	}
+	if *pkg {
+		b := s.newBuilder(*quiet)
+		bad := 0
+		for _, p := range fs.Args() {
+			if err := b.VerifyPackageWithOptions(s.path(p), checksum.Options{Jobs: *jobs}); err != nil {
+				fmt.Fprintf(s.stderr, "%s: %v\n", p, err)
+				bad++
+			}
+		}
+		if bad > 0 {
+			return fmt.Errorf("%d of %d packages failed verification", bad, fs.NArg())
+		}
+		return nil
+	}
+	baseDir := "."
+	if fs.NArg() > 1 {
+		baseDir = fs.Arg(1)
+	}
+	return s.newBuilder(*quiet).VerifyChecksumsWithOptions(s.path(fs.Arg(0)), s.path(baseDir), checksum.Options{Jobs: *jobs})
+}
+
+// cmdList: apgbuild list <pkg.apg>
+func cmdList(s *session, args []string) error {
+	if len(args) < 1 {
+		return fmt.Errorf("usage: apgbuild list <pkg.apg>")
+	}
+	return s.builder().ListPackage(s.path(args[0]))
+}
+
+// cmdExtract: apgbuild extract <pkg.apg> [dest] [-j N] [--file <path>] [--max-files N] [--max-file-size N] [--max-size N]
+func cmdExtract(args []string) error {
+	fs := flag.NewFlagSet("extract", flag.ContinueOnError)
+	member := fs.String("file", "", "Extract only this member (e.g. metadata.json)")
+	jobs := jobsFlag(fs, "Files written and seekable frames decompressed in parallel (0 = number of CPUs, 1 = serial)")
+	limits := limitsFlags(fs, true)
+	if err := parseInterspersed(fs, args); err != nil {
+		return err
+	}
+	if fs.NArg() < 1 {
+		return fmt.Errorf("usage: apgbuild extract <pkg.apg> [dest] [-j N] [--file <path>]")
+	}
+	dest := "."
+	if fs.NArg() > 1 {
+		dest = fs.Arg(1)
+	}
+
+	b := builder.New()
+	if *member != "" {
+		return b.ExtractFileWithLimits(fs.Arg(0), *member, dest, *limits)
+	}
+	return b.ExtractPackageWithOptions(fs.Arg(0), dest, archive.ExtractOptions{Jobs: *jobs, Limits: *limits})
+}
+
+// cmdDelta: apgbuild delta <old.apg> <new.apg> -o <out.apgd> [--diff] [--diff-min-size N] [--compression zstd] [--level N] [--max-files N] [--max-file-size N] [--max-size N]
+func cmdDelta(args []string) error {
+	fs := flag.NewFlagSet("delta", flag.ContinueOnError)
+	output := fs.String("o", "", "Output .apgd file")
+	diff := fs.Bool("diff", false, "Store large changed files as binary diffs against their old version")
+	diffMin := fs.Int64("diff-min-size", delta.DefaultDiffMinSize, "Smallest changed file --diff tries, in bytes")
+	compression := fs.String("compression", "zstd", "Compression type: zstd|xz|bz2|gz|lz4|lzma")
+	level := fs.Int("level", 0, "Compression level (0 = algorithm default)")
+	limits := limitsFlags(fs, false)
+	if err := parseInterspersed(fs, args); err != nil {
+		return err
+	}
+	if *output == "" || fs.NArg() != 2 {
+		return fmt.Errorf("usage: apgbuild delta <old.apg> <new.apg> -o <out.apgd> [--diff] [--diff-min-size N]")
+	}
+	return builder.New().CreateDelta(fs.Arg(0), fs.Arg(1), *output, delta.Options{
+		Diff:        *diff,
+		DiffMinSize: *diffMin,
+		Archive:     archive.CreateOptions{Compression: *compression, Level: *level},
+		Limits:      *limits,
+	})
+}
+
+// cmdApply: apgbuild apply <old.apg|dir> <delta.apgd> [-o <new.apg>] [-j N] [--compression zstd] [--level N] [--reproducible] [--max-files N] [--max-file-size N] [--max-size N]
+func cmdApply(args []string) error {
+	fs := flag.NewFlagSet("apply", flag.ContinueOnError)
+	output := fs.String("o", "", "Output .apg file (required when applying to a package)")
+	jobs := jobsFlag(fs, "Files extracted and verified in parallel (0 = number of CPUs)")
+	compression := fs.String("compression", "zstd", "Compression type of the rebuilt package: zstd|xz|bz2|gz|lz4|lzma")
+	level := fs.Int("level", 0, "Compression level (0 = algorithm default)")
+	reproducible := fs.Bool("reproducible", false, "Store owners of the rebuilt package as root, no atime/ctime")
+	limits := limitsFlags(fs, true)
+	if err := parseInterspersed(fs, args); err != nil {
+		return err
+	}
+	if fs.NArg() != 2 {
+		return fmt.Errorf("usage: apgbuild apply <old.apg|dir> <delta.apgd> [-o <new.apg>] [-j N]")
+	}
+	return builder.New().ApplyDelta(fs.Arg(0), fs.Arg(1), *output, delta.ApplyOptions{
+		Jobs:    *jobs,
+		Limits:  *limits,
+		Archive: archive.CreateOptions{Compression: *compression, Level: *level, Reproducible: *reproducible},
+	})
+}
+
+// cmdDict: apgbuild dict train -o <out.dict> [--size N] <dir>...
+func cmdDict(args []string) error {
+	if len(args) < 1 || args[0] != "train" {
+		return fmt.Errorf("usage: apgbuild dict train -o <out.dict> [--size N] <dir>...")
+	}
+	fs := flag.NewFlagSet("dict train", flag.ContinueOnError)
+	output := fs.String("o", "", "Output dictionary file")
+	size := fs.Int("size", archive.DefaultDictionarySize, "Maximum dictionary size in bytes")
+	if err := parseInterspersed(fs, args[1:]); err != nil {
+		return err
+	}
+	if *output == "" || fs.NArg() < 1 {
+		return fmt.Errorf("usage: apgbuild dict train -o <out.dict> [--size N] <dir>...")
+	}
+	return builder.New().TrainDictionary(fs.Args(), *output, *size)
+}
+
+// cmdSonames: apgbuild sonames build -o <soname.idx> <input>... | lookup [--index <file>] <soname>...
+func cmdSonames(args []string) error {
+	const use = "usage: apgbuild sonames build -o <soname.idx> <pkg.apg|pkgdir|repodir>... | lookup [--index <file>] <soname>..."
+	if len(args) < 1 {
+		return fmt.Errorf(use)
+	}
+	fs := flag.NewFlagSet("sonames "+args[0], flag.ContinueOnError)
+	switch args[0] {
+	case "build":
+		output := fs.String("o", "", "Output index file")
+		if err := parseInterspersed(fs, args[1:]); err != nil {
+			return err
+		}
+		if *output == "" || fs.NArg() < 1 {
+			return fmt.Errorf(use)
+		}
+		return builder.New().BuildSonameIndex(fs.Args(), *output)
+	case "lookup":
+		index := fs.String("index", "", "Index file (default $"+elfanalyzer.IndexPathEnv+" or "+elfanalyzer.DefaultIndexPath+")")
+		if err := parseInterspersed(fs, args[1:]); err != nil {
+			return err
+		}
+		ix := elfanalyzer.DefaultIndex()
+		if *index != "" {
+			var err error
+			if ix, err = elfanalyzer.OpenIndex(*index); err != nil {
+				return err
+			}
+		}
+		missing := 0
+		for _, name := range fs.Args() {
+			if pkg, ok := ix.Package(name); ok {
+				fmt.Printf("%s\t%s\n", name, pkg)
+			} else if pkg, ok := elfanalyzer.LibToPackageMap[name]; ok {
+				fmt.Printf("%s\t%s\t(builtin)\n", name, pkg)
+			} else if pkg, ok := ix.Provider(name); ok {
+				fmt.Printf("%s\t%s\t(provides)\n", name, pkg)
+			} else {
+				fmt.Printf("%s\t-\n", name)
+				missing++
+			}
+		}
+		if missing > 0 {
+			return fmt.Errorf("%d names not found", missing)
+		}
+		return nil
+	}
+	return fmt.Errorf(use)
+}
+
+// cmdIndex: apgbuild index <repodir> [-o <repo.idx>] [-j N]
+func cmdIndex(s *session, args []string) error {
+	const use = "usage: apgbuild index <repodir> [-o <repo.idx>] [-j N]"
+	fs := s.flagSet("index")
+	output := fs.String("o", "", "Output index file (default <repodir>/repo.idx)")
+	jobs := jobsFlag(fs, "Packages read at once (0 = number of CPUs)")
+	if err := parseInterspersed(fs, args); err != nil {
+		return err
+	}
+	if fs.NArg() != 1 {
+		return fmt.Errorf(use)
+	}
+	dir := s.path(fs.Arg(0))
+	out := *output
+	if out == "" {
+		out = filepath.Join(dir, "repo.idx")
+	}
+	return s.builder().BuildRepoIndex(dir, s.path(out), *jobs)
+}
+
+// parseInterspersed parses flags that may appear before, between or after
+// positional arguments. The positionals are left in fs.Args().
+func parseInterspersed(fs *flag.FlagSet, args []string) error {
+	var positional []string
+	for {
+		if err := fs.Parse(args); err != nil {
+			return err
+		}
+		if fs.NArg() == 0 {
+			break
+		}
+		positional = append(positional, fs.Arg(0))
+		args = fs.Args()[1:]
+	}
+	return fs.Parse(append([]string{"--"}, positional...))
 }
 
 // cmdMeta: apgbuild meta [flags]
 //
 // Without --split: runs interactive wizard.
 // With --split: generates metadata for a split sub-package.
-func cmdMeta(args []string) error {
-	fs := flag.NewFlagSet("meta", flag.ContinueOnError)
+// With --split all: partitions a DESTDIR into all three (see builder.SplitTree).
+func cmdMeta(s *session, args []string) error {
+	fs := s.flagSet("meta")
 	output := fs.String("o", "metadata.json", "Output metadata.json path")
-	splitKind := fs.String("split", "", "Split kind: libs | bins | dev")
+	splitKind := fs.String("split", "", "Split kind: libs | bins | dev | all")
 	baseName := fs.String("base-name", "", "Base package name (e.g. curl)")
 	version := fs.String("version", "", "Package version")
 	arch := fs.String("arch", "", "Architecture (e.g. x86_64)")
@@ -111,6 +653,8 @@ func cmdMeta(args []string) error {
 	maintainer := fs.String("maintainer", "", "Package maintainer")
 	license := fs.String("license", "", "Package license")
 	homepage := fs.String("homepage", "", "Package homepage URL")
+	build := fs.Bool("build", false, "With --split all: also build the split packages")
+	jobs := jobsFlag(fs, "With --split all: threads for the ELF scan and builds (0 = number of CPUs)")
 
 	if err := fs.Parse(args); err != nil {
 		return err
@@ -118,8 +662,10 @@ func cmdMeta(args []string) error {
 
 	if *splitKind == "" {
 		// Interactive wizard mode
-		b := builder.New()
-		return b.CreateMetadata(*output)
+		if s != local {
+			return fmt.Errorf("the metadata wizard is interactive; run it without apgbuild serve")
+		}
+		return builder.New().CreateMetadata(*output)
 	}
 
 	// Split metadata generation
@@ -149,6 +695,33 @@ func cmdMeta(args []string) error {
 		Conf:         []string{},
 	}
 
+	splitDir := *detectDeps
+	if splitDir == "" {
+		// Default to directory of output file
+		splitDir = "."
+	}
+	splitDir = s.path(splitDir)
+
+	if *splitKind == "all" {
+		outDir := *output
+		if outDir == "metadata.json" {
+			outDir = "."
+		}
+		b := s.builder()
+		pkgs, err := b.SplitTree(splitDir, s.path(outDir), base, *baseName, *jobs)
+		if err != nil || !*build {
+			return err
+		}
+		results := b.BuildBatch(pkgs, builder.Options{Compression: "zstd", Order: archive.OrderGroup, Caches: s.caches}, *jobs)
+		builder.WriteBatchSummary(s.stdout, results)
+		for _, r := range results {
+			if r.Err != nil {
+				return fmt.Errorf("build %s: %w", r.Package.Dir, r.Err)
+			}
+		}
+		return nil
+	}
+
 	var kind metadata.SplitKind
 	switch *splitKind {
 	case "libs":
@@ -158,13 +731,7 @@ func cmdMeta(args []string) error {
 	case "dev":
 		kind = metadata.SplitDev
 	default:
-		return fmt.Errorf("unknown --split value %q: must be libs, bins, or dev", *splitKind)
-	}
-
-	splitDir := *detectDeps
-	if splitDir == "" {
-		// Default to directory of output file
-		splitDir = "."
+		return fmt.Errorf("unknown --split value %q: must be libs, bins, dev or all", *splitKind)
 	}
 
 	m, err := metadata.GenerateSplitMetadata(base, splitDir, kind, *baseName)
@@ -172,5 +739,5 @@ func cmdMeta(args []string) error {
 		return fmt.Errorf("generate split metadata: %w", err)
 	}
 
-	return m.Save(*output)
+	return m.Save(s.path(*output))
 }
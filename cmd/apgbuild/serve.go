@@ -0,0 +1,424 @@
+// apgbuild — daemon mode: apgbuild serve and its thin client
+// NurOS 2026 - GPL 3.0
+package main
+
+import (
+	"encoding/json"
+	"errors"
+	"flag"
+	"fmt"
+	"io"
+	"net"
+	"os"
+	"os/signal"
+	"path/filepath"
+	"runtime"
+	"strings"
+	"sync"
+	"syscall"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/builder"
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+	"github.com/NurOS-Linux/apgbuild/internal/elfanalyzer"
+	"github.com/NurOS-Linux/apgbuild/internal/uring"
+)
+
+// SocketEnv names the socket of apgbuild serve; see socketPath.
+const SocketEnv = "APGBUILD_SOCKET"
+
+// servedEnv is the client environment a served command sees.
+var servedEnv = []string{"SOURCE_DATE_EPOCH"}
+
+// serverEnv is the environment the packages read from the process itself.
+// apgbuild serve declines a client whose values differ from its own, and
+// the client runs the command itself.
+var serverEnv = []string{archive.DictionaryPathEnv, elfanalyzer.IndexPathEnv, uring.DisableEnv}
+
+// ── Sessions ────────────────────────────────────────────────────────────────
+
+// session is where a command runs: in this process for this process, or in
+// apgbuild serve for a client, whose relative paths and environment are
+// its own.
+type session struct {
+	stdout, stderr io.Writer
+	dir            string             // working directory of relative paths ("" = ours)
+	env            map[string]string  // client environment (nil = ours)
+	caches         *checksum.CacheSet // build caches kept open by serve
+}
+
+// local is the session of a command run directly.
+var local = &session{stdout: os.Stdout, stderr: os.Stderr}
+
+// path resolves a path argument against the session's working directory.
+func (s *session) path(p string) string {
+	if s.dir == "" || p == "" || filepath.IsAbs(p) {
+		return p
+	}
+	return filepath.Join(s.dir, p)
+}
+
+func (s *session) getenv(key string) string {
+	if s.env == nil {
+		return os.Getenv(key)
+	}
+	return s.env[key]
+}
+
+func (s *session) flagSet(name string) *flag.FlagSet {
+	fs := flag.NewFlagSet(name, flag.ContinueOnError)
+	fs.SetOutput(s.stderr)
+	return fs
+}
+
+// builder returns a Builder printing to the session.
+func (s *session) builder() *builder.Builder {
+	b := builder.New()
+	b.SetOutput(s.stdout)
+	return b
+}
+
+// newBuilder returns a Builder that prints only failures when quiet and,
+// in this process, draws a progress line on stderr when it is a terminal.
+func (s *session) newBuilder(quiet bool) *builder.Builder {
+	b := s.builder()
+	b.Quiet = quiet
+	if s != local {
+		return b
+	}
+	if fi, err := os.Stderr.Stat(); err == nil && fi.Mode()&os.ModeCharDevice != 0 {
+		b.Progress = os.Stderr
+	}
+	return b
+}
+
+// ── Protocol ────────────────────────────────────────────────────────────────
+//
+// A client sends one request line and reads reply lines until the one with
+// Done set. All lines are JSON.
+
+type serveRequest struct {
+	Args []string          `json:"args"` // command and its arguments
+	Dir  string            `json:"dir"`  // client working directory
+	Env  map[string]string `json:"env,omitempty"`
+}
+
+type serveReply struct {
+	Stream int    `json:"stream,omitempty"` // 1 = stdout, 2 = stderr
+	Data   string `json:"data,omitempty"`
+	Done   bool   `json:"done,omitempty"`
+	Error  string `json:"error,omitempty"` // with Done: the command failed
+	// With Done: the command did not run here (see serverEnv).
+	Declined bool `json:"declined,omitempty"`
+}
+
+// replyWriter sends what a command prints as replies on one stream.
+type replyWriter struct {
+	mu     *sync.Mutex
+	enc    *json.Encoder
+	stream int
+}
+
+func (w *replyWriter) Write(p []byte) (int, error) {
+	w.mu.Lock()
+	defer w.mu.Unlock()
+	if err := w.enc.Encode(serveReply{Stream: w.stream, Data: string(p)}); err != nil {
+		return 0, err
+	}
+	return len(p), nil
+}
+
+// served lists the commands apgbuild serve runs.
+var served = map[string]func(*session, []string) error{
+	"build":  cmdBuild,
+	"list":   cmdList,
+	"verify": cmdVerify,
+	"meta":   cmdMeta,
+	"index":  cmdIndex,
+}
+
+// servable tells whether the client can hand args to apgbuild serve: a
+// served command that neither streams a package through stdout nor runs
+// the interactive metadata wizard.
+func servable(args []string) bool {
+	if len(args) == 0 || served[args[0]] == nil {
+		return false
+	}
+	split := false
+	for _, a := range args[1:] {
+		if a == "-" {
+			return false
+		}
+		split = split || a == "--split" || a == "-split" || strings.HasPrefix(a, "--split=") || strings.HasPrefix(a, "-split=")
+	}
+	return args[0] != "meta" || split
+}
+
+// socketPath returns $APGBUILD_SOCKET, else apgbuild.sock in
+// $XDG_RUNTIME_DIR, else apgbuild.sock in tmpSocketDir.
+func socketPath() string {
+	if p := os.Getenv(SocketEnv); p != "" {
+		return p
+	}
+	if d := os.Getenv("XDG_RUNTIME_DIR"); d != "" {
+		return filepath.Join(d, "apgbuild.sock")
+	}
+	return filepath.Join(tmpSocketDir(), "apgbuild.sock")
+}
+
+// tmpSocketDir is the per-user 0700 directory for the socket in the
+// temporary directory (see privateDir).
+func tmpSocketDir() string {
+	return filepath.Join(os.TempDir(), fmt.Sprintf("apgbuild-%d", os.Getuid()))
+}
+
+// privateDir creates dir 0700 if missing and checks that it is a real
+// directory owned by us that nobody else can enter, so no other user can
+// place a socket in it.
+func privateDir(dir string) error {
+	if err := os.Mkdir(dir, 0700); err != nil && !os.IsExist(err) {
+		return err
+	}
+	fi, err := os.Lstat(dir)
+	if err != nil {
+		return err
+	}
+	st, ok := fi.Sys().(*syscall.Stat_t)
+	if !fi.IsDir() || !ok || int(st.Uid) != os.Getuid() || fi.Mode().Perm()&0077 != 0 {
+		return fmt.Errorf("%s: not a private directory of uid %d", dir, os.Getuid())
+	}
+	return nil
+}
+
+// ownSocket tells whether path is a socket owned by us.
+func ownSocket(path string) bool {
+	fi, err := os.Lstat(path)
+	if err != nil || fi.Mode()&os.ModeSocket == 0 {
+		return false
+	}
+	st, ok := fi.Sys().(*syscall.Stat_t)
+	return ok && int(st.Uid) == os.Getuid()
+}
+
+// peerUID returns the uid of the process at the other end of conn.
+func peerUID(conn net.Conn) (int, error) {
+	uc, ok := conn.(*net.UnixConn)
+	if !ok {
+		return -1, errors.New("not a unix socket")
+	}
+	raw, err := uc.SyscallConn()
+	if err != nil {
+		return -1, err
+	}
+	var cred *syscall.Ucred
+	var credErr error
+	if err := raw.Control(func(fd uintptr) {
+		cred, credErr = syscall.GetsockoptUcred(int(fd), syscall.SOL_SOCKET, syscall.SO_PEERCRED)
+	}); err != nil {
+		return -1, err
+	}
+	if credErr != nil {
+		return -1, credErr
+	}
+	return int(cred.Uid), nil
+}
+
+// ── Client ──────────────────────────────────────────────────────────────────
+
+// runServed runs args through apgbuild serve if it listens on socketPath.
+// ok is false if there is no server, the command cannot be served or the
+// server declines it; the command then runs in this process. Only a socket, and a server, of our
+// own user is used: anyone else would see our arguments and could answer
+// for a build that never ran.
+func runServed(args []string) (ok bool, err error) {
+	if !servable(args) {
+		return false, nil
+	}
+	socket := socketPath()
+	if _, err := os.Lstat(socket); err != nil {
+		return false, nil
+	}
+	if !ownSocket(socket) {
+		fmt.Fprintf(os.Stderr, "Warning: ignoring %s: not a socket of uid %d\n", socket, os.Getuid())
+		return false, nil
+	}
+	conn, err := net.DialTimeout("unix", socket, time.Second)
+	if err != nil {
+		return false, nil
+	}
+	defer conn.Close()
+	if uid, err := peerUID(conn); err != nil || uid != os.Getuid() {
+		fmt.Fprintf(os.Stderr, "Warning: ignoring %s: server is not run by uid %d\n", socket, os.Getuid())
+		return false, nil
+	}
+	dir, err := os.Getwd()
+	if err != nil {
+		return false, nil
+	}
+	req := serveRequest{Args: args, Dir: dir, Env: map[string]string{}}
+	for _, k := range servedEnv {
+		if v, ok := os.LookupEnv(k); ok {
+			req.Env[k] = v
+		}
+	}
+	for _, k := range serverEnv {
+		req.Env[k] = os.Getenv(k)
+	}
+	if err := json.NewEncoder(conn).Encode(req); err != nil {
+		return false, nil
+	}
+
+	dec := json.NewDecoder(conn)
+	for {
+		var r serveReply
+		if err := dec.Decode(&r); err != nil {
+			return true, fmt.Errorf("apgbuild serve: %w", err)
+		}
+		switch {
+		case r.Done && r.Declined:
+			return false, nil
+		case r.Done && r.Error != "":
+			return true, errors.New(r.Error)
+		case r.Done:
+			return true, nil
+		case r.Stream == 2:
+			io.WriteString(os.Stderr, r.Data)
+		default:
+			io.WriteString(os.Stdout, r.Data)
+		}
+	}
+}
+
+// ── Server ──────────────────────────────────────────────────────────────────
+
+// server runs the requests of apgbuild serve. The SONAME index is loaded
+// once per process anyway (elfanalyzer.DefaultIndex); build caches stay
+// open in caches.
+type server struct {
+	slots  chan struct{} // bounds the requests running at once
+	caches *checksum.CacheSet
+}
+
+// cmdServe: apgbuild serve [--socket <path>] [-j N]
+func cmdServe(args []string) error {
+	fs := flag.NewFlagSet("serve", flag.ContinueOnError)
+	socket := fs.String("socket", socketPath(), "Unix socket to listen on")
+	jobs := jobsFlag(fs, "Requests run at once (0 = number of CPUs)")
+	if err := fs.Parse(args); err != nil {
+		return err
+	}
+	n := *jobs
+	if n <= 0 {
+		n = runtime.NumCPU()
+	}
+
+	if filepath.Dir(*socket) == tmpSocketDir() {
+		if err := privateDir(tmpSocketDir()); err != nil {
+			return err
+		}
+	}
+	if conn, err := net.Dial("unix", *socket); err == nil {
+		conn.Close()
+		return fmt.Errorf("apgbuild serve is already listening on %s", *socket)
+	}
+	if fi, err := os.Lstat(*socket); err == nil {
+		if !ownSocket(*socket) {
+			return fmt.Errorf("%s: %v is in the way and not a socket of uid %d", *socket, fi.Mode().Type(), os.Getuid())
+		}
+		os.Remove(*socket) // left behind by a server that died
+	}
+	// Created 0600: there is no moment at which others can connect.
+	old := syscall.Umask(0177)
+	l, err := net.Listen("unix", *socket)
+	syscall.Umask(old)
+	if err != nil {
+		return err
+	}
+	sig := make(chan os.Signal, 1)
+	signal.Notify(sig, syscall.SIGINT, syscall.SIGTERM)
+	go func() {
+		<-sig
+		l.Close()
+	}()
+
+	srv := &server{slots: make(chan struct{}, n), caches: checksum.NewCacheSet()}
+	fmt.Fprintf(os.Stderr, "apgbuild serve: listening on %s, %d requests at once\n", *socket, n)
+	var wg sync.WaitGroup
+	for {
+		conn, err := l.Accept()
+		if err != nil {
+			if errors.Is(err, net.ErrClosed) {
+				break
+			}
+			return err
+		}
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			srv.handle(conn)
+		}()
+	}
+	wg.Wait()
+	return nil
+}
+
+// handle runs the request on conn, if it comes from our own user.
+func (srv *server) handle(conn net.Conn) {
+	defer conn.Close()
+	if uid, err := peerUID(conn); err != nil || uid != os.Getuid() {
+		return
+	}
+	var req serveRequest
+	if err := json.NewDecoder(conn).Decode(&req); err != nil {
+		return
+	}
+	var mu sync.Mutex
+	enc := json.NewEncoder(conn)
+	done := func(err error) {
+		r := serveReply{Done: true}
+		if err != nil {
+			r.Error = err.Error()
+		}
+		mu.Lock()
+		enc.Encode(r)
+		mu.Unlock()
+	}
+	if !servable(req.Args) || !filepath.IsAbs(req.Dir) {
+		done(fmt.Errorf("apgbuild serve: cannot run %q", req.Args))
+		return
+	}
+
+	for _, k := range serverEnv {
+		if req.Env[k] != os.Getenv(k) {
+			mu.Lock()
+			enc.Encode(serveReply{Done: true, Declined: true})
+			mu.Unlock()
+			return
+		}
+	}
+
+	srv.slots <- struct{}{}
+	defer func() { <-srv.slots }()
+	s := &session{
+		stdout: &replyWriter{mu: &mu, enc: enc, stream: 1},
+		stderr: &replyWriter{mu: &mu, enc: enc, stream: 2},
+		dir:    req.Dir,
+		env:    req.Env,
+		caches: srv.caches,
+	}
+	if s.env == nil {
+		s.env = map[string]string{}
+	}
+	done(srv.run(s, req.Args))
+}
+
+// run runs one command; a panic fails the request, not the server.
+func (srv *server) run(s *session, args []string) (err error) {
+	defer func() {
+		if r := recover(); r != nil {
+			err = fmt.Errorf("apgbuild serve: %s failed: %v", args[0], r)
+		}
+	}()
+	return served[args[0]](s, args[1:])
+}
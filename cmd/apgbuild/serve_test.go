@@ -0,0 +1,73 @@
+package main
+
+import (
+	"encoding/json"
+	"net"
+	"path/filepath"
+	"testing"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+)
+
+// startServer serves requests on a socket in a temporary directory and
+// points SocketEnv at it.
+func startServer(t *testing.T) string {
+	socket := filepath.Join(t.TempDir(), "apgbuild.sock")
+	l, err := net.Listen("unix", socket)
+	if err != nil {
+		t.Fatal(err)
+	}
+	t.Cleanup(func() { l.Close() })
+	srv := &server{slots: make(chan struct{}, 1), caches: checksum.NewCacheSet()}
+	go func() {
+		for {
+			conn, err := l.Accept()
+			if err != nil {
+				return
+			}
+			go srv.handle(conn)
+		}
+	}()
+	t.Setenv(SocketEnv, socket)
+	return socket
+}
+
+func TestServe_DeclinesOtherServerEnv(t *testing.T) {
+	socket := startServer(t)
+	t.Setenv(archive.DictionaryPathEnv, "/usr/share/apg/dicts")
+
+	conn, err := net.Dial("unix", socket)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer conn.Close()
+	req := serveRequest{
+		Args: []string{"list", "missing.apg"},
+		Dir:  t.TempDir(),
+		Env:  map[string]string{archive.DictionaryPathEnv: "/home/user/dicts"},
+	}
+	if err := json.NewEncoder(conn).Encode(req); err != nil {
+		t.Fatal(err)
+	}
+	var r serveReply
+	if err := json.NewDecoder(conn).Decode(&r); err != nil {
+		t.Fatal(err)
+	}
+	if !r.Done || !r.Declined {
+		t.Fatalf("reply = %+v, want the request declined", r)
+	}
+}
+
+func TestRunServed_SameServerEnv(t *testing.T) {
+	startServer(t)
+	t.Setenv(archive.DictionaryPathEnv, t.TempDir())
+
+	ok, err := runServed([]string{"list", filepath.Join(t.TempDir(), "missing.apg")})
+	if !ok {
+		t.Fatal("not served with the server's own environment")
+	}
+	if err == nil {
+		t.Fatal("listing a missing package succeeded")
+	}
+}
@@ -27,6 +27,7 @@
           pkgs.gcc
           pkgs.openssl
           pkgs.libarchive
+          pkgs.zstd
           pkgs.nlohmann_json
         ];
 
@@ -5,25 +5,573 @@
 package archive
 
 /*
-#cgo pkg-config: libarchive
+#cgo pkg-config: libarchive libzstd
 #cgo CFLAGS: -I/usr/include
 
 #include <archive.h>
 #include <archive_entry.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <zstd.h>
 
-// apg_create creates a tar archive at archivePath from sourceDir.
+// apgGoWrite hands package bytes to a Go io.Writer (see sink.go).
+extern int apgGoWrite(uintptr_t sink, void *buf, size_t len);
+
+// apg_stats accounts where a writer spends its time. Compression runs
+// inside archive_write_data and is whatever is left of the total.
+typedef struct {
+    la_int64_t readNs;       // in read() of source files (apg_writer_file)
+    la_int64_t writeNs;      // in write() of the package file
+    la_int64_t written;      // bytes written to the package file
+    la_int64_t tarBytes;     // uncompressed tar stream
+    uintptr_t sink;          // Go io.Writer taking the package instead of fd (0 = none)
+} apg_stats;
+
+// apg_limits bounds what goes into or comes out of a package (0 =
+// unlimited). Headers are checked against it before any of their data is
+// read, and data blocks are counted as they pass, so an oversized member
+// stops the loop at its first header or block past the limit.
+typedef struct {
+    la_int64_t maxFiles, maxFileSize, maxTotal;
+    la_int64_t files, total;   // members and data bytes seen so far
+    la_int64_t cur;            // data bytes of the current member
+} apg_limits;
+
+// Returned by the loops below when a limit is exceeded.
+#define APG_ELIMIT (-2)
+
+// apg_limit_entry accounts a member header declaring size data bytes.
+static int apg_limit_entry(apg_limits *l, const char *path, la_int64_t size,
+                           char *errBuf, int errBufLen) {
+    l->cur = 0;
+    if (l->maxFiles > 0 && ++l->files > l->maxFiles) {
+        snprintf(errBuf, errBufLen, "more than %lld members", (long long)l->maxFiles);
+        return APG_ELIMIT;
+    }
+    if (l->maxFileSize > 0 && size > l->maxFileSize) {
+        snprintf(errBuf, errBufLen, "%s: %lld bytes, over the member limit of %lld",
+                 path, (long long)size, (long long)l->maxFileSize);
+        return APG_ELIMIT;
+    }
+    if (l->maxTotal > 0 && size > l->maxTotal - l->total) {
+        snprintf(errBuf, errBufLen, "%s: package data over the limit of %lld bytes",
+                 path, (long long)l->maxTotal);
+        return APG_ELIMIT;
+    }
+    return 0;
+}
+
+// apg_limit_data accounts n data bytes of the current member; headers can
+// understate what a member really inflates to.
+static int apg_limit_data(apg_limits *l, la_int64_t n, char *errBuf, int errBufLen) {
+    l->cur += n;
+    l->total += n;
+    if (l->maxFileSize > 0 && l->cur > l->maxFileSize) {
+        snprintf(errBuf, errBufLen, "member data over the limit of %lld bytes", (long long)l->maxFileSize);
+        return APG_ELIMIT;
+    }
+    if (l->maxTotal > 0 && l->total > l->maxTotal) {
+        snprintf(errBuf, errBufLen, "package data over the limit of %lld bytes", (long long)l->maxTotal);
+        return APG_ELIMIT;
+    }
+    return 0;
+}
+
+static la_int64_t apg_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (la_int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// apg_fd_write writes all of buf to fd, or st->sink if set, and accounts
+// for it in st. On error it returns -1 with errno set.
+static int apg_fd_write(int fd, apg_stats *st, const void *buf, size_t len) {
+    const char *p = buf;
+    la_int64_t t0 = apg_now();
+    if (st->sink) {
+        int r = apgGoWrite(st->sink, (void *)p, len);
+        st->writeNs += apg_now() - t0;
+        if (r != 0) { errno = EPIPE; return -1; }
+        st->written += (la_int64_t)len;
+        return 0;
+    }
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            st->writeNs += apg_now() - t0;
+            return -1;
+        }
+        p += n; len -= (size_t)n; st->written += n;
+    }
+    st->writeNs += apg_now() - t0;
+    return 0;
+}
+
+// ── zstd with a dictionary ──────────────────────────────────────────────────
+//
+// libarchive's zstd filter cannot take a dictionary, so packages built with
+// one are compressed, and read back, with libzstd directly. libarchive still
+// produces (and parses) the tar stream, just without a filter.
+
+typedef struct {
+    ZSTD_CCtx *cctx;
+    ZSTD_CDict *cdict;
+    void *out;
+    size_t outCap;
+} apg_zenc;
+
+static void apg_zenc_free(apg_zenc *z) {
+    if (!z) return;
+    ZSTD_freeCCtx(z->cctx);
+    ZSTD_freeCDict(z->cdict);
+    free(z->out);
+    free(z);
+}
+
+// apg_zenc_new returns a compressor with dict, or at level without one
+// (dict NULL).
+static apg_zenc *apg_zenc_new(const void *dict, size_t dictLen, int level, int threads,
+                              char *errBuf, int errBufLen) {
+    apg_zenc *z = calloc(1, sizeof(*z));
+    z->cctx = ZSTD_createCCtx();
+    if (dict) z->cdict = ZSTD_createCDict(dict, dictLen, level > 0 ? level : ZSTD_CLEVEL_DEFAULT);
+    z->outCap = ZSTD_CStreamOutSize();
+    z->out = malloc(z->outCap);
+    if (!z->cctx || (dict && !z->cdict) || !z->out) {
+        snprintf(errBuf, errBufLen, "zstd: cannot load dictionary");
+        apg_zenc_free(z); return NULL;
+    }
+    if (z->cdict) ZSTD_CCtx_refCDict(z->cctx, z->cdict);
+    else ZSTD_CCtx_setParameter(z->cctx, ZSTD_c_compressionLevel, level > 0 ? level : ZSTD_CLEVEL_DEFAULT);
+    ZSTD_CCtx_setParameter(z->cctx, ZSTD_c_checksumFlag, 1);
+    if (threads > 0) {
+        size_t r = ZSTD_CCtx_setParameter(z->cctx, ZSTD_c_nbWorkers, threads);
+        if (ZSTD_isError(r)) {
+            snprintf(errBuf, errBufLen, "set zstd threads: %s", ZSTD_getErrorName(r));
+            apg_zenc_free(z); return NULL;
+        }
+    }
+    return z;
+}
+
+// apg_zenc_run compresses buf (mode ZSTD_e_continue) or ends the frame
+// (ZSTD_e_end), writing the output to fd and adding its length to *out.
+static int apg_zenc_run(apg_zenc *z, const void *buf, size_t len, ZSTD_EndDirective mode,
+                        int fd, apg_stats *st, la_int64_t *out, char *err, size_t errLen) {
+    ZSTD_inBuffer in = {buf, len, 0};
+    for (;;) {
+        ZSTD_outBuffer o = {z->out, z->outCap, 0};
+        size_t left = ZSTD_compressStream2(z->cctx, &o, &in, mode);
+        if (ZSTD_isError(left)) {
+            snprintf(err, errLen, "compress: %s", ZSTD_getErrorName(left)); return -1;
+        }
+        if (o.pos > 0 && apg_fd_write(fd, st, z->out, o.pos) != 0) {
+            snprintf(err, errLen, "write: %s", strerror(errno)); return -1;
+        }
+        if (out) *out += (la_int64_t)o.pos;
+        if (mode == ZSTD_e_end ? left == 0 : in.pos == in.size) return 0;
+    }
+}
+
+// apg_zdec feeds libarchive the decompressed tar stream of a package built
+// with a dictionary, starting at the current offset of fd.
+typedef struct {
+    int fd, ownFd;
+    ZSTD_DCtx *dctx;
+    void *in, *out;
+    size_t inCap, outCap;
+    ZSTD_inBuffer zin;
+    int eof;
+} apg_zdec;
+
+static la_ssize_t apg_zdec_read(struct archive *a, void *client, const void **buf) {
+    apg_zdec *d = client;
+    for (;;) {
+        if (d->zin.pos == d->zin.size) {
+            if (d->eof) return 0;
+            ssize_t n = read(d->fd, d->in, d->inCap);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) { archive_set_error(a, errno, "read: %s", strerror(errno)); return -1; }
+            if (n == 0) { d->eof = 1; continue; }
+            d->zin.src = d->in; d->zin.size = (size_t)n; d->zin.pos = 0;
+        }
+        ZSTD_outBuffer o = {d->out, d->outCap, 0};
+        size_t r = ZSTD_decompressStream(d->dctx, &o, &d->zin);
+        if (ZSTD_isError(r)) { archive_set_error(a, -1, "zstd: %s", ZSTD_getErrorName(r)); return -1; }
+        if (o.pos > 0) { *buf = d->out; return (la_ssize_t)o.pos; }
+    }
+}
+
+static int apg_zdec_close(struct archive *a, void *client) {
+    apg_zdec *d = client;
+    (void)a;
+    if (d->ownFd) close(d->fd);
+    ZSTD_freeDCtx(d->dctx);
+    free(d->in); free(d->out); free(d);
+    return ARCHIVE_OK;
+}
+
+// apg_read_open_dict opens a for reading fd, which holds zstd frames
+// compressed with dict, at its current offset. With ownFd, fd is closed
+// together with a.
+static int apg_read_open_dict(struct archive *a, int fd, int ownFd, const void *dict, size_t dictLen) {
+    apg_zdec *d = calloc(1, sizeof(*d));
+    d->fd = fd; d->ownFd = ownFd;
+    d->dctx = ZSTD_createDCtx();
+    d->inCap = ZSTD_DStreamInSize(); d->in = malloc(d->inCap);
+    d->outCap = ZSTD_DStreamOutSize(); d->out = malloc(d->outCap);
+    if (ZSTD_isError(ZSTD_DCtx_loadDictionary(d->dctx, dict, dictLen))) {
+        archive_set_error(a, -1, "zstd: cannot load dictionary");
+        apg_zdec_close(a, d); return ARCHIVE_FATAL;
+    }
+    return archive_read_open(a, d, NULL, apg_zdec_read, apg_zdec_close);
+}
+
+// apg_read_open opens a for archivePath: through libarchive's own filters,
+// or through apg_zdec if the package needs dict.
+static int apg_read_open(struct archive *a, const char *archivePath,
+                         const void *dict, size_t dictLen) {
+    if (!dict) return archive_read_open_filename(a, archivePath, 65536);
+    int fd = open(archivePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        archive_set_error(a, errno, "%s", strerror(errno));
+        return ARCHIVE_FATAL;
+    }
+    return apg_read_open_dict(a, fd, 1, dict, dictLen);
+}
+
+// ── Parallel frame decoding ─────────────────────────────────────────────────
+//
+// The frames of a seekable package are independent zstd frames, so a reader
+// can decompress several at once on worker threads while libarchive parses
+// the tar stream in order. Frames above APG_PDEC_INLINE (single large
+// members) are streamed by the reading thread itself, and workers decode
+// ahead only within APG_PDEC_BUDGET bytes.
+
+#define APG_PDEC_INLINE ((la_int64_t)64 << 20)
+#define APG_PDEC_BUDGET ((la_int64_t)256 << 20)
+#define APG_PDEC_KEEP   ((size_t)8 << 20)   // slot buffers kept for reuse up to this size
+
+typedef struct {
+    void *buf;
+    size_t len, cap;
+    int state;               // APG_SLOT_*
+    char err[160];
+} apg_pslot;
+
+enum { APG_SLOT_FREE, APG_SLOT_BUSY, APG_SLOT_READY, APG_SLOT_INLINE };
+
+typedef struct {
+    int fd;
+    ZSTD_DDict *ddict;       // NULL without a dictionary
+    la_int64_t *off;
+    uint32_t *cSize, *dSize;
+    int n;                   // frames
+    int window;              // frame i is decoded into slot[i % window]
+    apg_pslot *slot;
+    pthread_t *tid;
+    int threads;
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    int claim;               // next frame for a worker
+    int cur;                 // frame libarchive reads next
+    int held;                // cur's slot is handed to libarchive
+    la_int64_t used;         // bytes of claimed frames not yet released
+    int stop;
+    // The reading thread's own decoder, for APG_SLOT_INLINE frames.
+    ZSTD_DCtx *dctx;
+    void *in, *out;
+    size_t inCap, outCap;
+    ZSTD_inBuffer zin;
+    la_int64_t inPos, inLeft, produced;
+    int streaming, frameDone;
+} apg_pdec;
+
+// apg_pdec_frame reads and decompresses frame i into s.
+static void apg_pdec_frame(apg_pdec *d, ZSTD_DCtx *dctx, void **cbuf, size_t *ccap, int i, apg_pslot *s) {
+    size_t cs = d->cSize[i], ds = d->dSize[i];
+    if (cs > *ccap) {
+        free(*cbuf);
+        *ccap = cs;
+        if (!(*cbuf = malloc(cs))) { *ccap = 0; snprintf(s->err, sizeof(s->err), "frame %d: out of memory", i); return; }
+    }
+    if (ds > s->cap || !s->buf) {
+        free(s->buf);
+        s->cap = ds > 0 ? ds : 1;
+        if (!(s->buf = malloc(s->cap))) { s->cap = 0; snprintf(s->err, sizeof(s->err), "frame %d: out of memory", i); return; }
+    }
+    for (size_t got = 0; got < cs; ) {
+        ssize_t n = pread(d->fd, (char *)*cbuf + got, cs - got, d->off[i] + (la_int64_t)got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            snprintf(s->err, sizeof(s->err), "frame %d: %s", i, n < 0 ? strerror(errno) : "truncated package");
+            return;
+        }
+        got += (size_t)n;
+    }
+    size_t r = d->ddict ? ZSTD_decompress_usingDDict(dctx, s->buf, ds, *cbuf, cs, d->ddict)
+                        : ZSTD_decompressDCtx(dctx, s->buf, ds, *cbuf, cs);
+    if (ZSTD_isError(r)) { snprintf(s->err, sizeof(s->err), "frame %d: zstd: %s", i, ZSTD_getErrorName(r)); return; }
+    if (r != ds) { snprintf(s->err, sizeof(s->err), "frame %d: %zu bytes, seek table says %zu", i, r, ds); return; }
+    s->len = r;
+}
+
+static void *apg_pdec_worker(void *arg) {
+    apg_pdec *d = arg;
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    void *cbuf = NULL;
+    size_t ccap = 0;
+    pthread_mutex_lock(&d->mu);
+    for (;;) {
+        // A frame is claimed once its slot is free and it fits the budget;
+        // the frame being read always fits.
+        while (!d->stop && d->claim < d->n &&
+               (d->claim >= d->cur + d->window ||
+                (d->used > 0 && d->dSize[d->claim] <= APG_PDEC_INLINE &&
+                 d->used + d->dSize[d->claim] > APG_PDEC_BUDGET)))
+            pthread_cond_wait(&d->cv, &d->mu);
+        if (d->stop || d->claim >= d->n) break;
+        int i = d->claim++;
+        apg_pslot *s = &d->slot[i % d->window];
+        s->err[0] = 0;
+        s->len = 0;
+        if (d->dSize[i] > APG_PDEC_INLINE) {
+            s->state = APG_SLOT_INLINE;
+            pthread_cond_broadcast(&d->cv);
+            continue;
+        }
+        s->state = APG_SLOT_BUSY;
+        d->used += d->dSize[i];
+        pthread_mutex_unlock(&d->mu);
+        if (!dctx) snprintf(s->err, sizeof(s->err), "frame %d: out of memory", i);
+        else apg_pdec_frame(d, dctx, &cbuf, &ccap, i, s);
+        pthread_mutex_lock(&d->mu);
+        s->state = APG_SLOT_READY;
+        pthread_cond_broadcast(&d->cv);
+    }
+    pthread_mutex_unlock(&d->mu);
+    free(cbuf);
+    ZSTD_freeDCtx(dctx);
+    return NULL;
+}
+
+// apg_pdec_stream returns the next output of the inline frame cur: a byte
+// count, 0 once it is complete, or -1.
+static la_ssize_t apg_pdec_stream(struct archive *a, apg_pdec *d, const void **buf) {
+    for (;;) {
+        if (d->zin.pos == d->zin.size) {
+            if (d->frameDone) break;
+            if (d->inLeft == 0) { archive_set_error(a, -1, "frame %d: truncated", d->cur); return -1; }
+            size_t want = (la_int64_t)d->inCap < d->inLeft ? d->inCap : (size_t)d->inLeft;
+            ssize_t n = pread(d->fd, d->in, want, d->inPos);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                archive_set_error(a, errno, "frame %d: %s", d->cur, n < 0 ? strerror(errno) : "truncated package");
+                return -1;
+            }
+            d->inPos += n; d->inLeft -= n;
+            d->zin.src = d->in; d->zin.size = (size_t)n; d->zin.pos = 0;
+        }
+        ZSTD_outBuffer o = {d->out, d->outCap, 0};
+        size_t r = ZSTD_decompressStream(d->dctx, &o, &d->zin);
+        if (ZSTD_isError(r)) { archive_set_error(a, -1, "frame %d: zstd: %s", d->cur, ZSTD_getErrorName(r)); return -1; }
+        if (r == 0) d->frameDone = 1;
+        if (o.pos > 0) { d->produced += (la_int64_t)o.pos; *buf = d->out; return (la_ssize_t)o.pos; }
+    }
+    if (d->produced != d->dSize[d->cur]) {
+        archive_set_error(a, -1, "frame %d: %lld bytes, seek table says %u", d->cur, (long long)d->produced, d->dSize[d->cur]);
+        return -1;
+    }
+    return 0;
+}
+
+// apg_pdec_release frees the slot of frame cur and moves on to the next.
+static void apg_pdec_release(apg_pdec *d) {
+    apg_pslot *s = &d->slot[d->cur % d->window];
+    if (s->state != APG_SLOT_INLINE) d->used -= d->dSize[d->cur];
+    if (s->cap > APG_PDEC_KEEP) { free(s->buf); s->buf = NULL; s->cap = 0; }
+    s->state = APG_SLOT_FREE;
+    d->held = 0;
+    d->cur++;
+    pthread_cond_broadcast(&d->cv);
+}
+
+static la_ssize_t apg_pdec_read(struct archive *a, void *client, const void **buf) {
+    apg_pdec *d = client;
+    for (;;) {
+        if (d->streaming) {
+            la_ssize_t n = apg_pdec_stream(a, d, buf);
+            if (n != 0) return n;
+            d->streaming = 0;
+            pthread_mutex_lock(&d->mu);
+            apg_pdec_release(d);
+            pthread_mutex_unlock(&d->mu);
+        }
+        pthread_mutex_lock(&d->mu);
+        if (d->held) apg_pdec_release(d);
+        if (d->cur >= d->n) { pthread_mutex_unlock(&d->mu); return 0; }
+        apg_pslot *s = &d->slot[d->cur % d->window];
+        while (s->state == APG_SLOT_FREE || s->state == APG_SLOT_BUSY) pthread_cond_wait(&d->cv, &d->mu);
+        pthread_mutex_unlock(&d->mu);
+
+        if (s->state == APG_SLOT_INLINE) {
+            ZSTD_DCtx_reset(d->dctx, ZSTD_reset_session_only);
+            d->inPos = d->off[d->cur]; d->inLeft = d->cSize[d->cur];
+            d->zin.size = d->zin.pos = 0;
+            d->produced = 0; d->frameDone = 0;
+            d->streaming = 1;
+            continue;
+        }
+        if (s->err[0]) { archive_set_error(a, -1, "%s", s->err); return -1; }
+        d->held = 1;
+        if (s->len > 0) { *buf = s->buf; return (la_ssize_t)s->len; }
+    }
+}
+
+static int apg_pdec_close(struct archive *a, void *client) {
+    apg_pdec *d = client;
+    (void)a;
+    pthread_mutex_lock(&d->mu);
+    d->stop = 1;
+    pthread_cond_broadcast(&d->cv);
+    pthread_mutex_unlock(&d->mu);
+    for (int i = 0; i < d->threads; i++) pthread_join(d->tid[i], NULL);
+    for (int i = 0; i < d->window; i++) free(d->slot[i].buf);
+    pthread_mutex_destroy(&d->mu);
+    pthread_cond_destroy(&d->cv);
+    close(d->fd);
+    ZSTD_freeDDict(d->ddict);
+    ZSTD_freeDCtx(d->dctx);
+    free(d->in); free(d->out);
+    free(d->slot); free(d->tid); free(d->off); free(d->cSize); free(d->dSize);
+    free(d);
+    return ARCHIVE_OK;
+}
+
+// apg_read_open_frames opens a for the n frames of the seekable package at
+// archivePath (offsets off, sizes cSize/dSize as in its seek table),
+// decompressed by threads workers, with dict if the package needs one.
+static int apg_read_open_frames(struct archive *a, const char *archivePath,
+                                const la_int64_t *off, const uint32_t *cSize, const uint32_t *dSize, int n,
+                                int threads, const void *dict, size_t dictLen) {
+    int fd = open(archivePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        archive_set_error(a, errno, "%s", strerror(errno));
+        return ARCHIVE_FATAL;
+    }
+    apg_pdec *d = calloc(1, sizeof(*d));
+    d->fd = fd;
+    d->n = n;
+    d->threads = threads;
+    d->window = threads + 2;
+    d->off = malloc(n * sizeof(*off) + 1); memcpy(d->off, off, n * sizeof(*off));
+    d->cSize = malloc(n * sizeof(*cSize) + 1); memcpy(d->cSize, cSize, n * sizeof(*cSize));
+    d->dSize = malloc(n * sizeof(*dSize) + 1); memcpy(d->dSize, dSize, n * sizeof(*dSize));
+    d->slot = calloc(d->window, sizeof(*d->slot));
+    d->tid = calloc(threads, sizeof(*d->tid));
+    d->dctx = ZSTD_createDCtx();
+    d->inCap = ZSTD_DStreamInSize(); d->in = malloc(d->inCap);
+    d->outCap = ZSTD_DStreamOutSize(); d->out = malloc(d->outCap);
+    if (dict) {
+        d->ddict = ZSTD_createDDict(dict, dictLen);
+        if (d->ddict) ZSTD_DCtx_refDDict(d->dctx, d->ddict);
+    }
+    pthread_mutex_init(&d->mu, NULL);
+    pthread_cond_init(&d->cv, NULL);
+    if (!d->dctx || (dict && !d->ddict)) {
+        d->threads = 0;
+        archive_set_error(a, -1, "zstd: cannot load dictionary");
+        apg_pdec_close(a, d); return ARCHIVE_FATAL;
+    }
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&d->tid[i], NULL, apg_pdec_worker, d) != 0) {
+            d->threads = i;
+            archive_set_error(a, errno, "start decompression threads: %s", strerror(errno));
+            apg_pdec_close(a, d); return ARCHIVE_FATAL;
+        }
+    }
+    return archive_read_open(a, d, NULL, apg_pdec_read, apg_pdec_close);
+}
+
+// apg_sink is the client side of a plain (non-seekable) writer. With z set
+// the tar stream is compressed here rather than by a libarchive filter.
+typedef struct {
+    int fd;
+    apg_stats *st;
+    apg_zenc *z;
+} apg_sink;
+
+static la_ssize_t apg_sink_write(struct archive *a, void *client, const void *buf, size_t len) {
+    apg_sink *s = client;
+    if (s->z) {
+        char err[256];
+        if (apg_zenc_run(s->z, buf, len, ZSTD_e_continue, s->fd, s->st, NULL, err, sizeof(err)) != 0) {
+            archive_set_error(a, -1, "%s", err);
+            return -1;
+        }
+        return (la_ssize_t)len;
+    }
+    if (apg_fd_write(s->fd, s->st, buf, len) != 0) {
+        archive_set_error(a, errno, "write: %s", strerror(errno));
+        return -1;
+    }
+    return (la_ssize_t)len;
+}
+
+static int apg_sink_close(struct archive *a, void *client) {
+    apg_sink *s = client;
+    int r = ARCHIVE_OK;
+    if (s->z) {
+        char err[256];
+        if (apg_zenc_run(s->z, NULL, 0, ZSTD_e_end, s->fd, s->st, NULL, err, sizeof(err)) != 0) {
+            archive_set_error(a, -1, "%s", err);
+            r = ARCHIVE_FATAL;
+        }
+        apg_zenc_free(s->z);
+        s->z = NULL;
+    }
+    if (s->fd >= 0 && close(s->fd) != 0 && r == ARCHIVE_OK) {
+        archive_set_error(a, errno, "close: %s", strerror(errno));
+        r = ARCHIVE_FATAL;
+    }
+    return r;
+}
+
+// apg_write_new returns an archive writer opened at archivePath (or on
+// outFd if not -1, or to sink->st->sink if set) with the requested
+// compression filter and the APG tar format, or NULL on error.
 // compressionType: "zstd", "xz", "bz2", "gz", "lz4", "lzma"
 // level: compression level (0 = algorithm default)
-static int apg_create(const char *archivePath, const char *sourceDir,
-                      const char *compressionType, int level,
-                      char *errBuf, int errBufLen) {
+// threads: compressor threads for zstd/xz (0 = libarchive default, single)
+// dict, if not NULL, is a zstd dictionary (compressionType must be zstd).
+// sink receives the package file; it must outlive the archive.
+static struct archive *apg_write_new(const char *archivePath, int outFd,
+                                     const char *compressionType, int level, int threads,
+                                     const void *dict, size_t dictLen,
+                                     apg_sink *sink, char *errBuf, int errBufLen) {
     struct archive *a = archive_write_new();
-    if (!a) { snprintf(errBuf, errBufLen, "archive_write_new failed"); return -1; }
+    if (!a) { snprintf(errBuf, errBufLen, "archive_write_new failed"); return NULL; }
 
     int r = ARCHIVE_FAILED;
-    if      (strcmp(compressionType, "zstd") == 0) r = archive_write_add_filter_zstd(a);
+    if (dict) {
+        if (strcmp(compressionType, "zstd") != 0) {
+            snprintf(errBuf, errBufLen, "zstd dictionaries require zstd, not %s", compressionType);
+            archive_write_free(a); return NULL;
+        }
+        sink->z = apg_zenc_new(dict, dictLen, level, threads, errBuf, errBufLen);
+        if (!sink->z) { archive_write_free(a); return NULL; }
+        r = archive_write_add_filter_none(a);
+        level = threads = 0;
+    }
+    else if (strcmp(compressionType, "zstd") == 0) r = archive_write_add_filter_zstd(a);
     else if (strcmp(compressionType, "xz")   == 0) r = archive_write_add_filter_xz(a);
     else if (strcmp(compressionType, "bz2")  == 0) r = archive_write_add_filter_bzip2(a);
     else if (strcmp(compressionType, "gz")   == 0) r = archive_write_add_filter_gzip(a);
@@ -31,78 +579,780 @@ static int apg_create(const char *archivePath, const char *sourceDir,
     else if (strcmp(compressionType, "lzma") == 0) r = archive_write_add_filter_lzma(a);
     else {
         snprintf(errBuf, errBufLen, "unknown compression: %s", compressionType);
-        archive_write_free(a); return -1;
+        archive_write_free(a); return NULL;
     }
 
     if (r != ARCHIVE_OK) {
         snprintf(errBuf, errBufLen, "set filter %s: %s", compressionType, archive_error_string(a));
-        archive_write_free(a); return -1;
+        apg_zenc_free(sink->z); sink->z = NULL;
+        archive_write_free(a); return NULL;
     }
 
     if (level > 0) {
-        char lvl[8]; snprintf(lvl, sizeof(lvl), "%d", level);
+        char lvl[16]; snprintf(lvl, sizeof(lvl), "%d", level);
         archive_write_set_filter_option(a, NULL, "compression-level", lvl);
     }
 
+    if (threads > 0 && (strcmp(compressionType, "zstd") == 0 || strcmp(compressionType, "xz") == 0)) {
+        char thr[16]; snprintf(thr, sizeof(thr), "%d", threads);
+        if (archive_write_set_filter_option(a, NULL, "threads", thr) != ARCHIVE_OK) {
+            snprintf(errBuf, errBufLen, "set %s threads: %s", compressionType, archive_error_string(a));
+            archive_write_free(a); return NULL;
+        }
+    }
+
     archive_write_set_format_pax_restricted(a);
 
-    if (archive_write_open_filename(a, archivePath) != ARCHIVE_OK) {
+    sink->fd = outFd;
+    if (outFd < 0 && !sink->st->sink &&
+        (sink->fd = open(archivePath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+        snprintf(errBuf, errBufLen, "open %s: %s", archivePath, strerror(errno));
+        apg_zenc_free(sink->z); sink->z = NULL;
+        archive_write_free(a); return NULL;
+    }
+    // Like archive_write_open_filename on a regular file: no last-block padding.
+    archive_write_set_bytes_in_last_block(a, 1);
+    if (archive_write_open(a, sink, NULL, apg_sink_write, apg_sink_close) != ARCHIVE_OK) {
         snprintf(errBuf, errBufLen, "open %s: %s", archivePath, archive_error_string(a));
-        archive_write_free(a); return -1;
+        archive_write_free(a); return NULL;
     }
+    return a;
+}
 
-    struct archive *disk = archive_read_disk_new();
-    archive_read_disk_set_standard_lookup(disk);
-    archive_read_disk_set_symlink_logical(disk);
+// ── Seekable (APGv2 framed) output ──────────────────────────────────────────
+//
+// A seekable package is a plain tar+zstd stream cut into independent zstd
+// frames at member boundaries, followed by two skippable frames: an APG
+// member index (path → frame) and a seek table in the zstd seekable format
+// (frame sizes). Any zstd reader sees one valid concatenated stream; readers
+// that know the layout decompress from the start of a member's frame only.
 
-    r = archive_read_disk_open(disk, sourceDir);
+#define APG_SEEK_TABLE_MAGIC  0x184D2A5Eu  // zstd seekable format skippable frame
+#define APG_SEEK_FOOTER_MAGIC 0x8F92EAB1u
+#define APG_INDEX_MAGIC       0x184D2A5Au  // APG member index skippable frame
+#define APG_INDEX_TAG         0x49475041u  // "APGI"
+// Frames are split inside a member before they outgrow the u32 seek table fields.
+#define APG_MAX_FRAME         ((la_int64_t)1 << 30)
+// Level of the frames of members that do not compress further: zstd stores
+// their blocks raw after a quick look.
+#define APG_FAST_LEVEL        1
+
+typedef struct {
+    int fd;
+    apg_stats *st;
+    int level, threads;
+    la_int64_t frameSize;    // cut at the next member boundary past this
+    int open;                // a frame is being written
+    struct archive *z;       // compressor of the current frame (no dictionary)
+    apg_zenc *zenc;          // compressor of every frame with a dictionary
+    la_int64_t in, out;      // uncompressed / compressed bytes of the current frame
+    int aligned, nextAligned; // frame starts (will start) at a member header
+    la_int64_t swallow;      // tar bytes to drop: data of a spliced member
+    int fast;                // frames until the next header: APG_FAST_LEVEL
+    uint32_t *cSize, *dSize; // finished frames
+    int n, cap;
+    char err[256];
+} apg_frames;
+
+static la_ssize_t apg_frames_out(struct archive *z, void *ctx, const void *buf, size_t len) {
+    apg_frames *f = ctx;
+    if (apg_fd_write(f->fd, f->st, buf, len) != 0) {
+        archive_set_error(z, errno, "write: %s", strerror(errno));
+        return -1;
+    }
+    f->out += (la_int64_t)len;
+    return (la_ssize_t)len;
+}
+
+static int apg_frames_begin(apg_frames *f) {
+    f->in = f->out = 0;
+    f->aligned = f->nextAligned;
+    if (f->zenc) { f->open = 1; return 0; }
+
+    struct archive *z = archive_write_new();
+    archive_write_add_filter_zstd(z);
+    int level = f->fast ? APG_FAST_LEVEL : f->level;
+    if (level > 0) {
+        char lvl[16]; snprintf(lvl, sizeof(lvl), "%d", level);
+        archive_write_set_filter_option(z, NULL, "compression-level", lvl);
+    }
+    if (f->threads > 0) {
+        char thr[16]; snprintf(thr, sizeof(thr), "%d", f->threads);
+        archive_write_set_filter_option(z, NULL, "threads", thr);
+    }
+    archive_write_set_format_raw(z);
+    archive_write_set_bytes_per_block(z, 0);
+    if (archive_write_open(z, f, NULL, apg_frames_out, NULL) != ARCHIVE_OK) {
+        snprintf(f->err, sizeof(f->err), "open frame: %s", archive_error_string(z));
+        archive_write_free(z); return -1;
+    }
+    struct archive_entry *e = archive_entry_new();
+    archive_entry_set_pathname(e, "frame");
+    archive_entry_set_filetype(e, AE_IFREG);
+    int r = archive_write_header(z, e);
+    archive_entry_free(e);
     if (r != ARCHIVE_OK) {
-        snprintf(errBuf, errBufLen, "open dir %s: %s", sourceDir, archive_error_string(disk));
-        archive_read_free(disk); archive_write_free(a); return -1;
+        snprintf(f->err, sizeof(f->err), "open frame: %s", archive_error_string(z));
+        archive_write_free(z); return -1;
+    }
+    f->z = z;
+    f->open = 1;
+    return 0;
+}
+
+// apg_frames_push records a finished frame.
+static void apg_frames_push(apg_frames *f, la_int64_t cSize, la_int64_t dSize) {
+    if (f->n == f->cap) {
+        f->cap = f->cap ? f->cap * 2 : 64;
+        f->cSize = realloc(f->cSize, f->cap * sizeof(uint32_t));
+        f->dSize = realloc(f->dSize, f->cap * sizeof(uint32_t));
+    }
+    f->cSize[f->n] = (uint32_t)cSize;
+    f->dSize[f->n] = (uint32_t)dSize;
+    f->n++;
+}
+
+// apg_frames_end finishes the current frame, if any, and records its sizes.
+static int apg_frames_end(apg_frames *f) {
+    if (!f->open) return 0;
+    f->open = 0;
+    if (f->zenc) {
+        if (apg_zenc_run(f->zenc, NULL, 0, ZSTD_e_end, f->fd, f->st, &f->out, f->err, sizeof(f->err)) != 0)
+            return -1;
+    } else {
+        int r = archive_write_close(f->z);
+        if (r != ARCHIVE_OK)
+            snprintf(f->err, sizeof(f->err), "close frame: %s", archive_error_string(f->z));
+        archive_write_free(f->z);
+        f->z = NULL;
+        if (r != ARCHIVE_OK) return -1;
+    }
+
+    apg_frames_push(f, f->out, f->in);
+    return 0;
+}
+
+// apg_frames_in receives the uncompressed tar stream.
+static la_ssize_t apg_frames_in(struct archive *t, void *ctx, const void *buf, size_t len) {
+    apg_frames *f = ctx;
+    const char *p = buf;
+    size_t left = len;
+    while (left > 0) {
+        if (f->swallow > 0) {
+            size_t n = (la_int64_t)left < f->swallow ? left : (size_t)f->swallow;
+            f->swallow -= (la_int64_t)n; p += n; left -= n;
+            continue;
+        }
+        if (!f->open && apg_frames_begin(f) != 0) {
+            archive_set_error(t, -1, "%s", f->err); return -1;
+        }
+        size_t n = left;
+        if ((la_int64_t)n > APG_MAX_FRAME - f->in) n = (size_t)(APG_MAX_FRAME - f->in);
+        if (f->zenc) {
+            if (apg_zenc_run(f->zenc, p, n, ZSTD_e_continue, f->fd, f->st, &f->out, f->err, sizeof(f->err)) != 0) {
+                archive_set_error(t, -1, "%s", f->err); return -1;
+            }
+        } else if (archive_write_data(f->z, p, n) < 0) {
+            archive_set_error(t, -1, "compress: %s", archive_error_string(f->z)); return -1;
+        }
+        f->in += (la_int64_t)n; p += n; left -= n;
+        if (f->in >= APG_MAX_FRAME) {
+            if (apg_frames_end(f) != 0) { archive_set_error(t, -1, "%s", f->err); return -1; }
+            f->nextAligned = 0;
+        }
+    }
+    return (la_ssize_t)len;
+}
+
+// apg_frames_cut ends the current frame at a member boundary.
+static int apg_frames_cut(apg_frames *f) {
+    if (apg_frames_end(f) != 0) return -1;
+    f->nextAligned = 1;
+    return 0;
+}
+
+static void apg_put32(unsigned char *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static int apg_write_all(apg_frames *f, const void *buf, size_t len) {
+    if (apg_fd_write(f->fd, f->st, buf, len) != 0) {
+        snprintf(f->err, sizeof(f->err), "write: %s", strerror(errno)); return -1;
+    }
+    return 0;
+}
+
+// apg_writer is an archive fed one entry at a time by the caller.
+// File data either comes from the caller through apg_writer_data, so the
+// same bytes can be consumed elsewhere, or is read by apg_writer_file.
+typedef struct {
+    struct archive *a;
+    struct archive *disk;
+    struct archive_entry *entry;
+    apg_frames *frames;      // non-NULL for seekable output
+    char **idxPath;          // member index: header of idxPath[i] is in frame idxFrame[i]
+    uint32_t *idxFrame;
+    int idxN, idxCap;
+    void *ioBuf;             // apg_writer_file read buffer, APG_IO_BUF bytes
+    apg_sink sink;           // package file of a plain writer
+    apg_stats stats;
+    int repro;               // normalize owners, drop atime/ctime
+    la_int64_t clamp;        // with repro: latest mtime stored (0 = none)
+    apg_limits limits;       // checked on every header
+    apg_zenc *benc;          // compressor of blobs without a dictionary
+} apg_writer;
+
+// Read buffer of apg_writer_file: files up to this size take a single read().
+#define APG_IO_BUF   (4 << 20)
+#define APG_IO_ALIGN 4096
+
+// The package goes to archivePath, outFd (if not -1, closed with the
+// writer) or the Go io.Writer sink (if not 0).
+static apg_writer *apg_writer_new(const char *archivePath, int outFd, uintptr_t sink,
+                                  const char *compressionType, int level, int threads,
+                                  int seekable, la_int64_t frameSize, int blobs,
+                                  int repro, la_int64_t clamp,
+                                  const void *dict, size_t dictLen, const apg_limits *limits,
+                                  char *errBuf, int errBufLen) {
+    apg_writer *w = calloc(1, sizeof(*w));
+    w->stats.sink = sink;
+    w->limits = *limits;
+    w->repro = repro;
+    w->clamp = clamp;
+    struct archive *a;
+    apg_frames *frames = NULL;
+
+    if (!seekable) {
+        w->sink.st = &w->stats;
+        a = apg_write_new(archivePath, outFd, compressionType, level, threads, dict, dictLen,
+                          &w->sink, errBuf, errBufLen);
+        if (!a) { free(w); return NULL; }
+    } else {
+        if (strcmp(compressionType, "zstd") != 0) {
+            snprintf(errBuf, errBufLen, "seekable packages require zstd, not %s", compressionType);
+            free(w); return NULL;
+        }
+        apg_zenc *zenc = NULL;
+        if (dict && !(zenc = apg_zenc_new(dict, dictLen, level, threads, errBuf, errBufLen))) {
+            free(w); return NULL;
+        }
+        int fd = outFd;
+        if (fd < 0 && !sink && (fd = open(archivePath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+            snprintf(errBuf, errBufLen, "open %s: %s", archivePath, strerror(errno));
+            apg_zenc_free(zenc); free(w); return NULL;
+        }
+        frames = calloc(1, sizeof(*frames));
+        frames->zenc = zenc;
+        frames->fd = fd;
+        frames->st = &w->stats;
+        frames->level = level;
+        frames->threads = threads;
+        frames->frameSize = frameSize;
+        frames->nextAligned = 1;
+        // Blobs are compressed single-threaded: the same file always gives
+        // the same blob.
+        if (blobs && !(w->benc = apg_zenc_new(dict, dictLen, level, 0, errBuf, errBufLen))) {
+            if (fd >= 0) close(fd);
+            apg_zenc_free(zenc); free(frames); free(w); return NULL;
+        }
+
+        // The tar stream is left uncompressed and unblocked, so every byte
+        // reaches apg_frames_in as soon as the tar writer emits it.
+        a = archive_write_new();
+        archive_write_add_filter_none(a);
+        archive_write_set_format_pax_restricted(a);
+        archive_write_set_bytes_per_block(a, 0);
+        if (archive_write_open(a, frames, NULL, apg_frames_in, NULL) != ARCHIVE_OK) {
+            snprintf(errBuf, errBufLen, "open %s: %s", archivePath, archive_error_string(a));
+            archive_write_free(a); if (fd >= 0) close(fd);
+            apg_zenc_free(zenc); free(frames); free(w); return NULL;
+        }
+    }
+
+    w->a = a;
+    w->frames = frames;
+    w->disk = archive_read_disk_new();
+    archive_read_disk_set_standard_lookup(w->disk);
+    archive_read_disk_set_symlink_physical(w->disk);
+    w->entry = archive_entry_new();
+    return w;
+}
+
+// apg_writer_boundary runs before every header of a seekable writer: it
+// flushes the previous member's padding into its frame, cuts the frame if
+// it is full (or did not start on a header) and indexes relPath.
+static int apg_writer_boundary(apg_writer *w, const char *relPath, char *errBuf, int errBufLen) {
+    apg_frames *f = w->frames;
+    if (archive_write_finish_entry(w->a) != ARCHIVE_OK) {
+        snprintf(errBuf, errBufLen, "write: %s", archive_error_string(w->a)); return -1;
+    }
+    if (!f->open) {
+        f->nextAligned = 1;
+    } else if ((f->in >= f->frameSize || !f->aligned) && apg_frames_cut(f) != 0) {
+        snprintf(errBuf, errBufLen, "%s", f->err); return -1;
+    }
+    f->fast = 0;
+    if (w->idxN == w->idxCap) {
+        w->idxCap = w->idxCap ? w->idxCap * 2 : 256;
+        w->idxPath = realloc(w->idxPath, w->idxCap * sizeof(char *));
+        w->idxFrame = realloc(w->idxFrame, w->idxCap * sizeof(uint32_t));
     }
+    w->idxPath[w->idxN] = strdup(relPath);
+    w->idxFrame[w->idxN] = (uint32_t)f->n;  // the current frame, or the next one to open
+    w->idxN++;
+    return 0;
+}
+
+// apg_writer_cut ends the current frame so the next member starts a new
+// one. It does nothing for non-seekable writers.
+static int apg_writer_cut(apg_writer *w, char *errBuf, int errBufLen) {
+    if (!w->frames) return 0;
+    if (archive_write_finish_entry(w->a) != ARCHIVE_OK) {
+        snprintf(errBuf, errBufLen, "write: %s", archive_error_string(w->a)); return -1;
+    }
+    if (apg_frames_cut(w->frames) != 0) {
+        snprintf(errBuf, errBufLen, "%s", w->frames->err); return -1;
+    }
+    return 0;
+}
+
+// apg_writer_fast compresses the data of the member whose header was just
+// written in frames of its own at APG_FAST_LEVEL. It does nothing for
+// non-seekable writers, and with a dictionary, whose level is fixed.
+static int apg_writer_fast(apg_writer *w, char *errBuf, int errBufLen) {
+    apg_frames *f = w->frames;
+    if (!f || f->zenc) return 0;
+    if (apg_frames_end(f) != 0) {
+        snprintf(errBuf, errBufLen, "%s", f->err); return -1;
+    }
+    f->nextAligned = 0;  // cut again at the next header
+    f->fast = 1;
+    return 0;
+}
+
+// apg_normalize strips what varies between build hosts from an entry:
+// owners become root, atime/ctime/birthtime are not stored and mtimes are
+// clamped to w->clamp.
+static void apg_normalize(apg_writer *w, struct archive_entry *e) {
+    archive_entry_set_uid(e, 0);
+    archive_entry_set_gid(e, 0);
+    archive_entry_copy_uname(e, "root");
+    archive_entry_copy_gname(e, "root");
+    archive_entry_unset_atime(e);
+    archive_entry_unset_ctime(e);
+    archive_entry_unset_birthtime(e);
+    if (w->clamp > 0 && archive_entry_mtime(e) >= w->clamp)
+        archive_entry_set_mtime(e, w->clamp, 0);
+}
+
+// apg_writer_put checks w->entry against w's limits and writes it,
+// starting a new frame first if one is due.
+static int apg_writer_put(apg_writer *w, const char *relPath, char *errBuf, int errBufLen) {
+    // What the header declares is exactly what will follow.
+    la_int64_t declared = archive_entry_filetype(w->entry) == AE_IFREG ? archive_entry_size(w->entry) : 0;
+    int lr = apg_limit_entry(&w->limits, relPath, declared, errBuf, errBufLen);
+    if (lr != 0) return lr;
+    w->limits.total += declared;
+
+    if (w->frames && apg_writer_boundary(w, relPath, errBuf, errBufLen) != 0) return -1;
+    if (archive_write_header(w->a, w->entry) != ARCHIVE_OK) {
+        snprintf(errBuf, errBufLen, "write header %s: %s", relPath, archive_error_string(w->a));
+        return -1;
+    }
+    return 0;
+}
+
+// apg_writer_header writes the header of fullPath stored as relPath. st is
+// the file's lstat result if the caller already has it, or NULL to stat
+// fullPath here. A non-NULL hardlink stores the entry as a hardlink to that
+// earlier member, without data. fileType and size report what was written,
+// so the caller knows whether (and how much) data must follow. Returns -1
+// on error and APG_ELIMIT if the entry would exceed w's limits.
+static int apg_writer_header(apg_writer *w, const char *fullPath, const char *relPath,
+                             const struct stat *st, const char *hardlink,
+                             unsigned int *fileType, la_int64_t *size,
+                             char *errBuf, int errBufLen) {
+    archive_entry_clear(w->entry);
+    archive_entry_copy_sourcepath(w->entry, fullPath);
+    if (archive_read_disk_entry_from_file(w->disk, w->entry, -1, st) != ARCHIVE_OK) {
+        snprintf(errBuf, errBufLen, "stat %s: %s", fullPath, archive_error_string(w->disk));
+        return -1;
+    }
+    archive_entry_copy_pathname(w->entry, relPath);
+    if (w->repro) apg_normalize(w, w->entry);
+    if (hardlink) {
+        archive_entry_copy_hardlink(w->entry, hardlink);
+        archive_entry_set_size(w->entry, 0);
+    }
+    int r = apg_writer_put(w, relPath, errBuf, errBufLen);
+    if (r != 0) return r;
+    *fileType = archive_entry_filetype(w->entry);
+    *size = archive_entry_size(w->entry);
+    return 0;
+}
+
+// apg_writer_entry writes a header built from raw fields, e.g. those of a
+// member of another archive, without data: size bytes must follow for a
+// regular file that is not a hardlink. symlink and hardlink may be NULL.
+static int apg_writer_entry(apg_writer *w, const char *relPath, unsigned int fileType,
+                            unsigned int perm, la_int64_t size, la_int64_t mtime, long mtimeNsec,
+                            la_int64_t uid, la_int64_t gid, la_int64_t rdev,
+                            const char *symlink, const char *hardlink,
+                            char *errBuf, int errBufLen) {
+    archive_entry_clear(w->entry);
+    archive_entry_copy_pathname(w->entry, relPath);
+    archive_entry_set_filetype(w->entry, fileType);
+    archive_entry_set_perm(w->entry, perm);
+    archive_entry_set_mtime(w->entry, mtime, mtimeNsec);
+    archive_entry_set_uid(w->entry, uid);
+    archive_entry_set_gid(w->entry, gid);
+    archive_entry_set_rdev(w->entry, (dev_t)rdev);
+    if (symlink) archive_entry_copy_symlink(w->entry, symlink);
+    if (hardlink) archive_entry_copy_hardlink(w->entry, hardlink);
+    archive_entry_set_size(w->entry, fileType == AE_IFREG && !hardlink ? size : 0);
+    if (w->repro) apg_normalize(w, w->entry);
+    return apg_writer_put(w, relPath, errBuf, errBufLen);
+}
+
+static int apg_writer_data(apg_writer *w, const void *buf, size_t len,
+                           char *errBuf, int errBufLen) {
+    if (archive_write_data(w->a, buf, len) < 0) {
+        snprintf(errBuf, errBufLen, "write data: %s", archive_error_string(w->a));
+        return -1;
+    }
+    return 0;
+}
+
+// apg_writer_file reads size bytes of fullPath straight into the current
+// entry through a reusable page-aligned buffer: one read() for files that
+// fit the buffer, large sequential reads with readahead hinted otherwise.
+// mmap is avoided on purpose: a file truncated while mapped would SIGBUS.
+static int apg_writer_file(apg_writer *w, const char *fullPath, la_int64_t size,
+                           char *errBuf, int errBufLen) {
+    if (!w->ioBuf && posix_memalign(&w->ioBuf, APG_IO_ALIGN, APG_IO_BUF) != 0) {
+        w->ioBuf = NULL;
+        snprintf(errBuf, errBufLen, "read %s: out of memory", fullPath); return -1;
+    }
+    int fd = open(fullPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        snprintf(errBuf, errBufLen, "open %s: %s", fullPath, strerror(errno)); return -1;
+    }
+    if (size > APG_IO_BUF) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    int r = 0;
+    while (size > 0) {
+        size_t want = size < APG_IO_BUF ? (size_t)size : APG_IO_BUF;
+        la_int64_t t0 = apg_now();
+        ssize_t n = read(fd, w->ioBuf, want);
+        w->stats.readNs += apg_now() - t0;
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            snprintf(errBuf, errBufLen, "read %s: %s", fullPath, strerror(errno)); r = -1; break;
+        }
+        if (n == 0) {
+            snprintf(errBuf, errBufLen, "read %s: file changed size while archiving", fullPath);
+            r = -1; break;
+        }
+        if (archive_write_data(w->a, w->ioBuf, (size_t)n) < 0) {
+            snprintf(errBuf, errBufLen, "write data: %s", archive_error_string(w->a)); r = -1; break;
+        }
+        size -= n;
+    }
+    close(fd);
+    return r;
+}
 
-    struct archive_entry *entry = archive_entry_new();
-    int sourceDirLen = (int)strlen(sourceDir);
+// ── Blob splicing ───────────────────────────────────────────────────────────
+//
+// A blob is one zstd frame holding a regular member's tar data: the file
+// and the zeros padding it to a 512-byte record. In a seekable package it
+// can stand in for the frame the member's data would have been compressed
+// into, so a file seen before is copied into the package compressed.
 
+static la_int64_t apg_pad(la_int64_t size) { return (512 - size % 512) % 512; }
+
+// apg_writer_blob compresses size bytes of fullPath and their padding into
+// a blob written to fd, with w's level and dictionary.
+static int apg_writer_blob(apg_writer *w, const char *fullPath, la_int64_t size, int fd,
+                           char *errBuf, int errBufLen) {
+    if (!w->benc) {
+        snprintf(errBuf, errBufLen, "blobs need a seekable writer"); return -1;
+    }
+    if (!w->ioBuf && posix_memalign(&w->ioBuf, APG_IO_ALIGN, APG_IO_BUF) != 0) {
+        w->ioBuf = NULL;
+        snprintf(errBuf, errBufLen, "read %s: out of memory", fullPath); return -1;
+    }
+    int in = open(fullPath, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        snprintf(errBuf, errBufLen, "open %s: %s", fullPath, strerror(errno)); return -1;
+    }
+    if (size > APG_IO_BUF) posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // The content size in the frame header is what apg_writer_splice checks.
+    la_int64_t pad = apg_pad(size);
+    ZSTD_CCtx_reset(w->benc->cctx, ZSTD_reset_session_only);
+    ZSTD_CCtx_setPledgedSrcSize(w->benc->cctx, (unsigned long long)(size + pad));
+    apg_stats st = {0};
+    int r = 0;
+    while (size > 0) {
+        size_t want = size < APG_IO_BUF ? (size_t)size : APG_IO_BUF;
+        la_int64_t t0 = apg_now();
+        ssize_t n = read(in, w->ioBuf, want);
+        w->stats.readNs += apg_now() - t0;
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            snprintf(errBuf, errBufLen, "read %s: %s", fullPath, strerror(errno)); r = -1; break;
+        }
+        if (n == 0) {
+            snprintf(errBuf, errBufLen, "read %s: file changed size while archiving", fullPath);
+            r = -1; break;
+        }
+        if (apg_zenc_run(w->benc, w->ioBuf, (size_t)n, ZSTD_e_continue, fd, &st, NULL, errBuf, errBufLen) != 0) {
+            r = -1; break;
+        }
+        size -= n;
+    }
+    close(in);
+    static const char zeros[512];
+    if (r == 0 && apg_zenc_run(w->benc, zeros, (size_t)pad, ZSTD_e_end, fd, &st, NULL, errBuf, errBufLen) != 0)
+        r = -1;
+    return r;
+}
+
+// apg_writer_splice stores the data of the member whose header was just
+// written (size bytes) as the blob at blobPath: the frame holding the
+// header ends, the blob follows as a frame of its own and the tar writer's
+// copy of the data, the zeros it pads the member with, is dropped.
+static int apg_writer_splice(apg_writer *w, const char *blobPath, la_int64_t size,
+                             char *errBuf, int errBufLen) {
+    apg_frames *f = w->frames;
+    la_int64_t want = size + apg_pad(size);
+    if (!f || want > APG_MAX_FRAME) {
+        snprintf(errBuf, errBufLen, "splice %s: not a seekable member frame", blobPath); return -1;
+    }
+    if (!w->ioBuf && posix_memalign(&w->ioBuf, APG_IO_ALIGN, APG_IO_BUF) != 0) {
+        w->ioBuf = NULL;
+        snprintf(errBuf, errBufLen, "read %s: out of memory", blobPath); return -1;
+    }
+    int fd = open(blobPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        snprintf(errBuf, errBufLen, "open %s: %s", blobPath, strerror(errno)); return -1;
+    }
+    unsigned char hdr[18];
+    struct stat bst;
+    ssize_t hn = pread(fd, hdr, sizeof(hdr), 0);
+    unsigned dictID = w->benc->cdict ? ZSTD_getDictID_fromCDict(w->benc->cdict) : 0;
+    if (hn <= 0 || fstat(fd, &bst) != 0 || bst.st_size > UINT32_MAX ||
+        ZSTD_getFrameContentSize(hdr, (size_t)hn) != (unsigned long long)want ||
+        ZSTD_getDictID_fromFrame(hdr, (size_t)hn) != dictID) {
+        snprintf(errBuf, errBufLen, "splice %s: not a blob of %lld bytes", blobPath, (long long)size);
+        close(fd); return -1;
+    }
+    if (apg_frames_end(f) != 0) {
+        snprintf(errBuf, errBufLen, "%s", f->err); close(fd); return -1;
+    }
+
+    int r = 0;
+    la_int64_t copied = 0;
     for (;;) {
-        r = archive_read_next_header2(disk, entry);
-        if (r == ARCHIVE_EOF) break;
-        if (r != ARCHIVE_OK) {
-            snprintf(errBuf, errBufLen, "read disk: %s", archive_error_string(disk));
-            break;
+        la_int64_t t0 = apg_now();
+        ssize_t n = read(fd, w->ioBuf, APG_IO_BUF);
+        w->stats.readNs += apg_now() - t0;
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            snprintf(errBuf, errBufLen, "read %s: %s", blobPath, strerror(errno)); r = -1; break;
         }
-        archive_read_disk_descend(disk);
+        if (n == 0) break;
+        if (apg_fd_write(f->fd, f->st, w->ioBuf, (size_t)n) != 0) {
+            snprintf(errBuf, errBufLen, "write: %s", strerror(errno)); r = -1; break;
+        }
+        copied += n;
+    }
+    close(fd);
+    if (r != 0) return -1;
+    apg_frames_push(f, copied, want);
+    f->nextAligned = 1;
+    f->swallow = want;
+    return 0;
+}
+
+// apg_writer_finish_frames ends the last frame and appends the member
+// index and seek table.
+static int apg_writer_finish_frames(apg_writer *w) {
+    apg_frames *f = w->frames;
+    if (apg_frames_end(f) != 0) return -1;
 
-        const char *fullPath = archive_entry_pathname(entry);
-        const char *relPath = fullPath + sourceDirLen;
-        while (*relPath == '/') relPath++;
-        if (*relPath == '\0') continue;
-        archive_entry_set_pathname(entry, relPath);
+    // Member index: magic, size, "APGI", version, count, {frame, len, path}...,
+    // then its own total size and "APGI" so it can be found from the end.
+    size_t body = 12;
+    for (int i = 0; i < w->idxN; i++) body += 6 + strlen(w->idxPath[i]);
+    body += 8;
+    unsigned char *idx = malloc(8 + body), *p = idx;
+    apg_put32(p, APG_INDEX_MAGIC); apg_put32(p + 4, (uint32_t)body); p += 8;
+    apg_put32(p, APG_INDEX_TAG); apg_put32(p + 4, 1); apg_put32(p + 8, (uint32_t)w->idxN); p += 12;
+    for (int i = 0; i < w->idxN; i++) {
+        size_t len = strlen(w->idxPath[i]);
+        apg_put32(p, w->idxFrame[i]);
+        p[4] = len; p[5] = len >> 8;
+        memcpy(p + 6, w->idxPath[i], len);
+        p += 6 + len;
+    }
+    apg_put32(p, (uint32_t)(8 + body)); apg_put32(p + 4, APG_INDEX_TAG);
+    int r = apg_write_all(f, idx, 8 + body);
+    free(idx);
+    if (r != 0) return -1;
 
-        if (archive_write_header(a, entry) != ARCHIVE_OK) continue;
+    // Seek table (zstd seekable format, no per-frame checksums).
+    size_t tbl = (size_t)f->n * 8 + 9;
+    unsigned char *st = malloc(8 + tbl);
+    apg_put32(st, APG_SEEK_TABLE_MAGIC); apg_put32(st + 4, (uint32_t)tbl);
+    for (int i = 0; i < f->n; i++) {
+        apg_put32(st + 8 + i * 8, f->cSize[i]);
+        apg_put32(st + 12 + i * 8, f->dSize[i]);
+    }
+    apg_put32(st + 8 + f->n * 8, (uint32_t)f->n);
+    st[12 + f->n * 8] = 0;
+    apg_put32(st + 13 + f->n * 8, APG_SEEK_FOOTER_MAGIC);
+    r = apg_write_all(f, st, 8 + tbl);
+    free(st);
+    return r;
+}
 
-        if (archive_entry_size(entry) > 0) {
-            FILE *f = fopen(fullPath, "rb");
-            if (f) {
-                char buf[65536]; size_t n;
-                while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
-                    archive_write_data(a, buf, n);
-                fclose(f);
-            }
+// apg_writer_close finishes the archive, frees w and reports its stats.
+static int apg_writer_close(apg_writer *w, apg_stats *stats, char *errBuf, int errBufLen) {
+    int r = archive_write_close(w->a) == ARCHIVE_OK ? 0 : -1;
+    if (r != 0)
+        snprintf(errBuf, errBufLen, "close: %s", archive_error_string(w->a));
+    w->stats.tarBytes = archive_filter_bytes(w->a, 0);
+    archive_write_free(w->a);
+
+    if (w->frames) {
+        apg_frames *f = w->frames;
+        if (r == 0 && apg_writer_finish_frames(w) != 0) {
+            snprintf(errBuf, errBufLen, "close: %s", f->err); r = -1;
         }
+        if (f->z) archive_write_free(f->z);
+        apg_zenc_free(f->zenc);
+        if (f->fd >= 0 && close(f->fd) != 0 && r == 0) {
+            snprintf(errBuf, errBufLen, "close: %s", strerror(errno)); r = -1;
+        }
+        free(f->cSize); free(f->dSize); free(f);
+        for (int i = 0; i < w->idxN; i++) free(w->idxPath[i]);
+        free(w->idxPath); free(w->idxFrame);
     }
 
-    archive_entry_free(entry);
-    archive_read_close(disk);
-    archive_read_free(disk);
-    archive_write_close(a);
-    archive_write_free(a);
-    return (r == ARCHIVE_EOF || r == ARCHIVE_OK) ? 0 : -1;
+    apg_zenc_free(w->benc);
+    archive_read_free(w->disk);
+    archive_entry_free(w->entry);
+    *stats = w->stats;
+    free(w->ioBuf);
+    free(w);
+    return r;
 }
 
-// apg_extract extracts an archive to destDir (auto-detects format).
-static int apg_extract(const char *archivePath, const char *destDir,
+// apg_reader walks an archive's members without extracting anything.
+typedef struct {
+    struct archive *a;
+    struct archive_entry *entry;
+    apg_limits limits;
+} apg_reader;
+
+// apg_entry_info mirrors the header fields Go needs. The string pointers
+// belong to libarchive and stay valid until the next apg_reader_next.
+typedef struct {
+    const char *path;
+    const char *link;     // symlink or hardlink target, NULL if none
+    la_int64_t size;
+    unsigned int fileType;
+    int hardlink;
+    unsigned int perm;
+    la_int64_t mtime;
+    long mtimeNsec;
+    la_int64_t uid, gid;
+    la_int64_t rdev;
+} apg_entry_info;
+
+// dict is the zstd dictionary the package needs, or NULL. With nFrames
+// frames from a seek table and threads > 1, they are decompressed in
+// parallel (apg_read_open_frames).
+static apg_reader *apg_reader_open(const char *archivePath, const void *dict, size_t dictLen,
+                                   const la_int64_t *frameOff, const uint32_t *frameC,
+                                   const uint32_t *frameD, int nFrames, int threads,
+                                   const apg_limits *limits, char *errBuf, int errBufLen) {
+    struct archive *a = archive_read_new();
+    archive_read_support_filter_all(a);
+    archive_read_support_format_all(a);
+    int rc = nFrames > 0 && threads > 1
+        ? apg_read_open_frames(a, archivePath, frameOff, frameC, frameD, nFrames, threads, dict, dictLen)
+        : apg_read_open(a, archivePath, dict, dictLen);
+    if (rc != ARCHIVE_OK) {
+        snprintf(errBuf, errBufLen, "open %s: %s", archivePath, archive_error_string(a));
+        archive_read_free(a); return NULL;
+    }
+    apg_reader *r = calloc(1, sizeof(*r));
+    r->a = a;
+    r->limits = *limits;
+    return r;
+}
+
+// apg_reader_next advances to the next header, skipping whatever data of
+// the previous member was not read. Returns 1 for an entry, 0 at the end
+// of the archive, -1 on error and APG_ELIMIT past r's limits.
+static int apg_reader_next(apg_reader *r, apg_entry_info *info, char *errBuf, int errBufLen) {
+    int rc = archive_read_next_header(r->a, &r->entry);
+    if (rc == ARCHIVE_EOF) return 0;
+    if (rc != ARCHIVE_OK && rc != ARCHIVE_WARN) {
+        snprintf(errBuf, errBufLen, "read: %s", archive_error_string(r->a));
+        return -1;
+    }
+    struct archive_entry *e = r->entry;
+    info->path = archive_entry_pathname(e);
+    info->hardlink = archive_entry_hardlink(e) != NULL;
+    info->link = info->hardlink ? archive_entry_hardlink(e) : archive_entry_symlink(e);
+    info->size = archive_entry_size(e);
+    info->fileType = archive_entry_filetype(e);
+    info->perm = archive_entry_perm(e);
+    info->mtime = archive_entry_mtime(e);
+    info->mtimeNsec = archive_entry_mtime_nsec(e);
+    info->uid = archive_entry_uid(e);
+    info->gid = archive_entry_gid(e);
+    info->rdev = (la_int64_t)archive_entry_rdev(e);
+    int lr = apg_limit_entry(&r->limits, info->path, info->size, errBuf, errBufLen);
+    return lr != 0 ? lr : 1;
+}
+
+static int apg_reader_skip(apg_reader *r, char *errBuf, int errBufLen) {
+    if (archive_read_data_skip(r->a) != ARCHIVE_OK) {
+        snprintf(errBuf, errBufLen, "skip: %s", archive_error_string(r->a));
+        return -1;
+    }
+    return 0;
+}
+
+// apg_reader_data reads up to len bytes of the current member.
+// Returns the byte count, 0 at the end of the member, -1 on error and
+// APG_ELIMIT past r's limits.
+static la_ssize_t apg_reader_data(apg_reader *r, void *buf, size_t len,
+                                  char *errBuf, int errBufLen) {
+    la_ssize_t n = archive_read_data(r->a, buf, len);
+    if (n < 0) snprintf(errBuf, errBufLen, "read data: %s", archive_error_string(r->a));
+    if (n > 0 && apg_limit_data(&r->limits, n, errBuf, errBufLen) != 0) return APG_ELIMIT;
+    return n;
+}
+
+static void apg_reader_close(apg_reader *r) {
+    archive_read_close(r->a);
+    archive_read_free(r->a);
+    free(r);
+}
+
+// apg_extract extracts an archive to destDir (auto-detects format). It
+// returns -1 on error and APG_ELIMIT, with what is extracted so far left
+// on disk, past limits.
+static int apg_extract(const char *archivePath, const void *dict, size_t dictLen,
+                       const char *destDir, const apg_limits *limits,
                        char *errBuf, int errBufLen) {
+    apg_limits lim = *limits;
     struct archive *a = archive_read_new();
     archive_read_support_filter_all(a);
     archive_read_support_format_all(a);
@@ -113,31 +1363,42 @@ static int apg_extract(const char *archivePath, const char *destDir,
         ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_SECURE_SYMLINKS);
     archive_write_disk_set_standard_lookup(ext);
 
-    if (archive_read_open_filename(a, archivePath, 65536) != ARCHIVE_OK) {
+    if (apg_read_open(a, archivePath, dict, dictLen) != ARCHIVE_OK) {
         snprintf(errBuf, errBufLen, "open %s: %s", archivePath, archive_error_string(a));
         archive_read_free(a); archive_write_free(ext); return -1;
     }
 
     struct archive_entry *entry;
-    int r;
-    char fullPath[4096];
+    int r, result = 0;
+    char fullPath[4096], linkPath[4096];
 
     for (;;) {
         r = archive_read_next_header(a, &entry);
         if (r == ARCHIVE_EOF) break;
         if (r != ARCHIVE_OK) {
             snprintf(errBuf, errBufLen, "read: %s", archive_error_string(a));
-            break;
+            result = -1; break;
         }
+        if ((result = apg_limit_entry(&lim, archive_entry_pathname(entry), archive_entry_size(entry),
+                                      errBuf, errBufLen)) != 0) break;
         snprintf(fullPath, sizeof(fullPath), "%s/%s", destDir, archive_entry_pathname(entry));
         archive_entry_set_pathname(entry, fullPath);
+        // Hardlink targets are member paths too.
+        const char *hardlink = archive_entry_hardlink(entry);
+        if (hardlink) {
+            snprintf(linkPath, sizeof(linkPath), "%s/%s", destDir, hardlink);
+            archive_entry_copy_hardlink(entry, linkPath);
+        }
 
         if (archive_write_header(ext, entry) != ARCHIVE_OK) continue;
 
         if (archive_entry_size(entry) > 0) {
             const void *buf; size_t size; la_int64_t offset;
-            while (archive_read_data_block(a, &buf, &size, &offset) == ARCHIVE_OK)
+            while (archive_read_data_block(a, &buf, &size, &offset) == ARCHIVE_OK) {
+                if ((result = apg_limit_data(&lim, (la_int64_t)size, errBuf, errBufLen)) != 0) break;
                 archive_write_data_block(ext, buf, size, offset);
+            }
+            if (result != 0) break;
         }
     }
 
@@ -145,35 +1406,265 @@ static int apg_extract(const char *archivePath, const char *destDir,
     archive_read_free(a);
     archive_write_close(ext);
     archive_write_free(ext);
-    return (r == ARCHIVE_EOF) ? 0 : -1;
+    return result;
+}
+
+// apg_extract_member extracts the single member memberPath into destDir,
+// starting to decompress at byte offset of the archive. offset must be the
+// start of a frame that begins on a member header (or 0).
+// Returns 0 on success, 1 if the member was not found, -1 on error, 2 if
+// the member is a hardlink (its target is then copied to errBuf) and
+// APG_ELIMIT if the member exceeds the size limits.
+static int apg_extract_member(const char *archivePath, la_int64_t offset,
+                              const void *dict, size_t dictLen,
+                              const char *memberPath, const char *destDir,
+                              const apg_limits *limits, char *errBuf, int errBufLen) {
+    apg_limits lim = *limits;
+    lim.maxFiles = 0;  // members scanned past are not extracted
+    int fd = open(archivePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        snprintf(errBuf, errBufLen, "open %s: %s", archivePath, strerror(errno));
+        return -1;
+    }
+    if (lseek(fd, offset, SEEK_SET) < 0) {
+        snprintf(errBuf, errBufLen, "seek %s: %s", archivePath, strerror(errno));
+        close(fd); return -1;
+    }
+
+    struct archive *a = archive_read_new();
+    archive_read_support_filter_all(a);
+    archive_read_support_format_all(a);
+    int r0 = dict ? apg_read_open_dict(a, fd, 0, dict, dictLen) : archive_read_open_fd(a, fd, 65536);
+    if (r0 != ARCHIVE_OK) {
+        snprintf(errBuf, errBufLen, "open %s: %s", archivePath, archive_error_string(a));
+        archive_read_free(a); close(fd); return -1;
+    }
+
+    struct archive *ext = archive_write_disk_new();
+    archive_write_disk_set_options(ext,
+        ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_PERM |
+        ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_SECURE_SYMLINKS);
+    archive_write_disk_set_standard_lookup(ext);
+
+    struct archive_entry *entry;
+    char fullPath[4096];
+    int result = 1;
+    for (;;) {
+        int r = archive_read_next_header(a, &entry);
+        if (r == ARCHIVE_EOF) break;
+        if (r != ARCHIVE_OK && r != ARCHIVE_WARN) {
+            snprintf(errBuf, errBufLen, "read: %s", archive_error_string(a));
+            result = -1; break;
+        }
+        if (strcmp(archive_entry_pathname(entry), memberPath) != 0) continue;
+
+        if (archive_entry_hardlink(entry)) {
+            snprintf(errBuf, errBufLen, "%s", archive_entry_hardlink(entry));
+            result = 2; break;
+        }
+        if ((result = apg_limit_entry(&lim, memberPath, archive_entry_size(entry), errBuf, errBufLen)) != 0)
+            break;
+        snprintf(fullPath, sizeof(fullPath), "%s/%s", destDir, memberPath);
+        archive_entry_set_pathname(entry, fullPath);
+        if (archive_write_header(ext, entry) != ARCHIVE_OK) {
+            snprintf(errBuf, errBufLen, "write %s: %s", fullPath, archive_error_string(ext));
+            result = -1; break;
+        }
+        const void *buf; size_t size; la_int64_t off;
+        while ((r = archive_read_data_block(a, &buf, &size, &off)) == ARCHIVE_OK) {
+            if ((result = apg_limit_data(&lim, (la_int64_t)size, errBuf, errBufLen)) != 0) break;
+            archive_write_data_block(ext, buf, size, off);
+        }
+        if (result != 0) break;
+        if (r != ARCHIVE_EOF) {
+            snprintf(errBuf, errBufLen, "read: %s", archive_error_string(a));
+            result = -1; break;
+        }
+        result = archive_write_finish_entry(ext) == ARCHIVE_OK ? 0 : -1;
+        if (result != 0)
+            snprintf(errBuf, errBufLen, "write %s: %s", fullPath, archive_error_string(ext));
+        break;
+    }
+
+    archive_read_close(a);
+    archive_read_free(a);
+    archive_write_close(ext);
+    archive_write_free(ext);
+    close(fd);
+    return result;
 }
 */
 import "C"
 import (
+	"errors"
 	"fmt"
+	"io"
+	"io/fs"
 	"os"
 	"path/filepath"
+	"runtime"
+	"strings"
+	"syscall"
+	"time"
 	"unsafe"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
 )
 
+// Default Limits: generous enough for firmware and VM-image packages.
+// Extraction is bounded tighter by default, by the free space of the
+// destination (see ExtractOptions.Limits).
 const (
-	MaxFileSize    = 100 * 1024 * 1024
-	MaxArchiveSize = 1024 * 1024 * 1024
-	MaxFiles       = 10000
+	MaxFileSize    = 64 << 30  // uncompressed bytes of one member
+	MaxArchiveSize = 256 << 30 // uncompressed bytes of all members
+	MaxFiles       = 1 << 20   // members of any type
 )
 
+// NoLimit disables a field of Limits.
+const NoLimit = -1
+
+// Limits bounds what a package may hold. They are checked as the archive
+// is streamed: against every header before its data is touched, and
+// against the data blocks as they are decompressed. A zero field takes
+// its default (MaxFiles, MaxFileSize, MaxArchiveSize).
+type Limits struct {
+	Files    int64
+	FileSize int64
+	Total    int64
+}
+
+// ErrLimit is wrapped by errors for packages that exceed their Limits.
+var ErrLimit = errors.New("package exceeds limits")
+
+func (l Limits) c() *C.apg_limits {
+	pick := func(v, def int64) C.la_int64_t {
+		switch {
+		case v == 0:
+			return C.la_int64_t(def)
+		case v < 0:
+			return 0
+		}
+		return C.la_int64_t(v)
+	}
+	return &C.apg_limits{
+		maxFiles:    pick(l.Files, MaxFiles),
+		maxFileSize: pick(l.FileSize, MaxFileSize),
+		maxTotal:    pick(l.Total, MaxArchiveSize),
+	}
+}
+
+// cError turns the message a C helper left in errBuf into an error; code
+// APG_ELIMIT wraps ErrLimit.
+func cError(prefix string, code C.int, errBuf *C.char) error {
+	if code == C.APG_ELIMIT {
+		return fmt.Errorf("%s: %w: %s", prefix, ErrLimit, C.GoString(errBuf))
+	}
+	return fmt.Errorf("%s: %s", prefix, C.GoString(errBuf))
+}
+
+// ThreadsAuto selects one compressor thread per CPU.
+const ThreadsAuto = -1
+
 // CreateOptions configures archive creation.
 type CreateOptions struct {
 	// Compression: "zstd" | "xz" | "bz2" | "gz" | "lz4" | "lzma"
 	Compression string
 	// Level: compression level (0 = algorithm default)
 	Level int
+	// Threads: compressor threads for zstd and xz (0 = single-threaded,
+	// ThreadsAuto = number of CPUs). Ignored by the other codecs.
+	Threads int
+	// Seekable writes the APGv2 framed layout (zstd only): TOC members
+	// first, independent frames at member boundaries, a member index and a
+	// zstd seek table at the end. See ExtractFile.
+	Seekable bool
+	// FrameSize: uncompressed bytes after which a seekable frame is cut at
+	// the next member boundary (0 = DefaultFrameSize).
+	FrameSize int64
+	// Order is the member order: OrderPath (default) or OrderGroup.
+	Order string
+	// Reproducible stores every entry as owned by root (0:0) without
+	// atime/ctime, and clamps mtimes to Epoch if that is set (usually
+	// SOURCE_DATE_EPOCH), so equal trees give byte-identical packages.
+	Reproducible bool
+	Epoch        time.Time
+	// DedupSums maps member paths to content hashes (e.g. from the
+	// sha256sums pass). Regular files with equal hash, permissions and
+	// owner are then stored once, later copies as hardlinks. Further paths
+	// of one inode are always stored as hardlinks.
+	DedupSums map[string]string
+	// Dictionary is a zstd dictionary (see TrainDictionary) to compress
+	// with; zstd only. Its ID is recorded in every frame header, and
+	// readers need the same dictionary (see LoadDictionary).
+	Dictionary []byte
+	// Sink, if set, receives the package instead of the file at
+	// archivePath, which then only names it in errors. Output is strictly
+	// sequential, so Sink can be a pipe or an upload stream. An *os.File
+	// (e.g. os.Stdout) is written to directly; other writers get the
+	// compressed stream through a callback, in blocks of about 10 KiB.
+	Sink io.Writer
+	// Limits bounds the tree being archived; an entry past them fails the
+	// build with ErrLimit before any of its data is read.
+	Limits Limits
+	// Blobs, with Seekable, stores regular files of at least Blobs.MinSize
+	// whose content key is in BlobSums as frames of their own, spliced in
+	// from the store (or compressed into it first). BlobSums maps member
+	// paths to "algorithm:hash" keys, e.g. "sha256:" plus the sha256sums
+	// entry.
+	Blobs    *BlobStore
+	BlobSums map[string]string
+	// Incompressible lists members whose data does not compress further
+	// (see PlanCompression). Seekable packages without a dictionary
+	// compress them in frames of their own at the fastest level.
+	Incompressible map[string]bool
+}
+
+// DefaultFrameSize is the default target size of a seekable frame.
+const DefaultFrameSize = 4 << 20
+
+// TOCMembers are stored first, in a frame of their own, in seekable
+// packages, so they can be read without decompressing anything else.
+var TOCMembers = []string{"metadata.json", "sha256sums", "sha256sums.home"}
+
+func (o CreateOptions) frameSize() int64 {
+	if o.FrameSize > 0 {
+		return o.FrameSize
+	}
+	return DefaultFrameSize
+}
+
+// threads resolves Threads to the value handed to libarchive.
+func (o CreateOptions) threads() int {
+	if o.Threads == ThreadsAuto {
+		return runtime.NumCPU()
+	}
+	if o.Threads < 0 {
+		return 0
+	}
+	return o.Threads
 }
 
 // CreateResult contains information about the created archive.
 type CreateResult struct {
-	FilesAdded int
-	TotalSize  int64
+	FilesAdded int   // entries written
+	TotalSize  int64 // file data bytes
+	// TarSize is the uncompressed tar stream, CompressedSize the package file.
+	TarSize        int64
+	CompressedSize int64
+	// Hardlinks counts regular files stored as hardlinks to an earlier
+	// member; LinkedSize is the data they did not store again.
+	Hardlinks  int
+	LinkedSize int64
+	// BlobHits counts members spliced from CreateOptions.Blobs, BlobMisses
+	// members compressed into it first.
+	BlobHits   int
+	BlobMisses int
+	// Duration is the writer's lifetime; ReadTime and WriteTime are the
+	// parts of it spent reading source files (AddFile only) and writing
+	// the package. The remainder is mostly compression.
+	Duration  time.Duration
+	ReadTime  time.Duration
+	WriteTime time.Duration
 }
 
 // Create creates a tar+zstd archive from sourceDir (default settings).
@@ -183,61 +1674,741 @@ func Create(archivePath, sourceDir string) (*CreateResult, error) {
 
 // CreateWithOptions creates an archive with explicit compression settings.
 func CreateWithOptions(archivePath, sourceDir string, opts CreateOptions) (*CreateResult, error) {
+	tree, err := scan.Scan(sourceDir, scan.Options{})
+	if err != nil {
+		return nil, fmt.Errorf("create archive: %w", err)
+	}
+	return CreateFromTree(archivePath, tree, opts)
+}
+
+// CreateFromTree archives an already scanned tree, reusing the stat data of
+// the scan instead of stat-ing every entry again. TOCMembers go first (in a
+// frame of their own when seekable), then the rest in opts.Order (see
+// MemberOrder). Symlinks are stored as links. With io_uring (see package
+// uring), small files are read ahead in batches.
+func CreateFromTree(archivePath string, tree *scan.Tree, opts CreateOptions) (*CreateResult, error) {
+	aw, err := NewWriter(archivePath, opts)
+	if err != nil {
+		return nil, err
+	}
+	fail := func(err error) (*CreateResult, error) {
+		aw.Close() //nolint:errcheck
+		if opts.Sink == nil {
+			os.Remove(archivePath)
+		}
+		return nil, fmt.Errorf("create archive: %w", err)
+	}
+
+	files, ntoc, err := MemberOrder(tree, opts.Order)
+	if err != nil {
+		return fail(err)
+	}
+	pf := newPrefetcher(aw, tree, files)
+	defer pf.close()
+	for i, f := range files[:ntoc] {
+		if err := aw.addFile(tree.Abs(f), f.Path, f.Stat(), pf.get(i)); err != nil {
+			return fail(err)
+		}
+	}
+	if err := aw.EndFrame(); err != nil {
+		return fail(err)
+	}
+	for i, f := range files[ntoc:] {
+		if err := aw.addFile(tree.Abs(f), f.Path, f.Stat(), pf.get(ntoc+i)); err != nil {
+			return fail(err)
+		}
+	}
+	return aw.Close()
+}
+
+// Writer builds an archive one entry at a time. The caller supplies file
+// data through Write, which lets it tee the bytes elsewhere (e.g. into a
+// SHA-256 state) instead of having the tree read a second time.
+type Writer struct {
+	w      *C.apg_writer
+	errBuf [512]C.char
+	result CreateResult
+	start  time.Time
+	links  map[string]string // link key → first member stored
+	sums   map[string]string
+	sink   *goSink // CreateOptions.Sink, if written through apgGoWrite
+
+	blobs     *BlobStore // CreateOptions.Blobs
+	blobSums  map[string]string
+	blobCodec string
+	fast      map[string]bool // CreateOptions.Incompressible
+	readTime  time.Duration   // reading files ahead (see prefetcher)
+}
+
+// NewWriter opens archivePath for writing with the given compression settings.
+func NewWriter(archivePath string, opts CreateOptions) (*Writer, error) {
 	if opts.Compression == "" {
 		opts.Compression = "zstd"
 	}
 
 	cArchive := C.CString(archivePath)
-	cSource := C.CString(sourceDir)
 	cComp := C.CString(opts.Compression)
 	defer C.free(unsafe.Pointer(cArchive))
-	defer C.free(unsafe.Pointer(cSource))
 	defer C.free(unsafe.Pointer(cComp))
 
-	var errBuf [512]C.char
-	r := C.apg_create(cArchive, cSource, cComp, C.int(opts.Level), &errBuf[0], 512)
+	if opts.Blobs != nil && (!opts.Seekable || opts.Compression != "zstd") {
+		return nil, fmt.Errorf("create archive: a blob store needs seekable zstd packages")
+	}
+	aw := &Writer{start: time.Now(), links: map[string]string{}, sums: opts.DedupSums, fast: opts.Incompressible}
+	blobs := C.int(0)
+	if opts.Blobs != nil {
+		level := opts.Level
+		if level <= 0 {
+			level = C.ZSTD_CLEVEL_DEFAULT
+		}
+		aw.blobs, aw.blobSums, aw.blobCodec = opts.Blobs, opts.BlobSums, blobCodec(level, opts.Dictionary)
+		blobs = 1
+	}
+	outFd, sink, err := aw.openSink(opts.Sink)
+	if err != nil {
+		return nil, fmt.Errorf("create archive: %w", err)
+	}
+	seekable := C.int(0)
+	if opts.Seekable {
+		seekable = 1
+	}
+	repro, clamp := C.int(0), C.la_int64_t(0)
+	if opts.Reproducible {
+		repro = 1
+		if !opts.Epoch.IsZero() {
+			clamp = C.la_int64_t(opts.Epoch.Unix())
+		}
+	}
+	dict, dictLen := cDict(opts.Dictionary)
+	aw.w = C.apg_writer_new(cArchive, outFd, sink, cComp, C.int(opts.Level), C.int(opts.threads()),
+		seekable, C.la_int64_t(opts.frameSize()), blobs, repro, clamp, dict, dictLen, opts.Limits.c(), &aw.errBuf[0], 512)
+	if aw.w == nil {
+		aw.closeSink()
+		return nil, fmt.Errorf("create archive: %s", C.GoString(&aw.errBuf[0]))
+	}
+	return aw, nil
+}
+
+// WriteHeader writes the entry for the file at fullPath, stored under relPath.
+// Symlinks are stored as links. For regular files it returns the number of
+// data bytes that must follow via Write; for everything else it returns 0.
+func (aw *Writer) WriteHeader(fullPath, relPath string) (int64, error) {
+	size, _, err := aw.WriteHeaderStat(fullPath, relPath, nil)
+	return size, err
+}
+
+// WriteHeaderStat is WriteHeader for a file whose lstat result is already
+// known (e.g. from a scan.Tree), which saves stat-ing it again. A nil st
+// behaves like WriteHeader.
+//
+// With st known, a regular file that duplicates an earlier member (see
+// CreateOptions.DedupSums) is stored as a hardlink to it: link names that
+// member and no data follows.
+func (aw *Writer) WriteHeaderStat(fullPath, relPath string, st *syscall.Stat_t) (size int64, link string, err error) {
+	cFull := C.CString(fullPath)
+	cRel := C.CString(relPath)
+	defer C.free(unsafe.Pointer(cFull))
+	defer C.free(unsafe.Pointer(cRel))
+
+	var cst *C.struct_stat
+	var cLink *C.char
+	if st != nil {
+		cst = cStat(st)
+		if link = aw.linkTarget(relPath, st); link != "" {
+			cLink = C.CString(link)
+			defer C.free(unsafe.Pointer(cLink))
+		}
+	}
+	var fileType C.uint
+	var cSize C.la_int64_t
+	if r := C.apg_writer_header(aw.w, cFull, cRel, cst, cLink, &fileType, &cSize, &aw.errBuf[0], 512); r != 0 {
+		return 0, "", cError("archive", r, &aw.errBuf[0])
+	}
+	aw.result.FilesAdded++
+	switch {
+	case link != "":
+		aw.result.Hardlinks++
+		aw.result.LinkedSize += st.Size
+		return 0, link, nil
+	case fileType != C.AE_IFREG:
+		return 0, "", nil
+	}
+	aw.result.TotalSize += int64(cSize)
+	if aw.fast[relPath] && cSize > 0 && C.apg_writer_fast(aw.w, &aw.errBuf[0], 512) != 0 {
+		return 0, "", fmt.Errorf("archive: %s", C.GoString(&aw.errBuf[0]))
+	}
+	return int64(cSize), "", nil
+}
+
+// WriteEntry writes the header of e, as returned by Reader.Next or built by
+// the caller, without data. For a regular member it returns e.Size: that
+// many bytes must follow via Write. Owner and device fields come along with
+// entries read from an archive; entries built by the caller belong to root.
+func (aw *Writer) WriteEntry(e *Entry) (int64, error) {
+	cRel := C.CString(e.Path)
+	defer C.free(unsafe.Pointer(cRel))
+	fileType := C.uint(C.AE_IFREG)
+	var cSymlink, cHardlink *C.char
+	switch e.Type {
+	case TypeDir:
+		fileType = C.AE_IFDIR
+	case TypeSymlink:
+		fileType = C.AE_IFLNK
+		cSymlink = C.CString(e.Linkname)
+		defer C.free(unsafe.Pointer(cSymlink))
+	case TypeHardlink:
+		cHardlink = C.CString(e.Linkname)
+		defer C.free(unsafe.Pointer(cHardlink))
+	case TypeOther:
+		fileType = C.uint(e.ftype)
+	}
+	if r := C.apg_writer_entry(aw.w, cRel, fileType, C.uint(unixPerm(e.Mode)), C.la_int64_t(e.Size),
+		C.la_int64_t(e.ModTime.Unix()), C.long(e.ModTime.Nanosecond()), C.la_int64_t(e.uid), C.la_int64_t(e.gid),
+		C.la_int64_t(e.rdev), cSymlink, cHardlink, &aw.errBuf[0], 512); r != 0 {
+		return 0, cError("archive", r, &aw.errBuf[0])
+	}
+	aw.result.FilesAdded++
+	switch e.Type {
+	case TypeHardlink:
+		aw.result.Hardlinks++
+	case TypeRegular:
+		aw.result.TotalSize += e.Size
+		return e.Size, nil
+	}
+	return 0, nil
+}
+
+// linkTarget returns the earlier member the regular file relPath can be
+// stored as a hardlink to: another path of the same inode or, with
+// DedupSums, a file of identical content, permissions and owner. Without
+// one, relPath is recorded as the member later copies link to.
+func (aw *Writer) linkTarget(relPath string, st *syscall.Stat_t) string {
+	if st.Mode&syscall.S_IFMT != syscall.S_IFREG {
+		return ""
+	}
+	var keys []string
+	if st.Nlink > 1 {
+		keys = append(keys, fmt.Sprintf("i%d:%d", st.Dev, st.Ino))
+	}
+	if sum, ok := aw.sums[relPath]; ok && st.Size > 0 {
+		keys = append(keys, fmt.Sprintf("c%s:%o:%d:%d", sum, st.Mode, st.Uid, st.Gid))
+	}
+	for _, k := range keys {
+		if target, ok := aw.links[k]; ok {
+			return target
+		}
+	}
+	for _, k := range keys {
+		aw.links[k] = relPath
+	}
+	return ""
+}
+
+// Write appends data to the current entry. It implements io.Writer.
+func (aw *Writer) Write(p []byte) (int, error) {
+	if len(p) == 0 {
+		return 0, nil
+	}
+	if C.apg_writer_data(aw.w, unsafe.Pointer(&p[0]), C.size_t(len(p)), &aw.errBuf[0], 512) != 0 {
+		return 0, fmt.Errorf("archive: %s", C.GoString(&aw.errBuf[0]))
+	}
+	return len(p), nil
+}
+
+// cStat converts a Go lstat result into the struct libarchive expects.
+func cStat(st *syscall.Stat_t) *C.struct_stat {
+	var c C.struct_stat
+	c.st_dev = C.dev_t(st.Dev)
+	c.st_ino = C.ino_t(st.Ino)
+	c.st_mode = C.mode_t(st.Mode)
+	c.st_nlink = C.nlink_t(st.Nlink)
+	c.st_uid = C.uid_t(st.Uid)
+	c.st_gid = C.gid_t(st.Gid)
+	c.st_rdev = C.dev_t(st.Rdev)
+	c.st_size = C.off_t(st.Size)
+	c.st_atim.tv_sec, c.st_atim.tv_nsec = C.time_t(st.Atim.Sec), C.long(st.Atim.Nsec)
+	c.st_mtim.tv_sec, c.st_mtim.tv_nsec = C.time_t(st.Mtim.Sec), C.long(st.Mtim.Nsec)
+	c.st_ctim.tv_sec, c.st_ctim.tv_nsec = C.time_t(st.Ctim.Sec), C.long(st.Ctim.Nsec)
+	return &c
+}
+
+// AddFile writes the entry for fullPath under relPath together with its data.
+func (aw *Writer) AddFile(fullPath, relPath string) error {
+	return aw.addFile(fullPath, relPath, nil, nil)
+}
+
+// addFile adds fullPath with the lstat result st, if known, and its data,
+// if already read.
+func (aw *Writer) addFile(fullPath, relPath string, st *syscall.Stat_t, data []byte) error {
+	size, _, err := aw.WriteHeaderStat(fullPath, relPath, st)
+	if err != nil || size == 0 {
+		return err
+	}
+	if int64(len(data)) == size {
+		_, err := aw.Write(data)
+		return err
+	}
+	if blob := aw.blobPath(relPath, size); blob != "" && !aw.fast[relPath] {
+		return aw.splice(fullPath, blob, size, st)
+	}
+	cFull := C.CString(fullPath)
+	defer C.free(unsafe.Pointer(cFull))
+	if C.apg_writer_file(aw.w, cFull, C.la_int64_t(size), &aw.errBuf[0], 512) != 0 {
+		return fmt.Errorf("archive: %s", C.GoString(&aw.errBuf[0]))
+	}
+	return nil
+}
+
+// blobPath returns the blob store path of the data of regular member
+// relPath, or "" if it is not stored as a blob.
+func (aw *Writer) blobPath(relPath string, size int64) string {
+	if aw.blobs == nil || size < aw.blobs.minSize() || size > 1<<30-512 {
+		return ""
+	}
+	key, ok := aw.blobSums[relPath]
+	if !ok {
+		return ""
+	}
+	return aw.blobs.path(aw.blobCodec, key)
+}
+
+// splice writes the data of the member whose header was just written as
+// the blob at blob, compressing fullPath into the store first if the blob
+// is not there yet. Every member with a blob path is spliced, found or
+// not, so the package does not depend on the state of the store.
+func (aw *Writer) splice(fullPath, blob string, size int64, st *syscall.Stat_t) error {
+	switch _, err := os.Stat(blob); {
+	case err == nil:
+		aw.result.BlobHits++
+	case errors.Is(err, fs.ErrNotExist):
+		if err := aw.storeBlob(fullPath, blob, size, st); err != nil {
+			return fmt.Errorf("archive: blob of %s: %w", fullPath, err)
+		}
+		aw.result.BlobMisses++
+	default:
+		return fmt.Errorf("archive: %w", err)
+	}
+	cBlob := C.CString(blob)
+	defer C.free(unsafe.Pointer(cBlob))
+	if C.apg_writer_splice(aw.w, cBlob, C.la_int64_t(size), &aw.errBuf[0], 512) != 0 {
+		return fmt.Errorf("archive: %s", C.GoString(&aw.errBuf[0]))
+	}
+	return nil
+}
+
+// storeBlob compresses size bytes of fullPath into the blob at blob. A
+// file that changed while it was read is not stored: its content no longer
+// matches the key.
+func (aw *Writer) storeBlob(fullPath, blob string, size int64, st *syscall.Stat_t) error {
+	if err := os.MkdirAll(filepath.Dir(blob), 0755); err != nil {
+		return err
+	}
+	tmp, err := os.CreateTemp(filepath.Dir(blob), ".blob-*")
+	if err != nil {
+		return err
+	}
+	defer os.Remove(tmp.Name())
+	cFull := C.CString(fullPath)
+	defer C.free(unsafe.Pointer(cFull))
+	r := C.apg_writer_blob(aw.w, cFull, C.la_int64_t(size), C.int(tmp.Fd()), &aw.errBuf[0], 512)
+	if err := tmp.Close(); r != 0 {
+		return errors.New(C.GoString(&aw.errBuf[0]))
+	} else if err != nil {
+		return err
+	}
+	if st != nil {
+		var now syscall.Stat_t
+		if err := syscall.Lstat(fullPath, &now); err != nil {
+			return err
+		}
+		if now.Size != st.Size || now.Mtim != st.Mtim || now.Ino != st.Ino {
+			return fmt.Errorf("file changed while archiving")
+		}
+	}
+	return os.Rename(tmp.Name(), blob)
+}
+
+// EndFrame makes the next member start a new frame in a seekable archive.
+// It does nothing for other archives.
+func (aw *Writer) EndFrame() error {
+	if C.apg_writer_cut(aw.w, &aw.errBuf[0], 512) != 0 {
+		return fmt.Errorf("archive: %s", C.GoString(&aw.errBuf[0]))
+	}
+	return nil
+}
+
+// Close finishes the archive and releases the underlying libarchive handles.
+func (aw *Writer) Close() (*CreateResult, error) {
+	if aw.w == nil {
+		return nil, fmt.Errorf("archive: writer already closed")
+	}
+	var st C.apg_stats
+	r := C.apg_writer_close(aw.w, &st, &aw.errBuf[0], 512)
+	aw.w = nil
+	sinkErr := aw.closeSink()
+	if sinkErr != nil {
+		return nil, fmt.Errorf("create archive: %w", sinkErr)
+	}
 	if r != 0 {
-		return nil, fmt.Errorf("create archive: %s", C.GoString(&errBuf[0]))
+		return nil, fmt.Errorf("create archive: %s", C.GoString(&aw.errBuf[0]))
 	}
-	return &CreateResult{}, nil
+	aw.result.TarSize = int64(st.tarBytes)
+	aw.result.CompressedSize = int64(st.written)
+	aw.result.Duration = time.Since(aw.start)
+	aw.result.ReadTime = time.Duration(st.readNs) + aw.readTime
+	aw.result.WriteTime = time.Duration(st.writeNs)
+	return &aw.result, nil
 }
 
 // Extract extracts an archive to destDir.
 // Automatically detects compression format via libarchive.
 func Extract(archivePath, destDir string) error {
+	return ExtractWithOptions(archivePath, destDir, ExtractOptions{})
+}
+
+// extractSerial extracts an archive with libarchive's own disk writer.
+func extractSerial(archivePath, destDir string, limits Limits) error {
 	cArchive := C.CString(archivePath)
 	cDest := C.CString(destDir)
 	defer C.free(unsafe.Pointer(cArchive))
 	defer C.free(unsafe.Pointer(cDest))
 
+	d, err := packageDictionary(archivePath, 0)
+	if err != nil {
+		return fmt.Errorf("extract archive: %w", err)
+	}
+	dict, dictLen := cDict(d)
 	var errBuf [512]C.char
-	r := C.apg_extract(cArchive, cDest, &errBuf[0], 512)
-	if r != 0 {
-		return fmt.Errorf("extract archive: %s", C.GoString(&errBuf[0]))
+	if r := C.apg_extract(cArchive, dict, dictLen, cDest, limits.c(), &errBuf[0], 512); r != 0 {
+		return cError("extract archive", r, &errBuf[0])
 	}
 	return nil
 }
 
-// ListContents lists the files in an archive without full extraction.
-func ListContents(archivePath string) ([]string, error) {
-	tempDir, err := os.MkdirTemp("", "apgbuild-list-*")
+// ExtractFile extracts the single member memberPath of a package into
+// destDir. For seekable packages only the frame holding the member is
+// decompressed; other packages are scanned from the start. The member
+// must be within the default extraction limits.
+func ExtractFile(archivePath, memberPath, destDir string) error {
+	return ExtractFileWithLimits(archivePath, memberPath, destDir, Limits{})
+}
+
+// ExtractFileWithLimits is ExtractFile with explicit limits, defaulted as
+// in ExtractOptions.Limits; the members scanned on the way count as well.
+func ExtractFileWithLimits(archivePath, memberPath, destDir string, limits Limits) error {
+	memberPath = strings.TrimPrefix(filepath.ToSlash(memberPath), "./")
+	if !isPathSafe(memberPath, destDir) {
+		return fmt.Errorf("extract %s: unsafe path", memberPath)
+	}
+
+	var offset int64
+	toc, err := ReadTOC(archivePath)
+	switch {
+	case err == nil:
+		frame, ok := toc.MemberFrame(memberPath)
+		if !ok {
+			return fmt.Errorf("extract %s: not in package", memberPath)
+		}
+		offset = toc.Frames[frame].Offset
+	case !errors.Is(err, ErrNotSeekable):
+		return fmt.Errorf("extract %s: %w", memberPath, err)
+	}
+
+	d, err := packageDictionary(archivePath, offset)
 	if err != nil {
-		return nil, err
+		return fmt.Errorf("extract %s: %w", memberPath, err)
+	}
+	dict, dictLen := cDict(d)
+
+	cArchive := C.CString(archivePath)
+	cMember := C.CString(memberPath)
+	cDest := C.CString(destDir)
+	defer C.free(unsafe.Pointer(cArchive))
+	defer C.free(unsafe.Pointer(cMember))
+	defer C.free(unsafe.Pointer(cDest))
+
+	var errBuf [512]C.char
+	switch r := C.apg_extract_member(cArchive, C.la_int64_t(offset), dict, dictLen, cMember, cDest, limits.forExtract(destDir).c(), &errBuf[0], 512); r {
+	case 0:
+		return nil
+	case 1:
+		return fmt.Errorf("extract %s: not in package", memberPath)
+	case 2:
+		return extractLinked(archivePath, memberPath, C.GoString(&errBuf[0]), destDir, limits)
+	default:
+		return cError("extract "+memberPath, r, &errBuf[0])
+	}
+}
+
+// extractLinked extracts a hardlink member on its own: the member it links
+// to is extracted in its place, since that one is not on disk.
+func extractLinked(archivePath, memberPath, target, destDir string, limits Limits) error {
+	if target == memberPath {
+		return fmt.Errorf("extract %s: hardlink to itself", memberPath)
+	}
+	tmp, err := os.MkdirTemp(destDir, ".apg-link-")
+	if err != nil {
+		return fmt.Errorf("extract %s: %w", memberPath, err)
+	}
+	defer os.RemoveAll(tmp)
+	if err := ExtractFileWithLimits(archivePath, target, tmp, limits); err != nil {
+		return fmt.Errorf("extract %s: %w", memberPath, err)
+	}
+	dst := filepath.Join(destDir, memberPath)
+	if err := os.MkdirAll(filepath.Dir(dst), 0755); err != nil {
+		return fmt.Errorf("extract %s: %w", memberPath, err)
+	}
+	if err := os.Rename(filepath.Join(tmp, target), dst); err != nil {
+		return fmt.Errorf("extract %s: %w", memberPath, err)
+	}
+	return nil
+}
+
+// isPathSafe reports whether the archive path stays inside baseDir.
+func isPathSafe(path, baseDir string) bool {
+	if path == "" || filepath.IsAbs(path) {
+		return false
+	}
+	rel, err := filepath.Rel(baseDir, filepath.Join(baseDir, path))
+	return err == nil && rel != ".." && !strings.HasPrefix(rel, "../")
+}
+
+// EntryType classifies an archive member.
+type EntryType byte
+
+const (
+	TypeRegular EntryType = iota
+	TypeDir
+	TypeSymlink
+	TypeHardlink
+	TypeOther // devices, fifos, sockets
+)
+
+func (t EntryType) String() string {
+	switch t {
+	case TypeRegular:
+		return "file"
+	case TypeDir:
+		return "dir"
+	case TypeSymlink:
+		return "symlink"
+	case TypeHardlink:
+		return "hardlink"
+	}
+	return "other"
+}
+
+// Entry describes one archive member as recorded in its header.
+type Entry struct {
+	Path     string
+	Size     int64
+	Mode     os.FileMode // permission bits plus setuid/setgid/sticky
+	Type     EntryType
+	ModTime  time.Time
+	Linkname string // symlink or hardlink target
+
+	// Raw header fields used by the extractor.
+	perm, ftype uint32
+	uid, gid    int64
+	rdev        uint64
+}
+
+// Owner returns the numeric owner and group recorded in e's header.
+func (e *Entry) Owner() (uid, gid int64) { return e.uid, e.gid }
+
+// Reader iterates over the members of an archive without extracting it.
+// Data of a member can be read with Read; whatever is left unread is
+// skipped by the next call to Next.
+type Reader struct {
+	r      *C.apg_reader
+	errBuf [512]C.char
+}
+
+// OpenReader opens an archive for reading (auto-detects format), within
+// the default Limits.
+func OpenReader(archivePath string) (*Reader, error) {
+	return OpenReaderWithLimits(archivePath, Limits{})
+}
+
+// OpenReaderWithLimits is OpenReader with explicit limits: Next and Read
+// fail with ErrLimit once the members read exceed them.
+func OpenReaderWithLimits(archivePath string, limits Limits) (*Reader, error) {
+	return OpenReaderWithOptions(archivePath, ReadOptions{Limits: limits})
+}
+
+// ReadOptions configures OpenReaderWithOptions.
+type ReadOptions struct {
+	// Limits bounds the members read (see OpenReaderWithLimits).
+	Limits Limits
+	// Threads decompresses the frames of a seekable package on this many
+	// threads while the caller reads the members in order (0 or 1 = on
+	// the reading thread, ThreadsAuto = number of CPUs). Other packages
+	// are one stream and read serially.
+	Threads int
+}
+
+// OpenReaderWithOptions is OpenReader with explicit options.
+func OpenReaderWithOptions(archivePath string, opts ReadOptions) (*Reader, error) {
+	cArchive := C.CString(archivePath)
+	defer C.free(unsafe.Pointer(cArchive))
+
+	d, err := packageDictionary(archivePath, 0)
+	if err != nil {
+		return nil, fmt.Errorf("read archive: %w", err)
+	}
+	dict, dictLen := cDict(d)
+
+	threads := CreateOptions{Threads: opts.Threads}.threads()
+	var off []C.la_int64_t
+	var cSize, dSize []C.uint32_t
+	if threads > 1 {
+		if toc, err := ReadTOC(archivePath); err == nil && len(toc.Frames) > 1 {
+			for _, f := range toc.Frames {
+				off = append(off, C.la_int64_t(f.Offset))
+				cSize, dSize = append(cSize, C.uint32_t(f.CompressedSize)), append(dSize, C.uint32_t(f.Size))
+			}
+		}
+	}
+	if len(off) == 0 {
+		off, cSize, dSize = make([]C.la_int64_t, 1), make([]C.uint32_t, 1), make([]C.uint32_t, 1)
+		threads = 0
 	}
-	defer os.RemoveAll(tempDir)
+	if threads > len(off) {
+		threads = len(off)
+	}
+
+	ar := &Reader{}
+	ar.r = C.apg_reader_open(cArchive, dict, dictLen, &off[0], &cSize[0], &dSize[0], C.int(len(off)), C.int(threads),
+		opts.Limits.c(), &ar.errBuf[0], 512)
+	if ar.r == nil {
+		return nil, fmt.Errorf("read archive: %s", C.GoString(&ar.errBuf[0]))
+	}
+	return ar, nil
+}
 
-	if err := Extract(archivePath, tempDir); err != nil {
+// Next advances to the next member. It returns io.EOF after the last one.
+func (ar *Reader) Next() (*Entry, error) {
+	var info C.apg_entry_info
+	switch r := C.apg_reader_next(ar.r, &info, &ar.errBuf[0], 512); r {
+	case 0:
+		return nil, io.EOF
+	case -1, C.APG_ELIMIT:
+		return nil, cError("read archive", r, &ar.errBuf[0])
+	}
+
+	e := &Entry{
+		Path:    C.GoString(info.path),
+		Size:    int64(info.size),
+		Mode:    fileMode(uint32(info.perm)),
+		ModTime: time.Unix(int64(info.mtime), int64(info.mtimeNsec)),
+		perm:    uint32(info.perm),
+		ftype:   uint32(info.fileType),
+		uid:     int64(info.uid),
+		gid:     int64(info.gid),
+		rdev:    uint64(info.rdev),
+	}
+	if info.link != nil {
+		e.Linkname = C.GoString(info.link)
+	}
+	switch {
+	case info.hardlink != 0:
+		e.Type = TypeHardlink
+	case info.fileType == C.AE_IFREG:
+		e.Type = TypeRegular
+	case info.fileType == C.AE_IFDIR:
+		e.Type = TypeDir
+		e.Path = strings.TrimSuffix(e.Path, "/")
+	case info.fileType == C.AE_IFLNK:
+		e.Type = TypeSymlink
+	default:
+		e.Type = TypeOther
+	}
+	return e, nil
+}
+
+// Skip discards the data of the current member.
+func (ar *Reader) Skip() error {
+	if C.apg_reader_skip(ar.r, &ar.errBuf[0], 512) != 0 {
+		return fmt.Errorf("read archive: %s", C.GoString(&ar.errBuf[0]))
+	}
+	return nil
+}
+
+// Read reads data of the current member. It implements io.Reader.
+func (ar *Reader) Read(p []byte) (int, error) {
+	if len(p) == 0 {
+		return 0, nil
+	}
+	n := C.apg_reader_data(ar.r, unsafe.Pointer(&p[0]), C.size_t(len(p)), &ar.errBuf[0], 512)
+	switch {
+	case n < 0:
+		return 0, cError("read archive", C.int(n), &ar.errBuf[0])
+	case n == 0:
+		return 0, io.EOF
+	}
+	return int(n), nil
+}
+
+// Close releases the underlying libarchive handle.
+func (ar *Reader) Close() error {
+	if ar.r != nil {
+		C.apg_reader_close(ar.r)
+		ar.r = nil
+	}
+	return nil
+}
+
+// fileMode converts unix permission bits to an os.FileMode.
+func fileMode(perm uint32) os.FileMode {
+	m := os.FileMode(perm & 0777)
+	if perm&04000 != 0 {
+		m |= os.ModeSetuid
+	}
+	if perm&02000 != 0 {
+		m |= os.ModeSetgid
+	}
+	if perm&01000 != 0 {
+		m |= os.ModeSticky
+	}
+	return m
+}
+
+// unixPerm is the inverse of fileMode.
+func unixPerm(m os.FileMode) uint32 {
+	perm := uint32(m.Perm())
+	if m&os.ModeSetuid != 0 {
+		perm |= 04000
+	}
+	if m&os.ModeSetgid != 0 {
+		perm |= 02000
+	}
+	if m&os.ModeSticky != 0 {
+		perm |= 01000
+	}
+	return perm
+}
+
+// ListContents lists the members of an archive from their headers alone:
+// data is skipped in the decompressed stream and nothing touches the disk.
+func ListContents(archivePath string) ([]Entry, error) {
+	ar, err := OpenReader(archivePath)
+	if err != nil {
 		return nil, err
 	}
+	defer ar.Close()
 
-	var contents []string
-	filepath.Walk(tempDir, func(path string, info os.FileInfo, err error) error { //nolint:errcheck
-		if err != nil || info.IsDir() {
-			return err
+	var contents []Entry
+	for {
+		e, err := ar.Next()
+		if err == io.EOF {
+			return contents, nil
 		}
-		rel, _ := filepath.Rel(tempDir, path)
-		contents = append(contents, rel)
-		return nil
-	})
-	return contents, nil
+		if err != nil {
+			return nil, err
+		}
+		if err := ar.Skip(); err != nil {
+			return nil, err
+		}
+		contents = append(contents, *e)
+	}
 }
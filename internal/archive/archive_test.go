@@ -1,6 +1,8 @@
 package archive
 
 import (
+	"bytes"
+	"errors"
 	"os"
 	"path/filepath"
 	"testing"
@@ -92,6 +94,61 @@ func TestListContents(t *testing.T) {
 	if len(contents) != 2 {
 		t.Errorf("Expected 2 entries, got %d", len(contents))
 	}
+	for _, e := range contents {
+		if e.Type != TypeRegular || e.Size != 1 || e.Mode.Perm() != 0644 {
+			t.Errorf("Unexpected entry %+v", e)
+		}
+	}
+}
+
+func TestListContents_Types(t *testing.T) {
+	sourceDir := t.TempDir()
+	if err := os.MkdirAll(filepath.Join(sourceDir, "usr", "lib"), 0755); err != nil {
+		t.Fatalf("Failed to create dir: %v", err)
+	}
+	if err := os.WriteFile(filepath.Join(sourceDir, "usr", "lib", "libfoo.so.1"), []byte("elf"), 0755); err != nil {
+		t.Fatalf("Failed to create file: %v", err)
+	}
+	if err := os.Symlink("libfoo.so.1", filepath.Join(sourceDir, "usr", "lib", "libfoo.so")); err != nil {
+		t.Fatalf("Failed to create symlink: %v", err)
+	}
+
+	archivePath := filepath.Join(t.TempDir(), "test.apg")
+	w, err := NewWriter(archivePath, CreateOptions{Compression: "zstd", Level: 1})
+	if err != nil {
+		t.Fatalf("NewWriter failed: %v", err)
+	}
+	for _, rel := range []string{"usr", "usr/lib", "usr/lib/libfoo.so", "usr/lib/libfoo.so.1"} {
+		size, err := w.WriteHeader(filepath.Join(sourceDir, rel), rel)
+		if err != nil {
+			t.Fatalf("WriteHeader(%s) failed: %v", rel, err)
+		}
+		if size > 0 {
+			data, _ := os.ReadFile(filepath.Join(sourceDir, rel))
+			w.Write(data)
+		}
+	}
+	if _, err := w.Close(); err != nil {
+		t.Fatalf("Close failed: %v", err)
+	}
+
+	contents, err := ListContents(archivePath)
+	if err != nil {
+		t.Fatalf("ListContents failed: %v", err)
+	}
+	byPath := make(map[string]Entry)
+	for _, e := range contents {
+		byPath[e.Path] = e
+	}
+	if e := byPath["usr/lib"]; e.Type != TypeDir {
+		t.Errorf("usr/lib: expected dir, got %+v", e)
+	}
+	if e := byPath["usr/lib/libfoo.so"]; e.Type != TypeSymlink || e.Linkname != "libfoo.so.1" {
+		t.Errorf("libfoo.so: expected symlink to libfoo.so.1, got %+v", e)
+	}
+	if e := byPath["usr/lib/libfoo.so.1"]; e.Type != TypeRegular || e.Size != 3 || e.Mode.Perm() != 0755 {
+		t.Errorf("libfoo.so.1: unexpected entry %+v", e)
+	}
 }
 
 func TestIsPathSafe(t *testing.T) {
@@ -163,3 +220,115 @@ func TestCreate_NonExistentSource(t *testing.T) {
 		t.Error("Create should fail for non-existent source directory")
 	}
 }
+
+func TestCreateWithOptions_Threads(t *testing.T) {
+	sourceDir := t.TempDir()
+	if err := os.WriteFile(filepath.Join(sourceDir, "file.txt"), []byte("threaded content"), 0644); err != nil {
+		t.Fatalf("Failed to create file: %v", err)
+	}
+
+	for _, comp := range []string{"zstd", "xz"} {
+		t.Run(comp, func(t *testing.T) {
+			archivePath := filepath.Join(t.TempDir(), "test.apg")
+			opts := CreateOptions{Compression: comp, Level: 3, Threads: ThreadsAuto}
+			if _, err := CreateWithOptions(archivePath, sourceDir, opts); err != nil {
+				t.Fatalf("CreateWithOptions failed: %v", err)
+			}
+
+			destDir := t.TempDir()
+			if err := Extract(archivePath, destDir); err != nil {
+				t.Fatalf("Extract failed: %v", err)
+			}
+			content, err := os.ReadFile(filepath.Join(destDir, "file.txt"))
+			if err != nil || string(content) != "threaded content" {
+				t.Errorf("Content mismatch: got %q, err %v", content, err)
+			}
+		})
+	}
+}
+
+func TestCreateWithOptions_Result(t *testing.T) {
+	srcDir := t.TempDir()
+	os.MkdirAll(filepath.Join(srcDir, "data"), 0755)
+	os.WriteFile(filepath.Join(srcDir, "data", "a"), make([]byte, 50000), 0644)
+	os.WriteFile(filepath.Join(srcDir, "metadata.json"), []byte("{}"), 0644)
+
+	for _, seekable := range []bool{false, true} {
+		out := filepath.Join(t.TempDir(), "t.apg")
+		r, err := CreateWithOptions(out, srcDir, CreateOptions{Compression: "zstd", Level: 3, Seekable: seekable})
+		if err != nil {
+			t.Fatalf("CreateWithOptions(seekable=%v) failed: %v", seekable, err)
+		}
+		info, _ := os.Stat(out)
+		if r.CompressedSize != info.Size() {
+			t.Errorf("seekable=%v: CompressedSize = %d, file is %d bytes", seekable, r.CompressedSize, info.Size())
+		}
+		if r.FilesAdded != 3 || r.TotalSize != 50002 || r.TarSize <= r.TotalSize {
+			t.Errorf("seekable=%v: unexpected result %+v", seekable, r)
+		}
+		if r.Duration <= 0 || r.Duration < r.ReadTime+r.WriteTime {
+			t.Errorf("seekable=%v: inconsistent timings %+v", seekable, r)
+		}
+	}
+}
+
+// failingWriter accepts n bytes, then fails.
+type failingWriter struct{ n int }
+
+var errSinkFull = errors.New("sink full")
+
+func (w *failingWriter) Write(p []byte) (int, error) {
+	if len(p) > w.n {
+		return 0, errSinkFull
+	}
+	w.n -= len(p)
+	return len(p), nil
+}
+
+func TestCreateWithOptions_Sink(t *testing.T) {
+	src := t.TempDir()
+	for i := 0; i < 50; i++ {
+		os.WriteFile(filepath.Join(src, "f"+string(rune('a'+i%26))+string(rune('a'+i/26))), bytes.Repeat([]byte{byte(i)}, 5000+i*300), 0644)
+	}
+	for _, opts := range []CreateOptions{
+		{Compression: "zstd", Level: 3},
+		{Compression: "zstd", Level: 3, Seekable: true, FrameSize: 16 << 10},
+		{Compression: "gz"},
+	} {
+		file := filepath.Join(t.TempDir(), "pkg.apg")
+		want, err := CreateWithOptions(file, src, opts)
+		if err != nil {
+			t.Fatal(err)
+		}
+		onDisk, _ := os.ReadFile(file)
+
+		// Through the io.Writer callback.
+		var buf bytes.Buffer
+		opts.Sink = &buf
+		got, err := CreateWithOptions("", src, opts)
+		if err != nil {
+			t.Fatalf("%s seekable=%v: %v", opts.Compression, opts.Seekable, err)
+		}
+		if !bytes.Equal(buf.Bytes(), onDisk) || got.CompressedSize != want.CompressedSize {
+			t.Errorf("%s seekable=%v: sink output (%d bytes) differs from file (%d bytes)", opts.Compression, opts.Seekable, buf.Len(), len(onDisk))
+		}
+
+		// An *os.File is written to directly.
+		pipeOut := filepath.Join(t.TempDir(), "direct.apg")
+		f, _ := os.Create(pipeOut)
+		opts.Sink = f
+		if _, err := CreateWithOptions("", src, opts); err != nil {
+			t.Fatal(err)
+		}
+		f.Close()
+		direct, _ := os.ReadFile(pipeOut)
+		if !bytes.Equal(direct, onDisk) {
+			t.Errorf("%s seekable=%v: *os.File sink output differs from file", opts.Compression, opts.Seekable)
+		}
+	}
+
+	_, err := CreateWithOptions("", src, CreateOptions{Compression: "zstd", Sink: &failingWriter{n: 1000}})
+	if !errors.Is(err, errSinkFull) {
+		t.Errorf("failing sink: err = %v, want errSinkFull", err)
+	}
+}
@@ -0,0 +1,141 @@
+// Package archive — automatic compression settings.
+// NurOS 2026 - GPL 3.0
+package archive
+
+import (
+	"fmt"
+	"io"
+	"math"
+	"os"
+	"path"
+	"strings"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// CompressionAuto selects zstd with a level chosen per package by
+// PlanCompression. It is resolved before archiving (see the builder);
+// CreateOptions never carries it.
+const CompressionAuto = "auto"
+
+// autoLevels are the zstd levels PlanCompression picks from, best first,
+// with a rough single-threaded throughput on compressible data (MB/s).
+var autoLevels = []struct {
+	level int
+	mbps  float64
+}{{19, 3}, {17, 6}, {15, 12}, {12, 30}, {9, 50}, {6, 80}, {3, 220}, {1, 400}}
+
+const (
+	// Regular files of at least entropyMinSize whose extension says
+	// nothing are sampled: entropySample bytes from their start, and above
+	// entropyLimit bits per byte they count as incompressible.
+	entropyMinSize = 64 << 10
+	entropySample  = 16 << 10
+	entropyLimit   = 7.5
+	fastMBps       = 700 // level 1 on data it stores raw
+)
+
+// PlanOptions configures PlanCompression.
+type PlanOptions struct {
+	// Budget is the compression time to aim for (0 = smallest package).
+	Budget time.Duration
+	// Threads: compressor threads, as in CreateOptions.
+	Threads int
+	// Seekable: incompressible members get fast frames of their own
+	// (CreateOptions.Incompressible), so they hardly cost any time.
+	// Without it they are compressed at the chosen level like the rest.
+	Seekable bool
+}
+
+// CompressionPlan is what PlanCompression chose for a tree.
+type CompressionPlan struct {
+	Level int // zstd level
+	// Incompressible holds the members already compressed (by extension,
+	// see OrderGroup) or of high entropy.
+	Incompressible map[string]bool
+	// Bytes is the regular file data, IncompressibleBytes the part of it
+	// in Incompressible.
+	Bytes, IncompressibleBytes int64
+	// Estimate is the expected compression time at Level.
+	Estimate time.Duration
+}
+
+// PlanCompression picks a zstd level for tree: the best one whose
+// estimated compression time fits opts.Budget, or the best one without a
+// budget. Data that does not compress further is told apart first, by
+// extension and by sampling the entropy of larger files, and is not
+// counted against the budget of a seekable package.
+func PlanCompression(tree *scan.Tree, opts PlanOptions) (*CompressionPlan, error) {
+	p := &CompressionPlan{Incompressible: map[string]bool{}}
+	var sample []byte
+	for i := range tree.Files {
+		f := &tree.Files[i]
+		if !f.Mode.IsRegular() || f.Size == 0 {
+			continue
+		}
+		p.Bytes += f.Size
+		dense := precompressed[strings.ToLower(path.Ext(f.Path))]
+		if !dense && f.Size >= entropyMinSize {
+			if sample == nil {
+				sample = make([]byte, entropySample)
+			}
+			e, err := sampleEntropy(tree.Abs(f), sample)
+			if err != nil {
+				return nil, fmt.Errorf("plan compression: %w", err)
+			}
+			dense = e > entropyLimit
+		}
+		if dense {
+			p.Incompressible[f.Path] = true
+			p.IncompressibleBytes += f.Size
+		}
+	}
+
+	threads := float64(CreateOptions{Threads: opts.Threads}.threads())
+	if threads < 1 {
+		threads = 1
+	}
+	estimate := func(mbps float64) time.Duration {
+		dense, rest := 0.0, float64(p.Bytes-p.IncompressibleBytes)
+		if opts.Seekable {
+			dense = float64(p.IncompressibleBytes) / (fastMBps * 1e6)
+		} else {
+			rest = float64(p.Bytes)
+		}
+		return time.Duration((rest/(mbps*1e6) + dense) / threads * float64(time.Second))
+	}
+	for _, l := range autoLevels {
+		p.Level, p.Estimate = l.level, estimate(l.mbps)
+		if opts.Budget <= 0 || p.Estimate <= opts.Budget {
+			break
+		}
+	}
+	return p, nil
+}
+
+// sampleEntropy returns the Shannon entropy, in bits per byte, of the
+// first len(buf) bytes of the file at name.
+func sampleEntropy(name string, buf []byte) (float64, error) {
+	f, err := os.Open(name)
+	if err != nil {
+		return 0, err
+	}
+	defer f.Close()
+	n, err := io.ReadFull(f, buf)
+	if err != nil && err != io.ErrUnexpectedEOF {
+		return 0, err
+	}
+	var count [256]int
+	for _, c := range buf[:n] {
+		count[c]++
+	}
+	e := 0.0
+	for _, c := range count {
+		if c > 0 {
+			q := float64(c) / float64(n)
+			e -= q * math.Log2(q)
+		}
+	}
+	return e, nil
+}
@@ -0,0 +1,105 @@
+package archive
+
+import (
+	"bytes"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// mixedTree writes text, an image and an extensionless random blob.
+func mixedTree(t *testing.T) string {
+	t.Helper()
+	dir := t.TempDir()
+	random := make([]byte, 300<<10)
+	rand.New(rand.NewSource(9)).Read(random)
+	files := map[string][]byte{
+		"metadata.json":              []byte(`{"name":"mixed","version":"1"}`),
+		"data/usr/share/doc/big.txt": []byte(strings.Repeat("a line of documentation\n", 20000)),
+		"data/usr/share/icons/a.png": random[:5000],
+		"data/usr/lib/firmware/fw":   random,
+	}
+	for rel, content := range files {
+		p := filepath.Join(dir, rel)
+		os.MkdirAll(filepath.Dir(p), 0755)
+		if err := os.WriteFile(p, content, 0644); err != nil {
+			t.Fatal(err)
+		}
+	}
+	return dir
+}
+
+func TestPlanCompression(t *testing.T) {
+	tree, err := scan.Scan(mixedTree(t), scan.Options{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	plan, err := PlanCompression(tree, PlanOptions{Seekable: true})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if plan.Level != 19 {
+		t.Errorf("level %d without a budget, want 19", plan.Level)
+	}
+	for rel, want := range map[string]bool{
+		"data/usr/share/icons/a.png": true,  // by extension
+		"data/usr/lib/firmware/fw":   true,  // by entropy
+		"data/usr/share/doc/big.txt": false, // text
+	} {
+		if plan.Incompressible[rel] != want {
+			t.Errorf("%s: incompressible = %v, want %v", rel, !want, want)
+		}
+	}
+
+	if plan, _ = PlanCompression(tree, PlanOptions{Budget: time.Nanosecond}); plan.Level != 1 {
+		t.Errorf("level %d for a budget nothing fits, want 1", plan.Level)
+	}
+	seekable, _ := PlanCompression(tree, PlanOptions{Budget: 100 * time.Millisecond, Seekable: true})
+	plain, _ := PlanCompression(tree, PlanOptions{Budget: 100 * time.Millisecond})
+	if seekable.Level <= plain.Level {
+		t.Errorf("seekable level %d, plain %d: fast frames should leave budget for a higher level", seekable.Level, plain.Level)
+	}
+}
+
+func TestCreate_IncompressibleFrames(t *testing.T) {
+	src := mixedTree(t)
+	tree, _ := scan.Scan(src, scan.Options{})
+	plan, _ := PlanCompression(tree, PlanOptions{Seekable: true})
+	base := CreateOptions{Compression: "zstd", Level: 9, Seekable: true}
+	fast := base
+	fast.Incompressible = plan.Incompressible
+
+	frames := map[string]int{}
+	for name, opts := range map[string]CreateOptions{"base": base, "fast": fast} {
+		out := filepath.Join(t.TempDir(), name+".apg")
+		if _, err := CreateWithOptions(out, src, opts); err != nil {
+			t.Fatalf("%s: %v", name, err)
+		}
+		toc, err := ReadTOC(out)
+		if err != nil {
+			t.Fatal(err)
+		}
+		frames[name] = len(toc.Frames)
+		for _, jobs := range []int{1, 4} {
+			dest := t.TempDir()
+			if err := ExtractWithOptions(out, dest, ExtractOptions{Jobs: jobs}); err != nil {
+				t.Fatalf("%s jobs=%d: %v", name, jobs, err)
+			}
+			for rel := range plan.Incompressible {
+				got, _ := os.ReadFile(filepath.Join(dest, rel))
+				want, _ := os.ReadFile(filepath.Join(src, rel))
+				if !bytes.Equal(got, want) {
+					t.Errorf("%s jobs=%d: %s differs", name, jobs, rel)
+				}
+			}
+		}
+	}
+	if frames["fast"] < frames["base"]+2 {
+		t.Errorf("%d frames with fast members, %d without: want them in frames of their own", frames["fast"], frames["base"])
+	}
+}
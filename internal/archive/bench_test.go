@@ -0,0 +1,107 @@
+package archive
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/NurOS-Linux/apgbuild/internal/testtree"
+)
+
+func TestMain(m *testing.M) {
+	code := m.Run()
+	testtree.Cleanup()
+	os.Exit(code)
+}
+
+// benchCodecs are the codec/level pairs BenchmarkCreate measures: the
+// default, the release level, and the alternatives users pick.
+var benchCodecs = []CreateOptions{
+	{Compression: "zstd", Level: 3},
+	{Compression: "zstd", Level: 19},
+	{Compression: "zstd", Level: 3, Seekable: true},
+	{Compression: "xz", Level: 6},
+	{Compression: "gz", Level: 6},
+	{Compression: "lz4", Level: 1},
+}
+
+func codecName(o CreateOptions) string {
+	name := fmt.Sprintf("%s-%d", o.Compression, o.Level)
+	if o.Seekable {
+		name += "-seekable"
+	}
+	return name
+}
+
+func BenchmarkCreateWithOptions(b *testing.B) {
+	for _, shape := range testtree.Shapes {
+		for _, opts := range benchCodecs {
+			b.Run(string(shape)+"/"+codecName(opts), func(b *testing.B) {
+				root, st := testtree.Shared(b, shape)
+				out := filepath.Join(b.TempDir(), "bench.apg")
+				b.SetBytes(st.Bytes)
+				b.ResetTimer()
+				var res *CreateResult
+				for i := 0; i < b.N; i++ {
+					var err error
+					if res, err = CreateWithOptions(out, root, opts); err != nil {
+						b.Fatal(err)
+					}
+				}
+				b.ReportMetric(float64(res.CompressedSize)/float64(res.TarSize), "ratio")
+			})
+		}
+	}
+}
+
+// benchPackage builds the zstd-3 package of shape once per benchmark.
+func benchPackage(b *testing.B, shape testtree.Shape, seekable bool) (string, testtree.Stats) {
+	b.Helper()
+	root, st := testtree.Shared(b, shape)
+	pkg := filepath.Join(b.TempDir(), "bench.apg")
+	if _, err := CreateWithOptions(pkg, root, CreateOptions{Compression: "zstd", Level: 3, Seekable: seekable}); err != nil {
+		b.Fatal(err)
+	}
+	return pkg, st
+}
+
+func BenchmarkExtract(b *testing.B) {
+	for _, shape := range testtree.Shapes {
+		b.Run(string(shape), func(b *testing.B) {
+			pkg, st := benchPackage(b, shape, false)
+			dest := filepath.Join(b.TempDir(), "out")
+			b.SetBytes(st.Bytes)
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				b.StopTimer()
+				os.RemoveAll(dest)
+				b.StartTimer()
+				if err := Extract(pkg, dest); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkListContents(b *testing.B) {
+	for _, shape := range testtree.Shapes {
+		for _, seekable := range []bool{false, true} {
+			name := string(shape)
+			if seekable {
+				name += "/seekable"
+			}
+			b.Run(name, func(b *testing.B) {
+				pkg, st := benchPackage(b, shape, seekable)
+				b.ReportMetric(float64(st.Files), "files/op")
+				b.ResetTimer()
+				for i := 0; i < b.N; i++ {
+					if _, err := ListContents(pkg); err != nil {
+						b.Fatal(err)
+					}
+				}
+			})
+		}
+	}
+}
@@ -0,0 +1,75 @@
+// Package archive — content-addressed store of compressed member data.
+// NurOS 2026 - GPL 3.0
+package archive
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+)
+
+// DefaultBlobMinSize is the smallest file a BlobStore is used for. Smaller
+// files compress better together with their neighbours than in a frame of
+// their own.
+const DefaultBlobMinSize = 64 << 10
+
+// A BlobStore caches the compressed data of regular files by content hash,
+// so seekable packages built from the same files (e.g. on a build farm)
+// splice the frames in instead of compressing the files again. Blobs live
+// at
+//
+//	<dir>/zstd-<level>[-d<dict ID>]/<algorithm>/<hash[:2]>/<hash>.zst
+//
+// each one zstd frame of a file's tar data. They are written to a
+// temporary file and renamed into place, so several builders can share a
+// store. Nothing is ever removed from it; old blobs can be deleted at any
+// time, e.g. by access time.
+type BlobStore struct {
+	Dir string
+	// MinSize: smallest file stored (0 = DefaultBlobMinSize).
+	MinSize int64
+}
+
+// OpenBlobStore returns the store at dir, creating the directory.
+func OpenBlobStore(dir string) (*BlobStore, error) {
+	if err := os.MkdirAll(dir, 0755); err != nil {
+		return nil, fmt.Errorf("open blob store: %w", err)
+	}
+	return &BlobStore{Dir: dir}, nil
+}
+
+func (s *BlobStore) minSize() int64 {
+	if s.MinSize > 0 {
+		return s.MinSize
+	}
+	return DefaultBlobMinSize
+}
+
+// blobCodec names the compression settings blobs are made with.
+func blobCodec(level int, dict []byte) string {
+	codec := fmt.Sprintf("zstd-%d", level)
+	if id := DictionaryID(dict); id != 0 {
+		codec += fmt.Sprintf("-d%08x", id)
+	}
+	return codec
+}
+
+// path returns where the blob of content key ("algorithm:hash", as in
+// CreateOptions.BlobSums) is kept, or "" for a key it cannot be stored under.
+func (s *BlobStore) path(codec, key string) string {
+	alg, sum, ok := strings.Cut(key, ":")
+	if !ok || !isHex(sum) || len(sum) < 16 || alg == "" || strings.ContainsAny(alg, "/.") {
+		return ""
+	}
+	return filepath.Join(s.Dir, codec, alg, sum[:2], sum+".zst")
+}
+
+func isHex(s string) bool {
+	for _, c := range s {
+		if !('0' <= c && c <= '9' || 'a' <= c && c <= 'f') {
+			return false
+		}
+	}
+	return true
+}
@@ -0,0 +1,103 @@
+package archive
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"encoding/hex"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"testing"
+)
+
+// blobTree adds files large enough for a blob store to seekableTree and
+// returns their content keys by member path.
+func blobTree(t *testing.T) (string, map[string]string) {
+	t.Helper()
+	dir := seekableTree(t)
+	smallFiles(t, dir, 200)
+	r := rand.New(rand.NewSource(5))
+	sums := map[string]string{}
+	for i, size := range []int{DefaultBlobMinSize, 200<<10 + 77, 3 << 20} {
+		data := make([]byte, size)
+		r.Read(data[:size/2]) // half random, half zeros
+		rel := filepath.Join("data", "usr", "lib", "big"+string(rune('a'+i)))
+		if err := os.WriteFile(filepath.Join(dir, rel), data, 0644); err != nil {
+			t.Fatal(err)
+		}
+		sum := sha256.Sum256(data)
+		sums[rel] = "sha256:" + hex.EncodeToString(sum[:])
+	}
+	sums["data/usr/share/readme"] = "sha256:" + hex.EncodeToString(make([]byte, 32)) // too small
+	return dir, sums
+}
+
+func TestBlobStore_Splice(t *testing.T) {
+	src, sums := blobTree(t)
+	dict, err := TrainDictionary(smallFiles(t, t.TempDir(), 200), 4096)
+	if err != nil {
+		t.Fatal(err)
+	}
+	dictDir := t.TempDir()
+	os.WriteFile(filepath.Join(dictDir, "conf.dict"), dict, 0644)
+	t.Setenv(DictionaryPathEnv, dictDir)
+
+	for name, d := range map[string][]byte{"plain": nil, "dictionary": dict} {
+		store, err := OpenBlobStore(filepath.Join(t.TempDir(), "blobs"))
+		if err != nil {
+			t.Fatal(err)
+		}
+		opts := CreateOptions{Compression: "zstd", Level: 3, Seekable: true, FrameSize: 64 << 10,
+			Dictionary: d, Blobs: store, BlobSums: sums}
+		first := filepath.Join(t.TempDir(), "first.apg")
+		res, err := CreateWithOptions(first, src, opts)
+		if err != nil {
+			t.Fatalf("%s: %v", name, err)
+		}
+		if res.BlobHits != 0 || res.BlobMisses != 3 {
+			t.Errorf("%s: first build: %d hits, %d misses, want 0 and 3", name, res.BlobHits, res.BlobMisses)
+		}
+		second := filepath.Join(t.TempDir(), "second.apg")
+		if res, err = CreateWithOptions(second, src, opts); err != nil {
+			t.Fatalf("%s: %v", name, err)
+		}
+		if res.BlobHits != 3 || res.BlobMisses != 0 {
+			t.Errorf("%s: second build: %d hits, %d misses, want 3 and 0", name, res.BlobHits, res.BlobMisses)
+		}
+		a, _ := os.ReadFile(first)
+		b, _ := os.ReadFile(second)
+		if !bytes.Equal(a, b) {
+			t.Errorf("%s: builds from a cold and a warm store differ", name)
+		}
+
+		for _, jobs := range []int{1, 4} {
+			dest := t.TempDir()
+			if err := ExtractWithOptions(second, dest, ExtractOptions{Jobs: jobs}); err != nil {
+				t.Fatalf("%s jobs=%d: %v", name, jobs, err)
+			}
+			for rel := range sums {
+				got, _ := os.ReadFile(filepath.Join(dest, rel))
+				want, _ := os.ReadFile(filepath.Join(src, rel))
+				if !bytes.Equal(got, want) {
+					t.Errorf("%s jobs=%d: %s differs", name, jobs, rel)
+				}
+			}
+		}
+		dest := t.TempDir()
+		if err := ExtractFile(second, "data/usr/lib/bigb", dest); err != nil {
+			t.Fatalf("%s: ExtractFile: %v", name, err)
+		}
+		if fi, err := os.Stat(filepath.Join(dest, "data/usr/lib/bigb")); err != nil || fi.Size() != 200<<10+77 {
+			t.Errorf("%s: ExtractFile: %v", name, err)
+		}
+	}
+}
+
+func TestBlobStore_RequiresSeekable(t *testing.T) {
+	src, sums := blobTree(t)
+	store, _ := OpenBlobStore(t.TempDir())
+	opts := CreateOptions{Compression: "zstd", Blobs: store, BlobSums: sums}
+	if _, err := CreateWithOptions(filepath.Join(t.TempDir(), "x.apg"), src, opts); err == nil {
+		t.Error("a blob store should be rejected for non-seekable packages")
+	}
+}
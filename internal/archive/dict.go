@@ -0,0 +1,160 @@
+// Package archive — zstd dictionaries.
+// NurOS 2026 - GPL 3.0
+package archive
+
+/*
+#cgo pkg-config: libzstd
+#include <stdio.h>
+#include <stdlib.h>
+#include <zstd.h>
+#include <zdict.h>
+
+static size_t apg_dict_train(void *dict, size_t cap, const void *samples,
+                             const size_t *sizes, unsigned n, char *errBuf, int errBufLen) {
+    size_t r = ZDICT_trainFromBuffer(dict, cap, samples, sizes, n);
+    if (ZDICT_isError(r)) {
+        snprintf(errBuf, errBufLen, "%s", ZDICT_getErrorName(r));
+        return 0;
+    }
+    return r;
+}
+*/
+import "C"
+import (
+	"encoding/binary"
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"unsafe"
+)
+
+const (
+	// DictionaryPathEnv lists directories (colon-separated) searched for
+	// dictionaries before DictionaryDir.
+	DictionaryPathEnv = "APG_DICT_PATH"
+	// DictionaryDir is where installed dictionaries live.
+	DictionaryDir = "/usr/share/apg/dictionaries"
+	// DefaultDictionarySize is the usual zstd dictionary size (110 KiB).
+	DefaultDictionarySize = 112640
+
+	dictMagic = 0xEC30A437
+)
+
+// TrainDictionary trains a zstd dictionary of at most size bytes
+// (0 = DefaultDictionarySize) from samples, typically the small files of
+// packages that should share it.
+func TrainDictionary(samples [][]byte, size int) ([]byte, error) {
+	if size <= 0 {
+		size = DefaultDictionarySize
+	}
+	var all []byte
+	sizes := make([]C.size_t, 0, len(samples))
+	for _, s := range samples {
+		if len(s) > 0 {
+			all = append(all, s...)
+			sizes = append(sizes, C.size_t(len(s)))
+		}
+	}
+	if len(sizes) == 0 {
+		return nil, fmt.Errorf("train dictionary: no samples")
+	}
+
+	dict := make([]byte, size)
+	var errBuf [256]C.char
+	n := C.apg_dict_train(unsafe.Pointer(&dict[0]), C.size_t(size), unsafe.Pointer(&all[0]),
+		&sizes[0], C.uint(len(sizes)), &errBuf[0], 256)
+	if n == 0 {
+		return nil, fmt.Errorf("train dictionary from %d samples: %s", len(sizes), C.GoString(&errBuf[0]))
+	}
+	return dict[:n], nil
+}
+
+// DictionaryID returns the ID of a zstd dictionary, 0 if dict is not one.
+func DictionaryID(dict []byte) uint32 {
+	if len(dict) < 8 || binary.LittleEndian.Uint32(dict) != dictMagic {
+		return 0
+	}
+	return binary.LittleEndian.Uint32(dict[4:])
+}
+
+// dictionaryDirs returns the directories LoadDictionary searches.
+func dictionaryDirs() []string {
+	var dirs []string
+	for _, d := range strings.Split(os.Getenv(DictionaryPathEnv), ":") {
+		if d != "" {
+			dirs = append(dirs, d)
+		}
+	}
+	return append(dirs, DictionaryDir)
+}
+
+// LoadDictionary finds the dictionary with the given ID in the
+// directories of DictionaryPathEnv, then DictionaryDir.
+func LoadDictionary(id uint32) ([]byte, error) {
+	for _, dir := range dictionaryDirs() {
+		entries, err := os.ReadDir(dir)
+		if err != nil {
+			continue
+		}
+		for _, e := range entries {
+			if !e.Type().IsRegular() {
+				continue
+			}
+			p := filepath.Join(dir, e.Name())
+			if dictFileID(p) != id {
+				continue
+			}
+			dict, err := os.ReadFile(p)
+			if err != nil {
+				return nil, err
+			}
+			return dict, nil
+		}
+	}
+	return nil, fmt.Errorf("zstd dictionary %d not found in %s", id, strings.Join(dictionaryDirs(), ":"))
+}
+
+// dictFileID returns the ID of the dictionary in file p, 0 if it is none.
+func dictFileID(p string) uint32 {
+	f, err := os.Open(p)
+	if err != nil {
+		return 0
+	}
+	defer f.Close()
+	var hdr [8]byte
+	if _, err := f.ReadAt(hdr[:], 0); err != nil {
+		return 0
+	}
+	return DictionaryID(hdr[:])
+}
+
+// packageDictionary returns the dictionary the zstd frame at offset of a
+// package was compressed with, or nil if it needs none.
+func packageDictionary(archivePath string, offset int64) ([]byte, error) {
+	f, err := os.Open(archivePath)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	// A frame header is at most 18 bytes.
+	hdr := make([]byte, 18)
+	n, _ := f.ReadAt(hdr, offset)
+	if n < 6 {
+		return nil, nil
+	}
+	id := uint32(C.ZSTD_getDictID_fromFrame(unsafe.Pointer(&hdr[0]), C.size_t(n)))
+	if id == 0 {
+		return nil, nil
+	}
+	return LoadDictionary(id)
+}
+
+// cDict returns dict as arguments for the C helpers: NULL when empty. The
+// helpers copy the dictionary, so it need not outlive the call.
+func cDict(dict []byte) (unsafe.Pointer, C.size_t) {
+	if len(dict) == 0 {
+		return nil, 0
+	}
+	return unsafe.Pointer(&dict[0]), C.size_t(len(dict))
+}
@@ -0,0 +1,96 @@
+package archive
+
+import (
+	"bytes"
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+)
+
+// smallFiles writes n small, similar config files under dir/data and
+// returns their contents.
+func smallFiles(t *testing.T, dir string, n int) [][]byte {
+	t.Helper()
+	var samples [][]byte
+	for i := 0; i < n; i++ {
+		body := fmt.Sprintf("[unit]\nname = service-%d\ndescription = Example service number %d\n"+
+			"after = network.target\n\n[service]\nexec = /usr/bin/daemon-%d --config /etc/d/%d.conf\n"+
+			"restart = on-failure\nuser = nobody\n", i, i*7, i%13, i)
+		p := filepath.Join(dir, "data", "etc", fmt.Sprintf("s%03d.conf", i))
+		os.MkdirAll(filepath.Dir(p), 0755)
+		if err := os.WriteFile(p, []byte(body), 0644); err != nil {
+			t.Fatal(err)
+		}
+		samples = append(samples, []byte(body))
+	}
+	return samples
+}
+
+func TestDictionary_RoundTrip(t *testing.T) {
+	src := t.TempDir()
+	samples := smallFiles(t, src, 400)
+	os.WriteFile(filepath.Join(src, "metadata.json"), []byte(`{"name":"d"}`), 0644)
+
+	dict, err := TrainDictionary(samples, 4096)
+	if err != nil {
+		t.Fatalf("TrainDictionary failed: %v", err)
+	}
+	id := DictionaryID(dict)
+	if id == 0 {
+		t.Fatal("trained dictionary has no ID")
+	}
+	dictDir := t.TempDir()
+	os.WriteFile(filepath.Join(dictDir, "conf.dict"), dict, 0644)
+	t.Setenv(DictionaryPathEnv, dictDir)
+
+	for _, seekable := range []bool{false, true} {
+		out := filepath.Join(t.TempDir(), "d.apg")
+		opts := CreateOptions{Compression: "zstd", Level: 3, Seekable: seekable, FrameSize: 8 << 10, Dictionary: dict}
+		if _, err := CreateWithOptions(out, src, opts); err != nil {
+			t.Fatalf("seekable=%v: CreateWithOptions failed: %v", seekable, err)
+		}
+		for _, jobs := range []int{1, 4} {
+			dest := t.TempDir()
+			if err := ExtractWithOptions(out, dest, ExtractOptions{Jobs: jobs}); err != nil {
+				t.Fatalf("seekable=%v jobs=%d: extract failed: %v", seekable, jobs, err)
+			}
+			got, _ := os.ReadFile(filepath.Join(dest, "data", "etc", "s123.conf"))
+			if !bytes.Equal(got, samples[123]) {
+				t.Errorf("seekable=%v jobs=%d: s123.conf differs", seekable, jobs)
+			}
+		}
+		dest := t.TempDir()
+		if err := ExtractFile(out, "data/etc/s321.conf", dest); err != nil {
+			t.Fatalf("seekable=%v: ExtractFile failed: %v", seekable, err)
+		}
+		if got, _ := os.ReadFile(filepath.Join(dest, "data", "etc", "s321.conf")); !bytes.Equal(got, samples[321]) {
+			t.Errorf("seekable=%v: ExtractFile returned wrong data", seekable)
+		}
+	}
+
+	if _, err := CreateWithOptions(filepath.Join(t.TempDir(), "x.apg"), src,
+		CreateOptions{Compression: "xz", Dictionary: dict}); err == nil {
+		t.Error("a dictionary should be rejected for xz")
+	}
+}
+
+func TestDictionary_Missing(t *testing.T) {
+	src := t.TempDir()
+	samples := smallFiles(t, src, 200)
+	dict, err := TrainDictionary(samples, 4096)
+	if err != nil {
+		t.Fatalf("TrainDictionary failed: %v", err)
+	}
+	out := filepath.Join(t.TempDir(), "d.apg")
+	if _, err := CreateWithOptions(out, src, CreateOptions{Compression: "zstd", Dictionary: dict}); err != nil {
+		t.Fatalf("CreateWithOptions failed: %v", err)
+	}
+
+	t.Setenv(DictionaryPathEnv, t.TempDir())
+	err = Extract(out, t.TempDir())
+	if err == nil || !strings.Contains(err.Error(), fmt.Sprintf("dictionary %d", DictionaryID(dict))) {
+		t.Errorf("Extract without the dictionary = %v, want an error naming it", err)
+	}
+}
@@ -0,0 +1,630 @@
+// Package archive — parallel extraction engine.
+// NurOS 2026 - GPL 3.0
+package archive
+
+/*
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// apg_lutimes sets the times of path without following a final symlink.
+static int apg_lutimes(const char *path, long long asec, long ansec, long long msec, long mnsec) {
+    struct timespec ts[2];
+    ts[0].tv_sec = asec; ts[0].tv_nsec = ansec;
+    ts[1].tv_sec = msec; ts[1].tv_nsec = mnsec;
+    return utimensat(AT_FDCWD, path, ts, AT_SYMLINK_NOFOLLOW);
+}
+
+// apg_lchmod sets the mode of path, failing rather than following a final
+// symlink. C libraries without the flag fail with ENOTSUP; the caller has
+// checked path with lstat and retries without it.
+static int apg_lchmod(const char *path, unsigned mode) {
+    return fchmodat(AT_FDCWD, path, mode, AT_SYMLINK_NOFOLLOW);
+}
+
+static int apg_chmod(const char *path, unsigned mode) {
+    return fchmodat(AT_FDCWD, path, mode, 0);
+}
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"path"
+	"path/filepath"
+	"runtime"
+	"sort"
+	"strings"
+	"sync"
+	"syscall"
+	"time"
+	"unsafe"
+)
+
+const (
+	// Files up to this size are buffered and written by the worker pool;
+	// larger ones are streamed to disk by the decompressing goroutine.
+	extractSmallFile = 1 << 20
+	// extractBudget bounds the file data buffered for the workers.
+	extractBudget = 64 << 20
+)
+
+// errUnsafeEntry marks a member that is skipped for security reasons, the
+// way libarchive's SECURE_NODOTDOT / SECURE_SYMLINKS reject an entry.
+var errUnsafeEntry = errors.New("unsafe entry")
+
+// ExtractOptions configures ExtractWithOptions.
+type ExtractOptions struct {
+	// Jobs is the number of file-writing workers (0 = number of CPUs),
+	// and of threads decompressing the frames of a seekable package.
+	// 1 selects the serial libarchive extractor.
+	Jobs int
+	// Limits bounds the package; extraction stops with ErrLimit at the
+	// first header or data block past them, leaving what was already
+	// written in place. Zero Total and FileSize default to the free space
+	// of destDir's file system, if less than MaxArchiveSize and
+	// MaxFileSize: a package cannot fill the disk it is installed to.
+	Limits Limits
+}
+
+func (o ExtractOptions) jobs() int {
+	if o.Jobs > 0 {
+		return o.Jobs
+	}
+	return runtime.NumCPU()
+}
+
+// ExtractWithOptions extracts an archive to destDir.
+//
+// One goroutine reads the stream and creates directories, links
+// and large files itself; small files are buffered (within a fixed memory
+// budget) and written by a pool of workers. Permissions and timestamps
+// are applied in a final pass once everything is on disk — files in
+// parallel, then directories deepest first — with the semantics of
+// ARCHIVE_EXTRACT_TIME | PERM. Members with ".." components or whose path
+// runs through a symlink are skipped, as with SECURE_NODOTDOT |
+// SECURE_SYMLINKS. The frames of a seekable package are decompressed on
+// Jobs threads ahead of that goroutine.
+func ExtractWithOptions(archivePath, destDir string, opts ExtractOptions) error {
+	jobs := opts.jobs()
+	limits := opts.Limits.forExtract(destDir)
+	if jobs == 1 {
+		return extractSerial(archivePath, destDir, limits)
+	}
+
+	ar, err := OpenReaderWithOptions(archivePath, ReadOptions{Limits: limits, Threads: jobs})
+	if err != nil {
+		return fmt.Errorf("extract archive: %w", err)
+	}
+	defer ar.Close()
+
+	if err := os.MkdirAll(destDir, 0755); err != nil {
+		return fmt.Errorf("extract archive: %w", err)
+	}
+	x, err := newExtractor(destDir, jobs)
+	if err != nil {
+		return fmt.Errorf("extract archive: %w", err)
+	}
+	for {
+		e, err := ar.Next()
+		if err == io.EOF {
+			break
+		}
+		if err == nil {
+			err = x.firstErr()
+		}
+		if err == nil {
+			err = x.entry(ar, e)
+		}
+		if err != nil {
+			x.finish() //nolint:errcheck
+			return fmt.Errorf("extract archive: %w", err)
+		}
+	}
+	if err := x.finish(); err != nil {
+		return fmt.Errorf("extract archive: %w", err)
+	}
+	return nil
+}
+
+// forExtract returns l with the extraction defaults for destDir (see
+// ExtractOptions.Limits). Explicit values and NoLimit are kept.
+func (l Limits) forExtract(destDir string) Limits {
+	free, ok := freeSpace(destDir)
+	if !ok {
+		return l
+	}
+	if free < 1 {
+		free = 1 // zero would select the default
+	}
+	if l.Total == 0 && free < MaxArchiveSize {
+		l.Total = free
+	}
+	if l.FileSize == 0 && free < MaxFileSize {
+		l.FileSize = free
+	}
+	return l
+}
+
+// freeSpace returns the bytes available to us on the file system of dir,
+// or of its nearest existing parent.
+func freeSpace(dir string) (int64, bool) {
+	dir, _ = filepath.Abs(dir)
+	for {
+		var st syscall.Statfs_t
+		err := syscall.Statfs(dir, &st)
+		if err == nil {
+			return int64(st.Bavail) * int64(st.Bsize), true
+		}
+		if !os.IsNotExist(err) || filepath.Dir(dir) == dir {
+			return 0, false
+		}
+		dir = filepath.Dir(dir)
+	}
+}
+
+// extractor holds the state of one ExtractWithOptions call. Everything but
+// the budget and the first error is owned by the decompressing goroutine.
+type extractor struct {
+	root       string
+	rootFd     int // root, opened once; workers create files beneath it
+	start      time.Time
+	euid, egid int64
+	buf        []byte
+
+	dirs   map[string]bool // rel paths known to be real directories
+	queued map[string]bool // files handed to workers since the last flush
+	under  map[string]bool // directories holding those files
+	fixups []fixup
+	fixIdx map[string]int
+
+	work    chan extractJob
+	workers sync.WaitGroup
+	pending sync.WaitGroup
+
+	mu    sync.Mutex
+	cond  *sync.Cond
+	inUse int64
+	err   error
+}
+
+type extractJob struct {
+	rel  string
+	data []byte
+}
+
+// fixup is the metadata of an entry, applied once every entry is on disk.
+type fixup struct {
+	rel   string
+	typ   EntryType
+	perm  uint32
+	mtime time.Time
+}
+
+func newExtractor(root string, jobs int) (*extractor, error) {
+	fd, err := syscall.Open(root, syscall.O_RDONLY|syscall.O_DIRECTORY|syscall.O_CLOEXEC, 0)
+	if err != nil {
+		return nil, &os.PathError{Op: "open", Path: root, Err: err}
+	}
+	x := &extractor{
+		root:   root,
+		rootFd: fd,
+		start:  time.Now(),
+		euid:   int64(os.Geteuid()),
+		egid:   int64(os.Getegid()),
+		dirs:   map[string]bool{},
+		queued: map[string]bool{},
+		under:  map[string]bool{},
+		fixIdx: map[string]int{},
+		work:   make(chan extractJob, jobs),
+	}
+	x.cond = sync.NewCond(&x.mu)
+	for i := 0; i < jobs; i++ {
+		x.workers.Add(1)
+		go x.worker()
+	}
+	return x, nil
+}
+
+func (x *extractor) worker() {
+	defer x.workers.Done()
+	for j := range x.work {
+		if x.firstErr() == nil {
+			if err := x.writeFile(j.rel, j.data); err != nil {
+				x.setErr(err)
+			}
+		}
+		x.release(int64(len(j.data)))
+		x.pending.Done()
+	}
+}
+
+func (x *extractor) setErr(err error) {
+	x.mu.Lock()
+	if x.err == nil {
+		x.err = err
+	}
+	x.mu.Unlock()
+}
+
+func (x *extractor) firstErr() error {
+	x.mu.Lock()
+	defer x.mu.Unlock()
+	return x.err
+}
+
+// acquire reserves n bytes of the buffer budget. A single file larger
+// than what is left waits until the workers have drained everything.
+func (x *extractor) acquire(n int64) {
+	x.mu.Lock()
+	for x.inUse > 0 && x.inUse+n > extractBudget {
+		x.cond.Wait()
+	}
+	x.inUse += n
+	x.mu.Unlock()
+}
+
+func (x *extractor) release(n int64) {
+	x.mu.Lock()
+	x.inUse -= n
+	x.cond.Broadcast()
+	x.mu.Unlock()
+}
+
+// flush waits until every queued file has been written.
+func (x *extractor) flush() {
+	x.pending.Wait()
+	for k := range x.queued {
+		delete(x.queued, k)
+	}
+	for k := range x.under {
+		delete(x.under, k)
+	}
+}
+
+// entry extracts one member. Its data, if any, is consumed from ar.
+func (x *extractor) entry(ar *Reader, e *Entry) error {
+	if !isPathSafe(e.Path, x.root) {
+		return nil
+	}
+	rel := path.Clean(e.Path)
+	if rel == "." {
+		return nil
+	}
+	full := filepath.Join(x.root, filepath.FromSlash(rel))
+	err := x.parents(rel)
+	switch {
+	case err != nil:
+	case x.queued[rel]:
+		// The same path again: the later member must win.
+		x.flush()
+	case e.Type != TypeDir && x.under[rel]:
+		// A directory about to be replaced (by a symlink, say) while
+		// files below it are still queued: they must land first, in the
+		// directory, not wherever the replacement leads.
+		x.flush()
+	}
+
+	if err == nil {
+		switch e.Type {
+		case TypeDir:
+			err = x.mkdir(rel, full)
+		case TypeRegular:
+			delete(x.dirs, rel)
+			err = x.regular(ar, e, rel, full)
+		case TypeSymlink:
+			delete(x.dirs, rel)
+			if err = replace(full); err == nil {
+				err = os.Symlink(e.Linkname, full)
+			}
+		case TypeHardlink:
+			delete(x.dirs, rel)
+			err = x.hardlink(e, full)
+		default:
+			delete(x.dirs, rel)
+			if err = replace(full); err == nil {
+				err = syscall.Mknod(full, e.ftype|(e.perm&0777), int(e.rdev))
+			}
+		}
+	}
+	switch {
+	case errors.Is(err, errUnsafeEntry):
+		return nil
+	case err != nil:
+		return err
+	}
+	if e.Type == TypeHardlink {
+		// The link shares its target's inode and metadata; whatever
+		// was at rel before must not have its fixup applied to it.
+		x.dropFixup(rel)
+	} else {
+		x.addFixup(fixup{rel: rel, typ: e.Type, perm: x.permOf(e), mtime: e.ModTime})
+	}
+	return nil
+}
+
+// regular writes a regular file: buffered through the workers if it is
+// small, streamed here otherwise.
+func (x *extractor) regular(ar *Reader, e *Entry, rel, full string) error {
+	if e.Size <= extractSmallFile {
+		x.acquire(e.Size)
+		data := make([]byte, e.Size)
+		if _, err := io.ReadFull(ar, data); err != nil {
+			x.release(e.Size)
+			return fmt.Errorf("read %s: %w", rel, err)
+		}
+		x.queued[rel] = true
+		for dir := path.Dir(rel); dir != "." && !x.under[dir]; dir = path.Dir(dir) {
+			x.under[dir] = true
+		}
+		x.pending.Add(1)
+		x.work <- extractJob{rel: rel, data: data}
+		return nil
+	}
+
+	f, err := x.createFile(rel)
+	if err != nil {
+		return err
+	}
+	if x.buf == nil {
+		x.buf = make([]byte, 1<<20)
+	}
+	if _, err := io.CopyBuffer(f, ar, x.buf); err != nil {
+		f.Close()
+		return fmt.Errorf("write %s: %w", rel, err)
+	}
+	return f.Close()
+}
+
+func (x *extractor) hardlink(e *Entry, full string) error {
+	if !isPathSafe(e.Linkname, x.root) {
+		return errUnsafeEntry
+	}
+	target := path.Clean(e.Linkname)
+	if err := x.parents(target); err != nil {
+		return err
+	}
+	// The target may still be in a worker's queue.
+	x.flush()
+	targetFull := filepath.Join(x.root, filepath.FromSlash(target))
+	if fi, err := os.Lstat(targetFull); err == nil && fi.Mode()&os.ModeSymlink != 0 {
+		// A link to a symlink would let later metadata reach outside.
+		return errUnsafeEntry
+	}
+	if err := replace(full); err != nil {
+		return err
+	}
+	return os.Link(targetFull, full)
+}
+
+// parents makes sure every parent directory of rel exists and is a real
+// directory, creating missing ones. A parent that is a symlink makes the
+// entry unsafe.
+func (x *extractor) parents(rel string) error {
+	dir := path.Dir(rel)
+	if dir == "." || x.dirs[dir] {
+		return nil
+	}
+	if err := x.parents(dir); err != nil {
+		return err
+	}
+	full := filepath.Join(x.root, filepath.FromSlash(dir))
+	fi, err := os.Lstat(full)
+	switch {
+	case os.IsNotExist(err):
+		if err := os.Mkdir(full, 0755); err != nil && !os.IsExist(err) {
+			return err
+		}
+	case err != nil:
+		return err
+	case fi.Mode()&os.ModeSymlink != 0:
+		return errUnsafeEntry
+	case !fi.IsDir():
+		return fmt.Errorf("%s: not a directory", dir)
+	}
+	x.dirs[dir] = true
+	return nil
+}
+
+// mkdir creates the directory entry rel, replacing a non-directory.
+func (x *extractor) mkdir(rel, full string) error {
+	fi, err := os.Lstat(full)
+	if err == nil && fi.IsDir() {
+		x.dirs[rel] = true
+		return nil
+	}
+	if err == nil {
+		if err := os.Remove(full); err != nil {
+			return err
+		}
+	} else if !os.IsNotExist(err) {
+		return err
+	}
+	if err := os.Mkdir(full, 0755); err != nil {
+		return err
+	}
+	x.dirs[rel] = true
+	return nil
+}
+
+// permOf returns the mode to restore. Without owner restoration setuid and
+// setgid survive only if the extracting user matches the archived owner,
+// as libarchive does.
+func (x *extractor) permOf(e *Entry) uint32 {
+	perm := e.perm & 07777
+	if perm&04000 != 0 && e.uid != x.euid {
+		perm &^= 04000
+	}
+	if perm&02000 != 0 && e.gid != x.egid {
+		perm &^= 02000
+	}
+	return perm
+}
+
+// dropFixup forgets the fixup of rel, replaced by an entry without one.
+func (x *extractor) dropFixup(rel string) {
+	if i, ok := x.fixIdx[rel]; ok {
+		x.fixups[i].typ = TypeHardlink
+		delete(x.fixIdx, rel)
+	}
+}
+
+func (x *extractor) addFixup(f fixup) {
+	if i, ok := x.fixIdx[f.rel]; ok {
+		x.fixups[i] = f
+		return
+	}
+	x.fixIdx[f.rel] = len(x.fixups)
+	x.fixups = append(x.fixups, f)
+}
+
+// finish waits for the workers and applies the deferred metadata.
+func (x *extractor) finish() error {
+	close(x.work)
+	x.workers.Wait()
+	syscall.Close(x.rootFd)
+	if err := x.firstErr(); err != nil {
+		return err
+	}
+
+	var dirs []fixup
+	next := make(chan fixup)
+	var wg sync.WaitGroup
+	for i := 0; i < cap(x.work); i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for f := range next {
+				if err := x.apply(f); err != nil {
+					x.setErr(err)
+				}
+			}
+		}()
+	}
+	for _, f := range x.fixups {
+		if f.typ == TypeHardlink {
+			continue // dropped
+		}
+		if f.typ == TypeDir {
+			dirs = append(dirs, f)
+		} else {
+			next <- f
+		}
+	}
+	close(next)
+	wg.Wait()
+	if err := x.firstErr(); err != nil {
+		return err
+	}
+
+	// Children before parents, so no later change bumps a parent's mtime.
+	sort.SliceStable(dirs, func(i, j int) bool {
+		return strings.Count(dirs[i].rel, "/") > strings.Count(dirs[j].rel, "/")
+	})
+	for _, f := range dirs {
+		if err := x.apply(f); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+// apply restores the permissions and times of one entry. Neither follows
+// a symlink: whatever is at rel now is checked with lstat, and a symlink
+// only has its own times set.
+func (x *extractor) apply(f fixup) error {
+	full := filepath.Join(x.root, filepath.FromSlash(f.rel))
+	fi, err := os.Lstat(full)
+	if err != nil {
+		return err
+	}
+	c := C.CString(full)
+	defer C.free(unsafe.Pointer(c))
+	if fi.Mode()&os.ModeSymlink == 0 {
+		r, err := C.apg_lchmod(c, C.unsigned(f.perm))
+		if r != 0 && (err == syscall.ENOTSUP || err == syscall.EOPNOTSUPP) {
+			r, err = C.apg_chmod(c, C.unsigned(f.perm))
+		}
+		if r != 0 {
+			return fmt.Errorf("chmod %s: %w", f.rel, err)
+		}
+	}
+	if r, err := C.apg_lutimes(c, C.longlong(x.start.Unix()), C.long(x.start.Nanosecond()),
+		C.longlong(f.mtime.Unix()), C.long(f.mtime.Nanosecond())); r != 0 {
+		return fmt.Errorf("set times %s: %w", f.rel, err)
+	}
+	return nil
+}
+
+// replace removes whatever is at full so a new entry can take its place.
+func replace(full string) error {
+	if err := os.Remove(full); err != nil && !os.IsNotExist(err) {
+		return err
+	}
+	return nil
+}
+
+// createFile creates rel beneath the root for writing, replacing an
+// existing entry. Every component is opened with O_NOFOLLOW from the root
+// directory, so no symlink is followed, whatever replaced a directory
+// since parents checked it.
+func (x *extractor) createFile(rel string) (*os.File, error) {
+	full := filepath.Join(x.root, filepath.FromSlash(rel))
+	dir, err := syscall.Dup(x.rootFd)
+	if err != nil {
+		return nil, &os.PathError{Op: "open", Path: full, Err: err}
+	}
+	parts := strings.Split(rel, "/")
+	for _, name := range parts[:len(parts)-1] {
+		fd, err := syscall.Openat(dir, name, syscall.O_RDONLY|syscall.O_DIRECTORY|syscall.O_NOFOLLOW|syscall.O_CLOEXEC, 0)
+		syscall.Close(dir)
+		if err != nil {
+			return nil, &os.PathError{Op: "open", Path: full, Err: err}
+		}
+		dir = fd
+	}
+	defer syscall.Close(dir)
+
+	name := parts[len(parts)-1]
+	const flags = syscall.O_WRONLY | syscall.O_CREAT | syscall.O_EXCL | syscall.O_NOFOLLOW | syscall.O_CLOEXEC
+	fd, err := syscall.Openat(dir, name, flags, 0600)
+	if err == syscall.EEXIST {
+		if err := removeAt(dir, name); err != nil {
+			return nil, &os.PathError{Op: "remove", Path: full, Err: err}
+		}
+		fd, err = syscall.Openat(dir, name, flags, 0600)
+	}
+	if err != nil {
+		return nil, &os.PathError{Op: "open", Path: full, Err: err}
+	}
+	return os.NewFile(uintptr(fd), full), nil
+}
+
+// removeAt removes name in dir, a file or an empty directory, as replace.
+func removeAt(dir int, name string) error {
+	c := C.CString(name)
+	defer C.free(unsafe.Pointer(c))
+	r, err := C.unlinkat(C.int(dir), c, 0)
+	if r != 0 && (err == syscall.EISDIR || err == syscall.EPERM) {
+		r, err = C.unlinkat(C.int(dir), c, C.AT_REMOVEDIR)
+	}
+	if r != 0 && err != syscall.ENOENT {
+		return err
+	}
+	return nil
+}
+
+func (x *extractor) writeFile(rel string, data []byte) error {
+	f, err := x.createFile(rel)
+	if err != nil {
+		return err
+	}
+	if _, err := f.Write(data); err != nil {
+		f.Close()
+		return err
+	}
+	return f.Close()
+}
@@ -0,0 +1,368 @@
+package archive
+
+import (
+	"bytes"
+	"errors"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"syscall"
+	"testing"
+	"time"
+)
+
+func TestExtractWithOptions_MatchesSerial(t *testing.T) {
+	src := t.TempDir()
+	mtime := time.Date(2024, 5, 1, 12, 0, 0, 0, time.UTC)
+	files := map[string]int{
+		"usr/bin/tool":          100,
+		"usr/lib/libx.so.1":     5000,
+		"usr/share/big.bin":     3 << 20, // streamed, not buffered
+		"usr/share/doc/README":  10,
+		"etc/ro/locked.conf":    20,
+		"etc/config.d/empty.cf": 0,
+	}
+	for rel, size := range files {
+		p := filepath.Join(src, rel)
+		os.MkdirAll(filepath.Dir(p), 0755)
+		if err := os.WriteFile(p, bytes.Repeat([]byte(rel[:1]), size), 0644); err != nil {
+			t.Fatal(err)
+		}
+		os.Chtimes(p, mtime, mtime)
+	}
+	os.Chmod(filepath.Join(src, "usr/bin/tool"), 0755)
+	os.Chmod(filepath.Join(src, "etc/ro/locked.conf"), 0600)
+	os.Symlink("libx.so.1", filepath.Join(src, "usr/lib/libx.so"))
+	os.Chmod(filepath.Join(src, "etc/ro"), 0555)
+	defer os.Chmod(filepath.Join(src, "etc/ro"), 0755)
+	for _, d := range []string{"usr/bin", "usr/lib", "etc/ro", "etc"} {
+		os.Chtimes(filepath.Join(src, d), mtime, mtime)
+	}
+
+	archivePath := filepath.Join(t.TempDir(), "t.apg")
+	if _, err := CreateWithOptions(archivePath, src, CreateOptions{Compression: "zstd", Level: 1}); err != nil {
+		t.Fatalf("CreateWithOptions failed: %v", err)
+	}
+
+	serial, parallel := t.TempDir(), t.TempDir()
+	if err := ExtractWithOptions(archivePath, serial, ExtractOptions{Jobs: 1}); err != nil {
+		t.Fatalf("serial extract failed: %v", err)
+	}
+	if err := ExtractWithOptions(archivePath, parallel, ExtractOptions{Jobs: 4}); err != nil {
+		t.Fatalf("parallel extract failed: %v", err)
+	}
+	defer os.Chmod(filepath.Join(serial, "etc/ro"), 0755)
+	defer os.Chmod(filepath.Join(parallel, "etc/ro"), 0755)
+
+	n := 0
+	filepath.WalkDir(serial, func(p string, d fs.DirEntry, err error) error {
+		if err != nil || p == serial {
+			return err
+		}
+		rel, _ := filepath.Rel(serial, p)
+		other := filepath.Join(parallel, rel)
+		want, _ := os.Lstat(p)
+		got, err := os.Lstat(other)
+		if err != nil {
+			t.Errorf("%s: missing from parallel extraction", rel)
+			return nil
+		}
+		n++
+		if got.Mode() != want.Mode() {
+			t.Errorf("%s: mode %v, want %v", rel, got.Mode(), want.Mode())
+		}
+		if !got.ModTime().Equal(want.ModTime()) {
+			t.Errorf("%s: mtime %v, want %v", rel, got.ModTime(), want.ModTime())
+		}
+		switch {
+		case want.Mode()&fs.ModeSymlink != 0:
+			a, _ := os.Readlink(p)
+			b, _ := os.Readlink(other)
+			if a != b {
+				t.Errorf("%s: link %q, want %q", rel, b, a)
+			}
+		case want.Mode().IsRegular():
+			a, _ := os.ReadFile(p)
+			b, _ := os.ReadFile(other)
+			if !bytes.Equal(a, b) {
+				t.Errorf("%s: content differs", rel)
+			}
+		}
+		return nil
+	})
+	if n < len(files)+1 {
+		t.Errorf("compared %d entries, want at least %d", n, len(files)+1)
+	}
+	if fi, _ := os.Stat(filepath.Join(parallel, "usr/bin/tool")); fi == nil || fi.Mode().Perm() != 0755 {
+		t.Errorf("usr/bin/tool not restored with 0755")
+	}
+}
+
+func TestExtractWithOptions_Unsafe(t *testing.T) {
+	src, outside := t.TempDir(), t.TempDir()
+	link := filepath.Join(src, "link")
+	file := filepath.Join(src, "file")
+	os.Symlink(outside, link)
+	os.WriteFile(file, []byte("pwned"), 0644)
+
+	archivePath := filepath.Join(t.TempDir(), "t.apg")
+	aw, err := NewWriter(archivePath, CreateOptions{Compression: "zstd", Level: 1})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := aw.WriteHeader(link, "link"); err != nil {
+		t.Fatal(err)
+	}
+	for _, rel := range []string{"link/pwned", "../pwned", "ok"} {
+		if err := aw.AddFile(file, rel); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if _, err := aw.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	dest := filepath.Join(t.TempDir(), "root")
+	if err := ExtractWithOptions(archivePath, dest, ExtractOptions{Jobs: 4}); err != nil {
+		t.Fatalf("ExtractWithOptions failed: %v", err)
+	}
+	if _, err := os.Stat(filepath.Join(outside, "pwned")); err == nil {
+		t.Error("member was written through a symlink")
+	}
+	if _, err := os.Stat(filepath.Join(filepath.Dir(dest), "pwned")); err == nil {
+		t.Error("member with .. escaped the destination")
+	}
+	if _, err := os.Stat(filepath.Join(dest, "ok")); err != nil {
+		t.Errorf("safe member not extracted: %v", err)
+	}
+}
+
+func TestExtractWithOptions_DirReplacedBySymlink(t *testing.T) {
+	src, outside := t.TempDir(), t.TempDir()
+	dir, link, file := filepath.Join(src, "dir"), filepath.Join(src, "link"), filepath.Join(src, "file")
+	os.Mkdir(dir, 0755)
+	os.Symlink(outside, link)
+	os.WriteFile(file, []byte("pwned"), 0644)
+
+	// a/, a/pwned (queued to a worker), then a -> outside.
+	archivePath := filepath.Join(t.TempDir(), "t.apg")
+	aw, err := NewWriter(archivePath, CreateOptions{Compression: "zstd", Level: 1})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := aw.WriteHeader(dir, "a"); err != nil {
+		t.Fatal(err)
+	}
+	if err := aw.AddFile(file, "a/pwned"); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := aw.WriteHeader(link, "a"); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := aw.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	for i := 0; i < 20; i++ {
+		dest := filepath.Join(t.TempDir(), "root")
+		ExtractWithOptions(archivePath, dest, ExtractOptions{Jobs: 8}) //nolint:errcheck
+		if _, err := os.Lstat(filepath.Join(outside, "pwned")); err == nil {
+			t.Fatalf("run %d: member was written through a symlink that replaced its directory", i)
+		}
+	}
+}
+
+func TestExtractWithOptions_HardlinkToSymlink(t *testing.T) {
+	src, outside := t.TempDir(), t.TempDir()
+	dir, link := filepath.Join(src, "dir"), filepath.Join(src, "link")
+	victim := filepath.Join(outside, "victim")
+	os.Mkdir(dir, 0777)
+	os.WriteFile(victim, []byte("secret"), 0600)
+	os.Chmod(dir, 0777)
+	os.Symlink(victim, link)
+
+	// a/ (fixup queued), s -> victim, then a hardlinked to s.
+	archivePath := filepath.Join(t.TempDir(), "t.apg")
+	aw, err := NewWriter(archivePath, CreateOptions{Compression: "zstd", Level: 1})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := aw.WriteHeader(dir, "a"); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := aw.WriteHeader(link, "s"); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := aw.WriteEntry(&Entry{Path: "a", Type: TypeHardlink, Linkname: "s"}); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := aw.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	dest := filepath.Join(t.TempDir(), "root")
+	ExtractWithOptions(archivePath, dest, ExtractOptions{Jobs: 4}) //nolint:errcheck
+	fi, err := os.Stat(victim)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if fi.Mode().Perm() != 0600 {
+		t.Fatalf("victim outside the tree is now %o, want 600", fi.Mode().Perm())
+	}
+}
+
+func TestExtractor_PermOf(t *testing.T) {
+	x := &extractor{euid: 1000, egid: 1000}
+	tests := []struct {
+		perm     uint32
+		uid, gid int64
+		want     uint32
+	}{
+		{04755, 1000, 1000, 04755},
+		{04755, 0, 1000, 0755},
+		{02755, 1000, 0, 0755},
+		{06755, 0, 0, 0755},
+		{01777, 0, 0, 01777},
+	}
+	for _, tt := range tests {
+		e := &Entry{perm: tt.perm | syscall.S_IFREG, uid: tt.uid, gid: tt.gid}
+		if got := x.permOf(e); got != tt.want {
+			t.Errorf("permOf(%o, uid=%d, gid=%d) = %o, want %o", tt.perm, tt.uid, tt.gid, got, tt.want)
+		}
+	}
+}
+
+func TestCreate_Hardlinks(t *testing.T) {
+	src := t.TempDir()
+	os.MkdirAll(filepath.Join(src, "data"), 0755)
+	blob := bytes.Repeat([]byte("firmware "), 10000)
+	for _, name := range []string{"a", "c", "d"} {
+		os.WriteFile(filepath.Join(src, "data", name), blob, 0644)
+	}
+	os.Chmod(filepath.Join(src, "data", "d"), 0600) // same content, other mode
+	if err := os.Link(filepath.Join(src, "data", "a"), filepath.Join(src, "data", "b")); err != nil {
+		t.Skipf("hardlinks not supported: %v", err)
+	}
+
+	sums := map[string]string{"data/a": "x", "data/b": "x", "data/c": "x", "data/d": "x"}
+	archivePath := filepath.Join(t.TempDir(), "t.apg")
+	opts := CreateOptions{Compression: "zstd", Level: 1, Seekable: true, FrameSize: 4096, DedupSums: sums}
+	r, err := CreateWithOptions(archivePath, src, opts)
+	if err != nil {
+		t.Fatalf("CreateWithOptions failed: %v", err)
+	}
+	if r.Hardlinks != 2 || r.LinkedSize != 2*int64(len(blob)) {
+		t.Errorf("Hardlinks = %d (%d bytes), want 2 (%d bytes)", r.Hardlinks, r.LinkedSize, 2*len(blob))
+	}
+
+	entries, err := ListContents(archivePath)
+	if err != nil {
+		t.Fatalf("ListContents failed: %v", err)
+	}
+	links := map[string]string{}
+	for _, e := range entries {
+		if e.Type == TypeHardlink {
+			links[e.Path] = e.Linkname
+		}
+	}
+	if links["data/b"] != "data/a" || links["data/c"] != "data/a" || links["data/d"] != "" {
+		t.Errorf("Unexpected hardlinks: %v", links)
+	}
+
+	for _, jobs := range []int{1, 4} {
+		dest := t.TempDir()
+		if err := ExtractWithOptions(archivePath, dest, ExtractOptions{Jobs: jobs}); err != nil {
+			t.Fatalf("ExtractWithOptions(jobs=%d) failed: %v", jobs, err)
+		}
+		a, _ := os.Stat(filepath.Join(dest, "data", "a"))
+		for _, name := range []string{"b", "c"} {
+			fi, err := os.Stat(filepath.Join(dest, "data", name))
+			if err != nil || !os.SameFile(a, fi) {
+				t.Errorf("jobs=%d: data/%s is not linked to data/a (%v)", jobs, name, err)
+			}
+		}
+		if d, _ := os.Stat(filepath.Join(dest, "data", "d")); d == nil || d.Mode().Perm() != 0600 {
+			t.Errorf("jobs=%d: data/d lost its own mode", jobs)
+		}
+	}
+
+	// A single hardlink member is extracted with the data of its target.
+	dest := t.TempDir()
+	if err := ExtractFile(archivePath, "data/c", dest); err != nil {
+		t.Fatalf("ExtractFile failed: %v", err)
+	}
+	if got, _ := os.ReadFile(filepath.Join(dest, "data", "c")); !bytes.Equal(got, blob) {
+		t.Errorf("ExtractFile(data/c) returned %d bytes, want %d", len(got), len(blob))
+	}
+	if _, err := os.Stat(filepath.Join(dest, "data", "a")); err == nil {
+		t.Errorf("ExtractFile left the link target behind")
+	}
+}
+
+func TestLimits(t *testing.T) {
+	src := t.TempDir()
+	// A small bomb: 64 MiB of zeros compress to a few KiB.
+	os.WriteFile(filepath.Join(src, "zeros.img"), make([]byte, 64<<20), 0644)
+	for i := 0; i < 8; i++ {
+		os.WriteFile(filepath.Join(src, "f"+string(rune('a'+i))), []byte("x"), 0644)
+	}
+	pkg := filepath.Join(t.TempDir(), "bomb.apg")
+	if _, err := CreateWithOptions(pkg, src, CreateOptions{Compression: "zstd", Level: 1}); err != nil {
+		t.Fatal(err)
+	}
+
+	for _, tc := range []struct {
+		name   string
+		limits Limits
+	}{
+		{"file size", Limits{FileSize: 1 << 20}},
+		{"total", Limits{Total: 32 << 20}},
+		{"files", Limits{Files: 4}},
+	} {
+		for _, jobs := range []int{1, 2} {
+			dest := t.TempDir()
+			err := ExtractWithOptions(pkg, dest, ExtractOptions{Jobs: jobs, Limits: tc.limits})
+			if !errors.Is(err, ErrLimit) {
+				t.Errorf("%s, %d jobs: got %v, want ErrLimit", tc.name, jobs, err)
+			}
+			if fi, err := os.Stat(filepath.Join(dest, "zeros.img")); err == nil && fi.Size() > 32<<20 {
+				t.Errorf("%s, %d jobs: %d bytes inflated before the limit hit", tc.name, jobs, fi.Size())
+			}
+		}
+	}
+
+	// Unlimited and default limits extract the package.
+	for _, l := range []Limits{{}, {Files: NoLimit, FileSize: NoLimit, Total: NoLimit}} {
+		if err := ExtractWithOptions(pkg, t.TempDir(), ExtractOptions{Jobs: 2, Limits: l}); err != nil {
+			t.Errorf("%+v: %v", l, err)
+		}
+	}
+
+	// A single member is bounded as well, and the defaults follow the free
+	// space of the destination.
+	if err := ExtractFileWithLimits(pkg, "zeros.img", t.TempDir(), Limits{FileSize: 1 << 20}); !errors.Is(err, ErrLimit) {
+		t.Errorf("ExtractFileWithLimits: got %v, want ErrLimit", err)
+	}
+	dest := t.TempDir()
+	free, ok := freeSpace(filepath.Join(dest, "not", "yet"))
+	if !ok {
+		t.Fatal("no free space for the destination")
+	}
+	l := Limits{}.forExtract(dest)
+	if free < MaxArchiveSize && l.Total != free || free < MaxFileSize && l.FileSize != free {
+		t.Errorf("forExtract: %+v, want at most %d", l, free)
+	}
+	if l := (Limits{Total: NoLimit, FileSize: 5}).forExtract(dest); l.Total != NoLimit || l.FileSize != 5 {
+		t.Errorf("forExtract changed explicit limits: %+v", l)
+	}
+
+	// Creation checks every header before reading the data.
+	out := filepath.Join(t.TempDir(), "big.apg")
+	_, err := CreateWithOptions(out, src, CreateOptions{Compression: "zstd", Level: 1, Limits: Limits{FileSize: 1 << 20}})
+	if !errors.Is(err, ErrLimit) {
+		t.Errorf("create: got %v, want ErrLimit", err)
+	}
+	if _, err := os.Stat(out); err == nil {
+		t.Error("create left a partial package behind")
+	}
+}
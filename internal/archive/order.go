@@ -0,0 +1,85 @@
+// Package archive — member ordering.
+// NurOS 2026 - GPL 3.0
+package archive
+
+import (
+	"fmt"
+	"path"
+	"sort"
+	"strings"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// Member orders for CreateOptions.Order.
+const (
+	// OrderPath stores members in scan order: sorted by path, each
+	// directory followed by its contents.
+	OrderPath = "path"
+	// OrderGroup stores directories, links and other non-regular entries
+	// first, then regular files in path order, except that content which
+	// is already compressed (archives, images, fonts, media; told by
+	// extension) goes last. Path order keeps related files (a library and
+	// its static archive, a module and its sources) within the
+	// compressor's window, which beats grouping by type; only data that
+	// cannot compress further is moved out of its way.
+	OrderGroup = "group"
+)
+
+// precompressed lists extensions of content that does not compress further.
+var precompressed = map[string]bool{}
+
+func init() {
+	for _, e := range strings.Fields(".gz .tgz .xz .txz .bz2 .zst .lz4 .lzma .zip .jar .apk .whl .7z .rar " +
+		".deb .rpm .apg .png .jpg .jpeg .gif .webp .avif .heic .svgz .woff .woff2 .mp3 .ogg .flac .opus " +
+		".mp4 .mkv .webm") {
+		precompressed[e] = true
+	}
+}
+
+// MemberOrder returns the entries of tree in the order they are archived:
+// the ntoc TOCMembers present first, then the rest in the given order
+// ("" = OrderPath).
+func MemberOrder(tree *scan.Tree, order string) (files []*scan.File, ntoc int, err error) {
+	files = make([]*scan.File, 0, len(tree.Files))
+	toc := make(map[string]bool, len(TOCMembers))
+	for _, name := range TOCMembers {
+		toc[name] = true
+		if f := tree.Lookup(name); f != nil {
+			files = append(files, f)
+		}
+	}
+	ntoc = len(files)
+	for i := range tree.Files {
+		if f := &tree.Files[i]; !toc[f.Path] {
+			files = append(files, f)
+		}
+	}
+
+	switch order {
+	case "", OrderPath:
+	case OrderGroup:
+		groupOrder(files[ntoc:])
+	default:
+		return nil, 0, fmt.Errorf("unknown member order %q (want %s or %s)", order, OrderPath, OrderGroup)
+	}
+	return files, ntoc, nil
+}
+
+// groupOrder sorts files (in scan order) for OrderGroup. The sort is
+// stable, so within each group scan order is kept and a directory still
+// precedes what it contains.
+func groupOrder(files []*scan.File) {
+	group := make(map[*scan.File]int, len(files))
+	for _, f := range files {
+		switch {
+		case !f.Mode.IsRegular():
+			group[f] = 0
+		case precompressed[strings.ToLower(path.Ext(f.Path))]:
+			group[f] = 2
+		default:
+			group[f] = 1
+		}
+	}
+	sort.SliceStable(files, func(i, j int) bool { return group[files[i]] < group[files[j]] })
+}
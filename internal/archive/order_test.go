@@ -0,0 +1,90 @@
+package archive
+
+import (
+	"bytes"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+func TestMemberOrder_Group(t *testing.T) {
+	tree := &scan.Tree{Files: []scan.File{
+		{Path: "data", Mode: os.ModeDir},
+		{Path: "data/a.png"},
+		{Path: "data/b.txt"},
+		{Path: "data/bin", Mode: os.ModeDir},
+		{Path: "data/bin/tool"},
+		{Path: "data/doc.gz"},
+		{Path: "data/lib", Mode: os.ModeSymlink},
+		{Path: "data/z.conf"},
+		{Path: "metadata.json"},
+		{Path: "sha256sums"},
+	}}
+
+	files, ntoc, err := MemberOrder(tree, OrderGroup)
+	if err != nil {
+		t.Fatalf("MemberOrder failed: %v", err)
+	}
+	var got []string
+	for _, f := range files {
+		got = append(got, f.Path)
+	}
+	want := []string{
+		"metadata.json", "sha256sums",
+		"data", "data/bin", "data/lib",
+		"data/b.txt", "data/bin/tool", "data/z.conf", "data/a.png", "data/doc.gz",
+	}
+	if ntoc != 2 || len(got) != len(want) {
+		t.Fatalf("MemberOrder = %v (ntoc %d), want %v", got, ntoc, want)
+	}
+	for i := range want {
+		if got[i] != want[i] {
+			t.Fatalf("MemberOrder = %v, want %v", got, want)
+		}
+	}
+
+	if _, _, err := MemberOrder(tree, "random"); err == nil {
+		t.Error("MemberOrder should reject an unknown order")
+	}
+}
+
+func TestCreate_Reproducible(t *testing.T) {
+	epoch := time.Date(2025, 1, 1, 0, 0, 0, 0, time.UTC)
+	old := time.Date(2020, 6, 1, 0, 0, 0, 0, time.UTC)
+	build := func() []byte {
+		src := t.TempDir()
+		os.MkdirAll(filepath.Join(src, "data", "usr"), 0755)
+		os.WriteFile(filepath.Join(src, "metadata.json"), []byte(`{"name":"r"}`), 0644)
+		os.WriteFile(filepath.Join(src, "data", "usr", "new"), []byte("new"), 0644)
+		os.WriteFile(filepath.Join(src, "data", "usr", "old"), []byte("old"), 0644)
+		os.Chtimes(filepath.Join(src, "data", "usr", "old"), old, old)
+
+		out := filepath.Join(t.TempDir(), "r.apg")
+		opts := CreateOptions{Compression: "zstd", Level: 3, Order: OrderGroup, Reproducible: true, Epoch: epoch}
+		if _, err := CreateWithOptions(out, src, opts); err != nil {
+			t.Fatalf("CreateWithOptions failed: %v", err)
+		}
+		entries, err := ListContents(out)
+		if err != nil {
+			t.Fatalf("ListContents failed: %v", err)
+		}
+		for _, e := range entries {
+			want := epoch
+			if e.Path == "data/usr/old" {
+				want = old
+			}
+			if !e.ModTime.Equal(want) || e.uid != 0 || e.gid != 0 {
+				t.Errorf("%s: mtime %v uid %d gid %d, want %v 0 0", e.Path, e.ModTime, e.uid, e.gid, want)
+			}
+		}
+		data, _ := os.ReadFile(out)
+		return data
+	}
+
+	if a, b := build(), build(); !bytes.Equal(a, b) {
+		t.Error("two builds of equal trees differ")
+	}
+}
@@ -0,0 +1,93 @@
+// Package archive — small members read ahead in batches through io_uring.
+// NurOS 2026 - GPL 3.0
+package archive
+
+import (
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+	"github.com/NurOS-Linux/apgbuild/internal/uring"
+)
+
+// prefetcher reads the data of small members ahead of a Writer adding
+// files in order, in batches of uring.BatchFiles, instead of an open, read
+// and close each in apg_writer_file.
+type prefetcher struct {
+	ring  *uring.Ring
+	tree  *scan.Tree
+	files []*scan.File
+	aw    *Writer
+	next  int // files[next:] are not batched yet
+	data  map[int][]byte
+	buf   []byte
+}
+
+// newPrefetcher returns a prefetcher for files, or nil without io_uring.
+func newPrefetcher(aw *Writer, tree *scan.Tree, files []*scan.File) *prefetcher {
+	r, err := uring.New(uring.DefaultDepth)
+	if err != nil {
+		return nil
+	}
+	return &prefetcher{ring: r, tree: tree, files: files, aw: aw, data: map[int][]byte{},
+		buf: make([]byte, uring.BatchBuffer)}
+}
+
+func (p *prefetcher) close() {
+	if p != nil {
+		p.ring.Close()
+	}
+}
+
+// wanted reports whether the data of f is read ahead: small regular files
+// that are neither further paths of an inode (stored as hardlinks) nor
+// spliced from the blob store.
+func (p *prefetcher) wanted(f *scan.File) bool {
+	return f.Mode.IsRegular() && f.Size > 0 && f.Size <= uring.BatchFileSize && f.Nlink <= 1 &&
+		p.aw.blobPath(f.Path, f.Size) == ""
+}
+
+// get returns the data of files[i], or nil if it was not read ahead (or
+// no longer has the size of the scan).
+func (p *prefetcher) get(i int) []byte {
+	if p == nil {
+		return nil
+	}
+	if i >= p.next {
+		p.fill(i)
+	}
+	return p.data[i]
+}
+
+// fill reads the next batch of wanted files from files[i:] on. The data
+// of the previous batch has been written by then, so its buffer is reused.
+func (p *prefetcher) fill(i int) {
+	clear(p.data)
+	var idx []int
+	var names []string
+	off := []int64{0}
+	for p.next = i; p.next < len(p.files) && len(idx) < uring.BatchFiles; p.next++ {
+		f := p.files[p.next]
+		if !p.wanted(f) {
+			continue
+		}
+		end := off[len(off)-1] + f.Size + 1
+		if end > int64(len(p.buf)) {
+			break
+		}
+		idx, names, off = append(idx, p.next), append(names, p.tree.Abs(f)), append(off, end)
+	}
+	if len(idx) == 0 {
+		return
+	}
+	t0 := time.Now()
+	got, errs, err := p.ring.ReadFiles(names, off, p.buf)
+	p.aw.readTime += time.Since(t0)
+	if err != nil {
+		return
+	}
+	for k, j := range idx {
+		if errs[k] == nil && got[k] == p.files[j].Size {
+			p.data[j] = p.buf[off[k] : off[k]+got[k]]
+		}
+	}
+}
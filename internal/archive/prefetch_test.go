@@ -0,0 +1,42 @@
+package archive
+
+import (
+	"bytes"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+	"github.com/NurOS-Linux/apgbuild/internal/testtree"
+	"github.com/NurOS-Linux/apgbuild/internal/uring"
+)
+
+func TestCreateFromTree_Prefetch(t *testing.T) {
+	src := t.TempDir()
+	if _, err := testtree.Generate(filepath.Join(src, "data"), testtree.ManyTiny, 1); err != nil {
+		t.Fatal(err)
+	}
+	os.WriteFile(filepath.Join(src, "metadata.json"), []byte(`{"name":"tiny"}`), 0644)
+	os.WriteFile(filepath.Join(src, "data/big"), bytes.Repeat([]byte("big file "), 20000), 0644)
+	os.Link(filepath.Join(src, "metadata.json"), filepath.Join(src, "data/meta-link"))
+	tree, err := scan.Scan(src, scan.Options{})
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	for _, seekable := range []bool{false, true} {
+		opts := CreateOptions{Compression: "zstd", Level: 3, Seekable: seekable}
+		var pkgs [2][]byte
+		for i, env := range []string{"", "0"} {
+			t.Setenv(uring.DisableEnv, env)
+			out := filepath.Join(t.TempDir(), "p.apg")
+			if _, err := CreateFromTree(out, tree, opts); err != nil {
+				t.Fatal(err)
+			}
+			pkgs[i], _ = os.ReadFile(out)
+		}
+		if !bytes.Equal(pkgs[0], pkgs[1]) {
+			t.Errorf("seekable=%v: package read ahead differs from the one read file by file", seekable)
+		}
+	}
+}
@@ -0,0 +1,133 @@
+// Package archive — table of contents of seekable (APGv2 framed) packages.
+// NurOS 2026 - GPL 3.0
+package archive
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"os"
+)
+
+// Layout constants; they must match the apg_frames writer in archive.go.
+const (
+	seekTableMagic  = 0x184D2A5E
+	seekFooterMagic = 0x8F92EAB1
+	indexMagic      = 0x184D2A5A
+	indexTag        = 0x49475041 // "APGI"
+	seekFooterSize  = 9
+)
+
+// ErrNotSeekable is returned by ReadTOC for packages without a seek table.
+var ErrNotSeekable = errors.New("package is not seekable")
+
+// Frame is one independently decompressible zstd frame of a package.
+type Frame struct {
+	Offset         int64  // offset of the frame in the package file
+	CompressedSize uint32 // bytes of the frame in the file
+	Size           uint32 // uncompressed tar bytes it holds
+}
+
+// TOC is the table of contents of a seekable package.
+type TOC struct {
+	Frames  []Frame
+	Members []string // member paths in archive order
+	frameOf map[string]int
+}
+
+// MemberFrame returns the index of the frame holding the header of path.
+func (t *TOC) MemberFrame(path string) (int, bool) {
+	i, ok := t.frameOf[path]
+	return i, ok
+}
+
+// ReadTOC reads the seek table and member index from the end of a package.
+// Only a few small reads are needed, however large the package is.
+func ReadTOC(archivePath string) (*TOC, error) {
+	f, err := os.Open(archivePath)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+
+	info, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	end := info.Size()
+
+	// Seek table: skippable header, {compressed, decompressed}×n, footer.
+	footer := make([]byte, seekFooterSize)
+	if end < seekFooterSize+8 {
+		return nil, ErrNotSeekable
+	}
+	if _, err := f.ReadAt(footer, end-seekFooterSize); err != nil {
+		return nil, err
+	}
+	if binary.LittleEndian.Uint32(footer[5:]) != seekFooterMagic {
+		return nil, ErrNotSeekable
+	}
+	n := int64(binary.LittleEndian.Uint32(footer[0:]))
+	tableSize := 8 + n*8 + seekFooterSize
+	if tableSize > end {
+		return nil, fmt.Errorf("corrupt seek table")
+	}
+	table := make([]byte, tableSize)
+	if _, err := f.ReadAt(table, end-tableSize); err != nil {
+		return nil, err
+	}
+	if binary.LittleEndian.Uint32(table) != seekTableMagic {
+		return nil, fmt.Errorf("corrupt seek table")
+	}
+
+	toc := &TOC{Frames: make([]Frame, n), frameOf: make(map[string]int)}
+	var off int64
+	for i := range toc.Frames {
+		e := table[8+i*8:]
+		toc.Frames[i] = Frame{
+			Offset:         off,
+			CompressedSize: binary.LittleEndian.Uint32(e),
+			Size:           binary.LittleEndian.Uint32(e[4:]),
+		}
+		off += int64(toc.Frames[i].CompressedSize)
+	}
+
+	// Member index: it ends with its own total size and tag, right before
+	// the seek table.
+	indexEnd := end - tableSize
+	if indexEnd < off+8 {
+		return nil, fmt.Errorf("corrupt member index")
+	}
+	trailer := make([]byte, 8)
+	if _, err := f.ReadAt(trailer, indexEnd-8); err != nil {
+		return nil, err
+	}
+	indexSize := int64(binary.LittleEndian.Uint32(trailer))
+	if binary.LittleEndian.Uint32(trailer[4:]) != indexTag || indexSize < 28 || indexSize > indexEnd-off {
+		return nil, fmt.Errorf("corrupt member index")
+	}
+	index := make([]byte, indexSize)
+	if _, err := f.ReadAt(index, indexEnd-indexSize); err != nil {
+		return nil, err
+	}
+	if binary.LittleEndian.Uint32(index) != indexMagic || binary.LittleEndian.Uint32(index[8:]) != indexTag {
+		return nil, fmt.Errorf("corrupt member index")
+	}
+	count := int(binary.LittleEndian.Uint32(index[16:]))
+	p := index[20 : len(index)-8]
+	for i := 0; i < count; i++ {
+		if len(p) < 6 {
+			return nil, fmt.Errorf("corrupt member index")
+		}
+		frame := int(binary.LittleEndian.Uint32(p))
+		l := int(binary.LittleEndian.Uint16(p[4:]))
+		if len(p) < 6+l || frame >= len(toc.Frames) {
+			return nil, fmt.Errorf("corrupt member index")
+		}
+		path := string(p[6 : 6+l])
+		toc.Members = append(toc.Members, path)
+		toc.frameOf[path] = frame
+		p = p[6+l:]
+	}
+	return toc, nil
+}
@@ -0,0 +1,216 @@
+package archive
+
+import (
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+)
+
+// seekableTree creates a package tree with metadata, sums and enough data
+// files to span several frames of frameSize bytes.
+func seekableTree(t *testing.T) string {
+	t.Helper()
+	dir := t.TempDir()
+	files := map[string]string{
+		"metadata.json":         `{"name": "seek", "version": "1.0"}`,
+		"sha256sums":            "0000  usr/bin/tool\n",
+		"scripts/post-install":  "#!/bin/sh\necho installed\n",
+		"data/usr/share/readme": "readme",
+	}
+	for i := 0; i < 8; i++ {
+		files[fmt.Sprintf("data/usr/lib/blob%d", i)] = strings.Repeat(fmt.Sprintf("blob %d ", i), 4000)
+	}
+	for rel, content := range files {
+		path := filepath.Join(dir, rel)
+		if err := os.MkdirAll(filepath.Dir(path), 0755); err != nil {
+			t.Fatalf("Failed to create dir: %v", err)
+		}
+		if err := os.WriteFile(path, []byte(content), 0644); err != nil {
+			t.Fatalf("Failed to create %s: %v", rel, err)
+		}
+	}
+	return dir
+}
+
+func TestSeekable_TOC(t *testing.T) {
+	sourceDir := seekableTree(t)
+	archivePath := filepath.Join(t.TempDir(), "seek.apg")
+	opts := CreateOptions{Compression: "zstd", Level: 3, Seekable: true, FrameSize: 64 << 10}
+	if _, err := CreateWithOptions(archivePath, sourceDir, opts); err != nil {
+		t.Fatalf("CreateWithOptions failed: %v", err)
+	}
+
+	toc, err := ReadTOC(archivePath)
+	if err != nil {
+		t.Fatalf("ReadTOC failed: %v", err)
+	}
+	if len(toc.Frames) < 3 {
+		t.Errorf("Expected several frames, got %d", len(toc.Frames))
+	}
+	if toc.Members[0] != "metadata.json" || toc.Members[1] != "sha256sums" {
+		t.Errorf("TOC members are not first: %v", toc.Members[:2])
+	}
+	if f, _ := toc.MemberFrame("metadata.json"); f != 0 {
+		t.Errorf("metadata.json should be in frame 0, got %d", f)
+	}
+	if f, _ := toc.MemberFrame("data/usr/lib/blob0"); f == 0 {
+		t.Errorf("data should not share the TOC frame")
+	}
+}
+
+func TestSeekable_ExtractFile(t *testing.T) {
+	sourceDir := seekableTree(t)
+	archivePath := filepath.Join(t.TempDir(), "seek.apg")
+	opts := CreateOptions{Compression: "zstd", Level: 3, Seekable: true, FrameSize: 64 << 10}
+	if _, err := CreateWithOptions(archivePath, sourceDir, opts); err != nil {
+		t.Fatalf("CreateWithOptions failed: %v", err)
+	}
+
+	for _, member := range []string{"metadata.json", "scripts/post-install", "data/usr/lib/blob6"} {
+		destDir := t.TempDir()
+		if err := ExtractFile(archivePath, member, destDir); err != nil {
+			t.Fatalf("ExtractFile(%s) failed: %v", member, err)
+		}
+		got, err := os.ReadFile(filepath.Join(destDir, member))
+		if err != nil {
+			t.Fatalf("%s was not extracted: %v", member, err)
+		}
+		want, _ := os.ReadFile(filepath.Join(sourceDir, member))
+		if string(got) != string(want) {
+			t.Errorf("%s: content mismatch", member)
+		}
+	}
+
+	if err := ExtractFile(archivePath, "missing", t.TempDir()); err == nil {
+		t.Error("ExtractFile should fail for a missing member")
+	}
+	if err := ExtractFile(archivePath, "../metadata.json", t.TempDir()); err == nil {
+		t.Error("ExtractFile should reject unsafe paths")
+	}
+}
+
+func TestSeekable_PlainReaders(t *testing.T) {
+	sourceDir := seekableTree(t)
+	archivePath := filepath.Join(t.TempDir(), "seek.apg")
+	opts := CreateOptions{Compression: "zstd", Level: 3, Seekable: true, FrameSize: 64 << 10}
+	if _, err := CreateWithOptions(archivePath, sourceDir, opts); err != nil {
+		t.Fatalf("CreateWithOptions failed: %v", err)
+	}
+
+	// The framed stream is a valid tar+zstd stream for plain libarchive.
+	destDir := t.TempDir()
+	if err := Extract(archivePath, destDir); err != nil {
+		t.Fatalf("Extract failed: %v", err)
+	}
+	got, _ := os.ReadFile(filepath.Join(destDir, "data", "usr", "lib", "blob7"))
+	want, _ := os.ReadFile(filepath.Join(sourceDir, "data", "usr", "lib", "blob7"))
+	if string(got) != string(want) {
+		t.Error("blob7: content mismatch after full extraction")
+	}
+
+	contents, err := ListContents(archivePath)
+	if err != nil {
+		t.Fatalf("ListContents failed: %v", err)
+	}
+	if contents[0].Path != "metadata.json" {
+		t.Errorf("Expected metadata.json first, got %s", contents[0].Path)
+	}
+}
+
+func TestSeekable_NonSeekablePackage(t *testing.T) {
+	sourceDir := seekableTree(t)
+	archivePath := filepath.Join(t.TempDir(), "plain.apg")
+	if _, err := Create(archivePath, sourceDir); err != nil {
+		t.Fatalf("Create failed: %v", err)
+	}
+
+	if _, err := ReadTOC(archivePath); err != ErrNotSeekable {
+		t.Errorf("Expected ErrNotSeekable, got %v", err)
+	}
+	destDir := t.TempDir()
+	if err := ExtractFile(archivePath, "metadata.json", destDir); err != nil {
+		t.Fatalf("ExtractFile failed: %v", err)
+	}
+	if _, err := os.Stat(filepath.Join(destDir, "metadata.json")); err != nil {
+		t.Errorf("metadata.json was not extracted: %v", err)
+	}
+}
+
+func TestSeekable_RequiresZstd(t *testing.T) {
+	archivePath := filepath.Join(t.TempDir(), "seek.apg")
+	opts := CreateOptions{Compression: "xz", Seekable: true}
+	if _, err := CreateWithOptions(archivePath, seekableTree(t), opts); err == nil {
+		t.Error("Seekable xz packages should be rejected")
+	}
+}
+
+// readMembers returns every member of archivePath with its data.
+func readMembers(t *testing.T, archivePath string, opts ReadOptions) (map[string]string, []string, error) {
+	t.Helper()
+	ar, err := OpenReaderWithOptions(archivePath, opts)
+	if err != nil {
+		return nil, nil, err
+	}
+	defer ar.Close()
+	data := map[string]string{}
+	var order []string
+	for {
+		e, err := ar.Next()
+		if err == io.EOF {
+			return data, order, nil
+		}
+		if err != nil {
+			return nil, nil, err
+		}
+		b, err := io.ReadAll(ar)
+		if err != nil {
+			return nil, nil, err
+		}
+		data[e.Path], order = string(b), append(order, e.Path)
+	}
+}
+
+func TestSeekable_ParallelFrames(t *testing.T) {
+	sourceDir := seekableTree(t)
+	// Far past APG_PDEC_INLINE: a frame of its own, streamed by the reader.
+	big := strings.Repeat("a large member in a single frame\n", (70<<20)/33)
+	os.WriteFile(filepath.Join(sourceDir, "data/usr/lib/zz-big"), []byte(big), 0644)
+	archivePath := filepath.Join(t.TempDir(), "seek.apg")
+	if _, err := CreateWithOptions(archivePath, sourceDir, CreateOptions{Compression: "zstd", Level: 1, Seekable: true, FrameSize: 16 << 10}); err != nil {
+		t.Fatal(err)
+	}
+
+	want, wantOrder, err := readMembers(t, archivePath, ReadOptions{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	for _, threads := range []int{2, 8} {
+		got, order, err := readMembers(t, archivePath, ReadOptions{Threads: threads})
+		if err != nil {
+			t.Fatalf("threads=%d: %v", threads, err)
+		}
+		if strings.Join(order, " ") != strings.Join(wantOrder, " ") {
+			t.Errorf("threads=%d: members %v, want %v", threads, order, wantOrder)
+		}
+		for path, content := range want {
+			if got[path] != content {
+				t.Errorf("threads=%d: %s differs", threads, path)
+			}
+		}
+	}
+
+	// A damaged frame fails the read (in zstd, or in the tar parser when
+	// the damage still decodes).
+	toc, _ := ReadTOC(archivePath)
+	pkg, _ := os.ReadFile(archivePath)
+	f := toc.Frames[len(toc.Frames)/2]
+	pkg[f.Offset+int64(f.CompressedSize)/2] ^= 0xff
+	damaged := filepath.Join(t.TempDir(), "damaged.apg")
+	os.WriteFile(damaged, pkg, 0644)
+	if _, _, err := readMembers(t, damaged, ReadOptions{Threads: 4}); err == nil {
+		t.Errorf("damaged frame read without error")
+	}
+}
@@ -0,0 +1,80 @@
+// Package archive — package output to an io.Writer.
+// NurOS 2026 - GPL 3.0
+package archive
+
+/*
+#include <stddef.h>
+#include <stdint.h>
+*/
+import "C"
+
+import (
+	"fmt"
+	"io"
+	"os"
+	"runtime/cgo"
+	"syscall"
+	"unsafe"
+)
+
+// goSink is a CreateOptions.Sink fed by the C writer through apgGoWrite.
+type goSink struct {
+	w      io.Writer
+	err    error
+	handle cgo.Handle
+}
+
+// apgGoWrite is the C writer's output callback (apg_fd_write): it passes
+// len bytes at buf to the sink behind handle. The bytes belong to C and
+// are only valid during the call, as io.Writer requires anyway.
+//
+//export apgGoWrite
+func apgGoWrite(handle C.uintptr_t, buf unsafe.Pointer, len C.size_t) C.int {
+	s := cgo.Handle(handle).Value().(*goSink)
+	if s.err != nil {
+		return -1
+	}
+	if _, s.err = s.w.Write(unsafe.Slice((*byte)(buf), int(len))); s.err != nil {
+		return -1
+	}
+	return 0
+}
+
+// openSink prepares w for the C writer: a descriptor of its own for an
+// *os.File (closed by the writer), a callback handle for anything else,
+// neither (-1, 0) for writing to archivePath.
+func (aw *Writer) openSink(w io.Writer) (C.int, C.uintptr_t, error) {
+	if w == nil {
+		return -1, 0, nil
+	}
+	if f, ok := w.(*os.File); ok {
+		syscall.ForkLock.RLock()
+		fd, err := syscall.Dup(int(f.Fd()))
+		if err == nil {
+			syscall.CloseOnExec(fd)
+		}
+		syscall.ForkLock.RUnlock()
+		if err != nil {
+			return -1, 0, os.NewSyscallError("dup", err)
+		}
+		return C.int(fd), 0, nil
+	}
+	aw.sink = &goSink{w: w}
+	aw.sink.handle = cgo.NewHandle(aw.sink)
+	return -1, C.uintptr_t(aw.sink.handle), nil
+}
+
+// closeSink releases the callback handle and returns the sink's write
+// error, if it had one.
+func (aw *Writer) closeSink() error {
+	if aw.sink == nil {
+		return nil
+	}
+	aw.sink.handle.Delete()
+	err := aw.sink.err
+	aw.sink = nil
+	if err != nil {
+		return fmt.Errorf("write to sink: %w", err)
+	}
+	return nil
+}
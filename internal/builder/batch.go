@@ -0,0 +1,183 @@
+// Package builder — batch builds of many packages in one process.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"bytes"
+	"encoding/json"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"runtime"
+	"sync"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+	"github.com/NurOS-Linux/apgbuild/internal/metadata"
+)
+
+// BatchPackage is one package of a batch build.
+type BatchPackage struct {
+	Dir    string `json:"dir"`
+	Output string `json:"output,omitempty"` // "" = OutputName(Dir)
+}
+
+// BatchManifest is the file read by LoadBatchManifest:
+//
+//	{"packages": [{"dir": "curl-libs", "output": "out/curl-libs.apg"}, ...]}
+//
+// Relative paths are relative to the manifest's directory.
+type BatchManifest struct {
+	Packages []BatchPackage `json:"packages"`
+}
+
+// BatchResult is the outcome of one package of a batch build. Stats.CPU
+// is that of the whole process, which the packages share.
+type BatchResult struct {
+	Package BatchPackage  `json:"package"`
+	Stats   *BuildStats   `json:"stats"`
+	Elapsed time.Duration `json:"elapsed_ns"`
+	Err     error         `json:"-"`
+	Error   string        `json:"error,omitempty"`
+}
+
+// LoadBatchManifest reads a batch manifest.
+func LoadBatchManifest(path string) ([]BatchPackage, error) {
+	data, err := os.ReadFile(path)
+	if err != nil {
+		return nil, fmt.Errorf("failed to read manifest: %w", err)
+	}
+	var m BatchManifest
+	if err := json.Unmarshal(data, &m); err != nil {
+		return nil, fmt.Errorf("failed to parse manifest %s: %w", path, err)
+	}
+	base := filepath.Dir(path)
+	for i := range m.Packages {
+		p := &m.Packages[i]
+		if p.Dir == "" {
+			return nil, fmt.Errorf("manifest %s: package %d has no dir", path, i+1)
+		}
+		if !filepath.IsAbs(p.Dir) {
+			p.Dir = filepath.Join(base, p.Dir)
+		}
+		if p.Output != "" && !filepath.IsAbs(p.Output) {
+			p.Output = filepath.Join(base, p.Output)
+		}
+	}
+	return m.Packages, nil
+}
+
+// OutputName returns the default package file name for sourceDir,
+// name-version-arch.apg from its metadata.json.
+func OutputName(sourceDir string) (string, error) {
+	meta, err := metadata.Load(filepath.Join(sourceDir, "metadata.json"))
+	if err != nil {
+		return "", err
+	}
+	arch := "noarch"
+	if meta.Architecture != nil && *meta.Architecture != "" {
+		arch = *meta.Architecture
+	}
+	return fmt.Sprintf("%s-%s-%s.apg", meta.Name, meta.Version, arch), nil
+}
+
+// BuildBatch builds pkgs with opts, within a budget of jobs threads (0 =
+// number of CPUs). Up to jobs packages are built at once, each started
+// package holding one thread; idle threads are lent to the hashing of
+// whichever packages have files left, so the last packages of a batch
+// still use every core. Compressor threads (opts.Threads) come on top.
+//
+// The output of each package is printed in one piece once it is done.
+// One failing package does not stop the others; results keep pkgs order.
+func (b *Builder) BuildBatch(pkgs []BatchPackage, opts Options, jobs int) []BatchResult {
+	if jobs <= 0 {
+		jobs = runtime.NumCPU()
+	}
+	workers := jobs
+	if workers > len(pkgs) {
+		workers = len(pkgs)
+	}
+	// Threads are handed out one per running package; the rest lends
+	// itself to hashing.
+	threads := checksum.NewSlots(jobs)
+	opts.Jobs = jobs
+	opts.slots = threads
+
+	results := make([]BatchResult, len(pkgs))
+	next := make(chan int)
+	var mu sync.Mutex
+	var wg sync.WaitGroup
+	for w := 0; w < workers; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := range next {
+				<-threads
+				results[i] = b.buildOne(pkgs[i], opts, &mu)
+				threads <- struct{}{}
+			}
+		}()
+	}
+	for i := range pkgs {
+		next <- i
+	}
+	close(next)
+	wg.Wait()
+	return results
+}
+
+// buildOne builds one package of a batch, buffering its output and
+// printing it under mu when done.
+func (b *Builder) buildOne(p BatchPackage, opts Options, mu *sync.Mutex) BatchResult {
+	start := time.Now()
+	r := BatchResult{Package: p, Stats: &BuildStats{}}
+	if p.Output == "" {
+		name, err := OutputName(p.Dir)
+		if err != nil {
+			r.Err = fmt.Errorf("no output given and failed to read metadata.json: %w", err)
+		}
+		r.Package.Output = name
+	}
+	var log bytes.Buffer
+	if r.Err == nil {
+		opts.Stats = r.Stats
+		r.Err = (&Builder{out: &log, Quiet: b.Quiet}).CreatePackageWithOptions(p.Dir, r.Package.Output, opts)
+	}
+	r.Elapsed = time.Since(start)
+	if r.Err != nil {
+		r.Error = r.Err.Error()
+		fmt.Fprintf(&log, "%sError: %s: %v%s\n", ColorRed, p.Dir, r.Err, ColorReset)
+	}
+
+	mu.Lock()
+	b.writer().Write(log.Bytes())
+	mu.Unlock()
+	return r
+}
+
+// WriteBatchSummary prints one line per package of a batch build.
+func WriteBatchSummary(w io.Writer, results []BatchResult) {
+	failed := 0
+	fmt.Fprintf(w, "Batch summary:\n")
+	fmt.Fprintf(w, "  %-40s %8s %7s %12s %10s\n", "package", "status", "entries", "size", "time")
+	for _, r := range results {
+		status, size := "built", fmtBytes(r.Stats.PackageBytes)
+		switch {
+		case r.Err != nil:
+			status, size = "FAILED", "-"
+			failed++
+		case r.Stats.UpToDate:
+			status = "current"
+			if fi, err := os.Stat(r.Package.Output); err == nil {
+				size = fmtBytes(fi.Size())
+			}
+		}
+		name := r.Package.Output
+		if name == "" {
+			name = r.Package.Dir
+		}
+		fmt.Fprintf(w, "  %-40s %8s %7d %12s %10s\n", name, status, r.Stats.Files, size, fmtDuration(r.Elapsed))
+	}
+	fmt.Fprintf(w, "  %d packages, %d failed\n", len(results), failed)
+}
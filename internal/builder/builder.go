@@ -4,12 +4,15 @@ package builder
 
 import (
 	"fmt"
+	"io"
 	"os"
 	"path/filepath"
+	"time"
 
 	"github.com/NurOS-Linux/apgbuild/internal/archive"
 	"github.com/NurOS-Linux/apgbuild/internal/checksum"
 	"github.com/NurOS-Linux/apgbuild/internal/metadata"
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
 )
 
 // Color codes for terminal output.
@@ -23,16 +26,120 @@ const (
 )
 
 // Builder handles APG package building operations.
-type Builder struct{}
+type Builder struct {
+	out io.Writer // progress output (nil = stdout)
+
+	// Quiet prints only warnings and failures.
+	Quiet bool
+	// Progress, if set, receives a rate-limited progress line during
+	// hashing and verification, usually os.Stderr when it is a terminal.
+	Progress io.Writer
+}
 
 // New creates a new Builder instance.
 func New() *Builder {
 	return &Builder{}
 }
 
+// SetOutput sends status messages to w instead of stdout, e.g. to stderr
+// while the package itself goes to stdout.
+func (b *Builder) SetOutput(w io.Writer) {
+	b.out = w
+}
+
+func (b *Builder) writer() io.Writer {
+	if b.out == nil {
+		return os.Stdout
+	}
+	return b.out
+}
+
+// printf prints a status message, unless b is quiet.
+func (b *Builder) printf(format string, args ...any) {
+	if !b.Quiet {
+		fmt.Fprintf(b.writer(), format, args...)
+	}
+}
+
+// warnf prints a warning or failure, also when b is quiet.
+func (b *Builder) warnf(format string, args ...any) {
+	fmt.Fprintf(b.writer(), format, args...)
+}
+
+// Options configures CreatePackageWithOptions.
+type Options struct {
+	// Compression, Level and Threads are passed through to archive.CreateOptions.
+	// Compression archive.CompressionAuto has archive.PlanCompression pick
+	// a zstd level (Level is ignored) that fits Budget, and with Seekable
+	// stores already-compressed members in fast frames.
+	Compression string
+	Level       int
+	Threads     int
+	Budget      time.Duration
+	// Seekable writes the APGv2 framed layout (see archive.CreateOptions),
+	// with frames cut at the first member boundary past FrameSize bytes.
+	// Readers decompress the frames in parallel.
+	Seekable  bool
+	FrameSize int64
+	// Order, Reproducible and Epoch set member order and normalization
+	// (see archive.CreateOptions).
+	Order        string
+	Reproducible bool
+	Epoch        time.Time
+	// Dictionary is a zstd dictionary to compress with (see
+	// archive.CreateOptions); its ID is recorded in metadata.json.
+	Dictionary []byte
+	// SinglePass hashes data/ and home/ while they are streamed into the
+	// archive, so every file is read once instead of twice.
+	SinglePass bool
+	// Jobs is the number of files hashed concurrently (0 = number of CPUs).
+	// It applies to the separate sums pass; SinglePass hashes in archive order.
+	Jobs int
+	// Hash is the algorithm of the sums files ("" = checksum.SHA256). With
+	// checksum.SHA256Tree, large files are hashed on several cores by the
+	// sums pass; SinglePass computes the same sums serially.
+	Hash checksum.Algorithm
+	// NoCache disables the build cache (checksum.CacheName in the source
+	// directory), which otherwise skips hashing unchanged files and skips
+	// the whole build when neither inputs nor output changed.
+	NoCache bool
+	// Caches, if set, keeps build caches open between builds (see
+	// checksum.CacheSet); builds of one tree then run one at a time.
+	Caches *checksum.CacheSet
+	// Dedup stores files under data/ and home/ whose sums, permissions and
+	// owner are equal only once; further copies become hardlinks (see
+	// archive.CreateOptions.DedupSums). It needs the separate sums pass and
+	// is ignored with SinglePass, which only links paths of one inode.
+	Dedup bool
+	// Blobs splices large files under data/ and home/ into seekable
+	// packages from this content-addressed store of compressed frames,
+	// keyed by their sums (see archive.BlobStore). It needs Seekable and
+	// the separate sums pass, and is ignored with SinglePass.
+	Blobs *archive.BlobStore
+	// Stats, if non-nil, is filled with per-phase timings of the build.
+	Stats *BuildStats
+	// Sink, if set, receives the package instead of outputPath, which then
+	// only names it in messages (see archive.CreateOptions.Sink). There is
+	// no output file to compare, so the build is never skipped as up to
+	// date; the hash cache is still used.
+	Sink io.Writer
+	// Limits bounds the tree being packaged (see archive.Limits).
+	Limits archive.Limits
+
+	slots          checksum.Slots  // hashing threads shared by a batch (BuildBatch)
+	incompressible map[string]bool // from the CompressionAuto plan
+}
+
 // CreatePackage creates an APG package from a directory.
 func (b *Builder) CreatePackage(sourceDir, outputPath string) error {
-	fmt.Printf("%sCreating package from directory: %s%s\n", ColorCyan, sourceDir, ColorReset)
+	return b.CreatePackageWithOptions(sourceDir, outputPath, Options{Compression: "zstd", Level: 19})
+}
+
+// CreatePackageWithOptions creates an APG package from a directory:
+// validates metadata.json, writes sha256sums for data/ and home/ and
+// archives the tree.
+func (b *Builder) CreatePackageWithOptions(sourceDir, outputPath string, opts Options) error {
+	b.printf("%sCreating package from directory: %s%s\n", ColorCyan, sourceDir, ColorReset)
 
 	// Validate source directory
 	info, err := os.Stat(sourceDir)
@@ -46,61 +153,274 @@ func (b *Builder) CreatePackage(sourceDir, outputPath string) error {
 	// Check for required metadata.json
 	metadataPath := filepath.Join(sourceDir, "metadata.json")
 	if _, err := os.Stat(metadataPath); os.IsNotExist(err) {
-		fmt.Printf("%sWarning: metadata.json not found in package%s\n", ColorYellow, ColorReset)
+		b.warnf("%sWarning: metadata.json not found in package%s\n", ColorYellow, ColorReset)
 	} else {
 		// Validate metadata
 		meta, err := metadata.Load(metadataPath)
 		if err != nil {
-			fmt.Printf("%sWarning: failed to parse metadata.json: %v%s\n", ColorYellow, err, ColorReset)
-		} else if err := meta.Validate(); err != nil {
-			fmt.Printf("%sWarning: metadata validation failed: %v%s\n", ColorYellow, err, ColorReset)
+			b.warnf("%sWarning: failed to parse metadata.json: %v%s\n", ColorYellow, err, ColorReset)
+		} else {
+			if err := meta.Validate(); err != nil {
+				b.warnf("%sWarning: metadata validation failed: %v%s\n", ColorYellow, err, ColorReset)
+			}
+			if err := recordDictionary(meta, metadataPath, opts.Dictionary); err != nil {
+				return err
+			}
 		}
 	}
 
-	// Generate SHA-256 checksums for data directory
-	dataDir := filepath.Join(sourceDir, "data")
-	if info, err := os.Stat(dataDir); err == nil && info.IsDir() {
-		sumsPath := filepath.Join(sourceDir, "sha256sums")
-		fmt.Printf("%sGenerating SHA-256 checksums for data directory...%s\n", ColorCyan, ColorReset)
+	// One scan of the tree feeds checksums and the archive alike.
+	pt := opts.Stats.begin("scan")
+	scanned := time.Now()
+	tree, err := scan.Scan(sourceDir, scan.Options{})
+	if err != nil {
+		return fmt.Errorf("failed to scan source directory: %w", err)
+	}
+	tree.Remove(checksum.CacheName)
+	pt.end(0)
+
+	var cache *checksum.Cache
+	var fp [32]byte
+	var stable bool
+	if !opts.NoCache {
+		cachePath := filepath.Join(sourceDir, checksum.CacheName)
+		if opts.Caches != nil {
+			var release func()
+			cache, release = opts.Caches.Acquire(cachePath)
+			defer release()
+		} else {
+			cache = checksum.OpenCache(cachePath)
+		}
+		cache.UseAlgorithm(opts.Hash)
+		fp, stable = fingerprint(tree, outputPath, opts, scanned)
+		if result, ok := upToDate(cache, fp, outputPath); ok && opts.Sink == nil {
+			if opts.Stats != nil {
+				opts.Stats.UpToDate = true
+				opts.Stats.Files, opts.Stats.DataBytes = result.FilesAdded, result.TotalSize
+			}
+			b.printf("%s Package is up to date: %s%s\n", ColorGreen, outputPath, ColorReset)
+			b.printf("%s  Files: %d, Size: %d bytes%s\n", ColorGreen, result.FilesAdded, result.TotalSize, ColorReset)
+			return nil
+		}
+	}
+
+	if opts.Compression == archive.CompressionAuto {
+		if opts, err = b.planCompression(tree, opts); err != nil {
+			return err
+		}
+	}
 
-		entries, err := checksum.CreateSums(dataDir, sumsPath)
+	var result *archive.CreateResult
+	if opts.SinglePass && opts.Dedup {
+		b.warnf("%sWarning: --dedup needs the checksum pass, ignored with --single-pass%s\n", ColorYellow, ColorReset)
+	}
+	if opts.Blobs != nil && !opts.Seekable {
+		return fmt.Errorf("a blob store needs seekable packages (--seekable)")
+	}
+	if opts.SinglePass && opts.Blobs != nil {
+		b.warnf("%sWarning: --blob-store needs the checksum pass, ignored with --single-pass%s\n", ColorYellow, ColorReset)
+	}
+	if opts.SinglePass {
+		result, err = b.createSinglePass(tree, outputPath, opts, cache)
+	} else {
+		result, err = b.createWithSums(tree, outputPath, opts, cache)
+	}
+	if err != nil {
+		return err
+	}
+	b.printCreated(outputPath, result)
+
+	if cache != nil {
+		pt := opts.Stats.begin("cache")
+		var err error
+		switch {
+		case opts.Sink != nil:
+		case stable:
+			err = recordStamp(cache, fp, outputPath, result)
+		default:
+			cache.Extra = nil // inputs too fresh to vouch for next time
+		}
+		if err == nil {
+			err = cache.Save()
+		}
 		if err != nil {
-			return fmt.Errorf("failed to create checksums: %w", err)
+			b.warnf("%sWarning: failed to update build cache: %v%s\n", ColorYellow, err, ColorReset)
 		}
+		pt.end(0)
+	}
+	return nil
+}
+
+// createWithSums writes the sums files for data/ and home/ and then
+// archives the tree.
+func (b *Builder) createWithSums(tree *scan.Tree, outputPath string, opts Options, cache *checksum.Cache) (*archive.CreateResult, error) {
+	bar := b.startProgress("hashing", countRegular(tree, "data")+countRegular(tree, "home"))
+	defer func() { bar.finish() }()
+	sumOpts := checksum.Options{Jobs: opts.Jobs, Cache: cache, Slots: opts.slots, Progress: bar.hook(), Algorithm: opts.Hash}
+	pt := opts.Stats.begin("hash")
+	var hashed int64
+	var dedup, blobSums map[string]string
+	if opts.Dedup {
+		dedup = map[string]string{}
+	}
+	if opts.Blobs != nil {
+		blobSums = map[string]string{}
+	}
+	alg := opts.Hash
+	if alg == "" {
+		alg = checksum.SHA256
+	}
+
+	// Generate SHA-256 checksums for data directory
+	if f := tree.Lookup("data"); f != nil && f.Mode.IsDir() {
+		sumsPath := filepath.Join(tree.Root, "sha256sums")
+		b.printf("%sGenerating SHA-256 checksums for data directory...%s\n", ColorCyan, ColorReset)
 
-		for _, entry := range entries {
-			fmt.Printf("%s  %s%s\n", ColorGreen, entry.Path, ColorReset)
+		entries, err := checksum.CreateSumsFromTree(tree, "data", sumsPath, sumOpts)
+		if err != nil {
+			return nil, fmt.Errorf("failed to create checksums: %w", err)
+		}
+		if _, err := tree.Add("sha256sums"); err != nil {
+			return nil, fmt.Errorf("failed to create checksums: %w", err)
 		}
-		fmt.Printf("%sGenerated %d checksums%s\n", ColorGreen, len(entries), ColorReset)
+		hashed += treeBytes(tree, "data")
+		addSums(dedup, "data", "", entries)
+		addSums(blobSums, "data", string(alg)+":", entries)
+		b.printf("%sGenerated %d checksums%s\n", ColorGreen, len(entries), ColorReset)
 	}
 
 	// Generate checksums for home directory if exists
-	homeDir := filepath.Join(sourceDir, "home")
-	if info, err := os.Stat(homeDir); err == nil && info.IsDir() {
-		sumsPath := filepath.Join(sourceDir, "sha256sums.home")
-		fmt.Printf("%sGenerating SHA-256 checksums for home directory...%s\n", ColorCyan, ColorReset)
+	if f := tree.Lookup("home"); f != nil && f.Mode.IsDir() {
+		sumsPath := filepath.Join(tree.Root, "sha256sums.home")
+		b.printf("%sGenerating SHA-256 checksums for home directory...%s\n", ColorCyan, ColorReset)
 
-		entries, err := checksum.CreateSums(homeDir, sumsPath)
+		entries, err := checksum.CreateSumsFromTree(tree, "home", sumsPath, sumOpts)
 		if err != nil {
-			fmt.Printf("%sWarning: failed to create home checksums: %v%s\n", ColorYellow, err, ColorReset)
+			b.warnf("%sWarning: failed to create home checksums: %v%s\n", ColorYellow, err, ColorReset)
+		} else if _, err := tree.Add("sha256sums.home"); err != nil {
+			b.warnf("%sWarning: failed to create home checksums: %v%s\n", ColorYellow, err, ColorReset)
 		} else {
-			fmt.Printf("%sGenerated %d home checksums%s\n", ColorGreen, len(entries), ColorReset)
+			hashed += treeBytes(tree, "home")
+			addSums(dedup, "home", "", entries)
+			addSums(blobSums, "home", string(alg)+":", entries)
+			b.printf("%sGenerated %d home checksums%s\n", ColorGreen, len(entries), ColorReset)
 		}
 	}
+	pt.end(hashed)
+	bar.finish()
+	bar = nil
 
 	// Create archive
-	fmt.Printf("%sCreating archive...%s\n", ColorCyan, ColorReset)
-	result, err := archive.Create(outputPath, sourceDir)
+	b.printf("%sCreating archive...%s\n", ColorCyan, ColorReset)
+	pt = opts.Stats.begin("archive")
+	archiveOpts := opts.archiveOptions()
+	archiveOpts.DedupSums = dedup
+	archiveOpts.Blobs, archiveOpts.BlobSums = opts.Blobs, blobSums
+	result, err := archive.CreateFromTree(outputPath, tree, archiveOpts)
 	if err != nil {
-		return fmt.Errorf("failed to create archive: %w", err)
+		return nil, fmt.Errorf("failed to create archive: %w", err)
+	}
+	pt.endArchive(result)
+	return result, nil
+}
+
+// addSums records the sums of a tree, each after prefix, under their
+// member paths. Nothing is recorded into a nil map (feature disabled).
+func addSums(m map[string]string, dir, prefix string, entries []checksum.Entry) {
+	if m == nil {
+		return
+	}
+	for _, e := range entries {
+		m[dir+"/"+filepath.ToSlash(e.Path)] = prefix + e.Checksum
+	}
+}
+
+// countRegular counts the regular files below dir.
+func countRegular(tree *scan.Tree, dir string) int {
+	n := 0
+	for _, f := range tree.Sub(dir) {
+		if f.Mode.IsRegular() {
+			n++
+		}
+	}
+	return n
+}
+
+// treeBytes sums the sizes of the regular files below dir.
+func treeBytes(tree *scan.Tree, dir string) int64 {
+	var n int64
+	for _, f := range tree.Sub(dir) {
+		if f.Mode.IsRegular() {
+			n += f.Size
+		}
+	}
+	return n
+}
+
+func (o Options) archiveOptions() archive.CreateOptions {
+	return archive.CreateOptions{
+		Compression:  o.Compression,
+		Level:        o.Level,
+		Threads:      o.Threads,
+		Seekable:     o.Seekable,
+		FrameSize:    o.FrameSize,
+		Order:        o.Order,
+		Reproducible: o.Reproducible,
+		Epoch:        o.Epoch,
+		Dictionary:   o.Dictionary,
+		Sink:         o.Sink,
+		Limits:       o.Limits,
+
+		Incompressible: o.incompressible,
 	}
+}
 
-	fmt.Printf("%s Package created successfully: %s%s\n", ColorGreen, outputPath, ColorReset)
-	fmt.Printf("%s  Files: %d, Size: %d bytes%s\n", ColorGreen, result.FilesAdded, result.TotalSize, ColorReset)
+// planCompression resolves archive.CompressionAuto in opts to zstd and the
+// level archive.PlanCompression picks for tree.
+func (b *Builder) planCompression(tree *scan.Tree, opts Options) (Options, error) {
+	plan, err := archive.PlanCompression(tree, archive.PlanOptions{
+		Budget:   opts.Budget,
+		Threads:  opts.Threads,
+		Seekable: opts.Seekable && len(opts.Dictionary) == 0,
+	})
+	if err != nil {
+		return opts, err
+	}
+	opts.Compression, opts.Level, opts.incompressible = "zstd", plan.Level, plan.Incompressible
+	b.printf("%sAuto compression: zstd level %d, %d of %d bytes already compressed (estimated %v)%s\n",
+		ColorCyan, plan.Level, plan.IncompressibleBytes, plan.Bytes, plan.Estimate.Round(time.Millisecond), ColorReset)
+	return opts, nil
+}
 
+// recordDictionary sets the zstd_dictionary field of metadata.json to the
+// ID of dict (removing it without one), rewriting the file only if the
+// field changes.
+func recordDictionary(meta *metadata.Metadata, metadataPath string, dict []byte) error {
+	id := archive.DictionaryID(dict)
+	if len(dict) > 0 && id == 0 {
+		return fmt.Errorf("not a zstd dictionary (or one without an ID)")
+	}
+	if meta.ZstdDictionary == id {
+		return nil
+	}
+	meta.ZstdDictionary = id
+	if err := meta.Save(metadataPath); err != nil {
+		return fmt.Errorf("record dictionary in metadata: %w", err)
+	}
 	return nil
 }
 
+func (b *Builder) printCreated(outputPath string, result *archive.CreateResult) {
+	b.printf("%s Package created successfully: %s%s\n", ColorGreen, outputPath, ColorReset)
+	b.printf("%s  Files: %d, Size: %d bytes%s\n", ColorGreen, result.FilesAdded, result.TotalSize, ColorReset)
+	if result.Hardlinks > 0 {
+		b.printf("%s  Hardlinks: %d (%d bytes not stored again)%s\n", ColorGreen, result.Hardlinks, result.LinkedSize, ColorReset)
+	}
+	if result.BlobHits+result.BlobMisses > 0 {
+		b.printf("%s  Blobs: %d spliced from the store, %d added to it%s\n", ColorGreen, result.BlobHits, result.BlobMisses, ColorReset)
+	}
+}
+
 // CreatePackageWithCompression creates an APG package with explicit compression settings.
 func (b *Builder) CreatePackageWithCompression(sourceDir, outputPath, compression string, level int) error {
 	info, err := os.Stat(sourceDir)
@@ -110,7 +430,7 @@ func (b *Builder) CreatePackageWithCompression(sourceDir, outputPath, compressio
 	if !info.IsDir() {
 		return fmt.Errorf("path is not a directory: %s", sourceDir)
 	}
-	fmt.Printf("%sCreating archive (%s level=%d)...%s\n", ColorCyan, compression, level, ColorReset)
+	b.printf("%sCreating archive (%s level=%d)...%s\n", ColorCyan, compression, level, ColorReset)
 	result, err := archive.CreateWithOptions(outputPath, sourceDir, archive.CreateOptions{
 		Compression: compression,
 		Level:       level,
@@ -118,15 +438,14 @@ func (b *Builder) CreatePackageWithCompression(sourceDir, outputPath, compressio
 	if err != nil {
 		return fmt.Errorf("failed to create archive: %w", err)
 	}
-	fmt.Printf("%s Package created: %s (%d files, %d bytes)%s\n",
+	b.printf("%s Package created: %s (%d files, %d bytes)%s\n",
 		ColorGreen, outputPath, result.FilesAdded, result.TotalSize, ColorReset)
 	return nil
 }
 
-
 // ExtractPackage extracts an APG package to the current directory.
 func (b *Builder) ExtractPackage(packagePath string) error {
-	fmt.Printf("%sExtracting package: %s%s\n", ColorCyan, packagePath, ColorReset)
+	b.printf("%sExtracting package: %s%s\n", ColorCyan, packagePath, ColorReset)
 
 	if _, err := os.Stat(packagePath); os.IsNotExist(err) {
 		return fmt.Errorf("package not found: %s", packagePath)
@@ -141,13 +460,19 @@ func (b *Builder) ExtractPackage(packagePath string) error {
 		return fmt.Errorf("failed to extract package: %w", err)
 	}
 
-	fmt.Printf("%s Package extracted successfully%s\n", ColorGreen, ColorReset)
+	b.printf("%s Package extracted successfully%s\n", ColorGreen, ColorReset)
 	return nil
 }
 
 // ExtractPackageTo extracts an APG package to a specified directory.
 func (b *Builder) ExtractPackageTo(packagePath, destDir string) error {
-	fmt.Printf("%sExtracting package: %s to %s%s\n", ColorCyan, packagePath, destDir, ColorReset)
+	return b.ExtractPackageWithOptions(packagePath, destDir, archive.ExtractOptions{})
+}
+
+// ExtractPackageWithOptions extracts an APG package to destDir with the
+// given extraction options.
+func (b *Builder) ExtractPackageWithOptions(packagePath, destDir string, opts archive.ExtractOptions) error {
+	b.printf("%sExtracting package: %s to %s%s\n", ColorCyan, packagePath, destDir, ColorReset)
 
 	if _, err := os.Stat(packagePath); os.IsNotExist(err) {
 		return fmt.Errorf("package not found: %s", packagePath)
@@ -158,11 +483,32 @@ func (b *Builder) ExtractPackageTo(packagePath, destDir string) error {
 		return fmt.Errorf("failed to create destination directory: %w", err)
 	}
 
-	if err := archive.Extract(packagePath, destDir); err != nil {
+	if err := archive.ExtractWithOptions(packagePath, destDir, opts); err != nil {
 		return fmt.Errorf("failed to extract package: %w", err)
 	}
 
-	fmt.Printf("%s Package extracted successfully%s\n", ColorGreen, ColorReset)
+	b.printf("%s Package extracted successfully%s\n", ColorGreen, ColorReset)
+	return nil
+}
+
+// ExtractFile extracts a single member of an APG package into destDir.
+func (b *Builder) ExtractFile(packagePath, memberPath, destDir string) error {
+	return b.ExtractFileWithLimits(packagePath, memberPath, destDir, archive.Limits{})
+}
+
+// ExtractFileWithLimits is ExtractFile within explicit limits (see
+// archive.ExtractOptions.Limits).
+func (b *Builder) ExtractFileWithLimits(packagePath, memberPath, destDir string, limits archive.Limits) error {
+	if _, err := os.Stat(packagePath); os.IsNotExist(err) {
+		return fmt.Errorf("package not found: %s", packagePath)
+	}
+	if err := os.MkdirAll(destDir, 0755); err != nil {
+		return fmt.Errorf("failed to create destination directory: %w", err)
+	}
+	if err := archive.ExtractFileWithLimits(packagePath, memberPath, destDir, limits); err != nil {
+		return fmt.Errorf("failed to extract file: %w", err)
+	}
+	b.printf("%s Extracted %s%s\n", ColorGreen, memberPath, ColorReset)
 	return nil
 }
 
@@ -179,13 +525,18 @@ func (b *Builder) CreateMetadata(outputPath string) error {
 		return fmt.Errorf("failed to save metadata: %w", err)
 	}
 
-	fmt.Printf("%s metadata.json created successfully!%s\n", ColorGreen, ColorReset)
+	b.printf("%s metadata.json created successfully!%s\n", ColorGreen, ColorReset)
 	return nil
 }
 
 // GenerateChecksums generates SHA-256 checksums for a directory.
 func (b *Builder) GenerateChecksums(directory, outputPath string) error {
-	fmt.Printf("%sGenerating SHA-256 checksums for: %s%s\n", ColorCyan, directory, ColorReset)
+	return b.GenerateChecksumsWithOptions(directory, outputPath, checksum.Options{})
+}
+
+// GenerateChecksumsWithOptions is GenerateChecksums with hashing options.
+func (b *Builder) GenerateChecksumsWithOptions(directory, outputPath string, opts checksum.Options) error {
+	b.printf("%sGenerating SHA-256 checksums for: %s%s\n", ColorCyan, directory, ColorReset)
 
 	info, err := os.Stat(directory)
 	if err != nil {
@@ -195,40 +546,49 @@ func (b *Builder) GenerateChecksums(directory, outputPath string) error {
 		return fmt.Errorf("path is not a directory: %s", directory)
 	}
 
-	entries, err := checksum.CreateSums(directory, outputPath)
+	tree, err := scan.Scan(directory, scan.Options{})
 	if err != nil {
-		return fmt.Errorf("failed to generate checksums: %w", err)
+		return fmt.Errorf("failed to scan %s: %w", directory, err)
 	}
-
-	for _, entry := range entries {
-		fmt.Printf("%s  %s  %s%s\n", ColorGreen, entry.Checksum, entry.Path, ColorReset)
+	bar := b.startProgress("hashing", countRegular(tree, ""))
+	opts.Progress = bar.hook()
+	entries, err := checksum.CreateSumsFromTree(tree, "", outputPath, opts)
+	bar.finish()
+	if err != nil {
+		return fmt.Errorf("failed to generate checksums: %w", err)
 	}
 
-	fmt.Printf("%s Generated %d checksums to %s%s\n", ColorGreen, len(entries), outputPath, ColorReset)
+	b.printf("%s Generated %d checksums to %s%s\n", ColorGreen, len(entries), outputPath, ColorReset)
 	return nil
 }
 
-// VerifyChecksums verifies files against a crc32sums file.
+// VerifyChecksums verifies files against a sha256sums file.
 func (b *Builder) VerifyChecksums(sumsFile, baseDir string) error {
-	fmt.Printf("%sVerifying checksums from: %s%s\n", ColorCyan, sumsFile, ColorReset)
+	return b.VerifyChecksumsWithOptions(sumsFile, baseDir, checksum.Options{})
+}
 
-	passed, failed, err := checksum.VerifySums(sumsFile, baseDir)
+// VerifyChecksumsWithOptions verifies files against a sha256sums file
+// with hashing options. Failures are printed as they are found; passed
+// files are only counted.
+func (b *Builder) VerifyChecksumsWithOptions(sumsFile, baseDir string, opts checksum.Options) error {
+	b.printf("%sVerifying checksums from: %s%s\n", ColorCyan, sumsFile, ColorReset)
+
+	bar := b.startProgress("verify", 0)
+	opts.Progress = bar.hook()
+	passed, failed, err := checksum.VerifySumsFunc(sumsFile, baseDir, opts, func(path string, err error) {
+		if err != nil {
+			bar.logf(b.writer(), "%s  FAILED %s: %v%s\n", ColorRed, path, err, ColorReset)
+		}
+	})
+	bar.finish()
 	if err != nil {
 		return fmt.Errorf("verification failed: %w", err)
 	}
 
-	for _, f := range passed {
-		fmt.Printf("%s  %s%s\n", ColorGreen, f, ColorReset)
-	}
-
-	for _, f := range failed {
-		fmt.Printf("%s  %s%s\n", ColorRed, f, ColorReset)
-	}
-
-	fmt.Printf("\n%sPassed: %d, Failed: %d%s\n", ColorCyan, len(passed), len(failed), ColorReset)
+	b.printf("%sPassed: %d, Failed: %d%s\n", ColorCyan, passed, failed, ColorReset)
 
-	if len(failed) > 0 {
-		return fmt.Errorf("%d files failed verification", len(failed))
+	if failed > 0 {
+		return fmt.Errorf("%d files failed verification", failed)
 	}
 
 	return nil
@@ -236,17 +596,22 @@ func (b *Builder) VerifyChecksums(sumsFile, baseDir string) error {
 
 // ListPackage lists the contents of an APG package.
 func (b *Builder) ListPackage(packagePath string) error {
-	fmt.Printf("%sListing contents of: %s%s\n", ColorCyan, packagePath, ColorReset)
+	b.printf("%sListing contents of: %s%s\n", ColorCyan, packagePath, ColorReset)
 
 	contents, err := archive.ListContents(packagePath)
 	if err != nil {
 		return fmt.Errorf("failed to list package: %w", err)
 	}
 
-	for _, entry := range contents {
-		fmt.Printf("  %s\n", entry)
+	for _, e := range contents {
+		line := fmt.Sprintf("  %-8s %s %10d  %s  %s", e.Type, e.Mode, e.Size,
+			e.ModTime.UTC().Format("2006-01-02 15:04"), e.Path)
+		if e.Linkname != "" {
+			line += " -> " + e.Linkname
+		}
+		b.printf("%s\n", line)
 	}
 
-	fmt.Printf("\n%sTotal: %d entries%s\n", ColorCyan, len(contents), ColorReset)
+	b.printf("\n%sTotal: %d entries%s\n", ColorCyan, len(contents), ColorReset)
 	return nil
 }
@@ -1,9 +1,18 @@
 package builder
 
 import (
+	"bytes"
+	"fmt"
 	"os"
 	"path/filepath"
+	"strings"
 	"testing"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+	"github.com/NurOS-Linux/apgbuild/internal/elfanalyzer"
+	"github.com/NurOS-Linux/apgbuild/internal/metadata"
 )
 
 func TestNew(t *testing.T) {
@@ -212,3 +221,576 @@ func TestListPackage(t *testing.T) {
 		t.Fatalf("ListPackage failed: %v", err)
 	}
 }
+
+func TestCreatePackage_SinglePass(t *testing.T) {
+	b := New()
+
+	sourceDir := t.TempDir()
+	binDir := filepath.Join(sourceDir, "data", "usr", "bin")
+	if err := os.MkdirAll(binDir, 0755); err != nil {
+		t.Fatalf("Failed to create data dir: %v", err)
+	}
+	if err := os.WriteFile(filepath.Join(binDir, "hello"), []byte("#!/bin/sh\necho hello\n"), 0755); err != nil {
+		t.Fatalf("Failed to create test file: %v", err)
+	}
+	if err := os.WriteFile(filepath.Join(sourceDir, "data", "README"), []byte("readme"), 0644); err != nil {
+		t.Fatalf("Failed to create test file: %v", err)
+	}
+
+	outputPath := filepath.Join(t.TempDir(), "test.apg")
+	opts := Options{Compression: "zstd", Level: 3, SinglePass: true}
+	if err := b.CreatePackageWithOptions(sourceDir, outputPath, opts); err != nil {
+		t.Fatalf("CreatePackageWithOptions failed: %v", err)
+	}
+
+	// The single pass must produce the same sums as a separate hashing walk.
+	got, err := os.ReadFile(filepath.Join(sourceDir, "sha256sums"))
+	if err != nil {
+		t.Fatalf("sha256sums was not created: %v", err)
+	}
+	refPath := filepath.Join(t.TempDir(), "sha256sums")
+	if _, err := checksum.CreateSums(filepath.Join(sourceDir, "data"), refPath); err != nil {
+		t.Fatalf("CreateSums failed: %v", err)
+	}
+	want, _ := os.ReadFile(refPath)
+	if string(got) != string(want) {
+		t.Errorf("sha256sums mismatch:\ngot:\n%s\nwant:\n%s", got, want)
+	}
+
+	// The sums file is part of the package.
+	destDir := t.TempDir()
+	if err := b.ExtractPackageTo(outputPath, destDir); err != nil {
+		t.Fatalf("ExtractPackageTo failed: %v", err)
+	}
+	extracted, err := os.ReadFile(filepath.Join(destDir, "sha256sums"))
+	if err != nil {
+		t.Fatalf("sha256sums was not packaged: %v", err)
+	}
+	if string(extracted) != string(want) {
+		t.Errorf("packaged sha256sums mismatch")
+	}
+	content, err := os.ReadFile(filepath.Join(destDir, "data", "usr", "bin", "hello"))
+	if err != nil {
+		t.Fatalf("data file was not packaged: %v", err)
+	}
+	if string(content) != "#!/bin/sh\necho hello\n" {
+		t.Errorf("Content mismatch: got %q", content)
+	}
+}
+
+func TestCreatePackage_TreeHash(t *testing.T) {
+	b := New()
+	b.Quiet = true
+	sourceDir := t.TempDir()
+	dataDir := filepath.Join(sourceDir, "data")
+	os.MkdirAll(dataDir, 0755)
+	big := bytes.Repeat([]byte("firmware "), checksum.TreeChunk/8)
+	os.WriteFile(filepath.Join(dataDir, "fw.bin"), big, 0644)
+	os.WriteFile(filepath.Join(dataDir, "README"), []byte("readme"), 0644)
+
+	// The sums pass and the single pass agree on tree sums.
+	var sums []string
+	for _, single := range []bool{false, true} {
+		opts := Options{Compression: "zstd", Level: 1, Jobs: 2, Hash: checksum.SHA256Tree, SinglePass: single, NoCache: true}
+		if err := b.CreatePackageWithOptions(sourceDir, filepath.Join(t.TempDir(), "t.apg"), opts); err != nil {
+			t.Fatalf("single pass %t: %v", single, err)
+		}
+		data, _ := os.ReadFile(filepath.Join(sourceDir, "sha256sums"))
+		sums = append(sums, string(data))
+	}
+	if sums[0] != sums[1] || !strings.HasPrefix(sums[0], "# apg-sums algorithm=sha256-tree") {
+		t.Errorf("sums differ or lack the header:\n%s\n%s", sums[0], sums[1])
+	}
+	if err := b.VerifyChecksums(filepath.Join(sourceDir, "sha256sums"), dataDir); err != nil {
+		t.Errorf("VerifyChecksums: %v", err)
+	}
+}
+
+func TestCreatePackage_Incremental(t *testing.T) {
+	srcDir := t.TempDir()
+	outDir := t.TempDir()
+	dataDir := filepath.Join(srcDir, "data", "usr", "bin")
+	os.MkdirAll(dataDir, 0755)
+	os.WriteFile(filepath.Join(srcDir, "metadata.json"), []byte(`{"name":"t","version":"1"}`), 0644)
+	os.WriteFile(filepath.Join(dataDir, "tool"), []byte("v1"), 0755)
+
+	b := New()
+	outPath := filepath.Join(outDir, "t.apg")
+	opts := Options{Compression: "zstd", Level: 3}
+	if err := b.CreatePackageWithOptions(srcDir, outPath, opts); err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+	if _, err := os.Stat(filepath.Join(srcDir, checksum.CacheName)); err != nil {
+		t.Fatalf("Expected build cache: %v", err)
+	}
+	fresh, _ := os.Stat(outPath)
+	time.Sleep(20 * time.Millisecond)
+
+	// Inputs written within the racy window are not vouched for.
+	if err := b.CreatePackageWithOptions(srcDir, outPath, opts); err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+	if st, _ := os.Stat(outPath); st.ModTime().Equal(fresh.ModTime()) {
+		t.Error("Rebuild skipped with inputs modified just before the scan")
+	}
+
+	old := time.Now().Add(-time.Hour)
+	filepath.Walk(srcDir, func(p string, _ os.FileInfo, err error) error {
+		if err == nil {
+			os.Chtimes(p, old, old)
+		}
+		return err
+	})
+	if err := b.CreatePackageWithOptions(srcDir, outPath, opts); err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+	first, _ := os.Stat(outPath)
+	time.Sleep(20 * time.Millisecond)
+
+	// Nothing changed: the package must be left alone.
+	if err := b.CreatePackageWithOptions(srcDir, outPath, opts); err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+	if st, _ := os.Stat(outPath); !st.ModTime().Equal(first.ModTime()) {
+		t.Error("No-op rebuild rewrote the package")
+	}
+
+	// Different options rebuild.
+	opts.Level = 5
+	if err := b.CreatePackageWithOptions(srcDir, outPath, opts); err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+	second, _ := os.Stat(outPath)
+	if second.ModTime().Equal(first.ModTime()) {
+		t.Error("Changed options did not rebuild the package")
+	}
+
+	// A changed file rebuilds, and the cache file is not packaged.
+	os.WriteFile(filepath.Join(dataDir, "tool"), []byte("v2!"), 0755)
+	if err := b.CreatePackageWithOptions(srcDir, outPath, opts); err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+	entries, err := archive.ListContents(outPath)
+	if err != nil {
+		t.Fatal(err)
+	}
+	for _, e := range entries {
+		if e.Path == checksum.CacheName {
+			t.Error("Build cache must not be packaged")
+		}
+		if e.Path == "data/usr/bin/tool" && e.Size != 3 {
+			t.Errorf("Expected the rebuilt package to hold the new file, size %d", e.Size)
+		}
+	}
+}
+
+func TestCreatePackage_Stats(t *testing.T) {
+	srcDir := t.TempDir()
+	os.MkdirAll(filepath.Join(srcDir, "data", "usr"), 0755)
+	os.WriteFile(filepath.Join(srcDir, "metadata.json"), []byte(`{"name":"t","version":"1"}`), 0644)
+	os.WriteFile(filepath.Join(srcDir, "data", "usr", "file"), make([]byte, 100000), 0644)
+
+	stats := &BuildStats{}
+	outPath := filepath.Join(t.TempDir(), "t.apg")
+	err := New().CreatePackageWithOptions(srcDir, outPath, Options{Compression: "zstd", Level: 3, NoCache: true, Stats: stats})
+	if err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+
+	var names []string
+	for _, p := range stats.Phases {
+		names = append(names, p.Name)
+	}
+	for _, want := range []string{"scan", "hash", "archive", "compress", "write"} {
+		found := false
+		for _, n := range names {
+			found = found || n == want
+		}
+		if !found {
+			t.Errorf("Missing phase %q in %v", want, names)
+		}
+	}
+	info, _ := os.Stat(outPath)
+	if stats.PackageBytes != info.Size() {
+		t.Errorf("PackageBytes = %d, package file is %d bytes", stats.PackageBytes, info.Size())
+	}
+	if stats.Files != 5 || stats.TarBytes < 100000 {
+		t.Errorf("Unexpected totals: %d entries, %d tar bytes", stats.Files, stats.TarBytes)
+	}
+}
+
+func TestCreatePackage_Dedup(t *testing.T) {
+	srcDir := t.TempDir()
+	os.MkdirAll(filepath.Join(srcDir, "data", "usr", "share", "locale"), 0755)
+	os.WriteFile(filepath.Join(srcDir, "metadata.json"), []byte(`{"name":"t","version":"1"}`), 0644)
+	for _, lang := range []string{"de", "fr", "ru"} {
+		os.WriteFile(filepath.Join(srcDir, "data", "usr", "share", "locale", lang), make([]byte, 50000), 0644)
+	}
+
+	stats := &BuildStats{}
+	outPath := filepath.Join(t.TempDir(), "t.apg")
+	err := New().CreatePackageWithOptions(srcDir, outPath, Options{Compression: "zstd", Level: 3, Dedup: true, NoCache: true, Stats: stats})
+	if err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+	if stats.Hardlinks != 2 || stats.LinkedBytes != 100000 {
+		t.Errorf("Hardlinks = %d (%d bytes), want 2 (100000 bytes)", stats.Hardlinks, stats.LinkedBytes)
+	}
+
+	destDir := t.TempDir()
+	if err := New().ExtractPackageTo(outPath, destDir); err != nil {
+		t.Fatalf("ExtractPackageTo failed: %v", err)
+	}
+	passed, failed, err := checksum.VerifySums(filepath.Join(destDir, "sha256sums"), filepath.Join(destDir, "data"))
+	if err != nil || len(failed) != 0 || len(passed) != 3 {
+		t.Errorf("VerifySums: %d passed, %v failed, err %v", len(passed), failed, err)
+	}
+}
+
+func TestCreatePackage_AutoCompression(t *testing.T) {
+	srcDir := t.TempDir()
+	os.MkdirAll(filepath.Join(srcDir, "data", "usr", "share", "icons"), 0755)
+	os.WriteFile(filepath.Join(srcDir, "metadata.json"), []byte(`{"name":"t","version":"1"}`), 0644)
+	os.WriteFile(filepath.Join(srcDir, "data", "usr", "share", "icons", "a.png"), make([]byte, 70000), 0644)
+	os.WriteFile(filepath.Join(srcDir, "data", "usr", "share", "readme"), []byte("readme"), 0644)
+
+	var out bytes.Buffer
+	b := New()
+	b.SetOutput(&out)
+	outPath := filepath.Join(t.TempDir(), "t.apg")
+	opts := Options{Compression: archive.CompressionAuto, Seekable: true, Budget: time.Minute, NoCache: true}
+	if err := b.CreatePackageWithOptions(srcDir, outPath, opts); err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+	if !strings.Contains(out.String(), "Auto compression: zstd level 19, 70000 of ") {
+		t.Errorf("unexpected output:\n%s", out.String())
+	}
+	if err := b.VerifyPackage(outPath); err != nil {
+		t.Errorf("VerifyPackage: %v", err)
+	}
+}
+
+func TestCreatePackage_Dictionary(t *testing.T) {
+	srcDir := t.TempDir()
+	os.MkdirAll(filepath.Join(srcDir, "data", "usr", "lib", "py"), 0755)
+	os.WriteFile(filepath.Join(srcDir, "metadata.json"), []byte(`{"name":"t","version":"1"}`), 0644)
+	for i := 0; i < 300; i++ {
+		body := fmt.Sprintf("import os\n\ndef handler_%d(request):\n    return os.path.join('/srv', %q)\n", i, fmt.Sprint(i*31))
+		os.WriteFile(filepath.Join(srcDir, "data", "usr", "lib", "py", fmt.Sprintf("m%d.py", i)), []byte(body), 0644)
+	}
+
+	dictPath := filepath.Join(t.TempDir(), "py.dict")
+	if err := New().TrainDictionary([]string{srcDir}, dictPath, 4096); err != nil {
+		t.Fatalf("TrainDictionary failed: %v", err)
+	}
+	dict, _ := os.ReadFile(dictPath)
+	t.Setenv(archive.DictionaryPathEnv, filepath.Dir(dictPath))
+
+	outPath := filepath.Join(t.TempDir(), "t.apg")
+	opts := Options{Compression: "zstd", Level: 3, Seekable: true, Dictionary: dict, NoCache: true}
+	if err := New().CreatePackageWithOptions(srcDir, outPath, opts); err != nil {
+		t.Fatalf("CreatePackage failed: %v", err)
+	}
+	meta, err := metadata.Load(filepath.Join(srcDir, "metadata.json"))
+	if err != nil || meta.ZstdDictionary != archive.DictionaryID(dict) {
+		t.Errorf("metadata.json zstd_dictionary = %v (err %v), want %d", meta, err, archive.DictionaryID(dict))
+	}
+
+	destDir := t.TempDir()
+	if err := New().ExtractPackageTo(outPath, destDir); err != nil {
+		t.Fatalf("ExtractPackageTo failed: %v", err)
+	}
+	passed, failed, err := checksum.VerifySums(filepath.Join(destDir, "sha256sums"), filepath.Join(destDir, "data"))
+	if err != nil || len(failed) != 0 || len(passed) != 300 {
+		t.Errorf("VerifySums: %d passed, %v failed, err %v", len(passed), failed, err)
+	}
+}
+
+func TestBuildBatch(t *testing.T) {
+	root := t.TempDir()
+	for _, name := range []string{"a", "b", "c"} {
+		dir := filepath.Join(root, name)
+		os.MkdirAll(filepath.Join(dir, "data", "usr", "share"), 0755)
+		os.WriteFile(filepath.Join(dir, "metadata.json"), []byte(fmt.Sprintf(`{"name":%q,"version":"1"}`, name)), 0644)
+		for i := 0; i < 20; i++ {
+			os.WriteFile(filepath.Join(dir, "data", "usr", "share", fmt.Sprint(i)), []byte(name+fmt.Sprint(i)), 0644)
+		}
+	}
+	manifest := filepath.Join(root, "batch.json")
+	os.WriteFile(manifest, []byte(`{"packages": [
+		{"dir": "a", "output": "out/a.apg"},
+		{"dir": "missing", "output": "out/missing.apg"},
+		{"dir": "b", "output": "out/b.apg"},
+		{"dir": "c", "output": "out/c.apg"}
+	]}`), 0644)
+	os.MkdirAll(filepath.Join(root, "out"), 0755)
+
+	pkgs, err := LoadBatchManifest(manifest)
+	if err != nil {
+		t.Fatalf("LoadBatchManifest failed: %v", err)
+	}
+	var log bytes.Buffer
+	b := &Builder{out: &log}
+	results := b.BuildBatch(pkgs, Options{Compression: "zstd", Level: 3, NoCache: true}, 3)
+	if len(results) != 4 {
+		t.Fatalf("got %d results, want 4", len(results))
+	}
+	for i, r := range results {
+		if (r.Err != nil) != (i == 1) {
+			t.Errorf("%s: err = %v", r.Package.Dir, r.Err)
+		}
+	}
+	for _, name := range []string{"a", "b", "c"} {
+		out := filepath.Join(root, "out", name+".apg")
+		entries, err := archive.ListContents(out)
+		if err != nil || len(entries) < 20 {
+			t.Errorf("%s: %d entries, err %v", out, len(entries), err)
+		}
+	}
+	if n := strings.Count(log.String(), "Package created successfully"); n != 3 {
+		t.Errorf("log reports %d packages created, want 3", n)
+	}
+
+	var summary bytes.Buffer
+	WriteBatchSummary(&summary, results)
+	if !strings.Contains(summary.String(), "4 packages, 1 failed") {
+		t.Errorf("unexpected summary:\n%s", summary.String())
+	}
+}
+
+func TestSplitTree(t *testing.T) {
+	lib, err := filepath.EvalSymlinks("/bin/sh")
+	if err != nil {
+		t.Skip("no /bin/sh")
+	}
+	libc, _ := filepath.Glob("/lib/*/libc.so.6")
+	if len(libc) == 0 {
+		t.Skip("no host libc")
+	}
+	dest := t.TempDir()
+	write := func(rel string, data []byte, mode os.FileMode) {
+		p := filepath.Join(dest, rel)
+		os.MkdirAll(filepath.Dir(p), 0755)
+		if err := os.WriteFile(p, data, mode); err != nil {
+			t.Fatal(err)
+		}
+	}
+	sh, _ := os.ReadFile(lib)
+	so, _ := os.ReadFile(libc[0])
+	write("usr/bin/tool", sh, 0755)
+	write("usr/lib/libfoo.so.1", so, 0755)
+	os.Symlink("libfoo.so.1", filepath.Join(dest, "usr/lib/libfoo.so"))
+	write("usr/include/foo.h", []byte("int foo(void);\n"), 0644)
+	write("usr/share/doc/foo/README", []byte("foo\n"), 0644)
+
+	out := t.TempDir()
+	var log bytes.Buffer
+	b := &Builder{out: &log}
+	pkgs, err := b.SplitTree(dest, out, &metadata.Metadata{Version: "1.0"}, "foo", 2)
+	if err != nil {
+		t.Fatalf("SplitTree failed: %v", err)
+	}
+	if len(pkgs) != 3 {
+		t.Fatalf("got %d splits, want 3", len(pkgs))
+	}
+
+	want := map[string][]string{
+		"libfoo":  {"usr/lib/libfoo.so.1"},
+		"foo":     {"usr/bin/tool", "usr/share/doc/foo/README"},
+		"foo-dev": {"usr/include/foo.h", "usr/lib/libfoo.so"},
+	}
+	for name, files := range want {
+		for _, rel := range files {
+			if _, err := os.Lstat(filepath.Join(out, name, "data", rel)); err != nil {
+				t.Errorf("%s: %s missing: %v", name, rel, err)
+			}
+		}
+	}
+	bins, err := metadata.Load(filepath.Join(out, "foo", "metadata.json"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if strings.Join(bins.Dependencies, ",") != "libfoo,glibc" {
+		t.Errorf("foo depends on %v, want [libfoo glibc]", bins.Dependencies)
+	}
+
+	results := b.BuildBatch(pkgs, Options{Compression: "zstd", Level: 1, NoCache: true}, 2)
+	for _, r := range results {
+		if r.Err != nil {
+			t.Errorf("build %s: %v", r.Package.Dir, r.Err)
+		} else if _, err := os.Stat(r.Package.Output); err != nil {
+			t.Errorf("%s not built: %v", r.Package.Output, err)
+		}
+	}
+}
+
+func TestBuildSonameIndex(t *testing.T) {
+	libc, _ := filepath.Glob("/lib/*/libc.so.6")
+	if len(libc) == 0 {
+		t.Skip("no host libc")
+	}
+	so, err := os.ReadFile(libc[0])
+	if err != nil {
+		t.Skip("host libc unreadable")
+	}
+	root := t.TempDir()
+	for _, name := range []string{"mylibc", "otherlibc"} {
+		dir := filepath.Join(root, "src", name)
+		os.MkdirAll(filepath.Join(dir, "data", "usr", "lib"), 0755)
+		os.WriteFile(filepath.Join(dir, "metadata.json"), []byte(fmt.Sprintf(`{"name":%q,"version":"1","provides":["libc-%s"]}`, name, name)), 0644)
+		os.WriteFile(filepath.Join(dir, "data", "usr", "lib", "libc.so.6"), so, 0755)
+	}
+	var log bytes.Buffer
+	b := &Builder{out: &log}
+	repo := filepath.Join(root, "repo")
+	os.MkdirAll(repo, 0755)
+	if err := b.CreatePackageWithOptions(filepath.Join(root, "src", "mylibc"), filepath.Join(repo, "mylibc.apg"), Options{Compression: "zstd", Level: 1, NoCache: true}); err != nil {
+		t.Fatal(err)
+	}
+
+	// The repository's package comes first and wins the SONAME; the
+	// source tree still contributes its provides.
+	idx := filepath.Join(root, "soname.idx")
+	if err := b.BuildSonameIndex([]string{repo, filepath.Join(root, "src", "otherlibc")}, idx); err != nil {
+		t.Fatalf("BuildSonameIndex failed: %v", err)
+	}
+	ix, err := elfanalyzer.OpenIndex(idx)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ix.Close()
+	if pkg, ok := ix.Package("libc.so.6"); !ok || pkg != "mylibc" {
+		t.Errorf("libc.so.6 -> %q, %v; want mylibc", pkg, ok)
+	}
+	for _, name := range []string{"mylibc", "otherlibc"} {
+		if pkg, ok := ix.Provider("libc-" + name); !ok || pkg != name {
+			t.Errorf("libc-%s -> %q, %v", name, pkg, ok)
+		}
+	}
+	if !strings.Contains(log.String(), "1 conflicts") {
+		t.Errorf("conflict not reported:\n%s", log.String())
+	}
+}
+
+func TestBuildRepoIndex(t *testing.T) {
+	root := t.TempDir()
+	repo := filepath.Join(root, "repo")
+	os.MkdirAll(filepath.Join(repo, "sub"), 0755)
+	var log bytes.Buffer
+	b := &Builder{out: &log}
+	for i, name := range []string{"zlib", "curl"} {
+		dir := filepath.Join(root, "src", name)
+		os.MkdirAll(filepath.Join(dir, "data"), 0755)
+		os.WriteFile(filepath.Join(dir, "metadata.json"), []byte(fmt.Sprintf(`{"name":%q,"version":"1.%d","description":"big","dependencies":["glibc"]}`, name, i)), 0644)
+		os.WriteFile(filepath.Join(dir, "data", "file"), []byte(name), 0644)
+		out := filepath.Join(repo, name+".apg")
+		if i == 1 {
+			out = filepath.Join(repo, "sub", name+".apg")
+		}
+		if err := b.CreatePackageWithOptions(dir, out, Options{Compression: "zstd", Level: 1, NoCache: true}); err != nil {
+			t.Fatal(err)
+		}
+	}
+	os.WriteFile(filepath.Join(repo, "broken.apg"), []byte("not a package"), 0644)
+
+	idx := filepath.Join(root, "repo.idx")
+	if err := b.BuildRepoIndex(repo, idx, 2); err != nil {
+		t.Fatalf("BuildRepoIndex failed: %v", err)
+	}
+	ix, err := metadata.OpenRepoIndex(idx)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ix.Close()
+	if ix.Len() != 2 {
+		t.Fatalf("%d packages indexed, want 2", ix.Len())
+	}
+	if e := ix.Entry(0); e.Name != "curl" || e.Version != "1.1" || e.File != "sub/curl.apg" || len(e.Dependencies) != 1 {
+		t.Errorf("entry 0: %+v", e)
+	}
+	if !strings.Contains(log.String(), "1 skipped") {
+		t.Errorf("broken package not reported:\n%s", log.String())
+	}
+}
+
+func TestVerifyChecksums_QuietProgress(t *testing.T) {
+	dir := t.TempDir()
+	for i := 0; i < 100; i++ {
+		os.WriteFile(filepath.Join(dir, fmt.Sprintf("f%03d", i)), []byte(fmt.Sprint(i)), 0644)
+	}
+	sums := filepath.Join(t.TempDir(), "sha256sums")
+	var log, bar bytes.Buffer
+	b := &Builder{out: &log, Quiet: true}
+	if err := b.GenerateChecksums(dir, sums); err != nil {
+		t.Fatal(err)
+	}
+	if log.Len() != 0 {
+		t.Errorf("quiet GenerateChecksums printed:\n%s", log.String())
+	}
+
+	os.WriteFile(filepath.Join(dir, "f042"), []byte("changed"), 0644)
+	if err := b.VerifyChecksums(sums, dir); err == nil {
+		t.Error("VerifyChecksums passed a changed file")
+	}
+	if got := strings.TrimSpace(log.String()); !strings.Contains(got, "FAILED f042") || strings.Count(got, "\n") != 0 {
+		t.Errorf("quiet VerifyChecksums should print only the failure, got:\n%s", got)
+	}
+
+	// Without -q, passed files are counted, not listed; the progress line
+	// ends with the final totals.
+	log.Reset()
+	b = &Builder{out: &log, Progress: &bar}
+	b.VerifyChecksums(sums, dir)
+	if strings.Contains(log.String(), "f001") || !strings.Contains(log.String(), "Passed: 99, Failed: 1") {
+		t.Errorf("unexpected output:\n%s", log.String())
+	}
+	if !strings.Contains(bar.String(), "100 files") || !strings.HasSuffix(bar.String(), "\n") {
+		t.Errorf("unexpected progress output %q", bar.String())
+	}
+}
+
+func TestVerifyPackage(t *testing.T) {
+	src := t.TempDir()
+	data := filepath.Join(src, "data", "usr", "share")
+	os.MkdirAll(data, 0755)
+	os.WriteFile(filepath.Join(src, "metadata.json"), []byte(`{"name":"v","version":"1"}`), 0644)
+	os.WriteFile(filepath.Join(data, "a"), []byte("aaa"), 0644)
+	os.WriteFile(filepath.Join(data, "b"), bytes.Repeat([]byte("b"), 3<<20), 0644)
+	os.Link(filepath.Join(data, "a"), filepath.Join(data, "a.link"))
+
+	var log bytes.Buffer
+	b := &Builder{out: &log, Quiet: true}
+	// Sums first (separate pass) and sums last (single pass), in both
+	// algorithms.
+	for _, opts := range []Options{
+		{},
+		{SinglePass: true},
+		{SinglePass: true, Hash: checksum.SHA256Tree},
+		{Seekable: true, Hash: checksum.SHA256Tree},
+	} {
+		opts.Compression, opts.Level, opts.NoCache = "zstd", 1, true
+		pkg := filepath.Join(t.TempDir(), "v.apg")
+		if err := b.CreatePackageWithOptions(src, pkg, opts); err != nil {
+			t.Fatal(err)
+		}
+		if err := b.VerifyPackage(pkg); err != nil {
+			t.Errorf("%+v: VerifyPackage: %v\n%s", opts, err, log.String())
+		}
+	}
+
+	// A package whose sums do not match its data.
+	sums := "0000000000000000000000000000000000000000000000000000000000000000  usr/share/a\n" +
+		"0000000000000000000000000000000000000000000000000000000000000000  usr/share/gone\n"
+	os.WriteFile(filepath.Join(src, "sha256sums"), []byte(sums), 0644)
+	pkg := filepath.Join(t.TempDir(), "bad.apg")
+	if _, err := archive.Create(pkg, src); err != nil {
+		t.Fatal(err)
+	}
+	log.Reset()
+	if err := b.VerifyPackage(pkg); err == nil || !strings.Contains(err.Error(), "2 files") {
+		t.Errorf("expected 2 failures, got %v", err)
+	}
+	if out := log.String(); !strings.Contains(out, "FAILED data/usr/share/a: checksum mismatch") || !strings.Contains(out, "FAILED data/usr/share/gone: not in the package") {
+		t.Errorf("unexpected output:\n%s", out)
+	}
+}
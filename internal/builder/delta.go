@@ -0,0 +1,52 @@
+// Package builder — delta packages between package versions.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"fmt"
+	"os"
+
+	"github.com/NurOS-Linux/apgbuild/internal/delta"
+)
+
+// CreateDelta writes a delta (see package delta) that turns the package
+// oldPkg into newPkg, and prints how it carries the new package.
+func (b *Builder) CreateDelta(oldPkg, newPkg, outputPath string, opts delta.Options) error {
+	b.printf("%sCreating delta: %s -> %s%s\n", ColorCyan, oldPkg, newPkg, ColorReset)
+	res, err := delta.Create(oldPkg, newPkg, outputPath, opts)
+	if err != nil {
+		return fmt.Errorf("failed to create delta: %w", err)
+	}
+	b.printf("%s Delta created: %s (%d bytes)%s\n", ColorGreen, outputPath, res.Size, ColorReset)
+	b.printf("%s  Stored: %d, Patched: %d, Copied: %d, Unchanged: %d, Removed: %d%s\n",
+		ColorGreen, res.Stored, res.Patched, res.Copied, res.Unchanged, res.Removed, ColorReset)
+	return nil
+}
+
+// ApplyDelta applies the delta at deltaPath to base: an extracted package
+// directory, patched in place, or an .apg, rebuilt into outputPath.
+func (b *Builder) ApplyDelta(base, deltaPath, outputPath string, opts delta.ApplyOptions) error {
+	fi, err := os.Stat(base)
+	if err != nil {
+		return err
+	}
+	b.printf("%sApplying delta: %s to %s%s\n", ColorCyan, deltaPath, base, ColorReset)
+	var m *delta.Manifest
+	if fi.IsDir() {
+		if m, err = delta.ApplyTree(base, deltaPath, opts); err != nil {
+			return fmt.Errorf("failed to apply delta: %w", err)
+		}
+		b.printf("%s %s updated: %s %s -> %s%s\n", ColorGreen, base, m.To.Name, m.From.Version, m.To.Version, ColorReset)
+		return nil
+	}
+	if outputPath == "" {
+		return fmt.Errorf("applying a delta to a package needs an output path")
+	}
+	m, result, err := delta.ApplyPackage(base, deltaPath, outputPath, opts)
+	if err != nil {
+		return fmt.Errorf("failed to apply delta: %w", err)
+	}
+	b.printf("%s Rebuilt %s %s: %s%s\n", ColorGreen, m.To.Name, m.To.Version, outputPath, ColorReset)
+	b.printf("%s  Files: %d, Size: %d bytes%s\n", ColorGreen, result.FilesAdded, result.TotalSize, ColorReset)
+	return nil
+}
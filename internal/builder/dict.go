@@ -0,0 +1,60 @@
+// Package builder — zstd dictionary training.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"fmt"
+	"os"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// Sampling limits of TrainDictionary: a dictionary helps small files, and
+// zstd gains little from more than about a thousand times its size.
+const (
+	dictSampleMax   = 128 << 10
+	dictSampleTotal = 128 << 20
+)
+
+// TrainDictionary trains a zstd dictionary of at most size bytes (0 =
+// archive.DefaultDictionarySize) on the small regular files under dirs,
+// usually unpacked package trees of one family, and writes it to outputPath.
+func (b *Builder) TrainDictionary(dirs []string, outputPath string, size int) error {
+	var samples [][]byte
+	var total int64
+	for _, dir := range dirs {
+		tree, err := scan.Scan(dir, scan.Options{})
+		if err != nil {
+			return fmt.Errorf("failed to scan %s: %w", dir, err)
+		}
+		tree.Remove(checksum.CacheName)
+		for i := range tree.Files {
+			f := &tree.Files[i]
+			if !f.Mode.IsRegular() || f.Size == 0 || f.Size > dictSampleMax {
+				continue
+			}
+			if total+f.Size > dictSampleTotal {
+				break
+			}
+			data, err := os.ReadFile(tree.Abs(f))
+			if err != nil {
+				return fmt.Errorf("failed to read sample: %w", err)
+			}
+			samples = append(samples, data)
+			total += int64(len(data))
+		}
+	}
+	b.printf("%sTraining dictionary on %d files (%d bytes)%s\n", ColorCyan, len(samples), total, ColorReset)
+
+	dict, err := archive.TrainDictionary(samples, size)
+	if err != nil {
+		return err
+	}
+	if err := os.WriteFile(outputPath, dict, 0644); err != nil {
+		return fmt.Errorf("failed to write dictionary: %w", err)
+	}
+	b.printf("%s Dictionary %d written to %s (%d bytes)%s\n", ColorGreen, archive.DictionaryID(dict), outputPath, len(dict), ColorReset)
+	return nil
+}
@@ -0,0 +1,133 @@
+// Package builder — up-to-date check for incremental rebuilds.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"encoding/binary"
+	"fmt"
+	"os"
+	"path/filepath"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// stampVersion is bumped whenever the fingerprint input changes.
+const stampVersion = 9
+
+// packageStamp records, in the build cache, which inputs produced which
+// output file. If the fingerprint of the tree and options is unchanged and
+// the output is the file written last time, the build can be skipped.
+type packageStamp struct {
+	fingerprint [32]byte
+	outSize     int64
+	outMtime    int64
+	files       int64
+	totalSize   int64
+}
+
+// generatedFiles are written by the build itself and so are no input.
+var generatedFiles = []struct{ name, dir string }{
+	{"sha256sums", "data"},
+	{"sha256sums.home", "home"},
+}
+
+// fingerprint hashes the stat data of every input entry in tree together
+// with the output path and the options that affect the package bytes.
+// File contents are not read: an edit changes size or mtime, a replaced
+// file changes the inode. stable is false if an entry was modified within
+// checksum.RacyWindow of scanned, the time the scan began: a second write
+// in the same mtime tick would leave the fingerprint unchanged.
+func fingerprint(tree *scan.Tree, outputPath string, opts Options, scanned time.Time) (fp [32]byte, stable bool) {
+	skip := make(map[string]bool, len(generatedFiles))
+	for _, g := range generatedFiles {
+		if f := tree.Lookup(g.dir); f != nil && f.Mode.IsDir() {
+			skip[g.name] = true
+		}
+	}
+
+	h := sha256.New()
+	out, _ := filepath.Abs(outputPath)
+	fmt.Fprintf(h, "apgbuild stamp %d\x00%s\x00%s\x00%d\x00%d\x00%t\x00%t\x00%t\x00%s\x00%t\x00%d\x00%d\x00%s\x00%t\x00%d\x00%d\x00",
+		stampVersion, out, opts.Compression, opts.Level, opts.Threads, opts.Seekable, opts.SinglePass, opts.Dedup,
+		opts.Order, opts.Reproducible, opts.Epoch.Unix(), archive.DictionaryID(opts.Dictionary), opts.Hash, opts.Blobs != nil, opts.Budget,
+		opts.FrameSize)
+
+	stable = true
+	racy := scanned.Add(-checksum.RacyWindow)
+	var rec [56]byte
+	for i := range tree.Files {
+		f := &tree.Files[i]
+		if skip[f.Path] {
+			continue
+		}
+		if f.ModTime.After(racy) {
+			stable = false
+		}
+		h.Write([]byte(f.Path))
+		binary.LittleEndian.PutUint32(rec[0:], uint32(f.Mode))
+		binary.LittleEndian.PutUint64(rec[8:], uint64(f.Size))
+		binary.LittleEndian.PutUint64(rec[16:], uint64(f.ModTime.UnixNano()))
+		binary.LittleEndian.PutUint64(rec[24:], f.Dev)
+		binary.LittleEndian.PutUint64(rec[32:], f.Ino)
+		if st := f.Stat(); st != nil {
+			binary.LittleEndian.PutUint32(rec[40:], st.Uid)
+			binary.LittleEndian.PutUint32(rec[44:], st.Gid)
+		}
+		h.Write(rec[:])
+	}
+
+	copy(fp[:], h.Sum(nil))
+	return fp, stable
+}
+
+// upToDate reports whether cache holds a stamp for fp whose output file
+// is still the one that build wrote.
+func upToDate(cache *checksum.Cache, fp [32]byte, outputPath string) (*archive.CreateResult, bool) {
+	s, ok := decodeStamp(cache.Extra)
+	if !ok || s.fingerprint != fp {
+		return nil, false
+	}
+	info, err := os.Stat(outputPath)
+	if err != nil || info.Size() != s.outSize || info.ModTime().UnixNano() != s.outMtime {
+		return nil, false
+	}
+	return &archive.CreateResult{FilesAdded: int(s.files), TotalSize: s.totalSize}, true
+}
+
+// recordStamp stores the stamp of a finished build in cache.Extra.
+func recordStamp(cache *checksum.Cache, fp [32]byte, outputPath string, result *archive.CreateResult) error {
+	info, err := os.Stat(outputPath)
+	if err != nil {
+		return err
+	}
+	s := packageStamp{
+		fingerprint: fp,
+		outSize:     info.Size(),
+		outMtime:    info.ModTime().UnixNano(),
+		files:       int64(result.FilesAdded),
+		totalSize:   result.TotalSize,
+	}
+	var buf bytes.Buffer
+	binary.Write(&buf, binary.LittleEndian, uint32(stampVersion))
+	buf.Write(s.fingerprint[:])
+	binary.Write(&buf, binary.LittleEndian, []int64{s.outSize, s.outMtime, s.files, s.totalSize})
+	cache.Extra = buf.Bytes()
+	return nil
+}
+
+func decodeStamp(b []byte) (packageStamp, bool) {
+	var s packageStamp
+	if len(b) != 4+32+4*8 || binary.LittleEndian.Uint32(b) != stampVersion {
+		return s, false
+	}
+	copy(s.fingerprint[:], b[4:36])
+	v := make([]int64, 4)
+	binary.Read(bytes.NewReader(b[36:]), binary.LittleEndian, v)
+	s.outSize, s.outMtime, s.files, s.totalSize = v[0], v[1], v[2], v[3]
+	return s, true
+}
@@ -0,0 +1,129 @@
+// Package builder — rate-limited progress line for long file passes.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"fmt"
+	"io"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+// progressInterval is how often the progress line is redrawn.
+const progressInterval = 200 * time.Millisecond
+
+// progress draws one status line (files, bytes, and their rates) for a
+// pass over many files. Workers only bump counters; the line is redrawn
+// from its own goroutine at most every progressInterval, so its cost does
+// not depend on the number of files. A nil *progress does nothing.
+type progress struct {
+	w     io.Writer
+	label string
+	total int64 // files, 0 = unknown
+	start time.Time
+
+	files, bytes atomic.Int64
+
+	mu    sync.Mutex // serializes drawing with logf
+	stop  chan struct{}
+	done  chan struct{}
+	drawn bool
+}
+
+// startProgress starts a progress line on b.Progress for a pass over
+// total files (0 = unknown). It returns nil when b has no progress writer
+// or is quiet.
+func (b *Builder) startProgress(label string, total int) *progress {
+	if b.Progress == nil || b.Quiet {
+		return nil
+	}
+	p := &progress{
+		w:     b.Progress,
+		label: label,
+		total: int64(total),
+		start: time.Now(),
+		stop:  make(chan struct{}),
+		done:  make(chan struct{}),
+	}
+	go func() {
+		defer close(p.done)
+		t := time.NewTicker(progressInterval)
+		defer t.Stop()
+		for {
+			select {
+			case <-t.C:
+				p.mu.Lock()
+				p.draw()
+				p.mu.Unlock()
+			case <-p.stop:
+				return
+			}
+		}
+	}()
+	return p
+}
+
+// add records one finished file of size bytes.
+func (p *progress) add(size int64) {
+	if p != nil {
+		p.files.Add(1)
+		p.bytes.Add(size)
+	}
+}
+
+// hook returns add as a checksum.Options.Progress callback, nil for a nil p.
+func (p *progress) hook() func(int64) {
+	if p == nil {
+		return nil
+	}
+	return p.add
+}
+
+// logf prints a line to w without it being garbled by the progress line,
+// which is redrawn on the next tick.
+func (p *progress) logf(w io.Writer, format string, args ...any) {
+	if p != nil {
+		p.mu.Lock()
+		defer p.mu.Unlock()
+		if p.drawn {
+			io.WriteString(p.w, "\r\033[K")
+			p.drawn = false
+		}
+	}
+	fmt.Fprintf(w, format, args...)
+}
+
+// finish draws the final state and ends the line.
+func (p *progress) finish() {
+	if p == nil {
+		return
+	}
+	close(p.stop)
+	<-p.done
+	p.mu.Lock()
+	p.draw()
+	io.WriteString(p.w, "\n")
+	p.mu.Unlock()
+}
+
+func (p *progress) draw() {
+	files, bytes := p.files.Load(), p.bytes.Load()
+	elapsed := time.Since(p.start)
+	var line strings.Builder
+	fmt.Fprintf(&line, "\r  %-8s ", p.label)
+	if p.total > 0 {
+		const width = 24
+		n := int(files * width / p.total)
+		if n > width {
+			n = width
+		}
+		fmt.Fprintf(&line, "[%s%s] %3d%% %d/%d files", strings.Repeat("#", n), strings.Repeat(".", width-n), files*100/p.total, files, p.total)
+	} else {
+		fmt.Fprintf(&line, "%d files", files)
+	}
+	fmt.Fprintf(&line, "  %s  %s MB/s  %.0f files/s\033[K", fmtBytes(bytes), throughput(bytes, elapsed), float64(files)/elapsed.Seconds())
+	io.WriteString(p.w, line.String())
+	p.drawn = true
+}
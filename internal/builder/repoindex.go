@@ -0,0 +1,65 @@
+// Package builder — binary repository index generation.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+
+	"github.com/NurOS-Linux/apgbuild/internal/metadata"
+)
+
+// BuildRepoIndex writes a repository index (see metadata.OpenRepoIndex) of
+// the .apg files under repoDir to outputPath. Metadata is loaded from the
+// head of each package, on jobs goroutines (0 = number of CPUs); packages
+// that cannot be read are skipped with a warning.
+func (b *Builder) BuildRepoIndex(repoDir, outputPath string, jobs int) error {
+	pkgFiles, err := findPackages(repoDir)
+	if err != nil {
+		return err
+	}
+	w := metadata.NewRepoIndexWriter()
+	skipped := 0
+	err = metadata.LoadPackages(pkgFiles, metadata.RepoFields, jobs, func(i int, m *metadata.Metadata, err error) error {
+		if err == nil && m.Name == "" {
+			err = fmt.Errorf("no package name in metadata.json")
+		}
+		if err != nil {
+			b.warnf("%sWarning: skipping %s: %v%s\n", ColorYellow, pkgFiles[i], err, ColorReset)
+			skipped++
+			return nil
+		}
+		rel, err := filepath.Rel(repoDir, pkgFiles[i])
+		if err != nil {
+			return err
+		}
+		return w.Add(filepath.ToSlash(rel), m)
+	})
+	if err != nil {
+		return err
+	}
+	if err := w.WriteFile(outputPath); err != nil {
+		return fmt.Errorf("failed to write index: %w", err)
+	}
+	b.printf("%s Indexed %d packages (%d skipped) -> %s%s\n", ColorGreen, w.Len(), skipped, outputPath, ColorReset)
+	return nil
+}
+
+// findPackages returns the .apg files under dir, sorted.
+func findPackages(dir string) ([]string, error) {
+	var found []string
+	err := filepath.WalkDir(dir, func(p string, d os.DirEntry, err error) error {
+		if err == nil && d.Type().IsRegular() && strings.HasSuffix(p, ".apg") {
+			found = append(found, p)
+		}
+		return err
+	})
+	if err != nil {
+		return nil, err
+	}
+	sort.Strings(found)
+	return found, nil
+}
@@ -0,0 +1,197 @@
+// Package builder — single-pass packaging: hash while archiving.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"encoding/hex"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"strings"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// hashedTree describes a tree whose files are checksummed into sumsName.
+type hashedTree struct {
+	dir      string // top-level directory inside the package, e.g. "data"
+	sumsName string // sums file written next to it, e.g. "sha256sums"
+	entries  []checksum.Entry
+}
+
+// createSinglePass archives a scanned tree. Every regular file is read a single
+// time and the bytes go both to the archive and, for files under data/ and
+// home/, to a hash state (see Options.Hash). metadata.json is stored first; the sums files
+// are written from the pass and appended as the last members.
+//
+// Symlinks are stored as links and have no sums line, since no data of
+// theirs goes into the archive. Further paths of a multiply linked file are
+// stored as hardlinks and reuse the sum of the first path.
+func (b *Builder) createSinglePass(tree *scan.Tree, outputPath string, opts Options, cache *checksum.Cache) (*archive.CreateResult, error) {
+	sourceDir := tree.Root
+	trees := []*hashedTree{
+		{dir: "data", sumsName: "sha256sums"},
+		{dir: "home", sumsName: "sha256sums.home"},
+	}
+	skip := make(map[string]bool, len(trees))
+	for _, t := range trees {
+		skip[t.sumsName] = true
+	}
+
+	b.printf("%sCreating archive and SHA-256 checksums in a single pass...%s\n", ColorCyan, ColorReset)
+
+	pt := opts.Stats.begin("archive+hash")
+	aw, err := archive.NewWriter(outputPath, opts.archiveOptions())
+	if err != nil {
+		return nil, fmt.Errorf("failed to create archive: %w", err)
+	}
+	removeOutput := func() {
+		if opts.Sink == nil {
+			os.Remove(outputPath)
+		}
+	}
+	closed := false
+	defer func() {
+		if !closed {
+			aw.Close() //nolint:errcheck
+			removeOutput()
+		}
+	}()
+
+	buf := make([]byte, 1<<20)
+	h := checksum.New(opts.Hash)
+	sums := map[string]string{} // member path → sum, for hardlinks
+
+	// metadata.json leads, in a frame of its own for seekable packages.
+	if f := tree.Lookup("metadata.json"); f != nil {
+		if err := aw.AddFile(tree.Abs(f), f.Path); err != nil {
+			return nil, fmt.Errorf("failed to create archive: %w", err)
+		}
+	}
+	skip["metadata.json"] = true
+	if err := aw.EndFrame(); err != nil {
+		return nil, fmt.Errorf("failed to create archive: %w", err)
+	}
+
+	files, _, err := archive.MemberOrder(tree, opts.Order)
+	if err != nil {
+		return nil, fmt.Errorf("failed to create archive: %w", err)
+	}
+	for _, f := range files {
+		if skip[f.Path] {
+			continue
+		}
+		path := tree.Abs(f)
+		size, link, err := aw.WriteHeaderStat(path, f.Path, f.Stat())
+		if err != nil {
+			return nil, fmt.Errorf("failed to create archive: %w", err)
+		}
+		if !f.Mode.IsRegular() {
+			continue
+		}
+
+		var t *hashedTree
+		for _, ht := range trees {
+			if hasPrefixDir(f.Path, ht.dir) {
+				t = ht
+				break
+			}
+		}
+
+		var sum string
+		switch {
+		case link != "":
+			// No data follows; the content is that of the link target.
+			if t == nil {
+				continue
+			}
+			var ok bool
+			if sum, ok = sums[link]; !ok {
+				if sum, err = checksum.CalculateWithOptions(path, checksum.Options{Jobs: 1, Algorithm: opts.Hash}); err != nil {
+					return nil, fmt.Errorf("failed to create checksums: %w", err)
+				}
+			}
+		case t != nil:
+			h.Reset()
+			if err := copyFile(io.MultiWriter(aw, h), path, size, buf); err != nil {
+				return nil, fmt.Errorf("failed to create archive: %w", err)
+			}
+			sum = hex.EncodeToString(h.Sum(nil))
+			if f.Nlink > 1 {
+				sums[f.Path] = sum
+			}
+		default:
+			if err := copyFile(aw, path, size, buf); err != nil {
+				return nil, fmt.Errorf("failed to create archive: %w", err)
+			}
+		}
+
+		if t != nil {
+			cache.Put(f, sum)
+			t.entries = append(t.entries, checksum.Entry{
+				Checksum: sum,
+				Path:     filepath.FromSlash(strings.TrimPrefix(f.Path, t.dir+"/")),
+			})
+		}
+	}
+
+	// Sums files are written from the pass above and go last.
+	for _, t := range trees {
+		if f := tree.Lookup(t.dir); f == nil || !f.Mode.IsDir() {
+			continue
+		}
+		sumsPath := filepath.Join(sourceDir, t.sumsName)
+		if err := checksum.WriteSumsWithOptions(sumsPath, t.entries, checksum.Options{Algorithm: opts.Hash}); err != nil {
+			return nil, fmt.Errorf("failed to create checksums: %w", err)
+		}
+		size, err := aw.WriteHeader(sumsPath, t.sumsName)
+		if err != nil {
+			return nil, fmt.Errorf("failed to create archive: %w", err)
+		}
+		if err := copyFile(aw, sumsPath, size, buf); err != nil {
+			return nil, fmt.Errorf("failed to create archive: %w", err)
+		}
+		b.printf("%sGenerated %d checksums for %s%s\n", ColorGreen, len(t.entries), t.dir, ColorReset)
+	}
+
+	closed = true
+	result, err := aw.Close()
+	if err != nil {
+		removeOutput()
+		return nil, fmt.Errorf("failed to create archive: %w", err)
+	}
+	// Data is read (and hashed) in Go here, inside what the writer sees as
+	// compression time, so there is no separate read figure to report.
+	r := *result
+	r.ReadTime = 0
+	pt.endArchive(&r)
+	return result, nil
+}
+
+// hasPrefixDir reports whether rel lies inside the top-level directory dir.
+func hasPrefixDir(rel, dir string) bool {
+	return strings.HasPrefix(rel, dir+"/")
+}
+
+// copyFile streams exactly size bytes of path into dst using buf.
+// The archive header already promised size bytes, so a file that changed
+// length while the build was running is an error rather than a short entry.
+func copyFile(dst io.Writer, path string, size int64, buf []byte) error {
+	f, err := os.Open(path)
+	if err != nil {
+		return fmt.Errorf("open file: %w", err)
+	}
+	defer f.Close()
+
+	n, err := io.CopyBuffer(dst, io.LimitReader(f, size), buf)
+	if err != nil {
+		return fmt.Errorf("read %s: %w", path, err)
+	}
+	if n != size {
+		return fmt.Errorf("read %s: file changed size during build", path)
+	}
+	return nil
+}
@@ -0,0 +1,163 @@
+// Package builder — SONAME index generation from repository packages.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"bytes"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"path"
+	"path/filepath"
+	"strings"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/elfanalyzer"
+	"github.com/NurOS-Linux/apgbuild/internal/metadata"
+)
+
+// maxIndexedObject bounds the size of a package member read into memory
+// to look for a SONAME.
+const maxIndexedObject = 256 << 20
+
+// indexedPackage is what one package contributes to a SONAME index.
+type indexedPackage struct {
+	name     string
+	sonames  []string
+	provides []string
+}
+
+// BuildSonameIndex writes a SONAME index (see elfanalyzer.OpenIndex) for
+// the packages in inputs: .apg files, package source directories (with
+// metadata.json) or directories searched for .apg files, e.g. a
+// repository. When two packages claim a name, the first one wins.
+func (b *Builder) BuildSonameIndex(inputs []string, outputPath string) error {
+	var pkgFiles []string
+	for _, in := range inputs {
+		fi, err := os.Stat(in)
+		if err != nil {
+			return err
+		}
+		if !fi.IsDir() {
+			pkgFiles = append(pkgFiles, in)
+			continue
+		}
+		if _, err := os.Stat(filepath.Join(in, "metadata.json")); err == nil {
+			pkgFiles = append(pkgFiles, in)
+			continue
+		}
+		found, err := findPackages(in)
+		if err != nil {
+			return err
+		}
+		pkgFiles = append(pkgFiles, found...)
+	}
+
+	e := elfanalyzer.IndexEntries{Sonames: map[string]string{}, Provides: map[string]string{}}
+	conflicts := 0
+	add := func(m map[string]string, key, pkg string) {
+		if prev, ok := m[key]; !ok {
+			m[key] = pkg
+		} else if prev != pkg {
+			conflicts++
+		}
+	}
+	for _, p := range pkgFiles {
+		var ip *indexedPackage
+		var err error
+		if fi, _ := os.Stat(p); fi != nil && fi.IsDir() {
+			ip, err = indexTree(p)
+		} else {
+			ip, err = indexArchive(p)
+		}
+		if err != nil {
+			b.warnf("%sWarning: skipping %s: %v%s\n", ColorYellow, p, err, ColorReset)
+			continue
+		}
+		for _, s := range ip.sonames {
+			add(e.Sonames, s, ip.name)
+		}
+		for _, s := range ip.provides {
+			add(e.Provides, s, ip.name)
+		}
+	}
+
+	if err := elfanalyzer.WriteIndex(outputPath, e); err != nil {
+		return fmt.Errorf("failed to write index: %w", err)
+	}
+	b.printf("%s Indexed %d packages: %d SONAMEs, %d provides (%d conflicts, first kept) -> %s%s\n",
+		ColorGreen, len(pkgFiles), len(e.Sonames), len(e.Provides), conflicts, outputPath, ColorReset)
+	return nil
+}
+
+// indexTree reads a package source directory.
+func indexTree(dir string) (*indexedPackage, error) {
+	meta, err := metadata.Load(filepath.Join(dir, "metadata.json"))
+	if err != nil {
+		return nil, err
+	}
+	ip := &indexedPackage{name: meta.Name, provides: meta.Provides}
+	data := filepath.Join(dir, "data")
+	if _, err := os.Stat(data); err != nil {
+		return ip, nil
+	}
+	objs, err := elfanalyzer.ScanDir(data, elfanalyzer.ScanOptions{})
+	if err != nil {
+		return nil, err
+	}
+	for _, o := range objs {
+		if o.Soname != "" {
+			ip.sonames = append(ip.sonames, o.Soname)
+		}
+	}
+	return ip, nil
+}
+
+// indexArchive reads an .apg in one pass: metadata.json, and the SONAME
+// of every regular member that looks like a shared object.
+func indexArchive(pkgPath string) (*indexedPackage, error) {
+	ar, err := archive.OpenReader(pkgPath)
+	if err != nil {
+		return nil, err
+	}
+	defer ar.Close()
+
+	ip := &indexedPackage{}
+	var buf []byte
+	for {
+		e, err := ar.Next()
+		if errors.Is(err, io.EOF) {
+			break
+		}
+		if err != nil {
+			return nil, err
+		}
+		if e.Type != archive.TypeRegular {
+			continue
+		}
+		switch base := path.Base(e.Path); {
+		case e.Path == "metadata.json":
+			var meta metadata.Metadata
+			if err := metadata.NewLoader(metadata.FieldName|metadata.FieldProvides).Read(ar, &meta); err != nil {
+				return nil, err
+			}
+			ip.name, ip.provides = meta.Name, meta.Provides
+		case strings.Contains(base, ".so") && e.Size > 0 && e.Size <= maxIndexedObject:
+			if int64(cap(buf)) < e.Size {
+				buf = make([]byte, e.Size)
+			}
+			obj := buf[:e.Size]
+			if _, err := io.ReadFull(ar, obj); err != nil {
+				return nil, err
+			}
+			if o, err := elfanalyzer.ReadELF(bytes.NewReader(obj), e.Path); err == nil && o.Soname != "" {
+				ip.sonames = append(ip.sonames, o.Soname)
+			}
+		}
+	}
+	if ip.name == "" {
+		return nil, fmt.Errorf("no package name in metadata.json")
+	}
+	return ip, nil
+}
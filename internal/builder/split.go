@@ -0,0 +1,119 @@
+// Package builder — lib/bin/dev split trees from one DESTDIR.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"fmt"
+	"io"
+	"os"
+	"path"
+	"path/filepath"
+
+	"github.com/NurOS-Linux/apgbuild/internal/metadata"
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// SplitTree partitions destDir into its libs, bins and dev sub-packages
+// (see metadata.GenerateSplits) from a single scan and ELF pass. Each
+// becomes a package source directory outDir/<name> holding metadata.json
+// and data/, whose files are hardlinked to destDir where possible. An
+// existing outDir/<name>/data is replaced. The returned packages build to
+// outDir/<name>.apg, e.g. with BuildBatch.
+func (b *Builder) SplitTree(destDir, outDir string, base *metadata.Metadata, baseName string, jobs int) ([]BatchPackage, error) {
+	tree, err := scan.Scan(destDir, scan.Options{DetectELF: true, Jobs: jobs})
+	if err != nil {
+		return nil, fmt.Errorf("failed to scan %s: %w", destDir, err)
+	}
+	splits, err := metadata.GenerateSplits(base, tree, baseName, jobs)
+	if err != nil {
+		return nil, fmt.Errorf("generate split metadata: %w", err)
+	}
+	if len(splits) == 0 {
+		return nil, fmt.Errorf("nothing to split in %s", destDir)
+	}
+
+	var pkgs []BatchPackage
+	for _, s := range splits {
+		dir := filepath.Join(outDir, s.Meta.Name)
+		data := filepath.Join(dir, "data")
+		if err := os.RemoveAll(data); err != nil {
+			return nil, fmt.Errorf("failed to clear %s: %w", data, err)
+		}
+		if err := os.MkdirAll(data, 0755); err != nil {
+			return nil, fmt.Errorf("failed to create %s: %w", data, err)
+		}
+		for _, rel := range s.Files {
+			if err := placeFile(tree, rel, data); err != nil {
+				return nil, fmt.Errorf("failed to populate %s split: %w", s.Kind, err)
+			}
+		}
+		if err := s.Meta.Save(filepath.Join(dir, "metadata.json")); err != nil {
+			return nil, err
+		}
+		b.printf("%s %s split: %s (%d files, depends on %v)%s\n", ColorGreen, s.Kind, s.Meta.Name, len(s.Files), s.Meta.Dependencies, ColorReset)
+		pkgs = append(pkgs, BatchPackage{Dir: dir, Output: filepath.Join(outDir, s.Meta.Name+".apg")})
+	}
+	return pkgs, nil
+}
+
+// placeFile recreates tree entry rel below data: parent directories with
+// their source permissions, symlinks as symlinks, other files as hardlinks
+// (copies across filesystems).
+func placeFile(tree *scan.Tree, rel, data string) error {
+	if err := placeDirs(tree, path.Dir(rel), data); err != nil {
+		return err
+	}
+	f := tree.Lookup(rel)
+	src, dst := tree.Abs(f), filepath.Join(data, filepath.FromSlash(rel))
+	if f.Mode&os.ModeSymlink != 0 {
+		target, err := os.Readlink(src)
+		if err != nil {
+			return err
+		}
+		return os.Symlink(target, dst)
+	}
+	if err := os.Link(src, dst); err == nil || !f.Mode.IsRegular() {
+		return err
+	}
+	return copyRegular(src, dst, f.Mode.Perm())
+}
+
+// placeDirs creates dir (relative to the tree) and its parents below data.
+func placeDirs(tree *scan.Tree, dir, data string) error {
+	if dir == "." {
+		return nil
+	}
+	dst := filepath.Join(data, filepath.FromSlash(dir))
+	if _, err := os.Lstat(dst); err == nil {
+		return nil
+	}
+	if err := placeDirs(tree, path.Dir(dir), data); err != nil {
+		return err
+	}
+	// The owner keeps write access so the split can be filled in.
+	perm := os.FileMode(0755)
+	if f := tree.Lookup(dir); f != nil {
+		perm = f.Mode.Perm() | 0700
+	}
+	if err := os.Mkdir(dst, 0700); err != nil {
+		return err
+	}
+	return os.Chmod(dst, perm)
+}
+
+func copyRegular(src, dst string, perm os.FileMode) error {
+	in, err := os.Open(src)
+	if err != nil {
+		return err
+	}
+	defer in.Close()
+	out, err := os.OpenFile(dst, os.O_WRONLY|os.O_CREATE|os.O_EXCL, perm)
+	if err != nil {
+		return err
+	}
+	if _, err := io.Copy(out, in); err != nil {
+		out.Close()
+		return err
+	}
+	return out.Close()
+}
@@ -0,0 +1,172 @@
+// Package builder — per-phase build statistics.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"encoding/json"
+	"fmt"
+	"io"
+	"syscall"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+)
+
+// Phase is the cost of one build stage. Sub-phases (Parent set) split the
+// wall time of their parent and carry no CPU time of their own.
+type Phase struct {
+	Name   string        `json:"name"`
+	Parent string        `json:"parent,omitempty"`
+	Wall   time.Duration `json:"wall_ns"`
+	CPU    time.Duration `json:"cpu_ns,omitempty"` // user+system, all threads
+	Bytes  int64         `json:"bytes"`
+}
+
+// BuildStats collects where a CreatePackageWithOptions call spent its time.
+type BuildStats struct {
+	Phases       []Phase       `json:"phases"`
+	Wall         time.Duration `json:"wall_ns"`
+	CPU          time.Duration `json:"cpu_ns"`
+	Files        int           `json:"files"`
+	DataBytes    int64         `json:"data_bytes"`
+	TarBytes     int64         `json:"tar_bytes"`
+	PackageBytes int64         `json:"package_bytes"`
+	Hardlinks    int           `json:"hardlinks,omitempty"`
+	LinkedBytes  int64         `json:"linked_bytes,omitempty"`
+	BlobHits     int           `json:"blob_hits,omitempty"`
+	BlobMisses   int           `json:"blob_misses,omitempty"`
+	UpToDate     bool          `json:"up_to_date"`
+}
+
+// phaseTimer measures one phase; a nil timer (stats disabled) does nothing.
+type phaseTimer struct {
+	s    *BuildStats
+	name string
+	wall time.Time
+	cpu  time.Duration
+}
+
+func (s *BuildStats) begin(name string) *phaseTimer {
+	if s == nil {
+		return nil
+	}
+	return &phaseTimer{s: s, name: name, wall: time.Now(), cpu: cpuTime()}
+}
+
+func (t *phaseTimer) end(bytes int64) {
+	if t == nil {
+		return
+	}
+	p := Phase{Name: t.name, Wall: time.Since(t.wall), CPU: cpuTime() - t.cpu, Bytes: bytes}
+	t.s.Phases = append(t.s.Phases, p)
+	t.s.Wall += p.Wall
+	t.s.CPU += p.CPU
+}
+
+// endArchive closes an archive phase and splits it into read, compress and
+// write using the writer's own accounting.
+func (t *phaseTimer) endArchive(r *archive.CreateResult) {
+	if t == nil {
+		return
+	}
+	t.end(r.TarSize)
+	s := t.s
+	s.Files, s.DataBytes = r.FilesAdded, r.TotalSize
+	s.TarBytes, s.PackageBytes = r.TarSize, r.CompressedSize
+	s.Hardlinks, s.LinkedBytes = r.Hardlinks, r.LinkedSize
+	s.BlobHits, s.BlobMisses = r.BlobHits, r.BlobMisses
+
+	compress := r.Duration - r.ReadTime - r.WriteTime
+	if compress < 0 {
+		compress = 0
+	}
+	if r.ReadTime > 0 {
+		s.Phases = append(s.Phases, Phase{Name: "read", Parent: t.name, Wall: r.ReadTime, Bytes: r.TotalSize})
+	}
+	s.Phases = append(s.Phases,
+		Phase{Name: "compress", Parent: t.name, Wall: compress, Bytes: r.TarSize},
+		Phase{Name: "write", Parent: t.name, Wall: r.WriteTime, Bytes: r.CompressedSize})
+}
+
+// cpuTime returns the CPU time used by the process so far.
+func cpuTime() time.Duration {
+	var ru syscall.Rusage
+	if err := syscall.Getrusage(syscall.RUSAGE_SELF, &ru); err != nil {
+		return 0
+	}
+	return time.Duration(ru.Utime.Nano() + ru.Stime.Nano())
+}
+
+// WriteText prints the statistics as a table.
+func (s *BuildStats) WriteText(w io.Writer) {
+	fmt.Fprintf(w, "Build statistics:\n")
+	fmt.Fprintf(w, "  %-12s %10s %10s %12s %10s\n", "phase", "wall", "cpu", "bytes", "MB/s")
+	for _, p := range s.Phases {
+		name := p.Name
+		if p.Parent != "" {
+			name = "  " + name
+		}
+		cpu := "-"
+		if p.Parent == "" {
+			cpu = fmtDuration(p.CPU)
+		}
+		fmt.Fprintf(w, "  %-12s %10s %10s %12s %10s\n", name, fmtDuration(p.Wall), cpu, fmtBytes(p.Bytes), throughput(p.Bytes, p.Wall))
+	}
+	fmt.Fprintf(w, "  %-12s %10s %10s\n", "total", fmtDuration(s.Wall), fmtDuration(s.CPU))
+	if s.UpToDate {
+		fmt.Fprintf(w, "  package up to date, nothing rebuilt\n")
+		return
+	}
+	ratio := 0.0
+	if s.TarBytes > 0 {
+		ratio = 100 * float64(s.PackageBytes) / float64(s.TarBytes)
+	}
+	fmt.Fprintf(w, "  %d entries, %s data, %s tar -> %s package (%.1f%%)\n",
+		s.Files, fmtBytes(s.DataBytes), fmtBytes(s.TarBytes), fmtBytes(s.PackageBytes), ratio)
+	if s.Hardlinks > 0 {
+		fmt.Fprintf(w, "  %d hardlinks, %s not stored again\n", s.Hardlinks, fmtBytes(s.LinkedBytes))
+	}
+	if s.BlobHits+s.BlobMisses > 0 {
+		fmt.Fprintf(w, "  %d files spliced from the blob store, %d compressed into it\n", s.BlobHits, s.BlobMisses)
+	}
+}
+
+// WriteJSON prints the statistics as one JSON object.
+func (s *BuildStats) WriteJSON(w io.Writer) error {
+	enc := json.NewEncoder(w)
+	enc.SetIndent("", "  ")
+	return enc.Encode(s)
+}
+
+func fmtDuration(d time.Duration) string {
+	switch {
+	case d >= time.Second:
+		return fmt.Sprintf("%.2fs", d.Seconds())
+	case d >= time.Millisecond:
+		return fmt.Sprintf("%.1fms", float64(d)/float64(time.Millisecond))
+	default:
+		return fmt.Sprintf("%dµs", d.Microseconds())
+	}
+}
+
+func fmtBytes(n int64) string {
+	switch {
+	case n <= 0:
+		return "-"
+	case n >= 1<<30:
+		return fmt.Sprintf("%.2f GiB", float64(n)/(1<<30))
+	case n >= 1<<20:
+		return fmt.Sprintf("%.1f MiB", float64(n)/(1<<20))
+	case n >= 1<<10:
+		return fmt.Sprintf("%.1f KiB", float64(n)/(1<<10))
+	default:
+		return fmt.Sprintf("%d B", n)
+	}
+}
+
+func throughput(n int64, d time.Duration) string {
+	if n <= 0 || d <= 0 {
+		return "-"
+	}
+	return fmt.Sprintf("%.1f", float64(n)/d.Seconds()/1e6)
+}
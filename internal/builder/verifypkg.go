@@ -0,0 +1,209 @@
+// Package builder — verification of a package straight from its archive.
+// NurOS 2026 - GPL 3.0
+package builder
+
+import (
+	"crypto/sha256"
+	"encoding/hex"
+	"errors"
+	"fmt"
+	"hash"
+	"io"
+	"path/filepath"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+)
+
+// memberSums are the digests of one archive member, in the algorithm of
+// its sums file, or in both if it came before the sums file.
+type memberSums struct{ sha256, tree string }
+
+func (m memberSums) in(a checksum.Algorithm) string {
+	if a == checksum.SHA256Tree {
+		return m.tree
+	}
+	return m.sha256
+}
+
+// packageTree is a directory of a package and what its sums file expects.
+type packageTree struct {
+	dir  string
+	sums *checksum.Sums    // nil until the sums file is read
+	want map[string]string // member path → sum, until the member is checked
+}
+
+// VerifyPackage checks the files of an .apg against the sha256sums and
+// sha256sums.home stored in it. The archive is read once and every member
+// is hashed as it is decompressed; nothing is written to disk. Failures
+// are printed as they are found; passed files are only counted.
+//
+// Members stored before their sums file (--single-pass packages put the
+// sums last) are hashed in both algorithms, since the header naming the
+// right one has not been read yet.
+func (b *Builder) VerifyPackage(pkgPath string) error {
+	return b.VerifyPackageWithOptions(pkgPath, checksum.Options{})
+}
+
+// VerifyPackageWithOptions is VerifyPackage with the frames of a seekable
+// package decompressed on opts.Jobs threads (0 = number of CPUs); members
+// are still hashed in archive order.
+func (b *Builder) VerifyPackageWithOptions(pkgPath string, opts checksum.Options) error {
+	b.printf("%sVerifying package: %s%s\n", ColorCyan, pkgPath, ColorReset)
+
+	threads := opts.Jobs
+	if threads <= 0 {
+		threads = archive.ThreadsAuto
+	}
+	ar, err := archive.OpenReaderWithOptions(pkgPath, archive.ReadOptions{Threads: threads})
+	if err != nil {
+		return fmt.Errorf("verification failed: %w", err)
+	}
+	defer ar.Close()
+
+	bar := b.startProgress("verify", 0)
+	defer func() { bar.finish() }()
+	passed, failed := 0, 0
+	report := func(member string, err error) {
+		if err != nil {
+			failed++
+			bar.logf(b.writer(), "%s  FAILED %s: %v%s\n", ColorRed, member, err, ColorReset)
+		} else {
+			passed++
+		}
+	}
+
+	var trees []*packageTree
+	bySums := map[string]*packageTree{}
+	for _, g := range generatedFiles {
+		t := &packageTree{dir: g.dir}
+		trees = append(trees, t)
+		bySums[g.name] = t
+	}
+	treeOf := func(member string) *packageTree {
+		for _, t := range trees {
+			if hasPrefixDir(member, t.dir) {
+				return t
+			}
+		}
+		return nil
+	}
+	check := func(t *packageTree, member string, got memberSums) {
+		want, ok := t.want[member]
+		if !ok {
+			return
+		}
+		delete(t.want, member)
+		if got.in(t.sums.Algorithm) != want {
+			report(member, checksum.ErrMismatch)
+		} else {
+			report(member, nil)
+		}
+	}
+
+	digests := map[string]memberSums{} // for hardlinks and members before their sums
+	buf := make([]byte, 1<<20)
+	for {
+		e, err := ar.Next()
+		if errors.Is(err, io.EOF) {
+			break
+		}
+		if err != nil {
+			return fmt.Errorf("verification failed: %w", err)
+		}
+
+		if t := bySums[e.Path]; t != nil && e.Type == archive.TypeRegular {
+			if t.sums, err = checksum.ReadSums(ar); err != nil {
+				return fmt.Errorf("verification failed: %s: %w", e.Path, err)
+			}
+			t.want = make(map[string]string, len(t.sums.Entries))
+			for _, s := range t.sums.Entries {
+				t.want[t.dir+"/"+filepath.ToSlash(s.Path)] = s.Checksum
+			}
+			for _, s := range t.sums.Entries {
+				member := t.dir + "/" + filepath.ToSlash(s.Path)
+				if got, ok := digests[member]; ok {
+					check(t, member, got)
+				}
+			}
+			continue
+		}
+
+		t := treeOf(e.Path)
+		if t == nil {
+			continue
+		}
+		var got memberSums
+		switch e.Type {
+		case archive.TypeHardlink:
+			var ok bool
+			if got, ok = digests[e.Linkname]; !ok {
+				if _, wanted := t.want[e.Path]; wanted {
+					delete(t.want, e.Path)
+					report(e.Path, fmt.Errorf("hardlink target %s is not in the package", e.Linkname))
+				}
+				continue
+			}
+		case archive.TypeRegular:
+			if got, err = hashMember(ar, t.sums, buf); err != nil {
+				return fmt.Errorf("verification failed: %s: %w", e.Path, err)
+			}
+			bar.add(e.Size)
+		default:
+			continue
+		}
+		digests[e.Path] = got
+		if t.sums != nil {
+			check(t, e.Path, got)
+		}
+	}
+
+	found := false
+	for _, t := range trees {
+		if t.sums == nil {
+			continue
+		}
+		found = true
+		for _, s := range t.sums.Entries {
+			member := t.dir + "/" + filepath.ToSlash(s.Path)
+			if _, ok := t.want[member]; ok {
+				delete(t.want, member)
+				report(member, errors.New("not in the package"))
+			}
+		}
+	}
+	bar.finish()
+	bar = nil
+	if !found {
+		return fmt.Errorf("verification failed: no sha256sums in %s", pkgPath)
+	}
+
+	b.printf("%sPassed: %d, Failed: %d%s\n", ColorCyan, passed, failed, ColorReset)
+	if failed > 0 {
+		return fmt.Errorf("%d files failed verification", failed)
+	}
+	return nil
+}
+
+// hashMember hashes the rest of the current member of ar in the algorithm
+// of sums, or in both algorithms while sums is nil.
+func hashMember(ar *archive.Reader, sums *checksum.Sums, buf []byte) (memberSums, error) {
+	if sums != nil {
+		h := sums.New()
+		if _, err := io.CopyBuffer(h, ar, buf); err != nil {
+			return memberSums{}, err
+		}
+		var m memberSums
+		if sums.Algorithm == checksum.SHA256Tree {
+			m.tree = hex.EncodeToString(h.Sum(nil))
+		} else {
+			m.sha256 = hex.EncodeToString(h.Sum(nil))
+		}
+		return m, nil
+	}
+	hs := []hash.Hash{sha256.New(), checksum.New(checksum.SHA256Tree)}
+	if _, err := io.CopyBuffer(io.MultiWriter(hs[0], hs[1]), ar, buf); err != nil {
+		return memberSums{}, err
+	}
+	return memberSums{hex.EncodeToString(hs[0].Sum(nil)), hex.EncodeToString(hs[1].Sum(nil))}, nil
+}
@@ -0,0 +1,243 @@
+// Package checksum — hash algorithms of sums files and tree hashing.
+// NurOS 2026 - GPL 3.0
+package checksum
+
+import (
+	"crypto/sha256"
+	"encoding/binary"
+	"encoding/hex"
+	"fmt"
+	"hash"
+	"io"
+	"os"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+)
+
+// Algorithm names the content hash of a sums file.
+type Algorithm string
+
+const (
+	// SHA256 is plain SHA-256, compatible with sha256sum(1). Sums files
+	// in this algorithm have no header.
+	SHA256 Algorithm = "sha256"
+	// SHA256Tree splits a file into TreeChunk-sized chunks, hashes them
+	// with SHA-256 independently and takes the SHA-256 of the chunk
+	// digests followed by the file size (8 bytes, little endian). Chunks
+	// of one large file are hashed on several cores.
+	SHA256Tree Algorithm = "sha256-tree"
+)
+
+// TreeChunk is the default chunk size of SHA256Tree.
+const TreeChunk = 4 << 20
+
+// readBufSize is the read size of the hashing loops. crypto/sha256 uses
+// the SHA-NI and ARMv8 SHA2 instructions where the CPU has them, so the
+// per-read overhead of a small buffer would dominate.
+const readBufSize = 1 << 20
+
+// sumsHeader starts the first line of a sums file not in SHA256.
+const sumsHeader = "# apg-sums "
+
+// ParseAlgorithm parses an algorithm name ("" = SHA256).
+func ParseAlgorithm(s string) (Algorithm, error) {
+	switch a := Algorithm(s); a {
+	case "":
+		return SHA256, nil
+	case SHA256, SHA256Tree:
+		return a, nil
+	}
+	return "", fmt.Errorf("unknown hash algorithm %q (want %s or %s)", s, SHA256, SHA256Tree)
+}
+
+func (a Algorithm) orDefault() Algorithm {
+	if a == "" {
+		return SHA256
+	}
+	return a
+}
+
+// New returns a streaming hash of algorithm a with the default chunk size.
+// Its Sum equals what CalculateWithOptions returns for the same bytes.
+func New(a Algorithm) hash.Hash {
+	if a == SHA256Tree {
+		return newTreeHash(TreeChunk)
+	}
+	return sha256.New()
+}
+
+var bufPool = sync.Pool{New: func() any { b := make([]byte, readBufSize); return &b }}
+
+// ── Tree hash ───────────────────────────────────────────────────────────────
+
+// treeHash computes SHA256Tree sequentially from a stream.
+type treeHash struct {
+	chunk  int64
+	leaf   hash.Hash // current chunk
+	inLeaf int64
+	size   int64
+	leaves []byte // digests of finished chunks
+}
+
+func newTreeHash(chunk int64) *treeHash {
+	return &treeHash{chunk: chunk, leaf: sha256.New()}
+}
+
+func (t *treeHash) Write(p []byte) (int, error) {
+	n := len(p)
+	for len(p) > 0 {
+		k := int64(len(p))
+		if r := t.chunk - t.inLeaf; k > r {
+			k = r
+		}
+		t.leaf.Write(p[:k])
+		t.inLeaf += k
+		t.size += k
+		p = p[k:]
+		if t.inLeaf == t.chunk {
+			t.leaves = t.leaf.Sum(t.leaves)
+			t.leaf.Reset()
+			t.inLeaf = 0
+		}
+	}
+	return n, nil
+}
+
+func (t *treeHash) Sum(b []byte) []byte {
+	root := sha256.New()
+	root.Write(t.leaves)
+	if t.inLeaf > 0 {
+		root.Write(t.leaf.Sum(nil))
+	}
+	return appendRoot(root, t.size, b)
+}
+
+func (t *treeHash) Reset() {
+	t.leaf.Reset()
+	t.leaves = t.leaves[:0]
+	t.inLeaf, t.size = 0, 0
+}
+
+func (t *treeHash) Size() int      { return sha256.Size }
+func (t *treeHash) BlockSize() int { return sha256.BlockSize }
+
+// appendRoot finishes a root hash over the chunk digests.
+func appendRoot(root hash.Hash, size int64, b []byte) []byte {
+	var n [8]byte
+	binary.LittleEndian.PutUint64(n[:], uint64(size))
+	root.Write(n[:])
+	return root.Sum(b)
+}
+
+// treeFile hashes f of size bytes in SHA256Tree with chunks of chunk
+// bytes. Besides the calling goroutine, chunks are hashed by helpers that
+// each take a token from helpers at start; with no token free (or nil
+// helpers) the file is hashed by fewer goroutines, down to this one.
+func treeFile(f *os.File, size, chunk int64, helpers Slots) (string, error) {
+	n := (size + chunk - 1) / chunk
+	leaves := make([]byte, n*sha256.Size)
+	var next atomic.Int64
+	var failed atomic.Bool
+	var errOnce sync.Once
+	var ferr error
+	work := func() {
+		h := sha256.New()
+		bp := bufPool.Get().(*[]byte)
+		defer bufPool.Put(bp)
+		buf := *bp
+		for {
+			i := next.Add(1) - 1
+			if i >= n || failed.Load() {
+				return
+			}
+			off, end := i*chunk, (i+1)*chunk
+			if end > size {
+				end = size
+			}
+			h.Reset()
+			for off < end {
+				k := int64(len(buf))
+				if k > end-off {
+					k = end - off
+				}
+				m, err := f.ReadAt(buf[:k], off)
+				h.Write(buf[:m])
+				off += int64(m)
+				if err != nil && (err != io.EOF || off < end) {
+					if err == io.EOF {
+						err = io.ErrUnexpectedEOF // file shrank
+					}
+					errOnce.Do(func() { ferr = err })
+					failed.Store(true)
+					return
+				}
+			}
+			h.Sum(leaves[i*sha256.Size : i*sha256.Size])
+		}
+	}
+
+	var wg sync.WaitGroup
+spawn:
+	for w := int64(1); w < n && helpers != nil; w++ {
+		select {
+		case <-helpers:
+		default:
+			break spawn // none free: go on with what we have
+		}
+		wg.Add(1)
+		go func() {
+			defer func() { helpers <- struct{}{}; wg.Done() }()
+			work()
+		}()
+	}
+	work()
+	wg.Wait()
+	if ferr != nil {
+		return "", ferr
+	}
+	root := sha256.New()
+	root.Write(leaves)
+	return hex.EncodeToString(appendRoot(root, size, nil)), nil
+}
+
+// ── Sums file header ────────────────────────────────────────────────────────
+
+// header returns the first line of a sums file in opts' algorithm, or ""
+// for SHA256.
+func (o Options) header() string {
+	if o.Algorithm.orDefault() == SHA256 {
+		return ""
+	}
+	return fmt.Sprintf("%salgorithm=%s chunk=%d\n", sumsHeader, o.Algorithm, o.chunkSize())
+}
+
+// parseHeader applies a sums file header line to o.
+func (o *Options) parseHeader(line string) error {
+	for _, kv := range strings.Fields(strings.TrimPrefix(line, sumsHeader)) {
+		k, v, _ := strings.Cut(kv, "=")
+		switch k {
+		case "algorithm":
+			a, err := ParseAlgorithm(v)
+			if err != nil {
+				return err
+			}
+			o.Algorithm = a
+		case "chunk":
+			n, err := strconv.ParseInt(v, 10, 64)
+			if err != nil || n < 1<<10 || n > 1<<30 {
+				return fmt.Errorf("bad chunk size %q", v)
+			}
+			o.chunk = n
+		}
+	}
+	return nil
+}
+
+func (o Options) chunkSize() int64 {
+	if o.chunk > 0 {
+		return o.chunk
+	}
+	return TreeChunk
+}
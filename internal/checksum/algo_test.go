@@ -0,0 +1,145 @@
+// Package checksum — hash algorithm tests.
+// NurOS 2026 - GPL 3.0
+package checksum
+
+import (
+	"crypto/sha256"
+	"encoding/binary"
+	"encoding/hex"
+	"errors"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+)
+
+// treeReference computes SHA256Tree from its definition.
+func treeReference(data []byte, chunk int) string {
+	root := sha256.New()
+	for off := 0; off < len(data); off += chunk {
+		end := off + chunk
+		if end > len(data) {
+			end = len(data)
+		}
+		leaf := sha256.Sum256(data[off:end])
+		root.Write(leaf[:])
+	}
+	var n [8]byte
+	binary.LittleEndian.PutUint64(n[:], uint64(len(data)))
+	root.Write(n[:])
+	return hex.EncodeToString(root.Sum(nil))
+}
+
+func TestSHA256Tree_MatchesDefinition(t *testing.T) {
+	dir := t.TempDir()
+	data := make([]byte, 2*TreeChunk+12345)
+	rand.New(rand.NewSource(1)).Read(data)
+
+	for _, size := range []int{0, 100, TreeChunk, len(data)} {
+		path := filepath.Join(dir, "f")
+		os.WriteFile(path, data[:size], 0644)
+		want := treeReference(data[:size], TreeChunk)
+
+		for _, jobs := range []int{1, 4} {
+			got, err := CalculateWithOptions(path, Options{Jobs: jobs, Algorithm: SHA256Tree})
+			if err != nil {
+				t.Fatal(err)
+			}
+			if got != want {
+				t.Errorf("size %d, %d jobs: got %s, want %s", size, jobs, got, want)
+			}
+		}
+
+		// The streaming hash, fed in odd pieces, agrees.
+		h := New(SHA256Tree)
+		for p := data[:size]; len(p) > 0; {
+			k := 777777
+			if k > len(p) {
+				k = len(p)
+			}
+			h.Write(p[:k])
+			p = p[k:]
+		}
+		if got := hex.EncodeToString(h.Sum(nil)); got != want {
+			t.Errorf("size %d, streaming: got %s, want %s", size, got, want)
+		}
+	}
+
+	// Plain SHA-256 is unchanged.
+	plain, _ := Calculate(filepath.Join(dir, "f"))
+	if want := sha256.Sum256(data); plain != hex.EncodeToString(want[:]) {
+		t.Error("Calculate no longer matches sha256sum")
+	}
+}
+
+func TestSums_TreeHeader(t *testing.T) {
+	dir := t.TempDir()
+	big := make([]byte, TreeChunk+1)
+	rand.New(rand.NewSource(2)).Read(big)
+	os.WriteFile(filepath.Join(dir, "big.img"), big, 0644)
+	os.WriteFile(filepath.Join(dir, "small.txt"), []byte("small"), 0644)
+
+	sums := filepath.Join(t.TempDir(), "sha256sums")
+	if _, err := CreateSumsWithOptions(dir, sums, Options{Jobs: 2, Algorithm: SHA256Tree}); err != nil {
+		t.Fatal(err)
+	}
+	data, _ := os.ReadFile(sums)
+	if !strings.HasPrefix(string(data), "# apg-sums algorithm=sha256-tree chunk=4194304\n") {
+		t.Fatalf("missing header:\n%s", data)
+	}
+
+	// VerifySums dispatches on the header, not on the options.
+	passed, failed, err := VerifySumsWithOptions(sums, dir, Options{Jobs: 2})
+	if err != nil || len(passed) != 2 || len(failed) != 0 {
+		t.Fatalf("passed %v, failed %v, err %v", passed, failed, err)
+	}
+
+	big[TreeChunk] ^= 1
+	os.WriteFile(filepath.Join(dir, "big.img"), big, 0644)
+	var errs []error
+	VerifySumsFunc(sums, dir, Options{}, func(_ string, err error) { errs = append(errs, err) })
+	if len(errs) != 2 || !errors.Is(errs[0], ErrMismatch) || errs[1] != nil {
+		t.Errorf("after tampering: %v", errs)
+	}
+
+	// Plain sums keep the sha256sum(1) format.
+	if _, err := CreateSums(dir, sums); err != nil {
+		t.Fatal(err)
+	}
+	data, _ = os.ReadFile(sums)
+	if strings.HasPrefix(string(data), "#") {
+		t.Errorf("plain sums file has a header:\n%s", data)
+	}
+
+	os.WriteFile(sums, []byte("# apg-sums algorithm=md5\n"), 0644)
+	if _, _, err := VerifySums(sums, dir); err == nil {
+		t.Error("expected an error for an unknown algorithm")
+	}
+}
+
+func TestCache_AlgorithmChange(t *testing.T) {
+	dir := t.TempDir()
+	file := filepath.Join(dir, "a.txt")
+	os.WriteFile(file, []byte("hello"), 0644)
+	old := time.Now().Add(-time.Hour)
+	os.Chtimes(file, old, old)
+
+	cachePath := filepath.Join(t.TempDir(), CacheName)
+	out := filepath.Join(t.TempDir(), "sums")
+	cache := OpenCache(cachePath)
+	if _, err := CreateSumsWithOptions(dir, out, Options{Cache: cache}); err != nil {
+		t.Fatal(err)
+	}
+	cache.Save()
+
+	// A sha256 entry must not be reused for sha256-tree.
+	got, err := CreateSumsWithOptions(dir, out, Options{Cache: OpenCache(cachePath), Algorithm: SHA256Tree})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if want := treeReference([]byte("hello"), TreeChunk); got[0].Checksum != want {
+		t.Errorf("got %s, want the tree sum %s", got[0].Checksum, want)
+	}
+}
@@ -0,0 +1,97 @@
+// Package checksum — small files read in batches through io_uring.
+// NurOS 2026 - GPL 3.0
+package checksum
+
+import (
+	"encoding/hex"
+	"sync"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+	"github.com/NurOS-Linux/apgbuild/internal/uring"
+)
+
+var batchPool = sync.Pool{New: func() any { b := make([]byte, uring.BatchBuffer); return &b }}
+
+// hashScanned hashes the scanned files at paths like hashFiles. With
+// io_uring available, small files are read in batches, each worker
+// through a ring of its own; a file whose size changed since the scan, or
+// that fails to read, is hashed again the usual way.
+func hashScanned(files []*scan.File, paths []string, opts Options) []hashResult {
+	if !uring.Available() {
+		return hashFiles(paths, opts)
+	}
+	opts = opts.withHelpers()
+
+	// An item is a batch of small files or a single large one.
+	var items [][]int
+	var batch []int
+	var bytes int64
+	for i, f := range files {
+		if f.Size > uring.BatchFileSize {
+			items = append(items, []int{i})
+			continue
+		}
+		if len(batch) == uring.BatchFiles || bytes+f.Size > uring.BatchBytes {
+			items, batch, bytes = append(items, batch), nil, 0
+		}
+		batch, bytes = append(batch, i), bytes+f.Size
+	}
+	if len(batch) > 0 {
+		items = append(items, batch)
+	}
+
+	results := make([]hashResult, len(paths))
+	rings := make([]*uring.Ring, opts.workers(len(items)))
+	spread(len(items), opts, func(w, i int) {
+		item := items[i]
+		if len(item) == 1 && files[item[0]].Size > uring.BatchFileSize {
+			results[item[0]] = opts.hash(paths[item[0]])
+			return
+		}
+		if rings[w] == nil {
+			if r, err := uring.New(uring.DefaultDepth); err == nil {
+				rings[w] = r
+			}
+		}
+		opts.hashBatch(rings[w], item, files, paths, results)
+	})
+	for _, r := range rings {
+		if r != nil {
+			r.Close()
+		}
+	}
+	return results
+}
+
+// hashBatch hashes files[i] for every i in batch, reading them through r
+// (if not nil) into one buffer.
+func (o Options) hashBatch(r *uring.Ring, batch []int, files []*scan.File, paths []string, results []hashResult) {
+	bp := batchPool.Get().(*[]byte)
+	defer batchPool.Put(bp)
+	var got []int64
+	var errs []error
+	off := make([]int64, len(batch)+1)
+	if r != nil {
+		names := make([]string, len(batch))
+		for k, i := range batch {
+			names[k] = paths[i]
+			off[k+1] = off[k] + files[i].Size + 1
+		}
+		var err error
+		if got, errs, err = r.ReadFiles(names, off, *bp); err != nil {
+			got = nil
+		}
+	}
+	for k, i := range batch {
+		if got == nil || errs[k] != nil || got[k] != files[i].Size {
+			results[i] = o.hash(paths[i])
+			continue
+		}
+		h := o.newHash()
+		h.Write((*bp)[off[k] : off[k]+got[k]])
+		results[i] = hashResult{sum: hex.EncodeToString(h.Sum(nil))}
+		if o.Progress != nil {
+			o.Progress(got[k])
+		}
+	}
+}
@@ -0,0 +1,91 @@
+package checksum
+
+import (
+	"math/rand"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/NurOS-Linux/apgbuild/internal/testtree"
+)
+
+func TestMain(m *testing.M) {
+	code := m.Run()
+	testtree.Cleanup()
+	os.Exit(code)
+}
+
+func BenchmarkCalculate(b *testing.B) {
+	root, _ := testtree.Shared(b, testtree.FewHuge)
+	path := filepath.Join(root, "data", "usr", "share", "bench", "blob00.bin")
+	fi, err := os.Stat(path)
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.SetBytes(fi.Size())
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if _, err := Calculate(path); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+// BenchmarkCalculateLarge hashes one 64 MiB file, where SHA256Tree can
+// use several cores.
+func BenchmarkCalculateLarge(b *testing.B) {
+	path := filepath.Join(b.TempDir(), "image.bin")
+	data := make([]byte, 64<<20)
+	rand.New(rand.NewSource(1)).Read(data)
+	if err := os.WriteFile(path, data, 0644); err != nil {
+		b.Fatal(err)
+	}
+	for _, alg := range []Algorithm{SHA256, SHA256Tree} {
+		b.Run(string(alg), func(b *testing.B) {
+			b.SetBytes(int64(len(data)))
+			for i := 0; i < b.N; i++ {
+				if _, err := CalculateWithOptions(path, Options{Algorithm: alg}); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkCreateSums(b *testing.B) {
+	for _, shape := range testtree.Shapes {
+		for _, jobs := range []struct {
+			name string
+			n    int
+		}{{"serial", 1}, {"parallel", 0}} {
+			b.Run(string(shape)+"/"+jobs.name, func(b *testing.B) {
+				root, st := testtree.Shared(b, shape)
+				out := filepath.Join(b.TempDir(), "sha256sums")
+				b.SetBytes(st.Bytes)
+				b.ReportMetric(float64(st.Files), "files/op")
+				b.ResetTimer()
+				for i := 0; i < b.N; i++ {
+					if _, err := CreateSumsWithOptions(filepath.Join(root, "data"), out, Options{Jobs: jobs.n}); err != nil {
+						b.Fatal(err)
+					}
+				}
+			})
+		}
+	}
+}
+
+func BenchmarkVerifySums(b *testing.B) {
+	root, st := testtree.Shared(b, testtree.ManyTiny)
+	data := filepath.Join(root, "data")
+	sums := filepath.Join(b.TempDir(), "sha256sums")
+	if _, err := CreateSums(data, sums); err != nil {
+		b.Fatal(err)
+	}
+	b.SetBytes(st.Bytes)
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if _, failed, err := VerifySumsFunc(sums, data, Options{}, func(string, error) {}); err != nil || failed != 0 {
+			b.Fatalf("verify: %d failed, %v", failed, err)
+		}
+	}
+}
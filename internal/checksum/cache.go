@@ -0,0 +1,262 @@
+// Package checksum — persistent content-hash cache for incremental builds.
+// NurOS 2026 - GPL 3.0
+package checksum
+
+import (
+	"bufio"
+	"encoding/binary"
+	"encoding/hex"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"sync"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// CacheName is the file name of the build cache kept in a package tree.
+const CacheName = ".apgbuild-cache"
+
+// Cache file layout (little endian):
+//
+//	"APGC" | u32 version | u32 count | u8 len | algorithm [len]
+//	| count × {dev u64, ino u64, size i64, mtime i64, sum [32]}
+//	| u32 len | extra [len]
+const (
+	cacheMagic   = "APGC"
+	cacheVersion = 2
+)
+
+// RacyWindow: files modified this close to the time they are hashed are
+// not cached, since a second write within the same mtime tick would go
+// unnoticed.
+const RacyWindow = time.Second
+
+// cacheKey identifies one version of a file on disk.
+type cacheKey struct {
+	dev, ino     uint64
+	size, mtimeN int64
+}
+
+func keyOf(f *scan.File) cacheKey {
+	return cacheKey{dev: f.Dev, ino: f.Ino, size: f.Size, mtimeN: f.ModTime.UnixNano()}
+}
+
+// Cache remembers the sums of files keyed by (dev, inode, size, mtime),
+// so unchanged files are not hashed again on the next build. All sums are
+// in one Algorithm (see UseAlgorithm). It is safe for concurrent use.
+type Cache struct {
+	path string
+	alg  Algorithm
+	mu   sync.Mutex
+	old  map[cacheKey][32]byte // loaded from disk
+	cur  map[cacheKey][32]byte // looked up or added during this run
+	// Extra is opaque data saved alongside the sums (the builder keeps its
+	// up-to-date stamp here).
+	Extra []byte
+	disk  fileStamp // the cache file as last loaded or saved
+}
+
+// fileStamp tells whether a file changed since it was stat-ed.
+type fileStamp struct {
+	size  int64
+	mtime time.Time
+}
+
+func stampOf(path string) fileStamp {
+	fi, err := os.Stat(path)
+	if err != nil {
+		return fileStamp{size: -1}
+	}
+	return fileStamp{fi.Size(), fi.ModTime()}
+}
+
+// OpenCache loads the cache at path. A missing or unreadable cache file
+// yields an empty cache rather than an error: the cache only saves work.
+func OpenCache(path string) *Cache {
+	c := &Cache{path: path, alg: SHA256, old: map[cacheKey][32]byte{}, cur: map[cacheKey][32]byte{}}
+	c.disk = stampOf(path)
+	f, err := os.Open(path)
+	if err != nil {
+		return c
+	}
+	defer f.Close()
+	if err := c.load(bufio.NewReader(f)); err != nil {
+		c.alg, c.old, c.Extra = SHA256, map[cacheKey][32]byte{}, nil
+	}
+	return c
+}
+
+// UseAlgorithm sets the algorithm of the sums looked up and recorded from
+// now on. Sums loaded from disk in another algorithm are dropped.
+func (c *Cache) UseAlgorithm(a Algorithm) {
+	if c == nil {
+		return
+	}
+	a = a.orDefault()
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if a != c.alg {
+		c.alg, c.old, c.cur = a, map[cacheKey][32]byte{}, map[cacheKey][32]byte{}
+	}
+}
+
+func (c *Cache) load(r io.Reader) error {
+	var hdr [12]byte
+	if _, err := io.ReadFull(r, hdr[:]); err != nil {
+		return err
+	}
+	if string(hdr[:4]) != cacheMagic || binary.LittleEndian.Uint32(hdr[4:]) != cacheVersion {
+		return errors.New("bad cache header")
+	}
+	n := binary.LittleEndian.Uint32(hdr[8:])
+	var alg [256]byte
+	if _, err := io.ReadFull(r, alg[:1]); err != nil {
+		return err
+	}
+	if _, err := io.ReadFull(r, alg[1:1+alg[0]]); err != nil {
+		return err
+	}
+	c.alg = Algorithm(alg[1 : 1+alg[0]])
+	var rec [64]byte
+	for i := uint32(0); i < n; i++ {
+		if _, err := io.ReadFull(r, rec[:]); err != nil {
+			return err
+		}
+		k := cacheKey{
+			dev:    binary.LittleEndian.Uint64(rec[0:]),
+			ino:    binary.LittleEndian.Uint64(rec[8:]),
+			size:   int64(binary.LittleEndian.Uint64(rec[16:])),
+			mtimeN: int64(binary.LittleEndian.Uint64(rec[24:])),
+		}
+		var sum [32]byte
+		copy(sum[:], rec[32:])
+		c.old[k] = sum
+	}
+	var l [4]byte
+	if _, err := io.ReadFull(r, l[:]); err != nil {
+		return err
+	}
+	c.Extra = make([]byte, binary.LittleEndian.Uint32(l[:]))
+	_, err := io.ReadFull(r, c.Extra)
+	return err
+}
+
+// lookup returns the cached sum of f, if any.
+func (c *Cache) lookup(f *scan.File) (string, bool) {
+	if c == nil || !f.Mode.IsRegular() {
+		return "", false
+	}
+	k := keyOf(f)
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	sum, ok := c.old[k]
+	if ok {
+		c.cur[k] = sum
+	}
+	return hex.EncodeToString(sum[:]), ok
+}
+
+// Put records the hex sum of f, in the cache's algorithm. Only regular files are cached: a
+// symlink's own stat says nothing about the data it points to.
+func (c *Cache) Put(f *scan.File, sum string) {
+	if c == nil || !f.Mode.IsRegular() || time.Since(f.ModTime) < RacyWindow {
+		return
+	}
+	var b [32]byte
+	if n, err := hex.Decode(b[:], []byte(sum)); err != nil || n != len(b) {
+		return
+	}
+	c.mu.Lock()
+	c.cur[keyOf(f)] = b
+	c.mu.Unlock()
+}
+
+// Save writes the entries used during this run (plus Extra) back to disk,
+// so files that disappeared from the tree drop out of the cache. They are
+// what the next run looks sums up in, if the cache stays open.
+func (c *Cache) Save() error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	tmp, err := os.CreateTemp(filepath.Dir(c.path), CacheName+".*")
+	if err != nil {
+		return fmt.Errorf("save cache: %w", err)
+	}
+	defer os.Remove(tmp.Name())
+
+	w := bufio.NewWriter(tmp)
+	var hdr [12]byte
+	copy(hdr[:], cacheMagic)
+	binary.LittleEndian.PutUint32(hdr[4:], cacheVersion)
+	binary.LittleEndian.PutUint32(hdr[8:], uint32(len(c.cur)))
+	w.Write(hdr[:])
+	w.WriteByte(byte(len(c.alg)))
+	w.WriteString(string(c.alg))
+	var rec [64]byte
+	for k, sum := range c.cur {
+		binary.LittleEndian.PutUint64(rec[0:], k.dev)
+		binary.LittleEndian.PutUint64(rec[8:], k.ino)
+		binary.LittleEndian.PutUint64(rec[16:], uint64(k.size))
+		binary.LittleEndian.PutUint64(rec[24:], uint64(k.mtimeN))
+		copy(rec[32:], sum[:])
+		w.Write(rec[:])
+	}
+	var l [4]byte
+	binary.LittleEndian.PutUint32(l[:], uint32(len(c.Extra)))
+	w.Write(l[:])
+	w.Write(c.Extra)
+
+	if err := w.Flush(); err != nil {
+		tmp.Close()
+		return fmt.Errorf("save cache: %w", err)
+	}
+	if err := tmp.Close(); err != nil {
+		return fmt.Errorf("save cache: %w", err)
+	}
+	if err := os.Rename(tmp.Name(), c.path); err != nil {
+		return fmt.Errorf("save cache: %w", err)
+	}
+	c.old, c.cur = c.cur, map[cacheKey][32]byte{}
+	c.disk = stampOf(c.path)
+	return nil
+}
+
+// CacheSet keeps caches open between builds in one process (apgbuild
+// serve), so a build does not load its cache from disk again. A cache
+// whose file was changed by someone else is loaded anew.
+type CacheSet struct {
+	mu     sync.Mutex
+	caches map[string]*setCache
+}
+
+type setCache struct {
+	sync.Mutex // held by the build using the cache
+	c          *Cache
+}
+
+// NewCacheSet returns an empty CacheSet.
+func NewCacheSet() *CacheSet {
+	return &CacheSet{caches: map[string]*setCache{}}
+}
+
+// Acquire returns the cache at path, opening it if needed, for the
+// exclusive use of the caller until it calls release.
+func (s *CacheSet) Acquire(path string) (c *Cache, release func()) {
+	s.mu.Lock()
+	sc := s.caches[path]
+	if sc == nil {
+		sc = &setCache{}
+		s.caches[path] = sc
+	}
+	s.mu.Unlock()
+
+	sc.Lock()
+	if sc.c == nil || stampOf(path) != sc.c.disk {
+		sc.c = OpenCache(path)
+	}
+	return sc.c, sc.Unlock
+}
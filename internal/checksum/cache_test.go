@@ -0,0 +1,121 @@
+package checksum
+
+import (
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+func TestCache_SkipsUnchangedFiles(t *testing.T) {
+	dir := t.TempDir()
+	file := filepath.Join(dir, "a.txt")
+	os.WriteFile(file, []byte("hello"), 0644)
+	old := time.Now().Add(-time.Hour)
+	os.Chtimes(file, old, old)
+
+	cachePath := filepath.Join(t.TempDir(), CacheName)
+	out := filepath.Join(t.TempDir(), "sums")
+
+	cache := OpenCache(cachePath)
+	first, err := CreateSumsWithOptions(dir, out, Options{Cache: cache})
+	if err != nil {
+		t.Fatalf("CreateSums failed: %v", err)
+	}
+	if err := cache.Save(); err != nil {
+		t.Fatalf("Save failed: %v", err)
+	}
+
+	// Same size and mtime: the cached sum must be used without reading the file.
+	os.WriteFile(file, []byte("HELLO"), 0644)
+	os.Chtimes(file, old, old)
+	second, err := CreateSumsWithOptions(dir, out, Options{Cache: OpenCache(cachePath)})
+	if err != nil {
+		t.Fatalf("CreateSums failed: %v", err)
+	}
+	if second[0].Checksum != first[0].Checksum {
+		t.Error("Expected the cached checksum for an unchanged stat")
+	}
+
+	// A new mtime invalidates the entry.
+	now := old.Add(time.Minute)
+	os.Chtimes(file, now, now)
+	third, err := CreateSumsWithOptions(dir, out, Options{Cache: OpenCache(cachePath)})
+	if err != nil {
+		t.Fatalf("CreateSums failed: %v", err)
+	}
+	want, _ := Calculate(file)
+	if third[0].Checksum != want {
+		t.Errorf("Expected a fresh checksum %s, got %s", want, third[0].Checksum)
+	}
+}
+
+func TestCache_RecentFilesNotCached(t *testing.T) {
+	dir := t.TempDir()
+	os.WriteFile(filepath.Join(dir, "new.txt"), []byte("fresh"), 0644)
+
+	cachePath := filepath.Join(t.TempDir(), CacheName)
+	cache := OpenCache(cachePath)
+	if _, err := CreateSumsWithOptions(dir, filepath.Join(t.TempDir(), "sums"), Options{Cache: cache}); err != nil {
+		t.Fatal(err)
+	}
+	if len(cache.cur) != 0 {
+		t.Errorf("Files modified within the racy window must not be cached, got %d entries", len(cache.cur))
+	}
+}
+
+func TestOpenCache_Corrupt(t *testing.T) {
+	path := filepath.Join(t.TempDir(), CacheName)
+	os.WriteFile(path, []byte("APGC\x01\x00\x00\x00\xff\xff\xff\xff"), 0644)
+	c := OpenCache(path)
+	if len(c.old) != 0 || c.Extra != nil {
+		t.Error("A truncated cache should load as empty")
+	}
+}
+
+func TestCacheSet_KeepsCachesOpen(t *testing.T) {
+	dir := t.TempDir()
+	file := filepath.Join(dir, "a.txt")
+	os.WriteFile(file, []byte("hello"), 0644)
+	old := time.Now().Add(-time.Hour)
+	os.Chtimes(file, old, old)
+	cachePath := filepath.Join(t.TempDir(), CacheName)
+	out := filepath.Join(t.TempDir(), "sums")
+
+	set := NewCacheSet()
+	first, release := set.Acquire(cachePath)
+	if _, err := CreateSumsWithOptions(dir, out, Options{Cache: first}); err != nil {
+		t.Fatal(err)
+	}
+	if err := first.Save(); err != nil {
+		t.Fatal(err)
+	}
+	release()
+
+	second, release := set.Acquire(cachePath)
+	release()
+	if second != first {
+		t.Error("an unchanged cache file was loaded again")
+	}
+	tree, err := scan.Scan(dir, scan.Options{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, ok := second.lookup(tree.Lookup("a.txt")); !ok {
+		t.Error("the sums of the previous run are not in the kept cache")
+	}
+
+	// Another process saves the cache: it is loaded anew.
+	other := OpenCache(cachePath)
+	other.Extra = []byte("changed elsewhere")
+	if err := other.Save(); err != nil {
+		t.Fatal(err)
+	}
+	third, release := set.Acquire(cachePath)
+	release()
+	if third == first || string(third.Extra) != "changed elsewhere" {
+		t.Error("a cache file changed on disk was not reloaded")
+	}
+}
@@ -0,0 +1,218 @@
+// Package checksum — bounded worker pool for hashing many files.
+// NurOS 2026 - GPL 3.0
+package checksum
+
+import (
+	"runtime"
+	"sync"
+)
+
+// Options configures CreateSumsWithOptions and VerifySumsWithOptions.
+type Options struct {
+	// Jobs is the number of files hashed concurrently (0 = number of CPUs).
+	Jobs int
+	// Cache, if set, supplies sums of unchanged files and records new ones.
+	// Only CreateSumsFromTree consults it.
+	Cache *Cache
+	// Slots, if set, is a token pool shared with other concurrent callers
+	// (see Slots). Workers beyond the first take a token for every file,
+	// so all callers together hash at most cap(Slots) extra files at once.
+	Slots Slots
+	// Progress, if set, is called with the size of every file once it is
+	// hashed (or found in Cache). It is called from the hashing workers
+	// and must be safe for concurrent use.
+	Progress func(size int64)
+	// Algorithm is the content hash ("" = SHA256). With SHA256Tree, files
+	// larger than a chunk are also split across the workers' spare slots
+	// (Slots, or Jobs-1 helpers of the run's own).
+	Algorithm Algorithm
+
+	chunk   int64 // SHA256Tree chunk size, from a sums file header (0 = TreeChunk)
+	helpers Slots // tokens for chunk helpers of SHA256Tree
+}
+
+// Slots bounds the hashing threads of several concurrent hash runs, e.g.
+// the packages of a batch build. Each run's first worker uses the caller's
+// own thread and needs no token.
+type Slots chan struct{}
+
+// NewSlots returns a pool of n tokens.
+func NewSlots(n int) Slots {
+	s := make(Slots, n)
+	for i := 0; i < n; i++ {
+		s <- struct{}{}
+	}
+	return s
+}
+
+func (o Options) jobs() int {
+	if o.Jobs > 0 {
+		return o.Jobs
+	}
+	return runtime.NumCPU()
+}
+
+// hashResult is the outcome of hashing one file.
+type hashResult struct {
+	sum string
+	err error
+}
+
+// withHelpers returns o with a helper pool for tree hashing, shared by all
+// files of one run.
+func (o Options) withHelpers() Options {
+	if o.Algorithm == SHA256Tree && o.helpers == nil {
+		if o.Slots != nil {
+			o.helpers = o.Slots
+		} else {
+			o.helpers = NewSlots(o.jobs() - 1)
+		}
+	}
+	return o
+}
+
+// hash hashes one file and reports it to opts.Progress.
+func (o Options) hash(path string) hashResult {
+	sum, n, err := o.calculate(path)
+	if o.Progress != nil {
+		o.Progress(n)
+	}
+	return hashResult{sum, err}
+}
+
+// hashFiles computes the SHA-256 of every path using at most opts.Jobs
+// workers; with opts.Slots, all but the first take a token per file.
+// results[i] always belongs to paths[i], so callers keep their own
+// ordering no matter in which order the workers finish.
+func hashFiles(paths []string, opts Options) []hashResult {
+	results := make([]hashResult, len(paths))
+	opts = opts.withHelpers()
+	spread(len(paths), opts, func(_, i int) { results[i] = opts.hash(paths[i]) })
+	return results
+}
+
+// workers returns the number of workers spread starts for n items.
+func (o Options) workers(n int) int {
+	if jobs := o.jobs(); jobs < n {
+		return jobs
+	}
+	return n
+}
+
+// spread calls do for every item in [0, n) on opts.workers(n) workers; w
+// is the worker (the caller's goroutine is 0 when there is just one).
+// With opts.Slots, all workers but the first take a token per item.
+func spread(n int, opts Options, do func(w, i int)) {
+	jobs, slots := opts.workers(n), opts.Slots
+	if jobs <= 1 {
+		for i := 0; i < n; i++ {
+			do(0, i)
+		}
+		return
+	}
+
+	next := make(chan int)
+	done := make(chan struct{})
+	var wg sync.WaitGroup
+	for w := 0; w < jobs; w++ {
+		wg.Add(1)
+		go func(w int, borrow bool) {
+			defer wg.Done()
+			for {
+				// A borrowing worker takes its token before an item, so it
+				// never sits on one the first worker could handle.
+				if borrow {
+					select {
+					case <-slots:
+					case <-done:
+						return
+					}
+				}
+				i, ok := <-next
+				if ok {
+					do(w, i)
+				}
+				if borrow {
+					slots <- struct{}{}
+				}
+				if !ok {
+					return
+				}
+			}
+		}(w, w > 0 && slots != nil)
+	}
+	for i := 0; i < n; i++ {
+		next <- i
+	}
+	close(next)
+	close(done)
+	wg.Wait()
+}
+
+// hashJob is one file of hashStream and where its result goes.
+type hashJob struct {
+	path string
+	res  chan hashResult
+}
+
+// hashStream hashes the paths returned by next (until it returns false)
+// like hashFiles, but hands every result to emit in the order next
+// produced them as soon as it and all earlier ones are done. At most a
+// few files per worker are in flight, so memory does not grow with the
+// number of paths. emit runs on the calling goroutine.
+func hashStream(next func() (string, bool), opts Options, emit func(hashResult)) {
+	opts = opts.withHelpers()
+	jobs, slots := opts.jobs(), opts.Slots
+	if jobs <= 1 {
+		for p, ok := next(); ok; p, ok = next() {
+			emit(opts.hash(p))
+		}
+		return
+	}
+
+	work := make(chan hashJob)
+	order := make(chan chan hashResult, 4*jobs)
+	done := make(chan struct{})
+	var wg sync.WaitGroup
+	for w := 0; w < jobs; w++ {
+		wg.Add(1)
+		go func(borrow bool) {
+			defer wg.Done()
+			for {
+				if borrow {
+					select {
+					case <-slots:
+					case <-done:
+						return
+					}
+				}
+				j, ok := <-work
+				if ok {
+					j.res <- opts.hash(j.path)
+				}
+				if borrow {
+					slots <- struct{}{}
+				}
+				if !ok {
+					return
+				}
+			}
+		}(w > 0 && slots != nil)
+	}
+	go func() {
+		// A result's place in order is taken before the file is handed
+		// out, so emit always waits for the oldest outstanding file.
+		for p, ok := next(); ok; p, ok = next() {
+			res := make(chan hashResult, 1)
+			order <- res
+			work <- hashJob{p, res}
+		}
+		close(work)
+		close(done)
+		close(order)
+	}()
+	for res := range order {
+		emit(<-res)
+	}
+	wg.Wait()
+}
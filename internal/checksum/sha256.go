@@ -6,97 +6,301 @@ import (
 	"bufio"
 	"crypto/sha256"
 	"encoding/hex"
+	"errors"
 	"fmt"
+	"hash"
 	"io"
 	"os"
 	"path/filepath"
 	"strings"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
 )
 
 // Entry represents a single checksum entry.
 type Entry struct {
-	Checksum string // hex-encoded SHA-256
+	Checksum string // hex digest in the sums file's Algorithm
 	Path     string
 }
 
+// ErrMismatch is reported by VerifySumsFunc for a file whose content does
+// not match its sum.
+var ErrMismatch = errors.New("checksum mismatch")
+
 // Calculate computes the SHA-256 checksum of a file.
 func Calculate(filePath string) (string, error) {
+	return CalculateWithOptions(filePath, Options{})
+}
+
+// CalculateWithOptions computes the checksum of a file in opts.Algorithm;
+// a SHA256Tree file is split across up to opts.Jobs goroutines.
+func CalculateWithOptions(filePath string, opts Options) (string, error) {
+	sum, _, err := opts.withHelpers().calculate(filePath)
+	return sum, err
+}
+
+// newHash returns the hash of a file that fits a single SHA256Tree chunk.
+func (o Options) newHash() hash.Hash {
+	if o.Algorithm == SHA256Tree {
+		return newTreeHash(o.chunkSize())
+	}
+	return sha256.New()
+}
+
+// calculate hashes one file, also returning the number of bytes read.
+func (o Options) calculate(filePath string) (string, int64, error) {
 	f, err := os.Open(filePath)
 	if err != nil {
-		return "", fmt.Errorf("open file: %w", err)
+		return "", 0, fmt.Errorf("open file: %w", err)
 	}
 	defer f.Close()
 
-	h := sha256.New()
-	if _, err := io.Copy(h, f); err != nil {
-		return "", fmt.Errorf("hash file: %w", err)
+	if o.Algorithm == SHA256Tree {
+		fi, err := f.Stat()
+		if err != nil {
+			return "", 0, fmt.Errorf("hash file: %w", err)
+		}
+		if chunk := o.chunkSize(); fi.Size() > chunk {
+			sum, err := treeFile(f, fi.Size(), chunk, o.helpers)
+			if err != nil {
+				return "", 0, fmt.Errorf("hash file: %w", err)
+			}
+			return sum, fi.Size(), nil
+		}
+	}
+
+	h := o.newHash()
+	// os.File's WriteTo would copy through a 32 KiB buffer.
+	bp := bufPool.Get().(*[]byte)
+	defer bufPool.Put(bp)
+	var n int64
+	for {
+		m, err := f.Read(*bp)
+		h.Write((*bp)[:m])
+		n += int64(m)
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return "", n, fmt.Errorf("hash file: %w", err)
+		}
 	}
-	return hex.EncodeToString(h.Sum(nil)), nil
+	return hex.EncodeToString(h.Sum(nil)), n, nil
 }
 
 // CreateSums generates a sha256sums file for all files in directory.
 func CreateSums(directory, outputPath string) ([]Entry, error) {
+	return CreateSumsWithOptions(directory, outputPath, Options{})
+}
+
+// CreateSumsWithOptions generates a sha256sums file for all files in
+// directory, hashing up to opts.Jobs files at once. Entries keep the
+// filepath.Walk order, so the output is identical for any job count.
+func CreateSumsWithOptions(directory, outputPath string, opts Options) ([]Entry, error) {
+	tree, err := scan.Scan(directory, scan.Options{})
+	if err != nil {
+		return nil, err
+	}
+	return CreateSumsFromTree(tree, "", outputPath, opts)
+}
+
+// CreateSumsFromTree is CreateSumsWithOptions over an already scanned tree.
+// It covers the entries below the top-level directory dir ("" = the whole
+// tree); sums paths are relative to dir. Only regular files get a line:
+// symlinks are archived as links, so their targets (possibly outside the
+// tree, or in another split) are not hashed.
+func CreateSumsFromTree(tree *scan.Tree, dir, outputPath string, opts Options) ([]Entry, error) {
 	var entries []Entry
+	var missFiles []*scan.File
+	var missPaths []string
+	var missIdx []int
 
-	err := filepath.Walk(directory, func(path string, info os.FileInfo, err error) error {
-		if err != nil || info.IsDir() {
-			return err
+	opts.Cache.UseAlgorithm(opts.Algorithm)
+	files := tree.Sub(dir)
+	for i := range files {
+		f := &files[i]
+		if !f.Mode.IsRegular() {
+			continue
 		}
-		rel, err := filepath.Rel(directory, path)
-		if err != nil {
-			return err
+		rel := f.Path
+		if dir != "" {
+			rel = strings.TrimPrefix(rel, dir+"/")
 		}
-		sum, err := Calculate(path)
-		if err != nil {
-			return fmt.Errorf("sha256 %s: %w", rel, err)
+		sum, ok := opts.Cache.lookup(f)
+		if ok && opts.Progress != nil {
+			opts.Progress(f.Size)
+		} else if !ok {
+			missFiles = append(missFiles, f)
+			missPaths = append(missPaths, tree.Abs(f))
+			missIdx = append(missIdx, len(entries))
 		}
-		entries = append(entries, Entry{Checksum: sum, Path: rel})
-		return nil
-	})
-	if err != nil {
+		entries = append(entries, Entry{Checksum: sum, Path: filepath.FromSlash(rel)})
+	}
+
+	// Only files the cache does not know are read.
+	for i, r := range hashScanned(missFiles, missPaths, opts) {
+		e := &entries[missIdx[i]]
+		if r.err != nil {
+			return nil, fmt.Errorf("sha256 %s: %w", e.Path, r.err)
+		}
+		e.Checksum = r.sum
+		opts.Cache.Put(missFiles[i], r.sum)
+	}
+
+	if err := WriteSumsWithOptions(outputPath, entries, opts); err != nil {
 		return nil, err
 	}
+	return entries, nil
+}
 
+// WriteSums writes entries to outputPath in sha256sums format.
+func WriteSums(outputPath string, entries []Entry) error {
+	return WriteSumsWithOptions(outputPath, entries, Options{})
+}
+
+// WriteSumsWithOptions writes entries, whose sums are in opts.Algorithm,
+// to outputPath. Algorithms other than SHA256 are named in a header line
+// that VerifySums reads; sha256sum(1) skips it as malformed.
+func WriteSumsWithOptions(outputPath string, entries []Entry, opts Options) error {
 	f, err := os.Create(outputPath)
 	if err != nil {
-		return nil, fmt.Errorf("create sums file: %w", err)
+		return fmt.Errorf("create sums file: %w", err)
 	}
-	defer f.Close()
 
+	w := bufio.NewWriter(f)
+	w.WriteString(opts.header())
 	for _, e := range entries {
-		fmt.Fprintf(f, "%s  %s\n", e.Checksum, e.Path)
+		fmt.Fprintf(w, "%s  %s\n", e.Checksum, e.Path)
 	}
-	return entries, nil
+	if err := w.Flush(); err != nil {
+		f.Close()
+		return fmt.Errorf("write sums file: %w", err)
+	}
+	return f.Close()
 }
 
 // VerifySums verifies files against a sha256sums file.
 // Returns lists of passed and failed file paths.
 func VerifySums(sumsFile, baseDir string) (passed, failed []string, err error) {
+	return VerifySumsWithOptions(sumsFile, baseDir, Options{})
+}
+
+// VerifySumsWithOptions verifies files against a sha256sums file, hashing up
+// to opts.Jobs files at once. passed and failed keep the sums file order.
+func VerifySumsWithOptions(sumsFile, baseDir string, opts Options) (passed, failed []string, err error) {
+	_, _, err = VerifySumsFunc(sumsFile, baseDir, opts, func(path string, err error) {
+		if err != nil {
+			failed = append(failed, path)
+		} else {
+			passed = append(passed, path)
+		}
+	})
+	if err != nil {
+		return nil, nil, err
+	}
+	return passed, failed, nil
+}
+
+// VerifySumsFunc verifies files against a sha256sums file while reading
+// it, calling fn for every file in sums file order as soon as it is
+// checked: err is nil, ErrMismatch or why the file could not be read.
+// The algorithm is taken from the sums file header (SHA256 without one),
+// whatever opts.Algorithm says. Memory use does not depend on the number
+// of files.
+func VerifySumsFunc(sumsFile, baseDir string, opts Options, fn func(path string, err error)) (passed, failed int, err error) {
 	f, err := os.Open(sumsFile)
 	if err != nil {
-		return nil, nil, fmt.Errorf("open sums file: %w", err)
+		return 0, 0, fmt.Errorf("open sums file: %w", err)
 	}
 	defer f.Close()
 
 	sc := bufio.NewScanner(f)
-	for sc.Scan() {
-		line := sc.Text()
-		if line == "" {
-			continue
+	opts.Algorithm, opts.chunk = SHA256, 0
+	first, haveFirst := "", sc.Scan()
+	if haveFirst {
+		first = sc.Text()
+		if strings.HasPrefix(first, sumsHeader) {
+			if err := opts.parseHeader(first); err != nil {
+				return 0, 0, fmt.Errorf("sums file %s: %w", sumsFile, err)
+			}
+			haveFirst = false
+		}
+	}
+
+	// Lines read but not yet reported; the producer in hashStream runs
+	// ahead of emit by at most its window.
+	type line struct{ sum, rel string }
+	pending := make(chan line, 8*opts.jobs()+1)
+	next := func() (string, bool) {
+		for haveFirst || sc.Scan() {
+			text := sc.Text()
+			if haveFirst {
+				text, haveFirst = first, false
+			}
+			parts := strings.SplitN(text, "  ", 2)
+			if len(parts) != 2 {
+				continue
+			}
+			pending <- line{parts[0], parts[1]}
+			return filepath.Join(baseDir, parts[1]), true
 		}
-		parts := strings.SplitN(line, "  ", 2)
-		if len(parts) != 2 {
+		return "", false
+	}
+	hashStream(next, opts, func(r hashResult) {
+		l := <-pending
+		switch {
+		case r.err != nil:
+			failed++
+			fn(l.rel, r.err)
+		case r.sum != l.sum:
+			failed++
+			fn(l.rel, ErrMismatch)
+		default:
+			passed++
+			fn(l.rel, nil)
+		}
+	})
+	if err := sc.Err(); err != nil {
+		return passed, failed, err
+	}
+	return passed, failed, nil
+}
+
+// Sums is a sums file read into memory.
+type Sums struct {
+	Algorithm Algorithm
+	Entries   []Entry
+	chunk     int64
+}
+
+// ReadSums parses a sums file, with or without a header. Malformed lines
+// are skipped, as by VerifySums.
+func ReadSums(r io.Reader) (*Sums, error) {
+	s := &Sums{Algorithm: SHA256}
+	sc := bufio.NewScanner(r)
+	for first := true; sc.Scan(); first = false {
+		text := sc.Text()
+		if first && strings.HasPrefix(text, sumsHeader) {
+			opts := Options{}
+			if err := opts.parseHeader(text); err != nil {
+				return nil, err
+			}
+			s.Algorithm, s.chunk = opts.Algorithm.orDefault(), opts.chunk
 			continue
 		}
-		expected, relPath := parts[0], parts[1]
-		actual, err := Calculate(filepath.Join(baseDir, relPath))
-		if err != nil || actual != expected {
-			failed = append(failed, relPath)
-		} else {
-			passed = append(passed, relPath)
+		if parts := strings.SplitN(text, "  ", 2); len(parts) == 2 {
+			s.Entries = append(s.Entries, Entry{Checksum: parts[0], Path: parts[1]})
 		}
 	}
-	return passed, failed, sc.Err()
+	return s, sc.Err()
+}
+
+// New returns a streaming hash in the algorithm (and chunk size) of s.
+func (s *Sums) New() hash.Hash {
+	if s.Algorithm == SHA256Tree {
+		return newTreeHash(Options{chunk: s.chunk}.chunkSize())
+	}
+	return sha256.New()
 }
 
 // ── Legacy aliases kept for any callers that used the old CRC32 names ─────────
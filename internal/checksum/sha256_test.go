@@ -3,9 +3,16 @@
 package checksum
 
 import (
+	"errors"
+	"fmt"
 	"os"
 	"path/filepath"
+	"strings"
+	"sync/atomic"
 	"testing"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+	"github.com/NurOS-Linux/apgbuild/internal/uring"
 )
 
 func TestCalculate(t *testing.T) {
@@ -65,3 +72,149 @@ func TestVerifySums_Tampered(t *testing.T) {
 		t.Errorf("expected 1 failure after tampering, got %d", len(failed))
 	}
 }
+
+func TestCreateSums_ParallelDeterministic(t *testing.T) {
+	dir := t.TempDir()
+	for i := 0; i < 50; i++ {
+		sub := filepath.Join(dir, fmt.Sprintf("d%02d", i%7))
+		os.MkdirAll(sub, 0755)
+		os.WriteFile(filepath.Join(sub, fmt.Sprintf("f%03d", i)), []byte(strings.Repeat("x", i*131)), 0644)
+	}
+
+	serialPath := filepath.Join(t.TempDir(), "serial")
+	parallelPath := filepath.Join(t.TempDir(), "parallel")
+	if _, err := CreateSumsWithOptions(dir, serialPath, Options{Jobs: 1}); err != nil {
+		t.Fatalf("CreateSumsWithOptions(1): %v", err)
+	}
+	if _, err := CreateSumsWithOptions(dir, parallelPath, Options{Jobs: 8}); err != nil {
+		t.Fatalf("CreateSumsWithOptions(8): %v", err)
+	}
+
+	serial, _ := os.ReadFile(serialPath)
+	parallel, _ := os.ReadFile(parallelPath)
+	if string(serial) != string(parallel) {
+		t.Errorf("parallel sums differ from serial sums")
+	}
+
+	passed, failed, err := VerifySumsWithOptions(parallelPath, dir, Options{Jobs: 8})
+	if err != nil {
+		t.Fatalf("VerifySumsWithOptions: %v", err)
+	}
+	if len(failed) != 0 || len(passed) != 50 {
+		t.Errorf("expected 50 passed and 0 failed, got %d and %v", len(passed), failed)
+	}
+}
+
+func TestCreateSums_SharedSlots(t *testing.T) {
+	dir := t.TempDir()
+	for i := 0; i < 30; i++ {
+		os.WriteFile(filepath.Join(dir, fmt.Sprintf("f%02d", i)), []byte(strings.Repeat("y", i*17)), 0644)
+	}
+	want, err := CreateSumsWithOptions(dir, filepath.Join(t.TempDir(), "serial"), Options{Jobs: 1})
+	if err != nil {
+		t.Fatalf("CreateSumsWithOptions(1): %v", err)
+	}
+
+	// With no token free only the first worker hashes, but all files are.
+	for _, n := range []int{0, 2} {
+		slots := NewSlots(n)
+		got, err := CreateSumsWithOptions(dir, filepath.Join(t.TempDir(), "sums"), Options{Jobs: 4, Slots: slots})
+		if err != nil {
+			t.Fatalf("CreateSumsWithOptions(slots=%d): %v", n, err)
+		}
+		if len(got) != len(want) || got[29] != want[29] {
+			t.Errorf("slots=%d: sums differ from serial sums", n)
+		}
+		if len(slots) != n {
+			t.Errorf("slots=%d: %d tokens left after hashing", n, len(slots))
+		}
+	}
+}
+
+func TestVerifySumsFunc_Streaming(t *testing.T) {
+	dir := t.TempDir()
+	for i := 0; i < 200; i++ {
+		os.WriteFile(filepath.Join(dir, fmt.Sprintf("f%03d", i)), []byte(strings.Repeat("z", i*53)), 0644)
+	}
+	sumsPath := filepath.Join(t.TempDir(), "sha256sums")
+	entries, err := CreateSums(dir, sumsPath)
+	if err != nil {
+		t.Fatalf("CreateSums: %v", err)
+	}
+	os.WriteFile(filepath.Join(dir, "f010"), []byte("tampered"), 0644)
+	os.Remove(filepath.Join(dir, "f150"))
+
+	var files, bytes atomic.Int64
+	opts := Options{Jobs: 4, Slots: NewSlots(2), Progress: func(n int64) {
+		files.Add(1)
+		bytes.Add(n)
+	}}
+	var seen []string
+	passed, failed, err := VerifySumsFunc(sumsPath, dir, opts, func(path string, err error) {
+		seen = append(seen, path)
+		switch path {
+		case "f010":
+			if !errors.Is(err, ErrMismatch) {
+				t.Errorf("f010: err = %v, want ErrMismatch", err)
+			}
+		case "f150":
+			if err == nil || errors.Is(err, ErrMismatch) {
+				t.Errorf("f150: err = %v, want a read error", err)
+			}
+		default:
+			if err != nil {
+				t.Errorf("%s: %v", path, err)
+			}
+		}
+	})
+	if err != nil {
+		t.Fatalf("VerifySumsFunc: %v", err)
+	}
+	if passed != 198 || failed != 2 {
+		t.Errorf("passed %d, failed %d; want 198 and 2", passed, failed)
+	}
+	for i, e := range entries {
+		if i >= len(seen) || seen[i] != e.Path {
+			t.Fatalf("results not in sums file order at %d", i)
+		}
+	}
+	if files.Load() != 200 || bytes.Load() == 0 {
+		t.Errorf("progress saw %d files, %d bytes", files.Load(), bytes.Load())
+	}
+}
+
+func TestCreateSumsFromTree_Batched(t *testing.T) {
+	dir := t.TempDir()
+	for i := 0; i < 300; i++ { // more than one batch, a few files past uring.BatchFileSize
+		os.WriteFile(filepath.Join(dir, fmt.Sprintf("f%03d", i)), []byte(strings.Repeat("z", i*i)), 0644)
+	}
+	tree, err := scan.Scan(dir, scan.Options{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	// Changed after the scan: the batch read comes up short and the file
+	// is hashed again.
+	os.WriteFile(filepath.Join(dir, "f010"), []byte("rewritten"), 0644)
+	want, _ := Calculate(filepath.Join(dir, "f010"))
+
+	for _, alg := range []Algorithm{SHA256, SHA256Tree} {
+		got, err := CreateSumsFromTree(tree, "", filepath.Join(t.TempDir(), "sums"), Options{Jobs: 4, Algorithm: alg})
+		if err != nil {
+			t.Fatal(err)
+		}
+		t.Setenv(uring.DisableEnv, "0")
+		plain, err := CreateSumsFromTree(tree, "", filepath.Join(t.TempDir(), "sums"), Options{Jobs: 4, Algorithm: alg})
+		t.Setenv(uring.DisableEnv, "")
+		if err != nil {
+			t.Fatal(err)
+		}
+		for i := range plain {
+			if got[i] != plain[i] {
+				t.Errorf("%s: %v, want %v", alg, got[i], plain[i])
+			}
+		}
+		if alg == SHA256 && got[10].Checksum != want {
+			t.Errorf("changed file: %s, want %s", got[10].Checksum, want)
+		}
+	}
+}
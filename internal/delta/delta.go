@@ -0,0 +1,850 @@
+// Package delta — delta packages between consecutive versions of a package.
+// NurOS 2026 - GPL 3.0
+package delta
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"encoding/hex"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"syscall"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+	"github.com/NurOS-Linux/apgbuild/internal/metadata"
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// A delta is an archive, in the same format as a package, of what turns
+// one version of a package (From) into the next (To):
+//
+//   - the members of To that are new or changed, with their headers,
+//     always including metadata.json and the sums files;
+//   - .apgdelta/patch/<member>: binary diffs (see Diff) of large changed
+//     files against their version in From;
+//   - .apgdelta/manifest.json, the last member: the Manifest.
+//
+// What changed is told by the sums files both packages carry, so no file
+// is hashed to build a delta.
+const (
+	Ext    = ".apgd"
+	Format = 1 // Manifest.Format written by Create
+
+	// DefaultDiffMinSize is the smallest changed file Options.Diff tries
+	// to store as a patch.
+	DefaultDiffMinSize = 1 << 20
+
+	metaDir      = ".apgdelta"
+	manifestName = metaDir + "/manifest.json"
+	patchPrefix  = metaDir + "/patch/"
+)
+
+// sumsFiles are the sums files of a package and the directory each covers.
+var sumsFiles = []struct{ name, dir string }{{"sha256sums", "data"}, {"sha256sums.home", "home"}}
+
+// Manifest says how to rebuild To from an extracted From and the members
+// stored in the delta. Paths are member paths.
+type Manifest struct {
+	Format int     `json:"format"`
+	From   Version `json:"from"`
+	To     Version `json:"to"`
+	// Removed are members of From that are not in To, or are of another
+	// type there (a directory that became a file).
+	Removed []string `json:"removed,omitempty"`
+	// Copies are files of To whose content is a file of From elsewhere
+	// (moved or duplicated).
+	Copies []Copy `json:"copies,omitempty"`
+	// Patches are files of To rebuilt by applying .apgdelta/patch/<Path>
+	// to From's file.
+	Patches []Copy `json:"patches,omitempty"`
+	// Links are the hardlinks of To.
+	Links []Link `json:"links,omitempty"`
+	// Attrs are headers of To's members not stored in the delta: copies,
+	// patches, unchanged files whose header changed, and all directories.
+	Attrs []Attr `json:"attrs,omitempty"`
+}
+
+// Version identifies a package by name, version and its sums files.
+type Version struct {
+	Name    string            `json:"name"`
+	Version string            `json:"version"`
+	Sums    map[string]string `json:"sums"` // sums file → SHA-256 of its content
+}
+
+// Copy names a file of To made from the file From of the old package.
+type Copy struct {
+	Path string `json:"path"`
+	From string `json:"from"`
+}
+
+// Link is a hardlink of To.
+type Link struct {
+	Path   string `json:"path"`
+	Target string `json:"target"`
+}
+
+// Attr is the header of a member of To.
+type Attr struct {
+	Path  string `json:"path"`
+	Mode  uint32 `json:"mode"`  // permission bits, as in a tar header
+	MTime int64  `json:"mtime"` // Unix nanoseconds
+	UID   int64  `json:"uid"`
+	GID   int64  `json:"gid"`
+}
+
+// Options configures Create.
+type Options struct {
+	// Diff stores changed files of at least DiffMinSize bytes as binary
+	// diffs against their old version, when the diff is under half the
+	// size of the file.
+	Diff        bool
+	DiffMinSize int64 // 0 = DefaultDiffMinSize
+	// Archive is the compression of the delta.
+	Archive archive.CreateOptions
+	// Limits bounds both packages while they are read.
+	Limits archive.Limits
+}
+
+func (o Options) diffMinSize() int64 {
+	if o.DiffMinSize > 0 {
+		return o.DiffMinSize
+	}
+	return DefaultDiffMinSize
+}
+
+// Result counts the members of To by how a delta carries them.
+type Result struct {
+	Stored    int // whole
+	Patched   int // as binary diffs
+	Copied    int // from another path of From
+	Unchanged int // not at all
+	Removed   int // members of From dropped
+	Size      int64
+}
+
+// ── Create ──────────────────────────────────────────────────────────────────
+
+// pkgInfo is what one pass over a package collects.
+type pkgInfo struct {
+	entries []*archive.Entry
+	byPath  map[string]*archive.Entry
+	sums    map[string]string // member → "algorithm:sum"
+	ref     Version
+}
+
+// readPackage reads the headers, metadata.json and sums files of pkgPath
+// in one pass. data, if not nil, is called for every other regular member
+// and may read its content.
+func readPackage(pkgPath string, limits archive.Limits, data func(e *archive.Entry, r io.Reader) error) (*pkgInfo, error) {
+	ar, err := archive.OpenReaderWithLimits(pkgPath, limits)
+	if err != nil {
+		return nil, err
+	}
+	defer ar.Close()
+
+	p := &pkgInfo{byPath: map[string]*archive.Entry{}, sums: map[string]string{}, ref: Version{Sums: map[string]string{}}}
+	for {
+		e, err := ar.Next()
+		if errors.Is(err, io.EOF) {
+			break
+		}
+		if err != nil {
+			return nil, err
+		}
+		p.entries = append(p.entries, e)
+		p.byPath[e.Path] = e
+		if e.Type != archive.TypeRegular {
+			continue
+		}
+		dir, isSums := sumsDir(e.Path)
+		switch {
+		case e.Path == "metadata.json":
+			raw, err := io.ReadAll(ar)
+			if err != nil {
+				return nil, err
+			}
+			var meta metadata.Metadata
+			if err := json.Unmarshal(raw, &meta); err != nil {
+				return nil, fmt.Errorf("%s: parse metadata.json: %w", pkgPath, err)
+			}
+			p.ref.Name, p.ref.Version = meta.Name, meta.Version
+		case isSums:
+			raw, err := io.ReadAll(ar)
+			if err != nil {
+				return nil, err
+			}
+			sum := sha256.Sum256(raw)
+			p.ref.Sums[e.Path] = hex.EncodeToString(sum[:])
+			s, err := checksum.ReadSums(bytes.NewReader(raw))
+			if err != nil {
+				return nil, fmt.Errorf("%s: %s: %w", pkgPath, e.Path, err)
+			}
+			for _, se := range s.Entries {
+				p.sums[dir+"/"+filepath.ToSlash(se.Path)] = string(s.Algorithm) + ":" + se.Checksum
+			}
+		case data != nil:
+			if err := data(e, ar); err != nil {
+				return nil, err
+			}
+		}
+	}
+	if p.ref.Name == "" {
+		return nil, fmt.Errorf("%s: no package name in metadata.json", pkgPath)
+	}
+	return p, nil
+}
+
+// sumsDir returns the directory the sums file member covers.
+func sumsDir(member string) (string, bool) {
+	for _, s := range sumsFiles {
+		if s.name == member {
+			return s.dir, true
+		}
+	}
+	return "", false
+}
+
+// isTOC reports whether member is one of archive.TOCMembers.
+func isTOC(member string) bool {
+	for _, name := range archive.TOCMembers {
+		if name == member {
+			return true
+		}
+	}
+	return false
+}
+
+// hasFile reports whether e leaves a file with content in an extracted tree.
+func hasFile(e *archive.Entry) bool {
+	return e.Type == archive.TypeRegular || e.Type == archive.TypeHardlink
+}
+
+// sameKind reports whether new can replace old in place.
+func sameKind(old, new *archive.Entry) bool {
+	return old.Type == new.Type || hasFile(old) && hasFile(new)
+}
+
+func attrOf(e *archive.Entry) Attr {
+	uid, gid := e.Owner()
+	return Attr{Path: e.Path, Mode: unixPerm(e.Mode), MTime: e.ModTime.UnixNano(), UID: uid, GID: gid}
+}
+
+// Create writes to out a delta that turns the package oldPkg into newPkg.
+// newPkg is read twice and oldPkg once, as streams; with opts.Diff, the
+// old versions of large changed files are kept in a temporary directory
+// next to out while the delta is written.
+func Create(oldPkg, newPkg, out string, opts Options) (*Result, error) {
+	nw, err := readPackage(newPkg, opts.Limits, nil)
+	if err != nil {
+		return nil, err
+	}
+	tmp, err := os.MkdirTemp(filepath.Dir(out), metaDir+"-")
+	if err != nil {
+		return nil, err
+	}
+	defer os.RemoveAll(tmp)
+
+	minSize := opts.diffMinSize()
+	bases := map[string]string{} // member → its old version in tmp
+	old, err := readPackage(oldPkg, opts.Limits, func(e *archive.Entry, r io.Reader) error {
+		n := nw.byPath[e.Path]
+		if !opts.Diff || n == nil || n.Type != archive.TypeRegular || n.Size < minSize || nw.sums[e.Path] == "" {
+			return nil
+		}
+		f := filepath.Join(tmp, "base"+strconv.Itoa(len(bases)))
+		if err := writeFile(f, r); err != nil {
+			return err
+		}
+		bases[e.Path] = f
+		return nil
+	})
+	if err != nil {
+		return nil, err
+	}
+
+	m := &Manifest{Format: Format, From: old.ref, To: nw.ref}
+	byContent := map[string]string{} // "algorithm:sum" → a file of From
+	for _, e := range old.entries {
+		if s, ok := old.sums[e.Path]; ok && hasFile(e) {
+			if _, dup := byContent[s]; !dup {
+				byContent[s] = e.Path
+			}
+		}
+	}
+	res := &Result{}
+	store, patch := map[string]bool{}, map[string]bool{}
+	for _, e := range nw.entries {
+		o := old.byPath[e.Path]
+		if o != nil && !sameKind(o, e) {
+			m.Removed = append(m.Removed, e.Path)
+			o = nil
+		}
+		s, summed := nw.sums[e.Path]
+		switch {
+		case isTOC(e.Path) || e.Type == archive.TypeOther:
+			store[e.Path] = true
+		case e.Type == archive.TypeHardlink:
+			m.Links = append(m.Links, Link{Path: e.Path, Target: e.Linkname})
+		case e.Type == archive.TypeRegular && summed && o != nil && old.sums[e.Path] == s:
+			res.Unchanged++
+			if attrOf(o) != attrOf(e) {
+				m.Attrs = append(m.Attrs, attrOf(e))
+			}
+		case e.Type == archive.TypeRegular && summed && byContent[s] != "":
+			res.Copied++
+			m.Copies = append(m.Copies, Copy{Path: e.Path, From: byContent[s]})
+			m.Attrs = append(m.Attrs, attrOf(e))
+		case e.Type == archive.TypeRegular && bases[e.Path] != "":
+			patch[e.Path] = true // a patch if it turns out small enough
+		case e.Type == archive.TypeRegular:
+			store[e.Path] = true
+		case o != nil && o.Linkname == e.Linkname:
+			// Directories are always listed: their mtimes change while
+			// the tree is patched.
+			res.Unchanged++
+			if e.Type == archive.TypeDir || attrOf(o) != attrOf(e) {
+				m.Attrs = append(m.Attrs, attrOf(e))
+			}
+		default:
+			store[e.Path] = true
+		}
+	}
+	for _, e := range old.entries {
+		if nw.byPath[e.Path] == nil {
+			m.Removed = append(m.Removed, e.Path)
+		}
+	}
+	res.Removed = len(m.Removed)
+
+	ar, err := archive.OpenReaderWithLimits(newPkg, opts.Limits)
+	if err != nil {
+		return nil, err
+	}
+	defer ar.Close()
+	aw, err := archive.NewWriter(out, opts.Archive)
+	if err != nil {
+		return nil, err
+	}
+	fail := func(err error) (*Result, error) {
+		aw.Close() //nolint:errcheck
+		os.Remove(out)
+		return nil, err
+	}
+	buf := make([]byte, 1<<20)
+	var mtime time.Time
+	for {
+		e, err := ar.Next()
+		if errors.Is(err, io.EOF) {
+			break
+		}
+		if err != nil {
+			return fail(err)
+		}
+		if e.Path == "metadata.json" {
+			mtime = e.ModTime
+		}
+		switch {
+		case store[e.Path]:
+			res.Stored++
+			err = copyMember(aw, e, ar, buf)
+		case patch[e.Path]:
+			var patched bool
+			if patched, err = diffMember(aw, e, ar, bases[e.Path], tmp, buf); patched {
+				res.Patched++
+				m.Patches = append(m.Patches, Copy{Path: e.Path, From: e.Path})
+				m.Attrs = append(m.Attrs, attrOf(e))
+			} else {
+				res.Stored++
+			}
+		}
+		if err != nil {
+			return fail(fmt.Errorf("%s: %w", e.Path, err))
+		}
+	}
+
+	raw, err := json.MarshalIndent(m, "", "  ")
+	if err != nil {
+		return fail(err)
+	}
+	hdr := &archive.Entry{Path: manifestName, Type: archive.TypeRegular, Mode: 0644, Size: int64(len(raw)), ModTime: mtime}
+	if err := copyMember(aw, hdr, bytes.NewReader(raw), buf); err != nil {
+		return fail(err)
+	}
+	cr, err := aw.Close()
+	if err != nil {
+		os.Remove(out)
+		return nil, err
+	}
+	res.Size = cr.CompressedSize
+	return res, nil
+}
+
+// copyMember writes the header e and the data of e read from r.
+func copyMember(aw *archive.Writer, e *archive.Entry, r io.Reader, buf []byte) error {
+	n, err := aw.WriteEntry(e)
+	if err != nil || n == 0 {
+		return err
+	}
+	m, err := io.CopyBuffer(aw, io.LimitReader(r, n), buf)
+	if err == nil && m != n {
+		err = io.ErrUnexpectedEOF
+	}
+	return err
+}
+
+// diffMember stores the member e read from r as a patch against the file
+// base if that is under half its size, and whole otherwise. It reports
+// whether it stored a patch.
+func diffMember(aw *archive.Writer, e *archive.Entry, r io.Reader, base, tmp string, buf []byte) (bool, error) {
+	whole, err := os.CreateTemp(tmp, "new")
+	if err != nil {
+		return false, err
+	}
+	defer func() { whole.Close(); os.Remove(whole.Name()) }()
+	patch, err := os.CreateTemp(tmp, "patch")
+	if err != nil {
+		return false, err
+	}
+	defer func() { patch.Close(); os.Remove(patch.Name()) }()
+
+	data, unmap, err := mapFile(base)
+	if err != nil {
+		return false, err
+	}
+	n, err := Diff(data, io.TeeReader(r, whole), e.Size, patch)
+	unmap()
+	if err != nil {
+		return false, err
+	}
+	os.Remove(base)
+
+	src, hdr := whole, e
+	if n < e.Size/2 {
+		src = patch
+		hdr = &archive.Entry{Path: patchPrefix + e.Path, Type: archive.TypeRegular, Mode: 0644, Size: n, ModTime: e.ModTime}
+	}
+	if _, err := src.Seek(0, io.SeekStart); err != nil {
+		return false, err
+	}
+	return src == patch, copyMember(aw, hdr, src, buf)
+}
+
+// mapFile maps the file at path read-only.
+func mapFile(path string) ([]byte, func(), error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, nil, err
+	}
+	defer f.Close()
+	fi, err := f.Stat()
+	if err != nil {
+		return nil, nil, err
+	}
+	if fi.Size() == 0 {
+		return nil, func() {}, nil
+	}
+	data, err := syscall.Mmap(int(f.Fd()), 0, int(fi.Size()), syscall.PROT_READ, syscall.MAP_SHARED)
+	if err != nil {
+		return nil, nil, fmt.Errorf("mmap %s: %w", path, err)
+	}
+	return data, func() { syscall.Munmap(data) }, nil
+}
+
+func writeFile(path string, r io.Reader) error {
+	f, err := os.Create(path)
+	if err != nil {
+		return err
+	}
+	if _, err := io.Copy(f, r); err != nil {
+		f.Close()
+		return err
+	}
+	return f.Close()
+}
+
+// ── Apply ───────────────────────────────────────────────────────────────────
+
+// ApplyOptions configures ApplyTree and ApplyPackage.
+type ApplyOptions struct {
+	// Jobs is the number of extraction and verification workers
+	// (0 = number of CPUs).
+	Jobs int
+	// Limits bounds the delta and, for ApplyPackage, the old package.
+	Limits archive.Limits
+	// Archive is the compression of the package ApplyPackage writes.
+	Archive archive.CreateOptions
+}
+
+// errUnsafePath marks a manifest path outside the tree.
+var errUnsafePath = errors.New("unsafe path in delta")
+
+// ApplyTree turns dir, the extracted From package of the delta, into its
+// To package. The delta is extracted into a staging directory inside dir
+// and everything taken from the old files (copies and patches) is staged
+// before dir is changed; then removed members are deleted, the staged
+// files moved into place, hardlinks made and headers applied. Finally the
+// tree is verified against To's sums files.
+//
+// Owners are only applied when running as root.
+func ApplyTree(dir, deltaPath string, opts ApplyOptions) (*Manifest, error) {
+	stage, err := os.MkdirTemp(dir, metaDir+"-")
+	if err != nil {
+		return nil, err
+	}
+	defer os.RemoveAll(stage)
+	if err := archive.ExtractWithOptions(deltaPath, stage, archive.ExtractOptions{Jobs: opts.Jobs, Limits: opts.Limits}); err != nil {
+		return nil, err
+	}
+	m, err := readManifest(filepath.Join(stage, filepath.FromSlash(manifestName)))
+	if err != nil {
+		return nil, err
+	}
+	if err := m.From.check(dir); err != nil {
+		return nil, err
+	}
+	for _, p := range m.paths() {
+		if err := checkPath(dir, p); err != nil {
+			return nil, err
+		}
+	}
+
+	for _, p := range m.Patches {
+		err := patchFile(filepath.Join(dir, p.From), filepath.Join(stage, patchPrefix+p.Path), filepath.Join(stage, p.Path))
+		if err != nil {
+			return nil, fmt.Errorf("patch %s: %w", p.Path, err)
+		}
+	}
+	for _, c := range m.Copies {
+		if err := copyFile(filepath.Join(dir, c.From), filepath.Join(stage, c.Path)); err != nil {
+			return nil, fmt.Errorf("copy %s: %w", c.Path, err)
+		}
+	}
+	if err := os.RemoveAll(filepath.Join(stage, metaDir)); err != nil {
+		return nil, err
+	}
+
+	removed := append([]string(nil), m.Removed...)
+	sort.Sort(sort.Reverse(sort.StringSlice(removed))) // children first
+	for _, p := range removed {
+		if err := os.RemoveAll(filepath.Join(dir, p)); err != nil {
+			return nil, err
+		}
+	}
+	created, err := merge(stage, dir)
+	if err != nil {
+		return nil, err
+	}
+	for _, l := range m.Links {
+		if err := checkPath(dir, l.Path); err != nil {
+			return nil, err
+		}
+		if err := checkPath(dir, l.Target); err != nil {
+			return nil, err
+		}
+		full := filepath.Join(dir, l.Path)
+		if err := os.Remove(full); err != nil && !os.IsNotExist(err) {
+			return nil, err
+		}
+		if err := os.Link(filepath.Join(dir, l.Target), full); err != nil {
+			return nil, err
+		}
+	}
+	for _, a := range m.Attrs {
+		if err := a.apply(dir); err != nil {
+			return nil, err
+		}
+	}
+	for i := len(created) - 1; i >= 0; i-- { // deepest first
+		if err := os.Chtimes(created[i].path, created[i].mtime, created[i].mtime); err != nil {
+			return nil, err
+		}
+	}
+
+	if err := m.To.check(dir); err != nil {
+		return nil, fmt.Errorf("after applying the delta: %w", err)
+	}
+	for name := range m.To.Sums {
+		sub, _ := sumsDir(name)
+		_, failed, err := checksum.VerifySumsWithOptions(filepath.Join(dir, name), filepath.Join(dir, sub), checksum.Options{Jobs: opts.Jobs})
+		if err != nil {
+			return nil, err
+		}
+		if len(failed) > 0 {
+			return nil, fmt.Errorf("after applying the delta, %d files fail %s (first: %s)", len(failed), name, failed[0])
+		}
+	}
+	return m, nil
+}
+
+// ApplyPackage writes to out the To package of the delta, rebuilt from the
+// package oldPkg: oldPkg is extracted into a temporary directory next to
+// out, patched by ApplyTree and archived with opts.Archive. Members are
+// stored with their headers from the patched tree, so owners other than
+// the caller's survive only when running as root (or are normalized with
+// opts.Archive.Reproducible).
+func ApplyPackage(oldPkg, deltaPath, out string, opts ApplyOptions) (*Manifest, *archive.CreateResult, error) {
+	tmp, err := os.MkdirTemp(filepath.Dir(out), metaDir+"-")
+	if err != nil {
+		return nil, nil, err
+	}
+	defer os.RemoveAll(tmp)
+	dir := filepath.Join(tmp, "pkg")
+	if err := archive.ExtractWithOptions(oldPkg, dir, archive.ExtractOptions{Jobs: opts.Jobs, Limits: opts.Limits}); err != nil {
+		return nil, nil, err
+	}
+	m, err := ApplyTree(dir, deltaPath, opts)
+	if err != nil {
+		return nil, nil, err
+	}
+	tree, err := scan.Scan(dir, scan.Options{})
+	if err != nil {
+		return nil, nil, err
+	}
+	res, err := archive.CreateFromTree(out, tree, opts.Archive)
+	if err != nil {
+		return nil, nil, err
+	}
+	return m, res, nil
+}
+
+// readManifest loads a manifest and checks that its paths stay in a tree.
+func readManifest(path string) (*Manifest, error) {
+	raw, err := os.ReadFile(path)
+	if err != nil {
+		return nil, fmt.Errorf("not a delta: %w", err)
+	}
+	var m Manifest
+	if err := json.Unmarshal(raw, &m); err != nil {
+		return nil, fmt.Errorf("parse %s: %w", manifestName, err)
+	}
+	if m.Format != Format {
+		return nil, fmt.Errorf("unsupported delta format %d", m.Format)
+	}
+	for _, p := range m.paths() {
+		if !filepath.IsLocal(p) || p == metaDir || strings.HasPrefix(p, metaDir+"/") {
+			return nil, fmt.Errorf("%w: %q", errUnsafePath, p)
+		}
+	}
+	return &m, nil
+}
+
+// paths lists every path m names.
+func (m *Manifest) paths() []string {
+	paths := append([]string(nil), m.Removed...)
+	for _, c := range append(append([]Copy(nil), m.Copies...), m.Patches...) {
+		paths = append(paths, c.Path, c.From)
+	}
+	for _, l := range m.Links {
+		paths = append(paths, l.Path, l.Target)
+	}
+	for _, a := range m.Attrs {
+		paths = append(paths, a.Path)
+	}
+	for name := range m.From.Sums {
+		paths = append(paths, name)
+	}
+	for name := range m.To.Sums {
+		paths = append(paths, name)
+	}
+	return paths
+}
+
+// check compares the sums files in dir with v's.
+func (v Version) check(dir string) error {
+	for name, want := range v.Sums {
+		raw, err := os.ReadFile(filepath.Join(dir, name))
+		if err == nil {
+			got := sha256.Sum256(raw)
+			if hex.EncodeToString(got[:]) == want {
+				continue
+			}
+			err = errors.New("content differs")
+		}
+		return fmt.Errorf("%s is not %s %s: %s: %w", dir, v.Name, v.Version, name, err)
+	}
+	return nil
+}
+
+// checkPath fails if rel leads out of dir through a symlink in dir.
+func checkPath(dir, rel string) error {
+	p := dir
+	parts := strings.Split(filepath.ToSlash(rel), "/")
+	for _, part := range parts[:len(parts)-1] {
+		p = filepath.Join(p, part)
+		if fi, err := os.Lstat(p); err == nil && fi.Mode()&os.ModeSymlink != 0 {
+			return fmt.Errorf("%w: %s runs through the symlink %s", errUnsafePath, rel, p)
+		}
+	}
+	return nil
+}
+
+func patchFile(base, patch, out string) error {
+	bf, err := openRegular(base)
+	if err != nil {
+		return err
+	}
+	defer bf.Close()
+	pf, err := openRegular(patch)
+	if err != nil {
+		return err
+	}
+	defer pf.Close()
+	return createWith(out, func(w io.Writer) error { return Patch(bf, pf, w) })
+}
+
+func copyFile(src, out string) error {
+	f, err := openRegular(src)
+	if err != nil {
+		return err
+	}
+	defer f.Close()
+	return createWith(out, func(w io.Writer) error { _, err := io.Copy(w, f); return err })
+}
+
+// openRegular opens path for reading if it is a regular file, without
+// following a symlink in its last component (checkPath covers the others).
+func openRegular(path string) (*os.File, error) {
+	f, err := os.OpenFile(path, os.O_RDONLY|syscall.O_NOFOLLOW|syscall.O_NONBLOCK, 0)
+	if err != nil {
+		if errors.Is(err, syscall.ELOOP) {
+			return nil, fmt.Errorf("%w: %s is a symlink", errUnsafePath, path)
+		}
+		return nil, err
+	}
+	if fi, err := f.Stat(); err != nil || !fi.Mode().IsRegular() {
+		f.Close()
+		if err == nil {
+			err = fmt.Errorf("%w: %s is not a regular file", errUnsafePath, path)
+		}
+		return nil, err
+	}
+	return f, nil
+}
+
+// createWith creates out (and its parents) with content written by fill.
+func createWith(out string, fill func(io.Writer) error) error {
+	if err := os.MkdirAll(filepath.Dir(out), 0755); err != nil {
+		return err
+	}
+	f, err := os.Create(out)
+	if err != nil {
+		return err
+	}
+	if err := fill(f); err != nil {
+		f.Close()
+		return err
+	}
+	return f.Close()
+}
+
+// createdDir is a directory merge made, and the mtime it gets at the end.
+type createdDir struct {
+	path  string
+	mtime time.Time
+}
+
+// merge moves everything below stage to the same place below dir.
+// Directories that exist in dir are kept; the others are created with the
+// mode and owner of the staged one and returned, parents first.
+func merge(stage, dir string) ([]createdDir, error) {
+	var created []createdDir
+	root := os.Geteuid() == 0
+	err := filepath.WalkDir(stage, func(src string, d os.DirEntry, err error) error {
+		if err != nil || src == stage {
+			return err
+		}
+		rel, _ := filepath.Rel(stage, src)
+		if err := checkPath(dir, rel); err != nil {
+			return err
+		}
+		dst := filepath.Join(dir, rel)
+		if !d.IsDir() {
+			return os.Rename(src, dst)
+		}
+		if fi, err := os.Lstat(dst); err == nil && fi.IsDir() {
+			return nil
+		}
+		fi, err := d.Info()
+		if err != nil {
+			return err
+		}
+		if err := os.Mkdir(dst, 0700); err != nil {
+			return err
+		}
+		if st, ok := fi.Sys().(*syscall.Stat_t); ok && root {
+			if err := os.Lchown(dst, int(st.Uid), int(st.Gid)); err != nil {
+				return err
+			}
+		}
+		if err := os.Chmod(dst, fi.Mode()&(os.ModePerm|os.ModeSetuid|os.ModeSetgid|os.ModeSticky)); err != nil {
+			return err
+		}
+		created = append(created, createdDir{dst, fi.ModTime()})
+		return nil
+	})
+	return created, err
+}
+
+// apply sets a's header on its member in dir.
+func (a Attr) apply(dir string) error {
+	if err := checkPath(dir, a.Path); err != nil {
+		return err
+	}
+	p := filepath.Join(dir, a.Path)
+	fi, err := os.Lstat(p)
+	if err != nil {
+		return err
+	}
+	if os.Geteuid() == 0 {
+		if err := os.Lchown(p, int(a.UID), int(a.GID)); err != nil {
+			return err
+		}
+	}
+	if fi.Mode()&os.ModeSymlink != 0 {
+		return nil
+	}
+	if err := os.Chmod(p, fileMode(a.Mode)); err != nil {
+		return err
+	}
+	t := time.Unix(0, a.MTime)
+	return os.Chtimes(p, t, t)
+}
+
+// unixPerm converts an os.FileMode to tar permission bits.
+func unixPerm(m os.FileMode) uint32 {
+	perm := uint32(m.Perm())
+	if m&os.ModeSetuid != 0 {
+		perm |= 04000
+	}
+	if m&os.ModeSetgid != 0 {
+		perm |= 02000
+	}
+	if m&os.ModeSticky != 0 {
+		perm |= 01000
+	}
+	return perm
+}
+
+// fileMode is the inverse of unixPerm.
+func fileMode(perm uint32) os.FileMode {
+	m := os.FileMode(perm & 0777)
+	if perm&04000 != 0 {
+		m |= os.ModeSetuid
+	}
+	if perm&02000 != 0 {
+		m |= os.ModeSetgid
+	}
+	if perm&01000 != 0 {
+		m |= os.ModeSticky
+	}
+	return m
+}
@@ -0,0 +1,263 @@
+// Package delta — delta creation and application tests.
+// NurOS 2026 - GPL 3.0
+package delta
+
+import (
+	"bytes"
+	"errors"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+	"github.com/NurOS-Linux/apgbuild/internal/checksum"
+)
+
+// writePackage builds dir (metadata.json and data/) into an .apg with sums.
+func writePackage(t *testing.T, dir, out string) {
+	t.Helper()
+	if _, err := checksum.CreateSums(filepath.Join(dir, "data"), filepath.Join(dir, "sha256sums")); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := archive.Create(out, dir); err != nil {
+		t.Fatal(err)
+	}
+}
+
+// versions builds two versions of a package in dir and returns their .apg paths.
+func versions(t *testing.T, dir string) (oldPkg, newPkg string) {
+	t.Helper()
+	big := make([]byte, 2<<20)
+	rand.New(rand.NewSource(3)).Read(big)
+	stamp := time.Date(2026, 1, 2, 3, 4, 5, 0, time.UTC)
+
+	type file struct {
+		content string
+		mode    os.FileMode
+	}
+	build := func(name, version string, files map[string]file, links map[string]string, hard map[string]string) string {
+		root := filepath.Join(dir, version)
+		files["metadata.json"] = file{`{"name":"` + name + `","version":"` + version + `","architecture":"x86_64"}`, 0644}
+		for p, f := range files {
+			full := filepath.Join(root, p)
+			os.MkdirAll(filepath.Dir(full), 0755)
+			if err := os.WriteFile(full, []byte(f.content), f.mode); err != nil {
+				t.Fatal(err)
+			}
+			os.Chmod(full, f.mode)
+			os.Chtimes(full, stamp, stamp)
+		}
+		for p, target := range links {
+			os.Symlink(target, filepath.Join(root, p))
+		}
+		for p, target := range hard {
+			os.Link(filepath.Join(root, target), filepath.Join(root, p))
+		}
+		out := filepath.Join(dir, name+"-"+version+".apg")
+		writePackage(t, root, out)
+		return out
+	}
+
+	edited := append([]byte(nil), big[:1<<20]...)
+	edited = append(edited, "a few new bytes"...)
+	edited = append(edited, big[1<<20:]...)
+	oldPkg = build("demo", "1.0", map[string]file{
+		"data/usr/bin/tool":            {"tool v1", 0755},
+		"data/usr/share/same.txt":      {"unchanged", 0644},
+		"data/usr/share/moved.txt":     {"moved content", 0644},
+		"data/usr/share/gone.txt":      {"gone", 0644},
+		"data/usr/share/mode.txt":      {"mode", 0644},
+		"data/usr/share/becomes/dir":   {"a file first", 0644},
+		"data/olddir/inner.txt":        {"inner", 0644},
+		"data/usr/lib/firmware.bin":    {string(big), 0644},
+		"data/usr/lib/libx.so.1":       {"lib", 0755},
+		"data/usr/share/doc/README.md": {"readme", 0644},
+	}, map[string]string{"data/usr/lib/libx.so": "libx.so.1"}, nil)
+	newPkg = build("demo", "1.1", map[string]file{
+		"data/usr/bin/tool":            {"tool v2", 0755},
+		"data/usr/share/same.txt":      {"unchanged", 0644},
+		"data/usr/lib/moved.txt":       {"moved content", 0644},
+		"data/usr/share/mode.txt":      {"mode", 0600},
+		"data/usr/share/becomes/dir/x": {"now a directory", 0644},
+		"data/usr/share/new.txt":       {"new", 0644},
+		"data/usr/lib/firmware.bin":    {string(edited), 0644},
+		"data/usr/lib/libx.so.2":       {"lib", 0755},
+		"data/usr/share/doc/README.md": {"readme", 0644},
+	}, map[string]string{"data/usr/lib/libx.so": "libx.so.2"}, map[string]string{"data/usr/bin/tool2": "data/usr/bin/tool"})
+	return oldPkg, newPkg
+}
+
+// sameTree fails unless dirs a and b hold the same entries, contents,
+// link targets, permissions and file mtimes.
+func sameTree(t *testing.T, a, b string) {
+	t.Helper()
+	list := func(root string) map[string]os.FileInfo {
+		m := map[string]os.FileInfo{}
+		filepath.Walk(root, func(p string, fi os.FileInfo, err error) error {
+			if err == nil && p != root {
+				rel, _ := filepath.Rel(root, p)
+				m[rel] = fi
+			}
+			return err
+		})
+		return m
+	}
+	la, lb := list(a), list(b)
+	for rel, fa := range la {
+		fb, ok := lb[rel]
+		switch {
+		case !ok:
+			t.Errorf("%s: only in %s", rel, a)
+			continue
+		case fa.Mode() != fb.Mode():
+			t.Errorf("%s: mode %v, want %v", rel, fa.Mode(), fb.Mode())
+		case fa.Mode().IsRegular():
+			ca, _ := os.ReadFile(filepath.Join(a, rel))
+			cb, _ := os.ReadFile(filepath.Join(b, rel))
+			if !bytes.Equal(ca, cb) {
+				t.Errorf("%s: content differs", rel)
+			}
+		case fa.Mode()&os.ModeSymlink != 0:
+			ta, _ := os.Readlink(filepath.Join(a, rel))
+			tb, _ := os.Readlink(filepath.Join(b, rel))
+			if ta != tb {
+				t.Errorf("%s: link to %s, want %s", rel, ta, tb)
+			}
+		}
+		if fa.Mode()&os.ModeSymlink == 0 && fa.ModTime().Unix() != fb.ModTime().Unix() {
+			t.Errorf("%s: mtime %v, want %v", rel, fa.ModTime(), fb.ModTime())
+		}
+	}
+	for rel := range lb {
+		if _, ok := la[rel]; !ok {
+			t.Errorf("%s: missing", rel)
+		}
+	}
+}
+
+func extract(t *testing.T, pkg string) string {
+	t.Helper()
+	dir := t.TempDir()
+	if err := archive.ExtractWithOptions(pkg, dir, archive.ExtractOptions{Jobs: 2}); err != nil {
+		t.Fatal(err)
+	}
+	return dir
+}
+
+func TestDelta(t *testing.T) {
+	dir := t.TempDir()
+	oldPkg, newPkg := versions(t, dir)
+	out := filepath.Join(dir, "demo"+Ext)
+	res, err := Create(oldPkg, newPkg, out, Options{Diff: true})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if res.Patched != 1 || res.Copied != 2 || res.Removed < 4 {
+		t.Errorf("result %+v: want 1 patched, 2 copied (moved.txt, libx.so.2), 4+ removed", res)
+	}
+	fi, _ := os.Stat(newPkg)
+	if res.Size >= fi.Size()/2 {
+		t.Errorf("delta of %d bytes for a package of %d", res.Size, fi.Size())
+	}
+
+	members, err := archive.ListContents(out)
+	if err != nil {
+		t.Fatal(err)
+	}
+	stored := map[string]bool{}
+	for _, e := range members {
+		stored[e.Path] = true
+	}
+	for _, p := range []string{"metadata.json", "sha256sums", "data/usr/bin/tool", "data/usr/share/new.txt", manifestName, patchPrefix + "data/usr/lib/firmware.bin"} {
+		if !stored[p] {
+			t.Errorf("%s not in the delta", p)
+		}
+	}
+	for _, p := range []string{"data/usr/share/same.txt", "data/usr/lib/moved.txt", "data/usr/lib/firmware.bin", "data/usr/bin/tool2"} {
+		if stored[p] {
+			t.Errorf("%s should not be stored whole", p)
+		}
+	}
+
+	want := extract(t, newPkg)
+
+	t.Run("tree", func(t *testing.T) {
+		tree := extract(t, oldPkg)
+		m, err := ApplyTree(tree, out, ApplyOptions{Jobs: 2})
+		if err != nil {
+			t.Fatal(err)
+		}
+		if m.From.Version != "1.0" || m.To.Version != "1.1" {
+			t.Errorf("manifest %s -> %s", m.From.Version, m.To.Version)
+		}
+		sameTree(t, tree, want)
+		a, _ := os.Stat(filepath.Join(tree, "data/usr/bin/tool"))
+		b, _ := os.Stat(filepath.Join(tree, "data/usr/bin/tool2"))
+		if !os.SameFile(a, b) {
+			t.Error("tool2 is not a hardlink of tool")
+		}
+
+		// The tree is now 1.1: the delta no longer applies.
+		if _, err := ApplyTree(tree, out, ApplyOptions{Jobs: 2}); err == nil || !strings.Contains(err.Error(), "is not demo 1.0") {
+			t.Errorf("applying twice: %v", err)
+		}
+	})
+
+	t.Run("package", func(t *testing.T) {
+		rebuilt := filepath.Join(t.TempDir(), "demo-1.1.apg")
+		if _, _, err := ApplyPackage(oldPkg, out, rebuilt, ApplyOptions{Jobs: 2, Archive: archive.CreateOptions{Level: 3}}); err != nil {
+			t.Fatal(err)
+		}
+		sameTree(t, extract(t, rebuilt), want)
+	})
+
+	t.Run("tampered", func(t *testing.T) {
+		tree := extract(t, oldPkg)
+		os.WriteFile(filepath.Join(tree, "data/usr/share/same.txt"), []byte("changed on disk"), 0644)
+		if _, err := ApplyTree(tree, out, ApplyOptions{Jobs: 2}); err == nil || !strings.Contains(err.Error(), "fail sha256sums") {
+			t.Errorf("got %v, want a verification failure", err)
+		}
+	})
+}
+
+func TestDelta_NoDiff(t *testing.T) {
+	dir := t.TempDir()
+	oldPkg, newPkg := versions(t, dir)
+	out := filepath.Join(dir, "demo"+Ext)
+	res, err := Create(oldPkg, newPkg, out, Options{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if res.Patched != 0 {
+		t.Errorf("%d patches without Diff", res.Patched)
+	}
+	tree := extract(t, oldPkg)
+	if _, err := ApplyTree(tree, out, ApplyOptions{Jobs: 1}); err != nil {
+		t.Fatal(err)
+	}
+	sameTree(t, tree, extract(t, newPkg))
+}
+
+func TestApplyTree_CopyFromSymlink(t *testing.T) {
+	dir := t.TempDir()
+	oldPkg, newPkg := versions(t, dir)
+	out := filepath.Join(dir, "demo"+Ext)
+	if _, err := Create(oldPkg, newPkg, out, Options{}); err != nil {
+		t.Fatal(err)
+	}
+
+	// The copy source of moved.txt leads outside, to the same content.
+	tree := extract(t, oldPkg)
+	outside := filepath.Join(t.TempDir(), "secret")
+	os.WriteFile(outside, []byte("moved content"), 0600)
+	from := filepath.Join(tree, "data/usr/share/moved.txt")
+	os.Remove(from)
+	os.Symlink(outside, from)
+
+	if _, err := ApplyTree(tree, out, ApplyOptions{Jobs: 1}); !errors.Is(err, errUnsafePath) {
+		t.Fatalf("got %v, want %v", err, errUnsafePath)
+	}
+}
@@ -0,0 +1,236 @@
+// Package delta — binary diffs of changed files.
+// NurOS 2026 - GPL 3.0
+package delta
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+)
+
+// A patch rebuilds a file from an older version of it, the base:
+//
+//	"APGDIFF1" | u64 size of the result
+//	ops, until the result is complete:
+//	  'C' u64 offset u64 length — length bytes of the base at offset
+//	  'D' u64 length, data      — length literal bytes
+//
+// Integers are little endian.
+const patchMagic = "APGDIFF1"
+
+// diffBlock is the granularity of copies from the base. Smaller blocks find
+// more matches at the cost of a larger index (one entry per block).
+const diffBlock = 4096
+
+// errCorruptPatch marks a patch that does not describe a result.
+var errCorruptPatch = errors.New("corrupt patch")
+
+// rolling is the rsync weak checksum of a diffBlock-byte window: the sum
+// of the bytes and the sum of the bytes weighted by their distance from
+// the end of the window. Both roll forward one byte in O(1).
+type rolling struct{ a, b uint32 }
+
+func (h *rolling) init(p []byte) {
+	h.a, h.b = 0, 0
+	for i, c := range p {
+		h.a += uint32(c)
+		h.b += uint32(len(p)-i) * uint32(c)
+	}
+}
+
+// roll drops out from the front of the window and appends in.
+func (h *rolling) roll(out, in byte) {
+	h.a += uint32(in) - uint32(out)
+	h.b += h.a - diffBlock*uint32(out)
+}
+
+func (h *rolling) sum() uint32 { return h.a&0xffff | h.b<<16 }
+
+// Diff writes to w a patch that rebuilds the size bytes read from r from
+// base, and returns the size of the patch. Every diffBlock-aligned block
+// of base is indexed by its weak checksum; the window rolls over r one
+// byte at a time, and wherever it matches a block byte for byte, the
+// block is copied instead of stored. Adjacent copies merge, so a file
+// that only had bytes inserted or replaced costs little more than the new
+// bytes.
+func Diff(base []byte, r io.Reader, size int64, w io.Writer) (int64, error) {
+	index := make(map[uint32]int64, len(base)/diffBlock)
+	var h rolling
+	for off := 0; off+diffBlock <= len(base); off += diffBlock {
+		h.init(base[off : off+diffBlock])
+		if _, ok := index[h.sum()]; !ok {
+			index[h.sum()] = int64(off)
+		}
+	}
+
+	pw := newPatchWriter(w, size)
+	buf := make([]byte, 2<<20)
+	n, pos, lit := 0, 0, 0 // buf[:n] is read, buf[lit:pos] literal, window at pos
+	eof, valid := false, false
+	for {
+		if n-pos <= diffBlock && !eof {
+			pw.literal(buf[lit:pos])
+			n = copy(buf, buf[pos:n])
+			pos, lit = 0, 0
+			m, err := io.ReadFull(r, buf[n:])
+			n += m
+			switch {
+			case err == io.EOF || err == io.ErrUnexpectedEOF:
+				eof = true
+			case err != nil:
+				return 0, err
+			}
+			continue
+		}
+		if n-pos < diffBlock {
+			break
+		}
+		if !valid {
+			h.init(buf[pos : pos+diffBlock])
+			valid = true
+		}
+		if off, ok := index[h.sum()]; ok && bytes.Equal(base[off:off+diffBlock], buf[pos:pos+diffBlock]) {
+			pw.literal(buf[lit:pos])
+			pw.copy(off, diffBlock)
+			pos += diffBlock
+			lit, valid = pos, false
+			continue
+		}
+		if n-pos == diffBlock {
+			break // at the end: no byte to roll in
+		}
+		h.roll(buf[pos], buf[pos+diffBlock])
+		pos++
+	}
+	pw.literal(buf[lit:n])
+	return pw.close()
+}
+
+// patchWriter encodes patch ops, merging adjacent copies.
+type patchWriter struct {
+	w           *bufio.Writer
+	cw          countWriter
+	size, done  int64 // bytes of the result: declared, covered by ops
+	off, length int64 // pending copy
+}
+
+func newPatchWriter(w io.Writer, size int64) *patchWriter {
+	p := &patchWriter{cw: countWriter{w: w}, size: size}
+	p.w = bufio.NewWriterSize(&p.cw, 64<<10)
+	p.w.WriteString(patchMagic)
+	p.u64(uint64(size))
+	return p
+}
+
+func (p *patchWriter) u64(v uint64) {
+	var b [8]byte
+	binary.LittleEndian.PutUint64(b[:], v)
+	p.w.Write(b[:])
+}
+
+func (p *patchWriter) copy(off, n int64) {
+	if p.length > 0 && p.off+p.length == off {
+		p.length += n
+		return
+	}
+	p.flushCopy()
+	p.off, p.length = off, n
+}
+
+func (p *patchWriter) flushCopy() {
+	if p.length == 0 {
+		return
+	}
+	p.w.WriteByte('C')
+	p.u64(uint64(p.off))
+	p.u64(uint64(p.length))
+	p.done += p.length
+	p.length = 0
+}
+
+func (p *patchWriter) literal(b []byte) {
+	if len(b) == 0 {
+		return
+	}
+	p.flushCopy()
+	p.w.WriteByte('D')
+	p.u64(uint64(len(b)))
+	p.w.Write(b)
+	p.done += int64(len(b))
+}
+
+func (p *patchWriter) close() (int64, error) {
+	p.flushCopy()
+	if err := p.w.Flush(); err != nil {
+		return 0, err
+	}
+	if p.done != p.size {
+		return 0, fmt.Errorf("diff: read %d bytes, want %d: %w", p.done, p.size, io.ErrUnexpectedEOF)
+	}
+	return p.cw.n, nil
+}
+
+// countWriter counts the bytes written through it.
+type countWriter struct {
+	w io.Writer
+	n int64
+}
+
+func (c *countWriter) Write(p []byte) (int, error) {
+	n, err := c.w.Write(p)
+	c.n += int64(n)
+	return n, err
+}
+
+// Patch writes to w the result of applying the patch read from r to base.
+func Patch(base io.ReaderAt, r io.Reader, w io.Writer) error {
+	br := bufio.NewReaderSize(r, 64<<10)
+	var hdr [16]byte
+	if _, err := io.ReadFull(br, hdr[:]); err != nil || string(hdr[:8]) != patchMagic {
+		return errCorruptPatch
+	}
+	size := int64(binary.LittleEndian.Uint64(hdr[8:]))
+	var arg [16]byte
+	for done := int64(0); done < size; {
+		op, err := br.ReadByte()
+		if err != nil {
+			return errCorruptPatch
+		}
+		var n int64
+		switch op {
+		case 'C':
+			if _, err := io.ReadFull(br, arg[:16]); err != nil {
+				return errCorruptPatch
+			}
+			off := int64(binary.LittleEndian.Uint64(arg[:8]))
+			if n = int64(binary.LittleEndian.Uint64(arg[8:])); n <= 0 || n > size-done || off < 0 {
+				return errCorruptPatch
+			}
+			if m, err := io.Copy(w, io.NewSectionReader(base, off, n)); err != nil {
+				return err
+			} else if m != n {
+				return fmt.Errorf("%w: copy past the end of the base", errCorruptPatch)
+			}
+		case 'D':
+			if _, err := io.ReadFull(br, arg[:8]); err != nil {
+				return errCorruptPatch
+			}
+			if n = int64(binary.LittleEndian.Uint64(arg[:8])); n <= 0 || n > size-done {
+				return errCorruptPatch
+			}
+			if _, err := io.CopyN(w, br, n); err != nil {
+				if err == io.EOF {
+					return errCorruptPatch
+				}
+				return err
+			}
+		default:
+			return errCorruptPatch
+		}
+		done += n
+	}
+	return nil
+}
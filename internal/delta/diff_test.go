@@ -0,0 +1,72 @@
+// Package delta — binary diff tests.
+// NurOS 2026 - GPL 3.0
+package delta
+
+import (
+	"bytes"
+	"errors"
+	"math/rand"
+	"testing"
+)
+
+func TestDiffPatch(t *testing.T) {
+	r := rand.New(rand.NewSource(1))
+	base := make([]byte, 1<<20+123)
+	r.Read(base)
+
+	edited := append([]byte(nil), base[:300000]...)
+	edited = append(edited, "inserted bytes"...)
+	edited = append(edited, base[300000:700000]...)
+	edited[500000] ^= 0xff
+	edited = append(edited, base[750000:]...) // 50000 bytes cut
+	junk := make([]byte, 5000)
+	r.Read(junk)
+
+	for name, data := range map[string][]byte{
+		"edited":   edited,
+		"appended": append(append([]byte(nil), base...), junk...),
+		"new":      junk,
+		"empty":    nil,
+		"tiny":     []byte("x"),
+	} {
+		var patch bytes.Buffer
+		n, err := Diff(base, bytes.NewReader(data), int64(len(data)), &patch)
+		if err != nil {
+			t.Fatalf("%s: %v", name, err)
+		}
+		if n != int64(patch.Len()) {
+			t.Errorf("%s: Diff returned %d, wrote %d", name, n, patch.Len())
+		}
+		var out bytes.Buffer
+		if err := Patch(bytes.NewReader(base), &patch, &out); err != nil {
+			t.Fatalf("%s: patch: %v", name, err)
+		}
+		if !bytes.Equal(out.Bytes(), data) {
+			t.Errorf("%s: patched result differs", name)
+		}
+		if name == "edited" && n > 5*diffBlock { // up to two blocks around each edit
+			t.Errorf("edited: patch of %d bytes for three small edits", n)
+		}
+	}
+
+	// A short read is an error, not a shorter result.
+	if _, err := Diff(base, bytes.NewReader(edited), int64(len(edited))+1, &bytes.Buffer{}); err == nil {
+		t.Error("expected an error for a short input")
+	}
+}
+
+func TestPatch_Corrupt(t *testing.T) {
+	base := []byte("0123456789")
+	for name, patch := range map[string]string{
+		"magic":     "NOTAPATCH0000000",
+		"truncated": patchMagic + "\x05\x00\x00\x00\x00\x00\x00\x00D\x05\x00\x00\x00\x00\x00\x00\x00ab",
+		"too long":  patchMagic + "\x01\x00\x00\x00\x00\x00\x00\x00D\x05\x00\x00\x00\x00\x00\x00\x00abcde",
+		"past base": patchMagic + "\x04\x00\x00\x00\x00\x00\x00\x00C\x08\x00\x00\x00\x00\x00\x00\x00\x04\x00\x00\x00\x00\x00\x00\x00",
+		"bad op":    patchMagic + "\x01\x00\x00\x00\x00\x00\x00\x00X",
+	} {
+		err := Patch(bytes.NewReader(base), bytes.NewReader([]byte(patch)), &bytes.Buffer{})
+		if !errors.Is(err, errCorruptPatch) {
+			t.Errorf("%s: got %v, want errCorruptPatch", name, err)
+		}
+	}
+}
@@ -0,0 +1,53 @@
+package elfanalyzer
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/NurOS-Linux/apgbuild/internal/testtree"
+)
+
+func TestMain(m *testing.M) {
+	code := m.Run()
+	testtree.Cleanup()
+	os.Exit(code)
+}
+
+func BenchmarkExtractFromDir(b *testing.B) {
+	for _, shape := range []testtree.Shape{testtree.ELFHeavy, testtree.ManyTiny} {
+		b.Run(string(shape), func(b *testing.B) {
+			root, st := testtree.Shared(b, shape)
+			b.ReportMetric(float64(st.Files), "files/op")
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				if _, err := ExtractFromDir(filepath.Join(root, "data")); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkIndexLookup(b *testing.B) {
+	e := IndexEntries{Sonames: map[string]string{}}
+	for i := 0; i < 100000; i++ {
+		e.Sonames[fmt.Sprintf("libbench%c%d.so.1", 'a'+i%26, i)] = fmt.Sprintf("pkg%d", i%5000)
+	}
+	path := filepath.Join(b.TempDir(), "soname.idx")
+	if err := WriteIndex(path, e); err != nil {
+		b.Fatal(err)
+	}
+	ix, err := OpenIndex(path)
+	if err != nil {
+		b.Fatal(err)
+	}
+	defer ix.Close()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if _, ok := ix.Package("libbenchq16.so.1"); !ok {
+			b.Fatal("missing key")
+		}
+	}
+}
@@ -0,0 +1,244 @@
+// Package elfanalyzer — minimal reader for the ELF dynamic section.
+// NurOS 2026 - GPL 3.0
+package elfanalyzer
+
+import (
+	"bytes"
+	"debug/elf"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+)
+
+// Bounds on what readDynamic is willing to read from a single file.
+const (
+	maxPhdrBytes   = 64 << 10
+	maxDynamicSize = 1 << 20
+	maxStrtabSize  = 16 << 20
+)
+
+var (
+	errNotELF = errors.New("not an ELF file")
+	// errUnsupported marks valid ELF files outside the fast path
+	// (e.g. more than 0xffff program headers).
+	errUnsupported = errors.New("unsupported ELF layout")
+)
+
+// dynInfo holds the DT_SONAME and DT_NEEDED entries of one ELF object.
+type dynInfo struct {
+	soname string
+	needed []string
+}
+
+// elfIdent is the part of the ELF header readDynamic needs.
+type elfIdent struct {
+	is64      bool
+	order     binary.ByteOrder
+	typ       elf.Type
+	phoff     uint64
+	phentsize uint64
+	phnum     uint64
+}
+
+// isELF reports whether hdr starts with the ELF magic.
+func isELF(hdr []byte) bool {
+	return len(hdr) >= 4 && bytes.Equal(hdr[:4], []byte(elf.ELFMAG))
+}
+
+// parseIdent decodes the ELF header. hdr must hold at least the first
+// 52 (ELF32) or 64 (ELF64) bytes of the file.
+func parseIdent(hdr []byte) (*elfIdent, error) {
+	if !isELF(hdr) || len(hdr) < 52 {
+		return nil, errNotELF
+	}
+	id := &elfIdent{}
+	switch elf.Data(hdr[elf.EI_DATA]) {
+	case elf.ELFDATA2LSB:
+		id.order = binary.LittleEndian
+	case elf.ELFDATA2MSB:
+		id.order = binary.BigEndian
+	default:
+		return nil, errUnsupported
+	}
+	id.typ = elf.Type(id.order.Uint16(hdr[16:]))
+
+	switch elf.Class(hdr[elf.EI_CLASS]) {
+	case elf.ELFCLASS64:
+		if len(hdr) < 64 {
+			return nil, errNotELF
+		}
+		id.is64 = true
+		id.phoff = id.order.Uint64(hdr[32:])
+		id.phentsize = uint64(id.order.Uint16(hdr[54:]))
+		id.phnum = uint64(id.order.Uint16(hdr[56:]))
+		if id.phentsize < 56 {
+			return nil, errUnsupported
+		}
+	case elf.ELFCLASS32:
+		id.phoff = uint64(id.order.Uint32(hdr[28:]))
+		id.phentsize = uint64(id.order.Uint16(hdr[42:]))
+		id.phnum = uint64(id.order.Uint16(hdr[44:]))
+		if id.phentsize < 32 {
+			return nil, errUnsupported
+		}
+	default:
+		return nil, errUnsupported
+	}
+	if id.phnum == 0xffff { // PN_XNUM: real count lives in section 0
+		return nil, errUnsupported
+	}
+	return id, nil
+}
+
+// segment is one program header entry.
+type segment struct {
+	typ    elf.ProgType
+	offset uint64
+	vaddr  uint64
+	filesz uint64
+}
+
+// readDynamic reads DT_SONAME and DT_NEEDED from r given its already-read
+// ELF header. Only the program headers, PT_DYNAMIC and the dynamic string
+// table are touched; section headers and symbol tables are never parsed.
+// Objects that are not executables or shared libraries, and static
+// binaries without PT_DYNAMIC, yield an empty result.
+func readDynamic(r io.ReaderAt, hdr []byte) (*dynInfo, error) {
+	id, err := parseIdent(hdr)
+	if err != nil {
+		return nil, err
+	}
+	if id.typ != elf.ET_EXEC && id.typ != elf.ET_DYN {
+		return &dynInfo{}, nil
+	}
+
+	size := id.phentsize * id.phnum
+	if size > maxPhdrBytes {
+		return nil, errUnsupported
+	}
+	ph := make([]byte, size)
+	if _, err := r.ReadAt(ph, int64(id.phoff)); err != nil {
+		return nil, fmt.Errorf("read program headers: %w", err)
+	}
+
+	var dyn *segment
+	loads := make([]segment, 0, 4)
+	for i := uint64(0); i < id.phnum; i++ {
+		s := id.segment(ph[i*id.phentsize:])
+		switch s.typ {
+		case elf.PT_LOAD:
+			loads = append(loads, s)
+		case elf.PT_DYNAMIC:
+			if dyn == nil {
+				dyn = &s
+			}
+		}
+	}
+	if dyn == nil {
+		return &dynInfo{}, nil
+	}
+	if dyn.filesz > maxDynamicSize {
+		return nil, errUnsupported
+	}
+
+	raw := make([]byte, dyn.filesz)
+	if _, err := r.ReadAt(raw, int64(dyn.offset)); err != nil {
+		return nil, fmt.Errorf("read dynamic section: %w", err)
+	}
+
+	entSize := uint64(8)
+	if id.is64 {
+		entSize = 16
+	}
+	var strtab, strsz, soname uint64
+	var needed []uint64
+	hasSoname := false
+	for off := uint64(0); off+entSize <= uint64(len(raw)); off += entSize {
+		var tag, val uint64
+		if id.is64 {
+			tag = id.order.Uint64(raw[off:])
+			val = id.order.Uint64(raw[off+8:])
+		} else {
+			tag = uint64(id.order.Uint32(raw[off:]))
+			val = uint64(id.order.Uint32(raw[off+4:]))
+		}
+		if elf.DynTag(tag) == elf.DT_NULL {
+			break
+		}
+		switch elf.DynTag(tag) {
+		case elf.DT_NEEDED:
+			needed = append(needed, val)
+		case elf.DT_SONAME:
+			soname, hasSoname = val, true
+		case elf.DT_STRTAB:
+			strtab = val
+		case elf.DT_STRSZ:
+			strsz = val
+		}
+	}
+	if len(needed) == 0 && !hasSoname {
+		return &dynInfo{}, nil
+	}
+
+	// DT_STRTAB is a virtual address; find the file offset through PT_LOAD.
+	strOff, ok := uint64(0), false
+	for _, l := range loads {
+		if strtab >= l.vaddr && strtab-l.vaddr < l.filesz {
+			strOff, ok = strtab-l.vaddr+l.offset, true
+			if strsz > l.filesz-(strtab-l.vaddr) {
+				strsz = l.filesz - (strtab - l.vaddr)
+			}
+			break
+		}
+	}
+	if !ok || strsz == 0 || strsz > maxStrtabSize {
+		return nil, fmt.Errorf("dynamic string table not found")
+	}
+	strs := make([]byte, strsz)
+	if _, err := r.ReadAt(strs, int64(strOff)); err != nil {
+		return nil, fmt.Errorf("read dynamic string table: %w", err)
+	}
+
+	info := &dynInfo{needed: make([]string, 0, len(needed))}
+	for _, n := range needed {
+		if s, ok := cstring(strs, n); ok {
+			info.needed = append(info.needed, s)
+		}
+	}
+	if hasSoname {
+		info.soname, _ = cstring(strs, soname)
+	}
+	return info, nil
+}
+
+// segment decodes the program header at the start of b.
+func (id *elfIdent) segment(b []byte) segment {
+	o := id.order
+	if id.is64 {
+		return segment{
+			typ:    elf.ProgType(o.Uint32(b[0:])),
+			offset: o.Uint64(b[8:]),
+			vaddr:  o.Uint64(b[16:]),
+			filesz: o.Uint64(b[32:]),
+		}
+	}
+	return segment{
+		typ:    elf.ProgType(o.Uint32(b[0:])),
+		offset: uint64(o.Uint32(b[4:])),
+		vaddr:  uint64(o.Uint32(b[8:])),
+		filesz: uint64(o.Uint32(b[16:])),
+	}
+}
+
+// cstring returns the NUL-terminated string at off in tab.
+func cstring(tab []byte, off uint64) (string, bool) {
+	if off >= uint64(len(tab)) {
+		return "", false
+	}
+	end := bytes.IndexByte(tab[off:], 0)
+	if end < 0 {
+		return "", false
+	}
+	return string(tab[off : off+uint64(end)]), true
+}
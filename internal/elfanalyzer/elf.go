@@ -1,13 +1,10 @@
 // Package elfanalyzer extracts shared library dependencies from ELF binaries.
-// Uses debug/elf standard library — no external dependencies.
+// Reads only the ELF dynamic section — no external dependencies.
 // NurOS 2026 - GPL 3.0
 package elfanalyzer
 
 import (
-	"debug/elf"
 	"fmt"
-	"os"
-	"path/filepath"
 	"sort"
 	"strings"
 )
@@ -20,24 +17,13 @@ type LibInfo struct {
 
 // ExtractDependencies reads an ELF binary and returns its NEEDED shared libraries.
 func ExtractDependencies(binaryPath string) ([]LibInfo, error) {
-	f, err := elf.Open(binaryPath)
+	info, err := readELF(binaryPath)
 	if err != nil {
 		return nil, fmt.Errorf("open elf binary %s: %w", binaryPath, err)
 	}
-	defer f.Close()
 
-	// Only ELF executables and shared objects have dynamic dependencies
-	if f.Type != elf.ET_EXEC && f.Type != elf.ET_DYN {
-		return nil, nil
-	}
-
-	imported, err := f.ImportedLibraries()
-	if err != nil {
-		return nil, fmt.Errorf("read imported libraries: %w", err)
-	}
-
-	libs := make([]LibInfo, 0, len(imported))
-	for _, lib := range imported {
+	libs := make([]LibInfo, 0, len(info.Needed))
+	for _, lib := range info.Needed {
 		libs = append(libs, LibInfo{
 			Name:     lib,
 			NeededBy: binaryPath,
@@ -50,32 +36,18 @@ func ExtractDependencies(binaryPath string) ([]LibInfo, error) {
 // ExtractFromDir scans a directory tree for ELF binaries and extracts
 // all shared library dependencies.
 func ExtractFromDir(dir string) ([]LibInfo, error) {
-	var allLibs []LibInfo
-
-	err := filepath.Walk(dir, func(path string, info os.FileInfo, err error) error {
-		if err != nil {
-			return err
-		}
-		if info.IsDir() {
-			return nil
-		}
-
-		// Skip non-executable files quickly
-		if info.Mode()&0111 == 0 {
-			return nil
-		}
+	objs, err := ScanDir(dir, ScanOptions{})
+	if err != nil {
+		return nil, err
+	}
 
-		libs, err := ExtractDependencies(path)
-		if err != nil {
-			// Not an ELF binary — skip silently
-			return nil
+	var allLibs []LibInfo
+	for _, obj := range objs {
+		for _, lib := range obj.Needed {
+			allLibs = append(allLibs, LibInfo{Name: lib, NeededBy: obj.Path})
 		}
-
-		allLibs = append(allLibs, libs...)
-		return nil
-	})
-
-	return allLibs, err
+	}
+	return allLibs, nil
 }
 
 // LibToPackageMap maps common shared library SONAMES to NurOS package names.
@@ -195,22 +167,41 @@ var LibToPackageMap = map[string]string{
 	"libwayland-server.so.0": "wayland",
 }
 
-// MapLibsToPackages maps library SONAMES to NurOS package names.
+// MapLibsToPackages maps library SONAMES to NurOS package names through
+// DefaultIndex, falling back to LibToPackageMap. SONAMEs neither knows are
+// dropped; see ResolveLibs.
 func MapLibsToPackages(libs []LibInfo) []string {
+	pkgs, _ := ResolveLibs(libs, DefaultIndex())
+	return pkgs
+}
+
+// ResolveLibs maps library SONAMES to package names through ix (may be
+// nil), then LibToPackageMap. pkgs is sorted; unresolved lists the
+// SONAMEs found in neither, sorted and without duplicates.
+func ResolveLibs(libs []LibInfo, ix *Index) (pkgs, unresolved []string) {
 	pkgSet := make(map[string]bool)
+	missing := make(map[string]bool)
 	for _, lib := range libs {
-		if pkg, ok := LibToPackageMap[lib.Name]; ok {
+		if pkg, ok := ix.Package(lib.Name); ok {
+			pkgSet[pkg] = true
+		} else if pkg, ok := LibToPackageMap[lib.Name]; ok {
 			pkgSet[pkg] = true
+		} else {
+			missing[lib.Name] = true
 		}
 	}
+	for name := range missing {
+		unresolved = append(unresolved, name)
+	}
+	sort.Strings(unresolved)
 
-	pkgs := make([]string, 0, len(pkgSet))
+	pkgs = make([]string, 0, len(pkgSet))
 	for pkg := range pkgSet {
 		pkgs = append(pkgs, pkg)
 	}
 	sort.Strings(pkgs)
 
-	return pkgs
+	return pkgs, unresolved
 }
 
 // AnalyzeAndGenerateDeps analyzes a directory for ELF binaries and generates
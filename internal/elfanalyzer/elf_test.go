@@ -0,0 +1,116 @@
+package elfanalyzer
+
+import (
+	"debug/elf"
+	"os"
+	"path/filepath"
+	"reflect"
+	"testing"
+)
+
+// systemELF returns a dynamically linked executable and a shared library
+// from the host, skipping the test when none can be found.
+func systemELF(t *testing.T) (exe, lib string) {
+	t.Helper()
+	for _, p := range []string{"/bin/sh", "/bin/ls", "/usr/bin/env"} {
+		if f, err := elf.Open(p); err == nil {
+			libs, _ := f.ImportedLibraries()
+			f.Close()
+			if len(libs) > 0 {
+				exe = p
+				break
+			}
+		}
+	}
+	for _, pattern := range []string{"/lib/x86_64-linux-gnu/libc.so.*", "/lib64/libc.so.*", "/usr/lib/libc.so.*", "/lib/*/libc.so.*"} {
+		if m, _ := filepath.Glob(pattern); len(m) > 0 {
+			if r, err := filepath.EvalSymlinks(m[0]); err == nil {
+				lib = r
+				break
+			}
+		}
+	}
+	if exe == "" || lib == "" {
+		t.Skip("no dynamically linked host binaries found")
+	}
+	return exe, lib
+}
+
+func copyTo(t *testing.T, src, dst string, mode os.FileMode) {
+	t.Helper()
+	data, err := os.ReadFile(src)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if err := os.WriteFile(dst, data, mode); err != nil {
+		t.Fatal(err)
+	}
+}
+
+func TestReadELF_MatchesDebugELF(t *testing.T) {
+	exe, lib := systemELF(t)
+	for _, p := range []string{exe, lib} {
+		f, err := elf.Open(p)
+		if err != nil {
+			t.Fatal(err)
+		}
+		want, _ := f.ImportedLibraries()
+		wantSoname, _ := f.DynString(elf.DT_SONAME)
+		f.Close()
+
+		got, err := readELF(p)
+		if err != nil {
+			t.Fatalf("readELF(%s): %v", p, err)
+		}
+		if !reflect.DeepEqual(got.Needed, want) {
+			t.Errorf("%s: Needed = %v, want %v", p, got.Needed, want)
+		}
+		if len(wantSoname) > 0 && got.Soname != wantSoname[0] {
+			t.Errorf("%s: Soname = %q, want %q", p, got.Soname, wantSoname[0])
+		}
+	}
+}
+
+func TestScanDir(t *testing.T) {
+	exe, lib := systemELF(t)
+	dir := t.TempDir()
+	os.MkdirAll(filepath.Join(dir, "usr/bin"), 0755)
+	os.MkdirAll(filepath.Join(dir, "usr/lib"), 0755)
+
+	copyTo(t, exe, filepath.Join(dir, "usr/bin/tool"), 0755)
+	// Libraries installed without +x must still be scanned.
+	copyTo(t, lib, filepath.Join(dir, "usr/lib/libfoo.so.1"), 0644)
+	os.WriteFile(filepath.Join(dir, "usr/bin/script"), []byte("#!/bin/sh\necho hi\n"), 0755)
+	os.WriteFile(filepath.Join(dir, "usr/lib/tiny"), []byte("\x7fEL"), 0644)
+	os.Symlink("libfoo.so.1", filepath.Join(dir, "usr/lib/libfoo.so"))
+
+	objs, err := ScanDir(dir, ScanOptions{Jobs: 4})
+	if err != nil {
+		t.Fatalf("ScanDir failed: %v", err)
+	}
+	if len(objs) != 2 {
+		t.Fatalf("Expected 2 ELF objects, got %d: %+v", len(objs), objs)
+	}
+	if objs[0].Path != filepath.Join(dir, "usr/bin/tool") || len(objs[0].Needed) == 0 {
+		t.Errorf("Unexpected executable entry: %+v", objs[0])
+	}
+	if objs[1].Path != filepath.Join(dir, "usr/lib/libfoo.so.1") || objs[1].Soname == "" {
+		t.Errorf("Unexpected library entry: %+v", objs[1])
+	}
+
+	libs, err := ExtractFromDir(dir)
+	if err != nil {
+		t.Fatalf("ExtractFromDir failed: %v", err)
+	}
+	if len(libs) != len(objs[0].Needed)+len(objs[1].Needed) {
+		t.Errorf("ExtractFromDir returned %d libs", len(libs))
+	}
+}
+
+func TestExtractDependencies_NotELF(t *testing.T) {
+	p := filepath.Join(t.TempDir(), "script")
+	os.WriteFile(p, []byte("#!/bin/sh\n"), 0755)
+	if _, err := ExtractDependencies(p); err == nil {
+		t.Error("Expected error for non-ELF file")
+	}
+}
@@ -0,0 +1,258 @@
+// Package elfanalyzer — memory-mapped SONAME → package index.
+// NurOS 2026 - GPL 3.0
+package elfanalyzer
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"os"
+	"sort"
+	"sync"
+	"syscall"
+)
+
+// Index file layout (little endian):
+//
+//	header  magic "APGSONX1", slots uint32, entries uint32
+//	slots   slots × {hash uint64, key uint32, value uint32}
+//	strings uint16 length + bytes, referenced by offset from the file start
+//
+// slots is a power of two at most half full; a key is found by linear
+// probing from hash & (slots-1), an empty slot has hash 0. Lookups touch
+// one or two slots and the two strings, so only those pages are read.
+const (
+	indexMagic      = "APGSONX1"
+	indexHeaderSize = 16
+	indexSlotSize   = 16
+)
+
+// Key namespaces of an index.
+const (
+	keySoname  = 's'
+	keyProvide = 'p'
+)
+
+const (
+	// IndexPathEnv overrides DefaultIndexPath.
+	IndexPathEnv = "APG_SONAME_INDEX"
+	// DefaultIndexPath is where the repository's index is installed.
+	DefaultIndexPath = "/var/lib/apg/soname.idx"
+)
+
+// Index maps SONAMEs and provided names to package names. It is
+// read-only and safe for concurrent use.
+type Index struct {
+	data    []byte
+	mask    uint64
+	entries int
+}
+
+// OpenIndex memory-maps an index written by WriteIndex.
+func OpenIndex(path string) (*Index, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	fi, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	if fi.Size() < indexHeaderSize || fi.Size() > 1<<32 {
+		return nil, fmt.Errorf("soname index %s: bad size", path)
+	}
+	data, err := syscall.Mmap(int(f.Fd()), 0, int(fi.Size()), syscall.PROT_READ, syscall.MAP_SHARED)
+	if err != nil {
+		return nil, fmt.Errorf("soname index %s: %w", path, err)
+	}
+	ix, err := parseIndex(data)
+	if err != nil {
+		syscall.Munmap(data)
+		return nil, fmt.Errorf("soname index %s: %w", path, err)
+	}
+	return ix, nil
+}
+
+func parseIndex(data []byte) (*Index, error) {
+	if len(data) < indexHeaderSize || string(data[:8]) != indexMagic {
+		return nil, errors.New("not a soname index")
+	}
+	slots := uint64(binary.LittleEndian.Uint32(data[8:]))
+	if slots == 0 || slots&(slots-1) != 0 || indexHeaderSize+slots*indexSlotSize > uint64(len(data)) {
+		return nil, errors.New("corrupt soname index")
+	}
+	return &Index{data: data, mask: slots - 1, entries: int(binary.LittleEndian.Uint32(data[12:]))}, nil
+}
+
+// Close unmaps the index.
+func (ix *Index) Close() error {
+	data := ix.data
+	ix.data, ix.mask = nil, 0
+	return syscall.Munmap(data)
+}
+
+// Len returns the number of entries.
+func (ix *Index) Len() int { return ix.entries }
+
+// Package returns the package shipping the library soname.
+func (ix *Index) Package(soname string) (string, bool) { return ix.lookup(keySoname, soname) }
+
+// Provider returns the package providing name (a provides entry).
+func (ix *Index) Provider(name string) (string, bool) { return ix.lookup(keyProvide, name) }
+
+func (ix *Index) lookup(ns byte, name string) (string, bool) {
+	if ix == nil || ix.data == nil {
+		return "", false
+	}
+	h := keyHash(ns, name)
+	i := h & ix.mask
+	for n := uint64(0); n <= ix.mask; n, i = n+1, (i+1)&ix.mask {
+		slot := ix.data[indexHeaderSize+i*indexSlotSize:]
+		sh := binary.LittleEndian.Uint64(slot)
+		if sh == 0 {
+			return "", false
+		}
+		if sh != h {
+			continue
+		}
+		key, ok := ix.str(binary.LittleEndian.Uint32(slot[8:]))
+		if ok && len(key) == len(name)+1 && key[0] == ns && string(key[1:]) == name {
+			v, ok := ix.str(binary.LittleEndian.Uint32(slot[12:]))
+			return string(v), ok
+		}
+	}
+	return "", false
+}
+
+// str returns the string at off without copying it.
+func (ix *Index) str(off uint32) ([]byte, bool) {
+	if uint64(off)+2 > uint64(len(ix.data)) {
+		return nil, false
+	}
+	n := uint64(binary.LittleEndian.Uint16(ix.data[off:]))
+	end := uint64(off) + 2 + n
+	if end > uint64(len(ix.data)) {
+		return nil, false
+	}
+	return ix.data[off+2 : end], true
+}
+
+// keyHash is FNV-1a over the namespace byte and name; never 0.
+func keyHash(ns byte, name string) uint64 {
+	h := uint64(14695981039346656037)
+	h = (h ^ uint64(ns)) * 1099511628211
+	for i := 0; i < len(name); i++ {
+		h = (h ^ uint64(name[i])) * 1099511628211
+	}
+	if h == 0 {
+		h = 1
+	}
+	return h
+}
+
+// IndexEntries collects the contents of an index being built.
+type IndexEntries struct {
+	Sonames  map[string]string // SONAME → package
+	Provides map[string]string // provided name → package
+}
+
+// WriteIndex writes e to path (atomically, through a temporary file).
+func WriteIndex(path string, e IndexEntries) error {
+	type kv struct{ key, value string }
+	var all []kv
+	for _, m := range []struct {
+		ns byte
+		m  map[string]string
+	}{{keySoname, e.Sonames}, {keyProvide, e.Provides}} {
+		for k, v := range m.m {
+			if len(k) >= 1<<16-1 || len(v) >= 1<<16 {
+				return fmt.Errorf("soname index: name too long: %.40s…", k)
+			}
+			all = append(all, kv{string(m.ns) + k, v})
+		}
+	}
+	// Sorted input gives byte-identical indexes for equal contents.
+	sort.Slice(all, func(i, j int) bool { return all[i].key < all[j].key })
+
+	slots := uint64(8)
+	for slots < 2*uint64(len(all)) {
+		slots *= 2
+	}
+	strBase := indexHeaderSize + slots*indexSlotSize
+	var strs bytes.Buffer
+	values := map[string]uint32{}
+	addStr := func(s string) uint32 {
+		off := uint32(strBase) + uint32(strs.Len())
+		binary.Write(&strs, binary.LittleEndian, uint16(len(s)))
+		strs.WriteString(s)
+		return off
+	}
+
+	table := make([]byte, slots*indexSlotSize)
+	for _, e := range all {
+		h := keyHash(e.key[0], e.key[1:])
+		i := h & (slots - 1)
+		for binary.LittleEndian.Uint64(table[i*indexSlotSize:]) != 0 {
+			i = (i + 1) & (slots - 1)
+		}
+		v, ok := values[e.value]
+		if !ok {
+			v = addStr(e.value)
+			values[e.value] = v
+		}
+		slot := table[i*indexSlotSize:]
+		binary.LittleEndian.PutUint64(slot, h)
+		binary.LittleEndian.PutUint32(slot[8:], addStr(e.key))
+		binary.LittleEndian.PutUint32(slot[12:], v)
+	}
+	if strBase+uint64(strs.Len()) > 1<<32 {
+		return fmt.Errorf("soname index: too large")
+	}
+
+	var hdr [indexHeaderSize]byte
+	copy(hdr[:], indexMagic)
+	binary.LittleEndian.PutUint32(hdr[8:], uint32(slots))
+	binary.LittleEndian.PutUint32(hdr[12:], uint32(len(all)))
+
+	tmp := path + ".tmp"
+	f, err := os.Create(tmp)
+	if err != nil {
+		return err
+	}
+	for _, b := range [][]byte{hdr[:], table, strs.Bytes()} {
+		if _, err := f.Write(b); err != nil {
+			f.Close()
+			os.Remove(tmp)
+			return err
+		}
+	}
+	if err := f.Close(); err != nil {
+		os.Remove(tmp)
+		return err
+	}
+	return os.Rename(tmp, path)
+}
+
+var (
+	defaultIndexOnce sync.Once
+	defaultIndex     *Index
+)
+
+// DefaultIndex returns the index at $APG_SONAME_INDEX or DefaultIndexPath,
+// opened on first use, or nil if there is none.
+func DefaultIndex() *Index {
+	defaultIndexOnce.Do(func() {
+		path := os.Getenv(IndexPathEnv)
+		if path == "" {
+			path = DefaultIndexPath
+		}
+		if ix, err := OpenIndex(path); err == nil {
+			defaultIndex = ix
+		} else if !errors.Is(err, os.ErrNotExist) {
+			fmt.Fprintf(os.Stderr, "Warning: %v; using the builtin SONAME map\n", err)
+		}
+	})
+	return defaultIndex
+}
@@ -0,0 +1,106 @@
+package elfanalyzer
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"reflect"
+	"testing"
+)
+
+func TestIndex_RoundTrip(t *testing.T) {
+	e := IndexEntries{Sonames: map[string]string{}, Provides: map[string]string{"libfoo": "foo-libs"}}
+	for i := 0; i < 50000; i++ {
+		e.Sonames[fmt.Sprintf("libx%d.so.%d", i, i%7)] = fmt.Sprintf("pkg%d", i%1000)
+	}
+	path := filepath.Join(t.TempDir(), "soname.idx")
+	if err := WriteIndex(path, e); err != nil {
+		t.Fatal(err)
+	}
+	ix, err := OpenIndex(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ix.Close()
+
+	if ix.Len() != len(e.Sonames)+len(e.Provides) {
+		t.Errorf("Len = %d", ix.Len())
+	}
+	for k, v := range e.Sonames {
+		if got, ok := ix.Package(k); !ok || got != v {
+			t.Fatalf("Package(%q) = %q, %v; want %q", k, got, ok, v)
+		}
+	}
+	if got, ok := ix.Provider("libfoo"); !ok || got != "foo-libs" {
+		t.Errorf("Provider(libfoo) = %q, %v", got, ok)
+	}
+	// Namespaces are separate.
+	if _, ok := ix.Package("libfoo"); ok {
+		t.Error("provides entry found as a SONAME")
+	}
+	if _, ok := ix.Package("libnothere.so.1"); ok {
+		t.Error("missing key found")
+	}
+}
+
+func TestIndex_Reproducible(t *testing.T) {
+	e := IndexEntries{Sonames: map[string]string{"liba.so.1": "a", "libb.so.2": "b", "libc.so.6": "glibc"}}
+	dir := t.TempDir()
+	var files [2][]byte
+	for i := range files {
+		p := filepath.Join(dir, fmt.Sprint(i))
+		if err := WriteIndex(p, e); err != nil {
+			t.Fatal(err)
+		}
+		files[i], _ = os.ReadFile(p)
+	}
+	if !reflect.DeepEqual(files[0], files[1]) {
+		t.Error("equal entries gave different indexes")
+	}
+}
+
+func TestIndex_Corrupt(t *testing.T) {
+	dir := t.TempDir()
+	for name, data := range map[string][]byte{
+		"short": []byte("APGS"),
+		"magic": []byte("NOTANIDX\x08\x00\x00\x00\x00\x00\x00\x00"),
+		"slots": []byte("APGSONX1\x00\x01\x00\x00\x00\x00\x00\x00"),
+	} {
+		p := filepath.Join(dir, name)
+		os.WriteFile(p, data, 0644)
+		if ix, err := OpenIndex(p); err == nil {
+			ix.Close()
+			t.Errorf("%s: corrupt index accepted", name)
+		}
+	}
+}
+
+func TestResolveLibs(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "soname.idx")
+	e := IndexEntries{Sonames: map[string]string{"libcustom.so.3": "custom", "libz.so.1": "zlib-ng"}}
+	if err := WriteIndex(path, e); err != nil {
+		t.Fatal(err)
+	}
+	ix, err := OpenIndex(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ix.Close()
+
+	libs := []LibInfo{{Name: "libcustom.so.3"}, {Name: "libz.so.1"}, {Name: "libc.so.6"}, {Name: "libunknown.so.9"}}
+	pkgs, unresolved := ResolveLibs(libs, ix)
+	// The index takes precedence over the builtin map, which is the fallback.
+	want := []string{"custom", LibToPackageMap["libc.so.6"], "zlib-ng"}
+	if !reflect.DeepEqual(pkgs, want) {
+		t.Errorf("pkgs = %v, want %v", pkgs, want)
+	}
+	if !reflect.DeepEqual(unresolved, []string{"libunknown.so.9"}) {
+		t.Errorf("unresolved = %v", unresolved)
+	}
+
+	// Without an index only the builtin map is used.
+	pkgs, unresolved = ResolveLibs(libs, nil)
+	if len(pkgs) != 2 || len(unresolved) != 2 {
+		t.Errorf("nil index: pkgs = %v, unresolved = %v", pkgs, unresolved)
+	}
+}
@@ -0,0 +1,146 @@
+// Package elfanalyzer — parallel directory scanner for ELF objects.
+// NurOS 2026 - GPL 3.0
+package elfanalyzer
+
+import (
+	"debug/elf"
+	"errors"
+	"io"
+	"os"
+	"runtime"
+	"sync"
+
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
+)
+
+// ELFObject is the dynamic linking summary of one ELF file.
+type ELFObject struct {
+	Path   string
+	Soname string   // DT_SONAME, empty for executables
+	Needed []string // DT_NEEDED in file order
+}
+
+// ScanOptions configures ScanDir.
+type ScanOptions struct {
+	// Jobs is the number of files inspected concurrently (0 = number of CPUs).
+	Jobs int
+}
+
+func (o ScanOptions) jobs() int {
+	if o.Jobs > 0 {
+		return o.Jobs
+	}
+	return runtime.NumCPU()
+}
+
+// ScanDir finds every ELF object under dir and reads its dynamic section.
+// See ScanTree.
+func ScanDir(dir string, opts ScanOptions) ([]ELFObject, error) {
+	tree, err := scan.Scan(dir, scan.Options{})
+	if err != nil {
+		return nil, err
+	}
+	return ScanTree(tree, opts), nil
+}
+
+// ScanTree reads the dynamic section of every ELF object in tree.
+//
+// All regular files are considered, whatever their mode, so libraries
+// installed 0644 are not missed. Each file costs one small header read;
+// anything without the ELF magic is dropped there (or up front, when the
+// tree was scanned with DetectELF). Files that fail to parse are skipped.
+// Results come back in tree order.
+func ScanTree(tree *scan.Tree, opts ScanOptions) []ELFObject {
+	var paths []string
+	for i := range tree.Files {
+		f := &tree.Files[i]
+		if !f.Mode.IsRegular() || (tree.ELFDetected && !f.ELF) {
+			continue
+		}
+		paths = append(paths, tree.Abs(f))
+	}
+
+	results := make([]*ELFObject, len(paths))
+	jobs := opts.jobs()
+	if jobs > len(paths) {
+		jobs = len(paths)
+	}
+	next := make(chan int)
+	var wg sync.WaitGroup
+	for w := 0; w < jobs; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := range next {
+				if obj, err := readELF(paths[i]); err == nil {
+					results[i] = obj
+				}
+			}
+		}()
+	}
+	for i := range paths {
+		next <- i
+	}
+	close(next)
+	wg.Wait()
+
+	objs := make([]ELFObject, 0, len(results))
+	for _, r := range results {
+		if r != nil {
+			objs = append(objs, *r)
+		}
+	}
+	return objs
+}
+
+// readELF checks the ELF magic and reads DT_SONAME/DT_NEEDED of path.
+func readELF(path string) (*ELFObject, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	return ReadELF(f, path)
+}
+
+// ReadELF is readELF for an object that is not a file of its own, e.g. a
+// package member read into memory; path only labels the result.
+func ReadELF(r io.ReaderAt, path string) (*ELFObject, error) {
+	hdr := make([]byte, 64)
+	n, err := r.ReadAt(hdr, 0)
+	if err != nil && !errors.Is(err, io.EOF) {
+		return nil, errNotELF
+	}
+	hdr = hdr[:n]
+	if !isELF(hdr) {
+		return nil, errNotELF
+	}
+
+	info, err := readDynamic(r, hdr)
+	if errors.Is(err, errUnsupported) {
+		return readELFSlow(r, path)
+	}
+	if err != nil {
+		return nil, err
+	}
+	return &ELFObject{Path: path, Soname: info.soname, Needed: info.needed}, nil
+}
+
+// readELFSlow handles the rare layouts readDynamic declines with debug/elf.
+func readELFSlow(r io.ReaderAt, path string) (*ELFObject, error) {
+	f, err := elf.NewFile(r)
+	if err != nil {
+		return nil, err
+	}
+	obj := &ELFObject{Path: path}
+	if f.Type != elf.ET_EXEC && f.Type != elf.ET_DYN {
+		return obj, nil
+	}
+	if obj.Needed, err = f.ImportedLibraries(); err != nil {
+		return nil, err
+	}
+	if s, err := f.DynString(elf.DT_SONAME); err == nil && len(s) > 0 {
+		obj.Soname = s[0]
+	}
+	return obj, nil
+}
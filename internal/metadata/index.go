@@ -0,0 +1,286 @@
+// Package metadata — memory-mapped repository index.
+// NurOS 2026 - GPL 3.0
+package metadata
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"os"
+	"sort"
+	"syscall"
+)
+
+// Repository index layout (little endian):
+//
+//	header  magic "APGREPX1", packages uint32, reserved uint32
+//	records packages × {name, version, architecture, file,
+//	        dependencies, provides, conflicts, replaces uint32}
+//	strings uint16 length + bytes
+//	lists   count uint32 + count × string uint32
+//
+// Records are sorted by name, then version and file. The first four fields are
+// string offsets, the others list offsets, all from the file start; 0 is
+// an absent (null or empty) field. Strings are stored once, so a lookup
+// reads the records it bisects and the strings they reference.
+const (
+	repoMagic      = "APGREPX1"
+	repoHeaderSize = 16
+	repoRecordSize = 32
+)
+
+// RepoFields are the fields a repository index holds.
+const RepoFields = FieldName | FieldVersion | FieldArchitecture |
+	FieldDependencies | FieldProvides | FieldConflicts | FieldReplaces
+
+// RepoEntry is one package of a repository index.
+type RepoEntry struct {
+	Name, Version string
+	Architecture  string // "" = any
+	File          string // package file, relative to the repository
+	Dependencies  []string
+	Provides      []string
+	Conflicts     []string
+	Replaces      []string
+}
+
+// RepoIndex is a repository index opened by OpenRepoIndex. It is
+// read-only and safe for concurrent use.
+type RepoIndex struct {
+	data []byte
+	n    int
+}
+
+// OpenRepoIndex memory-maps an index written by RepoIndexWriter.
+func OpenRepoIndex(path string) (*RepoIndex, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	fi, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	if fi.Size() < repoHeaderSize || fi.Size() > 1<<32 {
+		return nil, fmt.Errorf("repository index %s: bad size", path)
+	}
+	data, err := syscall.Mmap(int(f.Fd()), 0, int(fi.Size()), syscall.PROT_READ, syscall.MAP_SHARED)
+	if err != nil {
+		return nil, fmt.Errorf("repository index %s: %w", path, err)
+	}
+	ix, err := parseRepoIndex(data)
+	if err != nil {
+		syscall.Munmap(data)
+		return nil, fmt.Errorf("repository index %s: %w", path, err)
+	}
+	return ix, nil
+}
+
+func parseRepoIndex(data []byte) (*RepoIndex, error) {
+	if len(data) < repoHeaderSize || string(data[:8]) != repoMagic {
+		return nil, errors.New("not a repository index")
+	}
+	n := uint64(binary.LittleEndian.Uint32(data[8:]))
+	if repoHeaderSize+n*repoRecordSize > uint64(len(data)) {
+		return nil, errors.New("corrupt repository index")
+	}
+	return &RepoIndex{data: data, n: int(n)}, nil
+}
+
+// Close unmaps the index.
+func (ix *RepoIndex) Close() error {
+	data := ix.data
+	ix.data, ix.n = nil, 0
+	return syscall.Munmap(data)
+}
+
+// Len returns the number of packages.
+func (ix *RepoIndex) Len() int { return ix.n }
+
+// Entry returns package i, in name order.
+func (ix *RepoIndex) Entry(i int) RepoEntry {
+	return RepoEntry{
+		Name:         string(ix.str(ix.field(i, 0))),
+		Version:      string(ix.str(ix.field(i, 1))),
+		Architecture: string(ix.str(ix.field(i, 2))),
+		File:         string(ix.str(ix.field(i, 3))),
+		Dependencies: ix.list(ix.field(i, 4)),
+		Provides:     ix.list(ix.field(i, 5)),
+		Conflicts:    ix.list(ix.field(i, 6)),
+		Replaces:     ix.list(ix.field(i, 7)),
+	}
+}
+
+// Lookup returns the packages named name, lowest version string first.
+func (ix *RepoIndex) Lookup(name string) []RepoEntry {
+	i := sort.Search(ix.n, func(i int) bool { return string(ix.str(ix.field(i, 0))) >= name })
+	var out []RepoEntry
+	for ; i < ix.n && string(ix.str(ix.field(i, 0))) == name; i++ {
+		out = append(out, ix.Entry(i))
+	}
+	return out
+}
+
+func (ix *RepoIndex) field(i, f int) uint32 {
+	return binary.LittleEndian.Uint32(ix.data[repoHeaderSize+i*repoRecordSize+f*4:])
+}
+
+// str returns the string at off without copying it; nil if absent or out
+// of bounds.
+func (ix *RepoIndex) str(off uint32) []byte {
+	if off == 0 || uint64(off)+2 > uint64(len(ix.data)) {
+		return nil
+	}
+	end := uint64(off) + 2 + uint64(binary.LittleEndian.Uint16(ix.data[off:]))
+	if end > uint64(len(ix.data)) {
+		return nil
+	}
+	return ix.data[off+2 : end]
+}
+
+func (ix *RepoIndex) list(off uint32) []string {
+	if off == 0 || uint64(off)+4 > uint64(len(ix.data)) {
+		return nil
+	}
+	n := uint64(binary.LittleEndian.Uint32(ix.data[off:]))
+	if uint64(off)+4+n*4 > uint64(len(ix.data)) {
+		return nil
+	}
+	out := make([]string, n)
+	for j := range out {
+		out[j] = string(ix.str(binary.LittleEndian.Uint32(ix.data[uint64(off)+4+uint64(j)*4:])))
+	}
+	return out
+}
+
+// RepoIndexWriter collects the packages of a repository index. Add copies
+// what it needs out of the Metadata, which the caller may then reuse.
+type RepoIndexWriter struct {
+	records []repoRecord
+	items   []string // list elements of all records
+}
+
+type repoRecord struct {
+	strs  [4]string // name, version, architecture, file
+	lists [4][2]int // dependencies, provides, conflicts, replaces: ranges of items
+}
+
+// NewRepoIndexWriter returns an empty RepoIndexWriter.
+func NewRepoIndexWriter() *RepoIndexWriter {
+	return &RepoIndexWriter{}
+}
+
+// Add adds the package at file (relative to the repository) described by m.
+func (w *RepoIndexWriter) Add(file string, m *Metadata) error {
+	r := repoRecord{strs: [4]string{m.Name, m.Version, "", file}}
+	if m.Architecture != nil {
+		r.strs[2] = *m.Architecture
+	}
+	for _, s := range r.strs {
+		if len(s) >= 1<<16 {
+			return fmt.Errorf("repository index: string too long: %.40s…", s)
+		}
+	}
+	for i, l := range [][]string{m.Dependencies, m.Provides, m.Conflicts, m.Replaces} {
+		for _, s := range l {
+			if len(s) >= 1<<16 {
+				return fmt.Errorf("repository index: string too long: %.40s…", s)
+			}
+		}
+		r.lists[i] = [2]int{len(w.items), len(w.items) + len(l)}
+		w.items = append(w.items, l...)
+	}
+	w.records = append(w.records, r)
+	return nil
+}
+
+// Len returns the number of packages added.
+func (w *RepoIndexWriter) Len() int { return len(w.records) }
+
+// WriteFile writes the index to path (atomically, through a temporary
+// file). Equal contents give byte-identical indexes, in any order of Add.
+func (w *RepoIndexWriter) WriteFile(path string) error {
+	sort.Slice(w.records, func(i, j int) bool {
+		a, b := &w.records[i].strs, &w.records[j].strs
+		return a[0] < b[0] || a[0] == b[0] && (a[1] < b[1] || a[1] == b[1] && a[3] < b[3])
+	})
+
+	// Offsets are laid out relative to their section first, plus one so
+	// that 0 stays absent, and rebased once the section sizes are known.
+	var strs bytes.Buffer
+	strOff := map[string]uint32{}
+	str := func(s string) uint32 {
+		if s == "" {
+			return 0
+		}
+		off, ok := strOff[s]
+		if !ok {
+			off = uint32(strs.Len()) + 1
+			binary.Write(&strs, binary.LittleEndian, uint16(len(s)))
+			strs.WriteString(s)
+			strOff[s] = off
+		}
+		return off
+	}
+	var lists []uint32
+	fields := make([][8]uint32, len(w.records))
+	for i, r := range w.records {
+		for j, s := range r.strs {
+			fields[i][j] = str(s)
+		}
+		for j, rng := range r.lists {
+			if rng[0] == rng[1] {
+				continue
+			}
+			fields[i][4+j] = uint32(len(lists)*4) + 1
+			lists = append(lists, uint32(rng[1]-rng[0]))
+			for _, s := range w.items[rng[0]:rng[1]] {
+				lists = append(lists, str(s))
+			}
+		}
+	}
+
+	strBase := uint64(repoHeaderSize + len(fields)*repoRecordSize)
+	listBase := strBase + uint64(strs.Len())
+	size := listBase + uint64(len(lists))*4
+	if size > 1<<32 {
+		return fmt.Errorf("repository index: too large")
+	}
+	buf := make([]byte, 0, size)
+	buf = append(buf, repoMagic...)
+	buf = binary.LittleEndian.AppendUint32(buf, uint32(len(fields)))
+	buf = binary.LittleEndian.AppendUint32(buf, 0)
+	for _, f := range fields {
+		for j, off := range f {
+			switch {
+			case off == 0:
+			case j < 4:
+				off += uint32(strBase) - 1
+			default:
+				off += uint32(listBase) - 1
+			}
+			buf = binary.LittleEndian.AppendUint32(buf, off)
+		}
+	}
+	buf = append(buf, strs.Bytes()...)
+	for i := 0; i < len(lists); {
+		n := int(lists[i])
+		buf = binary.LittleEndian.AppendUint32(buf, uint32(n))
+		for _, off := range lists[i+1 : i+1+n] {
+			if off != 0 {
+				off += uint32(strBase) - 1
+			}
+			buf = binary.LittleEndian.AppendUint32(buf, off)
+		}
+		i += 1 + n
+	}
+
+	tmp := path + ".tmp"
+	if err := os.WriteFile(tmp, buf, 0644); err != nil {
+		os.Remove(tmp)
+		return err
+	}
+	return os.Rename(tmp, path)
+}
@@ -0,0 +1,65 @@
+package metadata
+
+import (
+	"bytes"
+	"os"
+	"path/filepath"
+	"reflect"
+	"testing"
+)
+
+func TestRepoIndex(t *testing.T) {
+	arch := "x86_64"
+	pkgs := []struct {
+		file string
+		meta Metadata
+	}{
+		{"curl-8.6.apg", Metadata{Name: "curl", Version: "8.6.0", Architecture: &arch, Dependencies: []string{"glibc", "libssl"}}},
+		{"glibc.apg", Metadata{Name: "glibc", Version: "2.39", Provides: []string{"libc"}, Conflicts: []string{"musl"}}},
+		{"curl-8.5.apg", Metadata{Name: "curl", Version: "8.5.0", Dependencies: []string{"glibc"}, Replaces: []string{"curl-old"}}},
+	}
+	dir := t.TempDir()
+	var files [2][]byte
+	for k, order := range [][]int{{0, 1, 2}, {2, 1, 0}} {
+		w := NewRepoIndexWriter()
+		for _, i := range order {
+			if err := w.Add(pkgs[i].file, &pkgs[i].meta); err != nil {
+				t.Fatal(err)
+			}
+		}
+		p := filepath.Join(dir, "repo.idx")
+		if err := w.WriteFile(p); err != nil {
+			t.Fatal(err)
+		}
+		files[k], _ = os.ReadFile(p)
+	}
+	if !bytes.Equal(files[0], files[1]) {
+		t.Error("index depends on the order of Add")
+	}
+
+	ix, err := OpenRepoIndex(filepath.Join(dir, "repo.idx"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ix.Close()
+	if ix.Len() != 3 {
+		t.Errorf("Len = %d", ix.Len())
+	}
+	curl := ix.Lookup("curl")
+	want := []RepoEntry{
+		{Name: "curl", Version: "8.5.0", File: "curl-8.5.apg", Dependencies: []string{"glibc"}, Replaces: []string{"curl-old"}},
+		{Name: "curl", Version: "8.6.0", Architecture: "x86_64", File: "curl-8.6.apg", Dependencies: []string{"glibc", "libssl"}},
+	}
+	if !reflect.DeepEqual(curl, want) {
+		t.Errorf("Lookup(curl) = %+v", curl)
+	}
+	if g := ix.Lookup("glibc"); len(g) != 1 || !reflect.DeepEqual(g[0].Provides, []string{"libc"}) || !reflect.DeepEqual(g[0].Conflicts, []string{"musl"}) {
+		t.Errorf("Lookup(glibc) = %+v", g)
+	}
+	if g := ix.Lookup("curla"); g != nil {
+		t.Errorf("Lookup(curla) = %+v", g)
+	}
+	if _, err := parseRepoIndex([]byte("APGREPX1\xff\xff\xff\xff\x00\x00\x00\x00")); err == nil {
+		t.Error("truncated index accepted")
+	}
+}
@@ -0,0 +1,609 @@
+// Package metadata — selective metadata loading for repository-scale tools.
+// NurOS 2026 - GPL 3.0
+package metadata
+
+import (
+	"bytes"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"runtime"
+	"strconv"
+	"sync"
+	"unicode/utf8"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+)
+
+// Field selects members of Metadata for a Loader.
+type Field uint32
+
+const (
+	FieldName Field = 1 << iota
+	FieldVersion
+	FieldType
+	FieldArchitecture
+	FieldDescription
+	FieldMaintainer
+	FieldLicense
+	FieldTags
+	FieldHomepage
+	FieldDependencies
+	FieldConflicts
+	FieldProvides
+	FieldReplaces
+	FieldConf
+	FieldZstdDictionary
+
+	FieldAll = 1<<iota - 1
+)
+
+// fieldKeys are the JSON keys of the fields, as Save writes them.
+var fieldKeys = []struct {
+	key   string
+	field Field
+}{
+	{"name", FieldName}, {"version", FieldVersion}, {"type", FieldType},
+	{"architecture", FieldArchitecture}, {"description", FieldDescription},
+	{"maintainer", FieldMaintainer}, {"license", FieldLicense}, {"tags", FieldTags},
+	{"homepage", FieldHomepage}, {"dependencies", FieldDependencies},
+	{"conflicts", FieldConflicts}, {"provides", FieldProvides},
+	{"replaces", FieldReplaces}, {"conf", FieldConf},
+	{"zstd_dictionary", FieldZstdDictionary},
+}
+
+// MaxSize bounds the metadata.json a Loader reads.
+const MaxSize = 1 << 20
+
+// maxInterned bounds the strings a Loader keeps for reuse.
+const maxInterned = 1 << 16
+
+// maxDepth bounds the nesting of skipped values, as encoding/json does.
+const maxDepth = 10000
+
+// Loader decodes the selected Fields of metadata.json files, without
+// building the rest: other keys are skipped in one pass over the bytes.
+// The read buffer is kept between calls, and strings that recur across
+// packages (dependencies, provides, types, licenses) are allocated once.
+// A Loader is not safe for concurrent use.
+type Loader struct {
+	Fields Field // 0 = FieldAll
+
+	buf  []byte
+	strs map[string]string
+}
+
+// NewLoader returns a Loader of fields.
+func NewLoader(fields Field) *Loader {
+	return &Loader{Fields: fields}
+}
+
+func (l *Loader) fields() Field {
+	if l.Fields == 0 {
+		return FieldAll
+	}
+	return l.Fields
+}
+
+// LoadFile decodes the metadata file at path into m.
+func (l *Loader) LoadFile(path string, m *Metadata) error {
+	f, err := os.Open(path)
+	if err != nil {
+		return fmt.Errorf("failed to read metadata file: %w", err)
+	}
+	defer f.Close()
+	return l.Read(f, m)
+}
+
+// LoadPackage decodes the metadata.json of the .apg at pkgPath into m.
+// Packages store it first (archive.TOCMembers), so only the head of the
+// package is decompressed; the rest of the file is not read.
+func (l *Loader) LoadPackage(pkgPath string, m *Metadata) error {
+	ar, err := archive.OpenReader(pkgPath)
+	if err != nil {
+		return err
+	}
+	defer ar.Close()
+	for {
+		e, err := ar.Next()
+		if errors.Is(err, io.EOF) {
+			return fmt.Errorf("%s: no metadata.json", pkgPath)
+		}
+		if err != nil {
+			return err
+		}
+		if e.Path == "metadata.json" && e.Type == archive.TypeRegular {
+			if err := l.Read(ar, m); err != nil {
+				return fmt.Errorf("%s: %w", pkgPath, err)
+			}
+			return nil
+		}
+	}
+}
+
+// Read decodes metadata read from r into m.
+func (l *Loader) Read(r io.Reader, m *Metadata) error {
+	l.buf = l.buf[:0]
+	for {
+		if len(l.buf) == cap(l.buf) {
+			if len(l.buf) > MaxSize {
+				return fmt.Errorf("failed to read metadata: larger than %d bytes", MaxSize)
+			}
+			l.buf = append(l.buf, make([]byte, 4096)...)[:len(l.buf)]
+		}
+		n, err := r.Read(l.buf[len(l.buf):cap(l.buf)])
+		l.buf = l.buf[:len(l.buf)+n]
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return fmt.Errorf("failed to read metadata: %w", err)
+		}
+	}
+	return l.Decode(l.buf, m)
+}
+
+// Decode decodes the selected fields of the JSON document data into m,
+// as json.Unmarshal would. The selected fields are reset first (list
+// fields keep their arrays for reuse); the others are left alone.
+func (l *Loader) Decode(data []byte, m *Metadata) error {
+	if err := l.decode(data, m); err != nil {
+		return fmt.Errorf("failed to parse metadata: %w", err)
+	}
+	return nil
+}
+
+func (l *Loader) decode(data []byte, m *Metadata) error {
+	want := l.fields()
+	l.reset(m, want)
+	s := &scanner{data: data}
+	if err := s.expect('{'); err != nil {
+		return err
+	}
+	if s.peek() == '}' {
+		s.pos++
+		return s.end()
+	}
+	for {
+		key, esc, err := s.str()
+		if err != nil {
+			return err
+		}
+		if esc {
+			key = []byte(l.unquote(key))
+		}
+		if err := s.expect(':'); err != nil {
+			return err
+		}
+		if f := keyField(key); f&want != 0 {
+			err = l.field(s, f, m)
+		} else {
+			err = s.skip(0)
+		}
+		if err != nil {
+			return err
+		}
+		switch s.peek() {
+		case ',':
+			s.pos++
+		case '}':
+			s.pos++
+			return s.end()
+		default:
+			return s.errorf("expected , or }")
+		}
+	}
+}
+
+// keyField matches a key as encoding/json does: exactly, else ignoring case.
+func keyField(key []byte) Field {
+	for _, k := range fieldKeys {
+		if string(key) == k.key {
+			return k.field
+		}
+	}
+	for _, k := range fieldKeys {
+		if bytes.EqualFold(key, []byte(k.key)) {
+			return k.field
+		}
+	}
+	return 0
+}
+
+func (l *Loader) reset(m *Metadata, want Field) {
+	for f := Field(1); f&FieldAll != 0; f <<= 1 {
+		if want&f == 0 {
+			continue
+		}
+		if p := m.stringField(f); p != nil {
+			*p = ""
+		} else if p := m.listField(f); p != nil {
+			*p = (*p)[:0]
+		}
+	}
+	if want&FieldArchitecture != 0 {
+		m.Architecture = nil
+	}
+	if want&FieldLicense != 0 {
+		m.License = nil
+	}
+	if want&FieldZstdDictionary != 0 {
+		m.ZstdDictionary = 0
+	}
+}
+
+// stringField returns the string field f of m, or nil.
+func (m *Metadata) stringField(f Field) *string {
+	switch f {
+	case FieldName:
+		return &m.Name
+	case FieldVersion:
+		return &m.Version
+	case FieldType:
+		return &m.Type
+	case FieldDescription:
+		return &m.Description
+	case FieldMaintainer:
+		return &m.Maintainer
+	case FieldHomepage:
+		return &m.Homepage
+	}
+	return nil
+}
+
+// listField returns the list field f of m, or nil.
+func (m *Metadata) listField(f Field) *[]string {
+	switch f {
+	case FieldTags:
+		return &m.Tags
+	case FieldDependencies:
+		return &m.Dependencies
+	case FieldConflicts:
+		return &m.Conflicts
+	case FieldProvides:
+		return &m.Provides
+	case FieldReplaces:
+		return &m.Replaces
+	case FieldConf:
+		return &m.Conf
+	}
+	return nil
+}
+
+// field decodes the value at s into field f of m. Values recurring across
+// packages are interned; names, versions and descriptions are not.
+func (l *Loader) field(s *scanner, f Field, m *Metadata) error {
+	null := s.null()
+	switch f {
+	case FieldArchitecture, FieldLicense:
+		var p *string
+		if !null {
+			v, err := l.string(s, true)
+			if err != nil {
+				return err
+			}
+			p = &v
+		}
+		if f == FieldArchitecture {
+			m.Architecture = p
+		} else {
+			m.License = p
+		}
+	case FieldZstdDictionary:
+		if null {
+			return nil
+		}
+		num, err := s.number()
+		if err != nil {
+			return err
+		}
+		id, err := strconv.ParseUint(string(num), 10, 32)
+		if err != nil {
+			return s.errorf("zstd_dictionary: %v", err)
+		}
+		m.ZstdDictionary = uint32(id)
+	default:
+		if p := m.listField(f); p != nil {
+			if null {
+				*p = nil
+				return nil
+			}
+			return l.list(s, p)
+		}
+		if null {
+			return nil
+		}
+		v, err := l.string(s, f == FieldType || f == FieldMaintainer)
+		if err != nil {
+			return err
+		}
+		*m.stringField(f) = v
+	}
+	return nil
+}
+
+// list decodes an array of strings at s, appending to *dst.
+func (l *Loader) list(s *scanner, dst *[]string) error {
+	if err := s.expect('['); err != nil {
+		return err
+	}
+	if *dst == nil {
+		*dst = []string{}
+	}
+	*dst = (*dst)[:0]
+	if s.peek() == ']' {
+		s.pos++
+		return nil
+	}
+	for {
+		v := ""
+		if !s.null() {
+			var err error
+			if v, err = l.string(s, true); err != nil {
+				return err
+			}
+		}
+		*dst = append(*dst, v)
+		switch s.peek() {
+		case ',':
+			s.pos++
+		case ']':
+			s.pos++
+			return nil
+		default:
+			return s.errorf("expected , or ]")
+		}
+	}
+}
+
+// string decodes the string at s; intern reuses an earlier copy.
+func (l *Loader) string(s *scanner, intern bool) (string, error) {
+	raw, esc, err := s.str()
+	if err != nil {
+		return "", err
+	}
+	switch {
+	case esc || !utf8.Valid(raw):
+		return l.unquote(raw), nil
+	case !intern:
+		return string(raw), nil
+	}
+	if v, ok := l.strs[string(raw)]; ok {
+		return v, nil
+	}
+	v := string(raw)
+	if l.strs == nil {
+		l.strs = make(map[string]string)
+	}
+	if len(l.strs) < maxInterned {
+		l.strs[v] = v
+	}
+	return v, nil
+}
+
+// unquote decodes the contents of a string the scanner has checked,
+// escapes and invalid UTF-8 included, through encoding/json.
+func (l *Loader) unquote(raw []byte) string {
+	q := make([]byte, 0, len(raw)+2)
+	q = append(append(append(q, '"'), raw...), '"')
+	var v string
+	json.Unmarshal(q, &v)
+	return v
+}
+
+// ── Scanner ─────────────────────────────────────────────────────────────────
+
+// scanner walks a JSON document; values that are not wanted are checked
+// and skipped without being decoded.
+type scanner struct {
+	data []byte
+	pos  int
+}
+
+func (s *scanner) errorf(format string, args ...any) error {
+	return fmt.Errorf("offset %d: %s", s.pos, fmt.Sprintf(format, args...))
+}
+
+// peek skips white space and returns the next byte (0 at the end).
+func (s *scanner) peek() byte {
+	for s.pos < len(s.data) {
+		switch c := s.data[s.pos]; c {
+		case ' ', '\t', '\n', '\r':
+			s.pos++
+		default:
+			return c
+		}
+	}
+	return 0
+}
+
+func (s *scanner) expect(c byte) error {
+	if s.peek() != c {
+		return s.errorf("expected %q", c)
+	}
+	s.pos++
+	return nil
+}
+
+// end checks that only white space follows.
+func (s *scanner) end() error {
+	if s.peek() != 0 || s.pos < len(s.data) {
+		return s.errorf("data after the document")
+	}
+	return nil
+}
+
+// null consumes a null literal if one comes next.
+func (s *scanner) null() bool {
+	if s.peek() == 'n' && bytes.HasPrefix(s.data[s.pos:], []byte("null")) {
+		s.pos += 4
+		return true
+	}
+	return false
+}
+
+// str consumes a string and returns its contents, still escaped if esc.
+func (s *scanner) str() (raw []byte, esc bool, err error) {
+	if err := s.expect('"'); err != nil {
+		return nil, false, err
+	}
+	start := s.pos
+	for s.pos < len(s.data) {
+		switch c := s.data[s.pos]; {
+		case c == '"':
+			s.pos++
+			return s.data[start : s.pos-1], esc, nil
+		case c == '\\':
+			esc = true
+			s.pos++
+			if s.pos >= len(s.data) {
+				break
+			}
+			switch s.data[s.pos] {
+			case '"', '\\', '/', 'b', 'f', 'n', 'r', 't':
+				s.pos++
+			case 'u':
+				if s.pos+5 > len(s.data) {
+					return nil, false, s.errorf("bad \\u escape")
+				}
+				if _, err := strconv.ParseUint(string(s.data[s.pos+1:s.pos+5]), 16, 16); err != nil {
+					return nil, false, s.errorf("bad \\u escape")
+				}
+				s.pos += 5
+			default:
+				return nil, false, s.errorf("bad escape")
+			}
+		case c < 0x20:
+			return nil, false, s.errorf("control character in string")
+		default:
+			s.pos++
+		}
+	}
+	return nil, false, s.errorf("unterminated string")
+}
+
+// number consumes a number and returns its text.
+func (s *scanner) number() ([]byte, error) {
+	s.peek()
+	start := s.pos
+	for s.pos < len(s.data) {
+		c := s.data[s.pos]
+		if c >= '0' && c <= '9' || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E' {
+			s.pos++
+			continue
+		}
+		break
+	}
+	num := s.data[start:s.pos]
+	if !json.Valid(num) {
+		return nil, s.errorf("bad number")
+	}
+	return num, nil
+}
+
+// skip consumes one value of any kind.
+func (s *scanner) skip(depth int) error {
+	if depth > maxDepth {
+		return s.errorf("nested too deeply")
+	}
+	switch c := s.peek(); c {
+	case '"':
+		_, _, err := s.str()
+		return err
+	case '{', '[':
+		closing := byte('}')
+		if c == '[' {
+			closing = ']'
+		}
+		s.pos++
+		if s.peek() == closing {
+			s.pos++
+			return nil
+		}
+		for {
+			if c == '{' {
+				if _, _, err := s.str(); err != nil {
+					return err
+				}
+				if err := s.expect(':'); err != nil {
+					return err
+				}
+			}
+			if err := s.skip(depth + 1); err != nil {
+				return err
+			}
+			switch s.peek() {
+			case ',':
+				s.pos++
+			case closing:
+				s.pos++
+				return nil
+			default:
+				return s.errorf("expected , or %c", closing)
+			}
+		}
+	case 't', 'f', 'n':
+		for _, lit := range []string{"true", "false", "null"} {
+			if bytes.HasPrefix(s.data[s.pos:], []byte(lit)) {
+				s.pos += len(lit)
+				return nil
+			}
+		}
+		return s.errorf("bad literal")
+	default:
+		_, err := s.number()
+		return err
+	}
+}
+
+// ── Bulk loading ────────────────────────────────────────────────────────────
+
+// LoadPackages loads the given fields of the metadata of every .apg in
+// pkgPaths, on jobs goroutines (0 = number of CPUs) with a Loader each.
+// fn is called once per package, one call at a time and in no particular
+// order, with its index in pkgPaths; m is reused once fn returns. An
+// error from fn stops the loading and is returned.
+func LoadPackages(pkgPaths []string, fields Field, jobs int, fn func(i int, m *Metadata, err error) error) error {
+	if jobs <= 0 {
+		jobs = runtime.NumCPU()
+	}
+	if jobs > len(pkgPaths) {
+		jobs = len(pkgPaths)
+	}
+	next := make(chan int)
+	stop := make(chan struct{})
+	var mu sync.Mutex
+	var firstErr error
+	var wg sync.WaitGroup
+	for w := 0; w < jobs; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			l := NewLoader(fields)
+			var m Metadata
+			for i := range next {
+				err := l.LoadPackage(pkgPaths[i], &m)
+				mu.Lock()
+				if firstErr == nil {
+					if firstErr = fn(i, &m, err); firstErr != nil {
+						close(stop)
+					}
+				}
+				mu.Unlock()
+			}
+		}()
+	}
+feed:
+	for i := range pkgPaths {
+		select {
+		case next <- i:
+		case <-stop:
+			break feed
+		}
+	}
+	close(next)
+	wg.Wait()
+	return firstErr
+}
@@ -0,0 +1,120 @@
+package metadata
+
+import (
+	"encoding/json"
+	"os"
+	"path/filepath"
+	"reflect"
+	"strings"
+	"testing"
+
+	"github.com/NurOS-Linux/apgbuild/internal/archive"
+)
+
+func TestLoader_MatchesUnmarshal(t *testing.T) {
+	docs := []string{
+		`{}`,
+		`{"name":"curl","version":"8.5.0","type":"app","architecture":"x86_64","description":"URL tool",
+		  "maintainer":"NurOS","license":"MIT","tags":["net"],"homepage":"https://curl.se",
+		  "dependencies":["glibc","libssl.so.3"],"conflicts":[],"provides":null,"replaces":["curl-old"],
+		  "conf":["/etc/curlrc"],"zstd_dictionary":305419896}`,
+		`{"name":"esc\"aped\\ \u00e9 \ud83d\ude00","architecture":null,"license":null,"tags":[null,"x"]}`,
+		`{"Name":"folded","VERSION":"1","extra":{"nested":[1,2.5e3,-0.1,{"a":[true,false,null]}],"s":"}"},"tail":"x"}`,
+		`{"dependencies":["a"],"dependencies":["b","c"],"name":"dup","name":"last"}`,
+		" \n\t{ \"name\" : \"spaced\" , \"tags\" : [ \"a\" , \"b\" ] } \n",
+	}
+	for _, doc := range docs {
+		var want, got Metadata
+		if err := json.Unmarshal([]byte(doc), &want); err != nil {
+			t.Fatalf("Unmarshal %s: %v", doc, err)
+		}
+		if err := NewLoader(FieldAll).Decode([]byte(doc), &got); err != nil {
+			t.Fatalf("Decode %s: %v", doc, err)
+		}
+		if !reflect.DeepEqual(got, want) {
+			t.Errorf("Decode %s:\n got %+v\nwant %+v", doc, got, want)
+		}
+	}
+}
+
+func TestLoader_Invalid(t *testing.T) {
+	for _, doc := range []string{
+		``, `[]`, `{`, `{"name"}`, `{"name":"a",}`, `{"name":"a"}x`, `{"name":5}`,
+		`{"tags":["a",]}`, `{"tags":"a"}`, `{"other":[1,}`, `{"other":tru}`, `{"other":"\x"}`,
+		"{\"name\":\"a\nb\"}", `{"zstd_dictionary":-1}`, `{"zstd_dictionary":4294967296}`,
+		`{"other":` + strings.Repeat("[", maxDepth+2) + strings.Repeat("]", maxDepth+2) + `}`,
+	} {
+		var m Metadata
+		if err := NewLoader(FieldAll).Decode([]byte(doc), &m); err == nil {
+			t.Errorf("Decode %q: no error", doc)
+		}
+	}
+}
+
+func TestLoader_FieldsAndReuse(t *testing.T) {
+	l := NewLoader(FieldName | FieldDependencies)
+	m := Metadata{Description: "kept", Dependencies: make([]string, 0, 8)}
+	docs := []string{
+		`{"name":"a","description":"skipped","dependencies":["glibc","zlib"],"provides":["x"]}`,
+		`{"name":"b","dependencies":["glibc"]}`,
+	}
+	for i, doc := range docs {
+		if err := l.Decode([]byte(doc), &m); err != nil {
+			t.Fatal(err)
+		}
+		if i == 0 && (m.Name != "a" || len(m.Dependencies) != 2 || m.Provides != nil || m.Description != "kept") {
+			t.Errorf("first decode: %+v", m)
+		}
+	}
+	if m.Name != "b" || !reflect.DeepEqual(m.Dependencies, []string{"glibc"}) || cap(m.Dependencies) != 8 {
+		t.Errorf("second decode: %+v (cap %d)", m, cap(m.Dependencies))
+	}
+
+	// Warm, decoding allocates the name and nothing for the interned
+	// dependencies or the skipped keys.
+	doc := []byte(docs[0])
+	if n := testing.AllocsPerRun(100, func() { l.Decode(doc, &m) }); n > 1 {
+		t.Errorf("Decode allocates %.0f times, want at most 1", n)
+	}
+}
+
+func TestLoader_LoadPackage(t *testing.T) {
+	src := t.TempDir()
+	meta := New()
+	meta.Name, meta.Version = "pkg", "2.0"
+	meta.Dependencies = []string{"glibc"}
+	if err := meta.Save(filepath.Join(src, "metadata.json")); err != nil {
+		t.Fatal(err)
+	}
+	os.MkdirAll(filepath.Join(src, "data"), 0755)
+	os.WriteFile(filepath.Join(src, "data", "file"), []byte(strings.Repeat("payload", 1000)), 0644)
+	pkg := filepath.Join(t.TempDir(), "pkg.apg")
+	if _, err := archive.Create(pkg, src); err != nil {
+		t.Fatal(err)
+	}
+	noMeta := filepath.Join(t.TempDir(), "nometa.apg")
+	if _, err := archive.Create(noMeta, filepath.Join(src, "data")); err != nil {
+		t.Fatal(err)
+	}
+
+	var got []string
+	err := LoadPackages([]string{pkg, noMeta, pkg}, FieldName|FieldVersion|FieldDependencies, 2, func(i int, m *Metadata, err error) error {
+		if i == 1 {
+			if err == nil {
+				t.Errorf("package without metadata.json loaded: %+v", m)
+			}
+			return nil
+		}
+		if err != nil {
+			return err
+		}
+		got = append(got, m.Name+" "+m.Version+" "+strings.Join(m.Dependencies, ","))
+		return nil
+	})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !reflect.DeepEqual(got, []string{"pkg 2.0 glibc", "pkg 2.0 glibc"}) {
+		t.Errorf("LoadPackages: %q", got)
+	}
+}
@@ -29,6 +29,9 @@ type Metadata struct {
 	Provides     []string `json:"provides"`
 	Replaces     []string `json:"replaces"`
 	Conf         []string `json:"conf"`
+	// ZstdDictionary is the ID of the zstd dictionary the package was
+	// compressed with; installers need it to decompress the package.
+	ZstdDictionary uint32 `json:"zstd_dictionary,omitempty"`
 }
 
 // New creates a new empty Metadata structure with initialized slices.
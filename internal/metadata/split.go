@@ -4,8 +4,12 @@ package metadata
 
 import (
 	"fmt"
+	"io/fs"
+	"path"
+	"strings"
 
 	"github.com/NurOS-Linux/apgbuild/internal/elfanalyzer"
+	"github.com/NurOS-Linux/apgbuild/internal/scan"
 )
 
 // SplitKind identifies which sub-package to generate metadata for.
@@ -30,6 +34,31 @@ const (
 //	SplitBins → "<baseName>"
 //	SplitDev  → "<baseName>-dev"
 func GenerateSplitMetadata(base *Metadata, splitDir string, kind SplitKind, baseName string) (*Metadata, error) {
+	var libs []elfanalyzer.LibInfo
+	if kind == SplitLibs || kind == SplitBins {
+		var err error
+		if libs, err = elfanalyzer.ExtractFromDir(splitDir); err != nil {
+			return nil, fmt.Errorf("detect deps for %s split: %w", kind, err)
+		}
+	}
+	return splitMetadata(base, kind, baseName, libs, true)
+}
+
+func (k SplitKind) String() string {
+	switch k {
+	case SplitLibs:
+		return "libs"
+	case SplitBins:
+		return "bins"
+	case SplitDev:
+		return "dev"
+	}
+	return fmt.Sprintf("SplitKind(%d)", int(k))
+}
+
+// splitMetadata builds the metadata of a split whose ELF files need libs.
+// withLibs tells whether a libs split exists for bins and dev to depend on.
+func splitMetadata(base *Metadata, kind SplitKind, baseName string, libs []elfanalyzer.LibInfo, withLibs bool) (*Metadata, error) {
 	m := &Metadata{
 		Version:      base.Version,
 		Architecture: base.Architecture,
@@ -37,6 +66,7 @@ func GenerateSplitMetadata(base *Metadata, splitDir string, kind SplitKind, base
 		License:      base.License,
 		Homepage:     base.Homepage,
 		Tags:         base.Tags,
+		Dependencies: []string{},
 		Conflicts:    []string{},
 		Provides:     []string{},
 		Replaces:     []string{},
@@ -44,17 +74,17 @@ func GenerateSplitMetadata(base *Metadata, splitDir string, kind SplitKind, base
 	}
 
 	libName := "lib" + baseName
+	if withLibs && kind != SplitLibs {
+		m.Dependencies = []string{libName}
+	}
 
 	switch kind {
 	case SplitLibs:
 		m.Name = libName
 		m.Type = "library"
 		m.Description = fmt.Sprintf("Shared libraries for %s", baseName)
-		m.Dependencies = []string{}
 		// Auto-detect runtime deps from ELF .so files
-		if err := m.DetectDependenciesFromDir(splitDir); err != nil {
-			return nil, fmt.Errorf("detect deps for %s: %w", m.Name, err)
-		}
+		addDeps(m, elfanalyzer.MapLibsToPackages(libs), nil)
 		m.Provides = []string{libName}
 
 	case SplitBins:
@@ -62,16 +92,12 @@ func GenerateSplitMetadata(base *Metadata, splitDir string, kind SplitKind, base
 		m.Type = "binary"
 		m.Description = base.Description
 		// Bins depend on the libs split + any additional ELF deps
-		m.Dependencies = []string{libName}
-		if err := addELFDeps(m, splitDir, []string{libName}); err != nil {
-			return nil, fmt.Errorf("detect deps for %s: %w", m.Name, err)
-		}
+		addDeps(m, elfanalyzer.MapLibsToPackages(libs), []string{libName})
 
 	case SplitDev:
 		m.Name = baseName + "-dev"
 		m.Type = "misc"
 		m.Description = fmt.Sprintf("Development files for %s", baseName)
-		m.Dependencies = []string{libName}
 		m.Provides = []string{baseName + "-devel"}
 
 	default:
@@ -81,15 +107,9 @@ func GenerateSplitMetadata(base *Metadata, splitDir string, kind SplitKind, base
 	return m, nil
 }
 
-// addELFDeps detects ELF dependencies from splitDir and merges them into m.Dependencies,
-// skipping any already listed in skip.
-func addELFDeps(m *Metadata, splitDir string, skip []string) error {
-	libs, err := elfanalyzer.ExtractFromDir(splitDir)
-	if err != nil {
-		return err
-	}
-	pkgs := elfanalyzer.MapLibsToPackages(libs)
-
+// addDeps merges pkgs into m.Dependencies, skipping any already listed in
+// m or in skip.
+func addDeps(m *Metadata, pkgs, skip []string) {
 	skipSet := make(map[string]bool, len(skip))
 	for _, s := range skip {
 		skipSet[s] = true
@@ -105,5 +125,108 @@ func addELFDeps(m *Metadata, splitDir string, skip []string) error {
 			existing[pkg] = true
 		}
 	}
-	return nil
+}
+
+// ── All splits from one scan ─────────────────────────────────────────────────
+
+// Split is one sub-package found by GenerateSplits.
+type Split struct {
+	Kind  SplitKind
+	Meta  *Metadata
+	Files []string // non-directory entries, relative to the DESTDIR, in scan order
+}
+
+// libDirs are the directories whose shared objects go to the libs split.
+var libDirs = []string{"lib/", "lib64/", "usr/lib/", "usr/lib64/", "usr/local/lib/"}
+
+// devPrefixes and devExts mark development files.
+var (
+	devPrefixes = []string{"usr/include/", "usr/local/include/", "include/", "usr/share/aclocal/",
+		"usr/share/gir-1.0/", "usr/share/man/man3/", "usr/share/pkgconfig/", "usr/share/cmake/"}
+	devExts = map[string]bool{".a": true, ".la": true, ".h": true, ".hpp": true, ".pc": true, ".prl": true}
+)
+
+// ClassifySplit returns the split a DESTDIR entry belongs to. soname tells
+// whether it is an ELF object with a DT_SONAME.
+//
+//   - dev:  headers, static and libtool archives, pkg-config, CMake and
+//     aclocal files, section 3 man pages and the unversioned libfoo.so
+//     symlinks used only at link time
+//   - libs: shared objects (and their versioned symlinks) in a lib dir
+//   - bins: everything else
+func ClassifySplit(rel string, mode fs.FileMode, soname bool) SplitKind {
+	for _, p := range devPrefixes {
+		if strings.HasPrefix(rel, p) {
+			return SplitDev
+		}
+	}
+	base := path.Base(rel)
+	if devExts[path.Ext(base)] {
+		return SplitDev
+	}
+	var inLib string
+	for _, d := range libDirs {
+		if strings.HasPrefix(rel, d) {
+			inLib = strings.TrimPrefix(rel, d)
+			break
+		}
+	}
+	if inLib == "" {
+		return SplitBins
+	}
+	if strings.Contains("/"+inLib, "/cmake/") || strings.Contains("/"+inLib, "/pkgconfig/") {
+		return SplitDev
+	}
+	if strings.HasSuffix(base, ".so") && mode&fs.ModeSymlink != 0 {
+		return SplitDev
+	}
+	if soname || (mode&fs.ModeSymlink != 0 && strings.Contains(base, ".so.")) {
+		return SplitLibs
+	}
+	return SplitBins
+}
+
+// GenerateSplits partitions a scanned DESTDIR into the libs, bins and dev
+// splits (see ClassifySplit) and derives their metadata as
+// GenerateSplitMetadata would, reading every ELF object once for all
+// three. Empty splits are left out; without a libs split, bins and dev do
+// not depend on lib<baseName>.
+func GenerateSplits(base *Metadata, tree *scan.Tree, baseName string, jobs int) ([]Split, error) {
+	objs := elfanalyzer.ScanTree(tree, elfanalyzer.ScanOptions{Jobs: jobs})
+	byPath := make(map[string]*elfanalyzer.ELFObject, len(objs))
+	for i := range objs {
+		byPath[objs[i].Path] = &objs[i]
+	}
+
+	splits := []Split{{Kind: SplitLibs}, {Kind: SplitBins}, {Kind: SplitDev}}
+	libs := make([][]elfanalyzer.LibInfo, len(splits))
+	for i := range tree.Files {
+		f := &tree.Files[i]
+		if f.Mode.IsDir() {
+			continue
+		}
+		obj := byPath[tree.Abs(f)]
+		k := ClassifySplit(f.Path, f.Mode, obj != nil && obj.Soname != "")
+		splits[k].Files = append(splits[k].Files, f.Path)
+		if obj != nil {
+			for _, lib := range obj.Needed {
+				libs[k] = append(libs[k], elfanalyzer.LibInfo{Name: lib, NeededBy: obj.Path})
+			}
+		}
+	}
+
+	withLibs := len(splits[SplitLibs].Files) > 0
+	var out []Split
+	for k, s := range splits {
+		if len(s.Files) == 0 {
+			continue
+		}
+		m, err := splitMetadata(base, s.Kind, baseName, libs[k], withLibs)
+		if err != nil {
+			return nil, err
+		}
+		s.Meta = m
+		out = append(out, s)
+	}
+	return out, nil
 }
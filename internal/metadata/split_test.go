@@ -0,0 +1,33 @@
+package metadata
+
+import (
+	"io/fs"
+	"testing"
+)
+
+func TestClassifySplit(t *testing.T) {
+	tests := []struct {
+		path   string
+		mode   fs.FileMode
+		soname bool
+		want   SplitKind
+	}{
+		{"usr/lib/libcurl.so.4.8.0", 0, true, SplitLibs},
+		{"usr/lib/libcurl.so.4", fs.ModeSymlink, false, SplitLibs},
+		{"usr/lib/libcurl.so", fs.ModeSymlink, false, SplitDev},
+		{"usr/lib/libcurl.a", 0, false, SplitDev},
+		{"usr/lib/pkgconfig/libcurl.pc", 0, false, SplitDev},
+		{"usr/lib/cmake/CURL/CURLConfig.cmake", 0, false, SplitDev},
+		{"usr/include/curl/curl.h", 0, false, SplitDev},
+		{"usr/share/man/man3/curl_easy_init.3", 0, false, SplitDev},
+		{"usr/bin/curl", 0, false, SplitBins},
+		{"usr/share/man/man1/curl.1", 0, false, SplitBins},
+		{"usr/lib/curl/helper", 0, false, SplitBins},
+		{"etc/curlrc", 0, false, SplitBins},
+	}
+	for _, tt := range tests {
+		if got := ClassifySplit(tt.path, tt.mode, tt.soname); got != tt.want {
+			t.Errorf("ClassifySplit(%q) = %v, want %v", tt.path, got, tt.want)
+		}
+	}
+}
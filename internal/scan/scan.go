@@ -0,0 +1,307 @@
+// Package scan builds an in-memory inventory of a package tree in one walk.
+// Checksumming, ELF analysis and archiving all read the same inventory
+// instead of each walking and stat-ing the tree again.
+// NurOS 2026 - GPL 3.0
+package scan
+
+import (
+	"bytes"
+	"errors"
+	"fmt"
+	"io"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"runtime"
+	"sort"
+	"strings"
+	"sync"
+	"syscall"
+	"time"
+
+	"github.com/NurOS-Linux/apgbuild/internal/uring"
+)
+
+// File is one entry of a scanned tree. The root itself is not included.
+type File struct {
+	Path    string // slash-separated, relative to Tree.Root
+	Mode    fs.FileMode
+	Size    int64
+	ModTime time.Time
+	Dev     uint64
+	Ino     uint64
+	Nlink   uint64
+	ELF     bool // regular file starting with \x7fELF; set only with Options.DetectELF
+
+	stat *syscall.Stat_t
+}
+
+// Stat returns the raw lstat result the entry was built from.
+func (f *File) Stat() *syscall.Stat_t { return f.stat }
+
+// Tree is the inventory of a directory in filepath.WalkDir order.
+type Tree struct {
+	Root  string
+	Files []File
+	// ELFDetected reports whether File.ELF was filled in.
+	ELFDetected bool
+}
+
+// Options configures Scan.
+type Options struct {
+	// DetectELF reads the first four bytes of every regular file to set File.ELF.
+	DetectELF bool
+	// Jobs is the number of files probed concurrently for DetectELF (0 = number of CPUs).
+	Jobs int
+}
+
+func (o Options) jobs() int {
+	if o.Jobs > 0 {
+		return o.Jobs
+	}
+	return runtime.NumCPU()
+}
+
+// Scan walks root once and records every entry below it. Each entry costs
+// a single lstat; symlinks are recorded, not followed. With io_uring (see
+// package uring) the entries of a directory are stat-ed in one batch.
+func Scan(root string, opts Options) (*Tree, error) {
+	t := &Tree{Root: root}
+	err := errRing
+	if fi, lerr := os.Lstat(root); lerr == nil && fi.IsDir() {
+		if r, rerr := uring.New(uring.DefaultDepth); rerr == nil {
+			err = t.walkRing(r, root, "")
+			r.Close()
+		}
+	}
+	if err == errRing {
+		t.Files = nil
+		err = t.walk()
+	}
+	if err != nil {
+		return nil, fmt.Errorf("scan %s: %w", root, err)
+	}
+	if opts.DetectELF {
+		t.detectELF(opts.jobs())
+	}
+	return t, nil
+}
+
+// errRing stops walkRing when the ring fails; Scan then walks again.
+var errRing = errors.New("io_uring failed")
+
+// walk records the entries below Root through filepath.WalkDir.
+func (t *Tree) walk() error {
+	root := t.Root
+	return filepath.WalkDir(root, func(path string, d fs.DirEntry, err error) error {
+		if err != nil {
+			return err
+		}
+		if path == root {
+			return nil
+		}
+		info, err := d.Info()
+		if err != nil {
+			return err
+		}
+		rel, err := filepath.Rel(root, path)
+		if err != nil {
+			return err
+		}
+		t.Files = append(t.Files, newFile(filepath.ToSlash(rel), info))
+		return nil
+	})
+}
+
+// walkRing records the entries below dir, slash path rel, in the order of
+// walk: each directory is read, all its entries are stat-ed through r in
+// one batch, then its subdirectories are walked in turn.
+func (t *Tree) walkRing(r *uring.Ring, dir, rel string) error {
+	entries, err := os.ReadDir(dir)
+	if err != nil {
+		return err
+	}
+	paths := make([]string, len(entries))
+	for i, e := range entries {
+		paths[i] = filepath.Join(dir, e.Name())
+	}
+	st := make([]syscall.Stat_t, len(entries))
+	errs, err := r.Lstat(paths, st)
+	if err != nil {
+		return errRing
+	}
+	for i, e := range entries {
+		if errs[i] != nil {
+			return errs[i]
+		}
+		name := e.Name()
+		if rel != "" {
+			name = rel + "/" + name
+		}
+		f := statFile(name, &st[i])
+		t.Files = append(t.Files, f)
+		if f.Mode.IsDir() {
+			if err := t.walkRing(r, paths[i], name); err != nil {
+				return err
+			}
+		}
+	}
+	return nil
+}
+
+func newFile(rel string, info fs.FileInfo) File {
+	f := File{Path: rel, Mode: info.Mode(), Size: info.Size(), ModTime: info.ModTime()}
+	if st, ok := info.Sys().(*syscall.Stat_t); ok {
+		f.stat = st
+		f.Dev, f.Ino, f.Nlink = uint64(st.Dev), uint64(st.Ino), uint64(st.Nlink)
+	}
+	return f
+}
+
+// statFile builds the entry for rel from its raw lstat result.
+func statFile(rel string, st *syscall.Stat_t) File {
+	return File{
+		Path: rel, Mode: statMode(st.Mode), Size: st.Size,
+		ModTime: time.Unix(st.Mtim.Sec, st.Mtim.Nsec),
+		Dev:     uint64(st.Dev), Ino: uint64(st.Ino), Nlink: uint64(st.Nlink),
+		stat: st,
+	}
+}
+
+// statMode converts st_mode the way os.Lstat does.
+func statMode(mode uint32) fs.FileMode {
+	m := fs.FileMode(mode & 0777)
+	switch mode & syscall.S_IFMT {
+	case syscall.S_IFBLK:
+		m |= fs.ModeDevice
+	case syscall.S_IFCHR:
+		m |= fs.ModeDevice | fs.ModeCharDevice
+	case syscall.S_IFDIR:
+		m |= fs.ModeDir
+	case syscall.S_IFIFO:
+		m |= fs.ModeNamedPipe
+	case syscall.S_IFLNK:
+		m |= fs.ModeSymlink
+	case syscall.S_IFSOCK:
+		m |= fs.ModeSocket
+	}
+	if mode&syscall.S_ISGID != 0 {
+		m |= fs.ModeSetgid
+	}
+	if mode&syscall.S_ISUID != 0 {
+		m |= fs.ModeSetuid
+	}
+	if mode&syscall.S_ISVTX != 0 {
+		m |= fs.ModeSticky
+	}
+	return m
+}
+
+// Abs returns the on-disk path of f.
+func (t *Tree) Abs(f *File) string {
+	return filepath.Join(t.Root, filepath.FromSlash(f.Path))
+}
+
+// Sub returns the entries below the top-level directory dir (not dir
+// itself), in tree order. An empty dir selects the whole tree.
+func (t *Tree) Sub(dir string) []File {
+	if dir == "" {
+		return t.Files
+	}
+	prefix := dir + "/"
+	lo := sort.Search(len(t.Files), func(i int) bool { return walkKey(t.Files[i].Path) > walkKey(dir) })
+	hi := lo
+	for hi < len(t.Files) && strings.HasPrefix(t.Files[hi].Path, prefix) {
+		hi++
+	}
+	return t.Files[lo:hi]
+}
+
+// Lookup returns the entry for rel, or nil if the tree has none.
+func (t *Tree) Lookup(rel string) *File {
+	if i, ok := t.search(rel); ok {
+		return &t.Files[i]
+	}
+	return nil
+}
+
+// Add stats rel under Root and inserts it, or refreshes it if it is already
+// listed. It is meant for files generated after the scan, such as sums files.
+func (t *Tree) Add(rel string) (*File, error) {
+	rel = filepath.ToSlash(rel)
+	info, err := os.Lstat(filepath.Join(t.Root, filepath.FromSlash(rel)))
+	if err != nil {
+		return nil, err
+	}
+	f := newFile(rel, info)
+	if t.ELFDetected && f.Mode.IsRegular() {
+		f.ELF = probeELF(t.Abs(&f))
+	}
+
+	i, ok := t.search(rel)
+	if !ok {
+		t.Files = append(t.Files, File{})
+		copy(t.Files[i+1:], t.Files[i:])
+	}
+	t.Files[i] = f
+	return &t.Files[i], nil
+}
+
+// Remove drops rel from the tree, if present.
+func (t *Tree) Remove(rel string) {
+	if i, ok := t.search(rel); ok {
+		t.Files = append(t.Files[:i], t.Files[i+1:]...)
+	}
+}
+
+// search returns the index of rel in Files, or where it would be inserted.
+func (t *Tree) search(rel string) (int, bool) {
+	key := walkKey(rel)
+	i := sort.Search(len(t.Files), func(i int) bool { return walkKey(t.Files[i].Path) >= key })
+	return i, i < len(t.Files) && t.Files[i].Path == rel
+}
+
+// walkKey orders paths the way filepath.WalkDir visits them: a directory's
+// children come right after it, before any sibling that sorts later.
+func walkKey(p string) string {
+	return strings.ReplaceAll(p, "/", "\x00")
+}
+
+// detectELF sets File.ELF for every regular file using up to jobs workers.
+func (t *Tree) detectELF(jobs int) {
+	next := make(chan int)
+	var wg sync.WaitGroup
+	for w := 0; w < jobs; w++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := range next {
+				t.Files[i].ELF = probeELF(t.Abs(&t.Files[i]))
+			}
+		}()
+	}
+	for i := range t.Files {
+		if t.Files[i].Mode.IsRegular() {
+			next <- i
+		}
+	}
+	close(next)
+	wg.Wait()
+	t.ELFDetected = true
+}
+
+var elfMagic = []byte("\x7fELF")
+
+// probeELF reports whether the file at path starts with the ELF magic.
+func probeELF(path string) bool {
+	f, err := os.Open(path)
+	if err != nil {
+		return false
+	}
+	defer f.Close()
+	var hdr [4]byte
+	if _, err := io.ReadFull(f, hdr[:]); err != nil {
+		return false
+	}
+	return bytes.Equal(hdr[:], elfMagic)
+}
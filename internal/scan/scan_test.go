@@ -0,0 +1,154 @@
+package scan
+
+import (
+	"io/fs"
+	"os"
+	"path/filepath"
+	"reflect"
+	"testing"
+
+	"github.com/NurOS-Linux/apgbuild/internal/uring"
+)
+
+func testTree(t *testing.T) string {
+	t.Helper()
+	dir := t.TempDir()
+	for _, d := range []string{"data/usr/bin", "data/usr/lib", "data.d", "home"} {
+		os.MkdirAll(filepath.Join(dir, d), 0755)
+	}
+	os.WriteFile(filepath.Join(dir, "metadata.json"), []byte("{}"), 0644)
+	os.WriteFile(filepath.Join(dir, "data/usr/bin/app"), []byte("\x7fELF\x02\x01\x01"), 0755)
+	os.WriteFile(filepath.Join(dir, "data/usr/bin/run.sh"), []byte("#!/bin/sh\n"), 0755)
+	os.WriteFile(filepath.Join(dir, "data/usr/lib/libx.so.1"), []byte("\x7fELF"), 0644)
+	os.Symlink("libx.so.1", filepath.Join(dir, "data/usr/lib/libx.so"))
+	os.WriteFile(filepath.Join(dir, "data.d/note"), []byte("n"), 0644)
+	return dir
+}
+
+func TestScan_MatchesWalkDir(t *testing.T) {
+	dir := testTree(t)
+	tree, err := Scan(dir, Options{})
+	if err != nil {
+		t.Fatalf("Scan failed: %v", err)
+	}
+
+	var want []string
+	filepath.WalkDir(dir, func(path string, d fs.DirEntry, err error) error {
+		if path != dir {
+			rel, _ := filepath.Rel(dir, path)
+			want = append(want, filepath.ToSlash(rel))
+		}
+		return nil
+	})
+	var got []string
+	for _, f := range tree.Files {
+		got = append(got, f.Path)
+	}
+	if !reflect.DeepEqual(got, want) {
+		t.Errorf("Scan order = %v, want %v", got, want)
+	}
+
+	link := tree.Lookup("data/usr/lib/libx.so")
+	if link == nil || link.Mode&fs.ModeSymlink == 0 {
+		t.Errorf("Expected symlink entry, got %+v", link)
+	}
+	if f := tree.Lookup("metadata.json"); f == nil || f.Size != 2 || f.Ino == 0 || f.Stat() == nil {
+		t.Errorf("Unexpected metadata.json entry: %+v", f)
+	}
+	if tree.Lookup("missing") != nil {
+		t.Error("Lookup of a missing path should return nil")
+	}
+}
+
+func TestTree_Sub(t *testing.T) {
+	tree, err := Scan(testTree(t), Options{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	var got []string
+	for _, f := range tree.Sub("data") {
+		got = append(got, f.Path)
+	}
+	want := []string{
+		"data/usr", "data/usr/bin", "data/usr/bin/app", "data/usr/bin/run.sh",
+		"data/usr/lib", "data/usr/lib/libx.so", "data/usr/lib/libx.so.1",
+	}
+	if !reflect.DeepEqual(got, want) {
+		t.Errorf("Sub(data) = %v, want %v", got, want)
+	}
+	if n := len(tree.Sub("home")); n != 0 {
+		t.Errorf("Sub(home) returned %d entries, want 0", n)
+	}
+}
+
+func TestTree_Add(t *testing.T) {
+	dir := testTree(t)
+	tree, err := Scan(dir, Options{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	n := len(tree.Files)
+
+	os.WriteFile(filepath.Join(dir, "sha256sums"), []byte("x"), 0644)
+	if _, err := tree.Add("sha256sums"); err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	os.WriteFile(filepath.Join(dir, "sha256sums"), []byte("xyz"), 0644)
+	f, err := tree.Add("sha256sums")
+	if err != nil {
+		t.Fatalf("Add failed: %v", err)
+	}
+	if len(tree.Files) != n+1 || f.Size != 3 {
+		t.Errorf("Add should insert once and refresh: %d files, size %d", len(tree.Files), f.Size)
+	}
+
+	fresh, _ := Scan(dir, Options{})
+	for i := range fresh.Files {
+		if fresh.Files[i].Path != tree.Files[i].Path {
+			t.Fatalf("Add broke tree order at %d: %s vs %s", i, tree.Files[i].Path, fresh.Files[i].Path)
+		}
+	}
+}
+
+func TestScan_DetectELF(t *testing.T) {
+	tree, err := Scan(testTree(t), Options{DetectELF: true, Jobs: 2})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !tree.ELFDetected {
+		t.Error("ELFDetected should be set")
+	}
+	var elfs []string
+	for _, f := range tree.Files {
+		if f.ELF {
+			elfs = append(elfs, f.Path)
+		}
+	}
+	want := []string{"data/usr/bin/app", "data/usr/lib/libx.so.1"}
+	if !reflect.DeepEqual(elfs, want) {
+		t.Errorf("ELF files = %v, want %v", elfs, want)
+	}
+}
+
+func TestScan_RingMatchesWalk(t *testing.T) {
+	dir := testTree(t)
+	tree, err := Scan(dir, Options{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	t.Setenv(uring.DisableEnv, "0")
+	walked, err := Scan(dir, Options{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(tree.Files) != len(walked.Files) {
+		t.Fatalf("%d entries, %d with filepath.WalkDir", len(tree.Files), len(walked.Files))
+	}
+	for i, f := range tree.Files {
+		w := walked.Files[i]
+		if f.Path != w.Path || f.Mode != w.Mode || f.Size != w.Size || !f.ModTime.Equal(w.ModTime) ||
+			f.Ino != w.Ino || f.Nlink != w.Nlink || f.Stat().Blocks != w.Stat().Blocks || f.Stat().Uid != w.Stat().Uid {
+			t.Errorf("entry %d: %+v, want %+v", i, f, w)
+		}
+	}
+}
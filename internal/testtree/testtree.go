@@ -0,0 +1,284 @@
+// Package testtree — deterministic synthetic package trees for benchmarks.
+// NurOS 2026 - GPL 3.0
+package testtree
+
+import (
+	"encoding/binary"
+	"fmt"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"strconv"
+	"sync"
+	"testing"
+)
+
+// Shape selects the kind of package a tree imitates.
+type Shape string
+
+const (
+	// FewHuge is a handful of multi-MiB files, half text, half noise
+	// (e.g. firmware, databases, fonts).
+	FewHuge Shape = "huge"
+	// ManyTiny is thousands of small text files in a deep tree (e.g.
+	// locales, icon themes, Python modules).
+	ManyTiny Shape = "tiny"
+	// ELFHeavy is shared libraries and executables with SONAMEs and
+	// DT_NEEDED entries (e.g. a -libs split).
+	ELFHeavy Shape = "elf"
+)
+
+// Shapes lists every shape, in the order benchmarks run them.
+var Shapes = []Shape{FewHuge, ManyTiny, ELFHeavy}
+
+// ScaleEnv multiplies the file counts of every shape (default 1).
+const ScaleEnv = "APG_BENCH_SCALE"
+
+// Stats describes a generated tree.
+type Stats struct {
+	Files int   // regular files under data/
+	Bytes int64 // their total size
+}
+
+// Generate writes a package source directory of shape to root: a
+// metadata.json and a data/ tree. scale multiplies the file count. The
+// result depends only on shape and scale, so runs are comparable.
+func Generate(root string, shape Shape, scale int) (Stats, error) {
+	if scale < 1 {
+		scale = 1
+	}
+	seed := int64(scale)
+	for _, c := range []byte(shape) {
+		seed = seed*131 + int64(c)
+	}
+	g := &gen{r: rand.New(rand.NewSource(seed)), data: filepath.Join(root, "data")}
+	meta := fmt.Sprintf(`{"name":"bench-%s","version":"1.0","architecture":"x86_64","description":"synthetic %s tree"}`+"\n", shape, shape)
+	if err := os.MkdirAll(g.data, 0755); err != nil {
+		return Stats{}, err
+	}
+	if err := os.WriteFile(filepath.Join(root, "metadata.json"), []byte(meta), 0644); err != nil {
+		return Stats{}, err
+	}
+
+	switch shape {
+	case FewHuge:
+		for i := 0; i < 3*scale; i++ {
+			buf := g.text(2 << 20)
+			buf = append(buf, g.noise(2<<20)...)
+			g.write(fmt.Sprintf("usr/share/bench/blob%02d.bin", i), buf)
+		}
+	case ManyTiny:
+		for i := 0; i < 5000*scale; i++ {
+			name := fmt.Sprintf("usr/share/locale/l%02d/LC_MESSAGES/d%02d/m%05d.txt", i%40, i/40%25, i)
+			g.write(name, g.text(32+g.r.Intn(480)))
+		}
+	case ELFHeavy:
+		libs := 100 * scale
+		for i := 0; i < libs; i++ {
+			soname := "libbench" + strconv.Itoa(i) + ".so.1"
+			g.write("usr/lib/"+soname, ELF(soname, g.needed(i, libs), g.noise(16<<10+g.r.Intn(64<<10))))
+		}
+		for i := 0; i < 2*libs; i++ {
+			g.write(fmt.Sprintf("usr/bin/tool%d", i), ELF("", g.needed(libs, libs), g.noise(8<<10+g.r.Intn(32<<10))))
+		}
+		for i := 0; i < libs; i++ {
+			g.write(fmt.Sprintf("usr/share/doc/bench/README%d", i), g.text(1024))
+		}
+	default:
+		return Stats{}, fmt.Errorf("unknown tree shape %q", shape)
+	}
+	return g.stats, g.err
+}
+
+// gen holds the state of one Generate call.
+type gen struct {
+	r     *rand.Rand
+	data  string
+	stats Stats
+	err   error
+}
+
+func (g *gen) write(rel string, content []byte) {
+	if g.err != nil {
+		return
+	}
+	p := filepath.Join(g.data, filepath.FromSlash(rel))
+	if g.err = os.MkdirAll(filepath.Dir(p), 0755); g.err != nil {
+		return
+	}
+	mode := os.FileMode(0644)
+	if len(content) > 4 && string(content[:4]) == "\x7fELF" {
+		mode = 0755
+	}
+	if g.err = os.WriteFile(p, content, mode); g.err == nil {
+		g.stats.Files++
+		g.stats.Bytes += int64(len(content))
+	}
+}
+
+var words = []string{
+	"package", "library", "the", "of", "system", "file", "error", "config",
+	"version", "install", "path", "return", "value", "string", "static",
+	"const", "msgid", "msgstr", "translation", "default", "user", "build",
+}
+
+// text returns n bytes of word salad, compressible like source or .po files.
+func (g *gen) text(n int) []byte {
+	b := make([]byte, 0, n+16)
+	for len(b) < n {
+		b = append(b, words[g.r.Intn(len(words))]...)
+		if g.r.Intn(10) == 0 {
+			b = append(b, '\n')
+		} else {
+			b = append(b, ' ')
+		}
+	}
+	return b[:n]
+}
+
+// noise returns n pseudo-random bytes, incompressible like machine code
+// or media.
+func (g *gen) noise(n int) []byte {
+	b := make([]byte, n)
+	g.r.Read(b)
+	return b
+}
+
+// needed returns DT_NEEDED entries for an object: libc plus a few of the
+// first below libraries of the tree.
+func (g *gen) needed(below, libs int) []string {
+	n := []string{"libc.so.6"}
+	if below > libs {
+		below = libs
+	}
+	for k := g.r.Intn(6); k > 0 && below > 0; k-- {
+		n = append(n, "libbench"+strconv.Itoa(g.r.Intn(below))+".so.1")
+	}
+	return n
+}
+
+// ELF returns a minimal little-endian x86-64 shared object: one PT_LOAD
+// covering the file and a PT_DYNAMIC with DT_SONAME (unless soname is
+// ""), DT_NEEDED, DT_STRTAB and DT_STRSZ, followed by payload and the
+// .dynstr, .dynamic and .shstrtab section headers.
+func ELF(soname string, needed []string, payload []byte) []byte {
+	const ehdrSize, phdrSize = 64, 56
+	strOff := uint64(ehdrSize + 2*phdrSize)
+	strs := []byte{0}
+	addStr := func(s string) uint64 {
+		off := uint64(len(strs))
+		strs = append(strs, s...)
+		strs = append(strs, 0)
+		return off
+	}
+	var dyn []uint64
+	for _, n := range needed {
+		dyn = append(dyn, uint64(1), addStr(n)) // DT_NEEDED
+	}
+	if soname != "" {
+		dyn = append(dyn, 14, addStr(soname)) // DT_SONAME
+	}
+	dynOff := (strOff + uint64(len(strs)) + 7) &^ 7
+	dyn = append(dyn, 5, strOff, 10, uint64(len(strs)), 0, 0) // DT_STRTAB, DT_STRSZ, DT_NULL
+	dynSize := uint64(len(dyn) * 8)
+	const shstrtab = "\x00.dynstr\x00.dynamic\x00.shstrtab\x00"
+	shstrOff := dynOff + dynSize + uint64(len(payload))
+	shOff := (shstrOff + uint64(len(shstrtab)) + 7) &^ 7
+	size := shOff + 4*64
+
+	b := make([]byte, size)
+	le := binary.LittleEndian
+	copy(b, "\x7fELF\x02\x01\x01") // ELFCLASS64, ELFDATA2LSB, EV_CURRENT
+	le.PutUint16(b[16:], 3)        // ET_DYN
+	le.PutUint16(b[18:], 62)       // EM_X86_64
+	le.PutUint32(b[20:], 1)        // EV_CURRENT
+	le.PutUint64(b[32:], ehdrSize) // e_phoff
+	le.PutUint16(b[52:], ehdrSize) // e_ehsize
+	le.PutUint16(b[54:], phdrSize) // e_phentsize
+	le.PutUint16(b[56:], 2)        // e_phnum
+	le.PutUint64(b[40:], shOff)    // e_shoff
+	le.PutUint16(b[58:], 64)       // e_shentsize
+	le.PutUint16(b[60:], 4)        // e_shnum
+	le.PutUint16(b[62:], 3)        // e_shstrndx
+	phdr := func(at int, typ, flags uint32, off, filesz uint64) {
+		p := b[at:]
+		le.PutUint32(p[0:], typ)
+		le.PutUint32(p[4:], flags)
+		le.PutUint64(p[8:], off)     // p_offset
+		le.PutUint64(p[16:], off)    // p_vaddr
+		le.PutUint64(p[24:], off)    // p_paddr
+		le.PutUint64(p[32:], filesz) // p_filesz
+		le.PutUint64(p[40:], filesz) // p_memsz
+		le.PutUint64(p[48:], 8)      // p_align
+	}
+	phdr(ehdrSize, 1, 5, 0, size)                  // PT_LOAD, R+X
+	phdr(ehdrSize+phdrSize, 2, 6, dynOff, dynSize) // PT_DYNAMIC, R+W
+	copy(b[strOff:], strs)
+	for i, v := range dyn {
+		le.PutUint64(b[dynOff+uint64(i)*8:], v)
+	}
+	copy(b[dynOff+dynSize:], payload)
+	copy(b[shstrOff:], shstrtab)
+	shdr := func(i int, name, typ uint32, flags, off, size uint64, link uint32, entsize uint64) {
+		p := b[shOff+uint64(i)*64:]
+		le.PutUint32(p[0:], name)
+		le.PutUint32(p[4:], typ)
+		le.PutUint64(p[8:], flags)
+		le.PutUint64(p[16:], off) // sh_addr
+		le.PutUint64(p[24:], off) // sh_offset
+		le.PutUint64(p[32:], size)
+		le.PutUint32(p[40:], link)
+		le.PutUint64(p[48:], 1) // sh_addralign
+		le.PutUint64(p[56:], entsize)
+	}
+	shdr(1, 1, 3, 2, strOff, uint64(len(strs)), 0, 0) // .dynstr: SHT_STRTAB, SHF_ALLOC
+	shdr(2, 9, 6, 3, dynOff, dynSize, 1, 16)          // .dynamic: SHT_DYNAMIC, SHF_WRITE|SHF_ALLOC
+	shdr(3, 18, 3, 0, shstrOff, uint64(len(shstrtab)), 0, 0)
+	le.PutUint64(b[shOff+3*64+16:], 0) // .shstrtab is not loaded
+	return b
+}
+
+// ── Shared trees for benchmarks ──────────────────────────────────────────────
+
+var (
+	sharedMu   sync.Mutex
+	sharedRoot string
+	shared     = map[Shape]Stats{}
+)
+
+// Shared returns a tree of shape (see Generate, scaled by $APG_BENCH_SCALE)
+// generated once per test binary, and its stats. Call Cleanup from
+// TestMain to remove the trees.
+func Shared(tb testing.TB, shape Shape) (string, Stats) {
+	tb.Helper()
+	sharedMu.Lock()
+	defer sharedMu.Unlock()
+	if sharedRoot == "" {
+		dir, err := os.MkdirTemp("", "apgbuild-bench-")
+		if err != nil {
+			tb.Fatal(err)
+		}
+		sharedRoot = dir
+	}
+	root := filepath.Join(sharedRoot, string(shape))
+	if st, ok := shared[shape]; ok {
+		return root, st
+	}
+	scale, _ := strconv.Atoi(os.Getenv(ScaleEnv))
+	st, err := Generate(root, shape, scale)
+	if err != nil {
+		tb.Fatalf("generate %s tree: %v", shape, err)
+	}
+	shared[shape] = st
+	return root, st
+}
+
+// Cleanup removes the trees made by Shared.
+func Cleanup() {
+	sharedMu.Lock()
+	defer sharedMu.Unlock()
+	if sharedRoot != "" {
+		os.RemoveAll(sharedRoot)
+		sharedRoot, shared = "", map[Shape]Stats{}
+	}
+}
@@ -0,0 +1,51 @@
+package testtree
+
+import (
+	"bytes"
+	"debug/elf"
+	"os"
+	"path/filepath"
+	"reflect"
+	"testing"
+)
+
+func TestELF(t *testing.T) {
+	obj := ELF("libx.so.2", []string{"libc.so.6", "liby.so.1"}, []byte("payload"))
+	f, err := elf.NewFile(bytes.NewReader(obj))
+	if err != nil {
+		t.Fatalf("not a valid ELF: %v", err)
+	}
+	needed, err := f.DynString(elf.DT_NEEDED)
+	if err != nil || !reflect.DeepEqual(needed, []string{"libc.so.6", "liby.so.1"}) {
+		t.Errorf("DT_NEEDED = %v, %v", needed, err)
+	}
+	if soname, _ := f.DynString(elf.DT_SONAME); !reflect.DeepEqual(soname, []string{"libx.so.2"}) {
+		t.Errorf("DT_SONAME = %v", soname)
+	}
+}
+
+func TestGenerate_Deterministic(t *testing.T) {
+	for _, shape := range []Shape{ManyTiny, ELFHeavy} {
+		a, b := t.TempDir(), t.TempDir()
+		sa, err := Generate(a, shape, 1)
+		if err != nil {
+			t.Fatal(err)
+		}
+		sb, _ := Generate(b, shape, 1)
+		if sa != sb || sa.Files == 0 {
+			t.Errorf("%s: stats %+v and %+v", shape, sa, sb)
+		}
+		filepath.WalkDir(filepath.Join(a, "data"), func(p string, d os.DirEntry, err error) error {
+			if err != nil || d.IsDir() {
+				return err
+			}
+			rel, _ := filepath.Rel(a, p)
+			x, _ := os.ReadFile(p)
+			y, _ := os.ReadFile(filepath.Join(b, rel))
+			if !bytes.Equal(x, y) {
+				t.Fatalf("%s: %s differs between runs", shape, rel)
+			}
+			return nil
+		})
+	}
+}
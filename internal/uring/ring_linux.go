@@ -0,0 +1,339 @@
+//go:build linux && uring
+
+// Package uring — io_uring rings through raw system calls (no liburing).
+// NurOS 2026 - GPL 3.0
+package uring
+
+/*
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+// apg_ring is one io_uring instance, used by one thread at a time. Every
+// batch is submitted and reaped completely before the call returns, so the
+// kernel never holds on to caller memory between calls.
+typedef struct {
+    int fd;
+    unsigned entries;
+    unsigned tail;                      // our submission tail
+    unsigned pending;                   // SQEs queued since the last apg_ring_wait
+    unsigned *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sqMap, *cqMap;
+    size_t sqMapLen, cqMapLen, sqesLen;
+    long long *res;                     // results by user_data, entries of them
+    int *fds;
+    struct statx *stx;
+} apg_ring;
+
+static void apg_ring_free(apg_ring *r) {
+    if (!r) return;
+    if (r->sqes) munmap(r->sqes, r->sqesLen);
+    if (r->cqMap && r->cqMap != r->sqMap) munmap(r->cqMap, r->cqMapLen);
+    if (r->sqMap) munmap(r->sqMap, r->sqMapLen);
+    if (r->fd >= 0) close(r->fd);
+    free(r->res); free(r->fds); free(r->stx);
+    free(r);
+}
+
+// apg_ring_probe reports whether the kernel supports every opcode used.
+static int apg_ring_probe(int fd) {
+    static const int ops[] = {IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_CLOSE};
+    size_t len = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *p = calloc(1, len);
+    int ok = p && syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, p, 256) == 0;
+    for (size_t i = 0; ok && i < sizeof(ops) / sizeof(ops[0]); i++)
+        ok = ops[i] <= p->last_op && (p->ops[ops[i]].flags & IO_URING_OP_SUPPORTED);
+    free(p);
+    return ok;
+}
+
+// apg_ring_new sets up a ring of entries SQEs; on failure *errnum is set.
+static apg_ring *apg_ring_new(unsigned entries, int *errnum) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd < 0) { *errnum = errno; return NULL; }
+    apg_ring *r = calloc(1, sizeof(*r));
+    r->fd = fd;
+    if (!apg_ring_probe(fd)) { *errnum = EOPNOTSUPP; apg_ring_free(r); return NULL; }
+
+    r->entries = p.sq_entries;
+    r->sqMapLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cqMapLen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) && r->cqMapLen > r->sqMapLen) r->sqMapLen = r->cqMapLen;
+    r->sqMap = mmap(NULL, r->sqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (r->sqMap == MAP_FAILED) { r->sqMap = NULL; *errnum = errno; apg_ring_free(r); return NULL; }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cqMap = r->sqMap;
+    } else {
+        r->cqMap = mmap(NULL, r->cqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (r->cqMap == MAP_FAILED) { r->cqMap = NULL; *errnum = errno; apg_ring_free(r); return NULL; }
+    }
+    r->sqesLen = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) { r->sqes = NULL; *errnum = errno; apg_ring_free(r); return NULL; }
+
+    char *sq = r->sqMap, *cq = r->cqMap;
+    r->sqTail = (unsigned *)(sq + p.sq_off.tail);
+    r->sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sqArray = (unsigned *)(sq + p.sq_off.array);
+    r->cqHead = (unsigned *)(cq + p.cq_off.head);
+    r->cqTail = (unsigned *)(cq + p.cq_off.tail);
+    r->cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->tail = *r->sqTail;
+
+    r->res = calloc(r->entries, sizeof(*r->res));
+    r->fds = calloc(r->entries, sizeof(*r->fds));
+    r->stx = calloc(r->entries, sizeof(*r->stx));
+    return r;
+}
+
+// apg_ring_sqe queues a zeroed SQE whose result goes to res[data].
+static struct io_uring_sqe *apg_ring_sqe(apg_ring *r, unsigned data) {
+    unsigned idx = r->tail & *r->sqMask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = data;
+    r->sqArray[idx] = idx;
+    r->tail++;
+    r->pending++;
+    return sqe;
+}
+
+// apg_ring_wait submits the queued SQEs and reaps all their completions
+// into r->res. It returns 0 or a negative errno, after which the ring
+// must not be used again.
+static int apg_ring_wait(apg_ring *r) {
+    unsigned want = r->pending, submit = r->pending, done = 0;
+    r->pending = 0;
+    __atomic_store_n(r->sqTail, r->tail, __ATOMIC_RELEASE);
+    while (done < want) {
+        int n = syscall(__NR_io_uring_enter, r->fd, submit, want - done, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -errno;
+        submit -= (unsigned)n < submit ? (unsigned)n : submit;
+        unsigned head = *r->cqHead, tail = __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++, done++) {
+            struct io_uring_cqe *c = &r->cqes[head & *r->cqMask];
+            r->res[c->user_data] = c->res;
+        }
+        __atomic_store_n(r->cqHead, head, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+static void apg_stat_from(const struct statx *x, struct stat *st) {
+    memset(st, 0, sizeof(*st));
+    st->st_dev = makedev(x->stx_dev_major, x->stx_dev_minor);
+    st->st_ino = x->stx_ino;
+    st->st_mode = x->stx_mode;
+    st->st_nlink = x->stx_nlink;
+    st->st_uid = x->stx_uid;
+    st->st_gid = x->stx_gid;
+    st->st_rdev = makedev(x->stx_rdev_major, x->stx_rdev_minor);
+    st->st_size = x->stx_size;
+    st->st_blksize = x->stx_blksize;
+    st->st_blocks = x->stx_blocks;
+    st->st_atim.tv_sec = x->stx_atime.tv_sec; st->st_atim.tv_nsec = x->stx_atime.tv_nsec;
+    st->st_mtim.tv_sec = x->stx_mtime.tv_sec; st->st_mtim.tv_nsec = x->stx_mtime.tv_nsec;
+    st->st_ctim.tv_sec = x->stx_ctime.tv_sec; st->st_ctim.tv_nsec = x->stx_ctime.tv_nsec;
+}
+
+// apg_ring_lstat stats n paths (NUL-terminated, at names + off[i]) without
+// following symlinks: st[i] is filled in, or errs[i] set to an errno.
+static int apg_ring_lstat(apg_ring *r, const char *names, const int *off, int n,
+                          struct stat *st, int *errs) {
+    for (int base = 0; base < n; base += r->entries) {
+        int m = n - base < (int)r->entries ? n - base : (int)r->entries;
+        for (int i = 0; i < m; i++) {
+            struct io_uring_sqe *sqe = apg_ring_sqe(r, i);
+            sqe->opcode = IORING_OP_STATX;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uintptr_t)(names + off[base + i]);
+            sqe->len = STATX_BASIC_STATS;
+            sqe->off = (uintptr_t)&r->stx[i];
+            sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+        }
+        int rc = apg_ring_wait(r);
+        if (rc != 0) return rc;
+        for (int i = 0; i < m; i++) {
+            errs[base + i] = r->res[i] < 0 ? (int)-r->res[i] : 0;
+            if (r->res[i] >= 0) apg_stat_from(&r->stx[i], &st[base + i]);
+        }
+    }
+    return 0;
+}
+
+// apg_ring_read reads the files named as for apg_ring_lstat, file i into
+// buf[boff[i], boff[i+1]), in rounds of opens, reads and closes of up to
+// r->entries files each. got[i] is the bytes read or a negative errno.
+static int apg_ring_read(apg_ring *r, const char *names, const int *off, int n,
+                         char *buf, const long long *boff, long long *got) {
+    for (int base = 0; base < n; base += r->entries) {
+        int m = n - base < (int)r->entries ? n - base : (int)r->entries;
+        for (int i = 0; i < m; i++) {
+            struct io_uring_sqe *sqe = apg_ring_sqe(r, i);
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uintptr_t)(names + off[base + i]);
+            sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        }
+        int rc = apg_ring_wait(r);
+        if (rc != 0) return rc;
+        for (int i = 0; i < m; i++) {
+            r->fds[i] = (int)r->res[i];
+            got[base + i] = r->res[i] < 0 ? r->res[i] : 0;
+            if (r->fds[i] < 0) continue;
+            struct io_uring_sqe *sqe = apg_ring_sqe(r, i);
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = r->fds[i];
+            sqe->addr = (uintptr_t)(buf + boff[base + i]);
+            sqe->len = (unsigned)(boff[base + i + 1] - boff[base + i]);
+        }
+        if ((rc = apg_ring_wait(r)) != 0) {
+            for (int i = 0; i < m; i++) if (r->fds[i] >= 0) close(r->fds[i]);
+            return rc;
+        }
+        for (int i = 0; i < m; i++) {
+            if (r->fds[i] < 0) continue;
+            got[base + i] = r->res[i];
+            struct io_uring_sqe *sqe = apg_ring_sqe(r, i);
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = r->fds[i];
+        }
+        if ((rc = apg_ring_wait(r)) != 0) return rc;
+    }
+    return 0;
+}
+*/
+import "C"
+
+import (
+	"fmt"
+	"io/fs"
+	"syscall"
+	"unsafe"
+)
+
+// syscall.Stat_t is struct stat (see package syscall's types_linux.go), so
+// Lstat has the C code fill it in directly.
+var (
+	_ [unsafe.Sizeof(syscall.Stat_t{}) - unsafe.Sizeof(C.struct_stat{})]byte
+	_ [unsafe.Sizeof(C.struct_stat{}) - unsafe.Sizeof(syscall.Stat_t{})]byte
+)
+
+// Ring is an io_uring instance. It is not safe for concurrent use; give
+// each worker its own.
+type Ring struct {
+	r     *C.apg_ring
+	names []byte // paths of the current batch, NUL-terminated
+	off   []C.int
+}
+
+// New sets up a ring keeping up to depth requests in flight.
+func New(depth int) (*Ring, error) {
+	if disabled() {
+		return nil, ErrUnavailable
+	}
+	var errnum C.int
+	r := C.apg_ring_new(C.uint(depth), &errnum)
+	if r == nil {
+		return nil, fmt.Errorf("%w: %v", ErrUnavailable, syscall.Errno(errnum))
+	}
+	return &Ring{r: r}, nil
+}
+
+// Close releases the ring.
+func (r *Ring) Close() {
+	C.apg_ring_free(r.r)
+	r.r = nil
+}
+
+// pack copies paths into names and off.
+func (r *Ring) pack(paths []string) {
+	r.names, r.off = r.names[:0], r.off[:0]
+	for _, p := range paths {
+		r.off = append(r.off, C.int(len(r.names)))
+		r.names = append(append(r.names, p...), 0)
+	}
+}
+
+// fail closes the ring after an io_uring error.
+func (r *Ring) fail(rc C.int) error {
+	r.Close()
+	return fmt.Errorf("%w: %v", ErrFailed, syscall.Errno(-rc))
+}
+
+// Lstat stats paths without following symlinks, like os.Lstat, into st.
+// errs[i] is the error for paths[i], if any; err is set only if the ring
+// itself failed.
+func (r *Ring) Lstat(paths []string, st []syscall.Stat_t) (errs []error, err error) {
+	if r.r == nil {
+		return nil, ErrFailed
+	}
+	if len(paths) == 0 {
+		return nil, nil
+	}
+	r.pack(paths)
+	cerr := make([]C.int, len(paths))
+	if rc := C.apg_ring_lstat(r.r, (*C.char)(unsafe.Pointer(&r.names[0])), &r.off[0], C.int(len(paths)),
+		(*C.struct_stat)(unsafe.Pointer(&st[0])), &cerr[0]); rc != 0 {
+		return nil, r.fail(rc)
+	}
+	errs = make([]error, len(paths))
+	for i, e := range cerr {
+		if e != 0 {
+			errs[i] = &fs.PathError{Op: "lstat", Path: paths[i], Err: syscall.Errno(e)}
+		}
+	}
+	return errs, nil
+}
+
+// ReadFiles reads paths[i] from its start into buf[off[i]:off[i+1]]; off
+// has one more element than paths. got[i] is the number of bytes read,
+// which is short for a file smaller than its slot. errs and err are as for
+// Lstat.
+func (r *Ring) ReadFiles(paths []string, off []int64, buf []byte) (got []int64, errs []error, err error) {
+	if r.r == nil {
+		return nil, nil, ErrFailed
+	}
+	if len(paths) == 0 {
+		return nil, nil, nil
+	}
+	if len(off) != len(paths)+1 || off[len(paths)] > int64(len(buf)) {
+		return nil, nil, fmt.Errorf("uring: %d offsets for %d files in %d bytes", len(off), len(paths), len(buf))
+	}
+	r.pack(paths)
+	var base *C.char
+	if len(buf) > 0 {
+		base = (*C.char)(unsafe.Pointer(&buf[0]))
+	}
+	cgot := make([]C.longlong, len(paths))
+	if rc := C.apg_ring_read(r.r, (*C.char)(unsafe.Pointer(&r.names[0])), &r.off[0], C.int(len(paths)),
+		base, (*C.longlong)(unsafe.Pointer(&off[0])), &cgot[0]); rc != 0 {
+		return nil, nil, r.fail(rc)
+	}
+	got = make([]int64, len(paths))
+	errs = make([]error, len(paths))
+	for i, n := range cgot {
+		if n < 0 {
+			errs[i] = &fs.PathError{Op: "read", Path: paths[i], Err: syscall.Errno(-n)}
+			continue
+		}
+		got[i] = int64(n)
+	}
+	return got, errs, nil
+}
@@ -0,0 +1,24 @@
+//go:build !linux || !uring
+
+// Package uring — stand-in without the io_uring backend.
+// NurOS 2026 - GPL 3.0
+package uring
+
+import "syscall"
+
+// Ring is an io_uring instance; without the backend none can be set up.
+type Ring struct{}
+
+// New returns ErrUnavailable: the backend is not built in.
+func New(depth int) (*Ring, error) { return nil, ErrUnavailable }
+
+// Close releases the ring.
+func (r *Ring) Close() {}
+
+// Lstat returns ErrFailed.
+func (r *Ring) Lstat(paths []string, st []syscall.Stat_t) ([]error, error) { return nil, ErrFailed }
+
+// ReadFiles returns ErrFailed.
+func (r *Ring) ReadFiles(paths []string, off []int64, buf []byte) ([]int64, []error, error) {
+	return nil, nil, ErrFailed
+}
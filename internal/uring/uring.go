@@ -0,0 +1,62 @@
+// Package uring — batched lstat and file reads through io_uring.
+// Scanning and reading many small files costs a chain of synchronous
+// lstat/open/read/close calls each; a Ring queues a whole batch of them
+// and waits once, keeping the device busy at a deep queue depth.
+//
+// The backend is built in with the uring build tag on Linux (meson
+// -Dio_uring=true); everywhere else, and where the kernel refuses io_uring,
+// New returns ErrUnavailable and callers keep to plain system calls.
+// NurOS 2026 - GPL 3.0
+package uring
+
+import (
+	"errors"
+	"os"
+	"sync"
+)
+
+// DefaultDepth is the number of requests a Ring keeps in flight.
+const DefaultDepth = 128
+
+// Files of at most BatchFileSize bytes are read BatchFiles (and BatchBytes)
+// at a time with one ReadFiles call, instead of an open, read and close
+// each. Their slots hold a spare byte per file, which tells one that grew
+// since the scan; BatchBuffer is the size of a full batch.
+const (
+	BatchFileSize = 64 << 10
+	BatchFiles    = 256
+	BatchBytes    = 4 << 20
+	BatchBuffer   = BatchBytes + BatchFiles
+)
+
+// DisableEnv, set to 0, turns the backend off at run time.
+const DisableEnv = "APG_URING"
+
+// ErrUnavailable is returned by New when io_uring cannot be used.
+var ErrUnavailable = errors.New("io_uring unavailable")
+
+// ErrFailed is returned by a Ring whose io_uring failed as a whole rather
+// than for one file; the ring is closed and callers fall back.
+var ErrFailed = errors.New("io_uring failed")
+
+func disabled() bool { return os.Getenv(DisableEnv) == "0" }
+
+var available struct {
+	once sync.Once
+	ok   bool
+}
+
+// Available reports whether New can succeed: the backend is built in, not
+// disabled through DisableEnv, and the kernel supports the operations used.
+func Available() bool {
+	if disabled() {
+		return false
+	}
+	available.once.Do(func() {
+		if r, err := New(1); err == nil {
+			r.Close()
+			available.ok = true
+		}
+	})
+	return available.ok
+}
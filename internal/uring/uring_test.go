@@ -0,0 +1,86 @@
+package uring
+
+import (
+	"bytes"
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"syscall"
+	"testing"
+)
+
+func TestRing_LstatReadFiles(t *testing.T) {
+	r, err := New(4) // fewer entries than files: batches are split
+	if errors.Is(err, ErrUnavailable) {
+		t.Skip(err)
+	}
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer r.Close()
+
+	dir := t.TempDir()
+	var paths []string
+	var want [][]byte
+	for i := 0; i < 10; i++ {
+		p := filepath.Join(dir, fmt.Sprintf("f%d", i))
+		content := bytes.Repeat([]byte{byte('a' + i)}, i*1000)
+		if err := os.WriteFile(p, content, 0644); err != nil {
+			t.Fatal(err)
+		}
+		paths, want = append(paths, p), append(want, content)
+	}
+	if err := os.Symlink("f1", filepath.Join(dir, "link")); err != nil {
+		t.Fatal(err)
+	}
+	withLink := append(append([]string{}, paths...), filepath.Join(dir, "link"), filepath.Join(dir, "missing"))
+
+	st := make([]syscall.Stat_t, len(withLink))
+	errs, err := r.Lstat(withLink, st)
+	if err != nil {
+		t.Fatal(err)
+	}
+	for i, p := range withLink[:len(withLink)-1] {
+		var ref syscall.Stat_t
+		if err := syscall.Lstat(p, &ref); err != nil {
+			t.Fatal(err)
+		}
+		if errs[i] != nil || st[i].Ino != ref.Ino || st[i].Mode != ref.Mode || st[i].Size != ref.Size ||
+			st[i].Dev != ref.Dev || st[i].Mtim != ref.Mtim {
+			t.Errorf("%s: lstat %+v (%v), want %+v", p, st[i], errs[i], ref)
+		}
+	}
+	if !errors.Is(errs[len(withLink)-1], os.ErrNotExist) {
+		t.Errorf("missing file: %v, want ErrNotExist", errs[len(withLink)-1])
+	}
+
+	// One spare byte per slot tells a file that grew from one that did not.
+	off := []int64{0}
+	for _, c := range want {
+		off = append(off, off[len(off)-1]+int64(len(c))+1)
+	}
+	buf := make([]byte, off[len(off)-1])
+	got, errs, err := r.ReadFiles(paths, off, buf)
+	if err != nil {
+		t.Fatal(err)
+	}
+	for i := range paths {
+		if errs[i] != nil || !bytes.Equal(buf[off[i]:off[i]+got[i]], want[i]) {
+			t.Errorf("%s: read %d bytes (%v), want %d", paths[i], got[i], errs[i], len(want[i]))
+		}
+	}
+	if _, errs, _ := r.ReadFiles(withLink[len(withLink)-1:], []int64{0, 1}, buf); !errors.Is(errs[0], os.ErrNotExist) {
+		t.Errorf("missing file: %v, want ErrNotExist", errs[0])
+	}
+}
+
+func TestNew_Disabled(t *testing.T) {
+	t.Setenv(DisableEnv, "0")
+	if _, err := New(DefaultDepth); !errors.Is(err, ErrUnavailable) {
+		t.Errorf("New with %s=0: %v, want ErrUnavailable", DisableEnv, err)
+	}
+	if Available() {
+		t.Errorf("Available with %s=0", DisableEnv)
+	}
+}